@@ -62,7 +62,8 @@ basis_project (
       vtkCommonDataModel,
       vtkFiltersCore,
       vtkFiltersGeneral,
-      vtkImagingCore
+      vtkImagingCore,
+      vtkImagingStencil
     }"
     #<dependency>
   OPTIONAL_DEPENDS
@@ -0,0 +1,1162 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright 2013-2017 Imperial College London
+ * Copyright 2013-2017 Andreas Schuh
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "mirtk/Common.h"
+#include "mirtk/Options.h"
+
+#include "mirtk/NumericsConfig.h"
+#include "mirtk/DeformableConfig.h"
+
+#include "mirtk/Path.h"
+#include "mirtk/Array.h"
+#include "mirtk/Parallel.h"
+#include "mirtk/PointSetUtils.h"
+#include "mirtk/GenericImage.h"
+#include "mirtk/RegisteredImage.h"
+#include "mirtk/LocalBoxStatistics.h"
+
+#include "mirtk/DeformableSurfaceModel.h"
+#include "mirtk/ParallelSurfaceRemeshing.h"
+#include "mirtk/LocalOptimizer.h"
+#include "mirtk/EulerMethod.h"
+#include "mirtk/EulerMethodWithDamping.h"
+#include "mirtk/EulerMethodWithMomentum.h"
+#include "mirtk/SemiImplicitEulerMethod.h"
+#include "mirtk/AdaptiveRungeKuttaMethod.h"
+#include "mirtk/FastInertialRelaxationEngine.h"
+
+// External forces
+#include "mirtk/BalloonForce.h"
+#include "mirtk/ImageEdgeForce.h"
+#include "mirtk/ImageEdgeDistance.h"
+#include "mirtk/ImplicitSurfaceDistance.h"
+
+// Internal forces
+#include "mirtk/SpringForce.h"
+#include "mirtk/InflationForce.h"
+#include "mirtk/CurvatureConstraint.h"
+#include "mirtk/GaussCurvatureConstraint.h"
+#include "mirtk/MeanCurvatureConstraint.h"
+#include "mirtk/MaximumCurvatureConstraint.h"
+#include "mirtk/QuadraticCurvatureConstraint.h"
+#include "mirtk/MetricDistortion.h"
+#include "mirtk/StretchingForce.h"
+#include "mirtk/RepulsiveForce.h"
+#include "mirtk/NonSelfIntersectionConstraint.h"
+#include "mirtk/NormalForce.h"
+
+#include "SyntheticInputs.h"
+
+#include "vtkSmartPointer.h"
+#include "vtkPolyData.h"
+#include "vtkPoints.h"
+#include "vtkCellArray.h"
+#include "vtkPointData.h"
+#include "vtkUnsignedCharArray.h"
+#include "vtkFloatArray.h"
+#include "vtkDoubleArray.h"
+#include "vtkMath.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <functional>
+
+using namespace mirtk;
+
+
+// =============================================================================
+// Help
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+void PrintHelp(const char *name)
+{
+  cout << endl;
+  cout << "Usage: " << name << " <output> [options]" << endl;
+  cout << endl;
+  cout << "Description:" << endl;
+  cout << "  Measures the execution time of the deformable surface model operations using" << endl;
+  cout << "  procedurally generated input surfaces, distance maps and intensity images." << endl;
+  cout << "  No external data is required. The synthetic inputs are geodesic icospheres," << endl;
+  cout << "  ellipsoids, and folded (\"gyrified\") spheres with the specified number of" << endl;
+  cout << "  vertices, and the corresponding signed distance maps and intensity images." << endl;
+  cout << endl;
+  cout << "  For each input, the execution times of the Update, Gradient, and Evaluate" << endl;
+  cout << "  functions of each energy term, the sampling of the edge distance intensity" << endl;
+  cout << "  profiles per ray point and per ray, a step of each Euler integrator, the per-step" << endl;
+  cout << "  node state update with vtkDataArray accessors and raw buffers, the time" << endl;
+  cout << "  until convergence of the explicit and semi-implicit Euler methods, the" << endl;
+  cout << "  adaptive Runge-Kutta method, and damped dynamics with constant and adaptive" << endl;
+  cout << "  (FIRE) damping given a stiff spring force, a local adaptive remeshing, and a" << endl;
+  cout << "  model step with and without the resolution of surface collisions are" << endl;
+  cout << "  measured. A model step with and without low-pass filtering of closed and open" << endl;
+  cout << "  surfaces is compared to the filtering with vtkWindowedSincPolyDataFilter." << endl;
+  cout << "  The model gradient with only a small fraction of active nodes is" << endl;
+  cout << "  timed with and without active set evaluation. The initialization and update" << endl;
+  cout << "  of the metric distortion neighbor distances are timed with the compressed" << endl;
+  cout << "  sparse row layout and with one array per node. The update of several" << endl;
+  cout << "  curvature constraints is timed with a shared and with separate curvature" << endl;
+  cout << "  caches. For each shape, the local intensity statistics are computed with" << endl;
+  cout << "  running sums and by brute-force window summation. The correctness of these" << endl;
+  cout << "  operations is checked by the tests of the Deformable module, not by this" << endl;
+  cout << "  command. The number of threads is set using the common :option:`-threads`" << endl;
+  cout << "  option. Run this command multiple times with different number of threads to" << endl;
+  cout << "  measure the parallel scalability." << endl;
+  cout << endl;
+  cout << "Arguments:" << endl;
+  cout << "  output   Output file. Results are written in CSV format when the file name" << endl;
+  cout << "           extension is .csv, and in JSON format otherwise." << endl;
+  cout << endl;
+  cout << "Optional arguments:" << endl;
+  cout << "  -sizes <n>..." << endl;
+  cout << "      Approximate number of surface vertices. (default: 10000 100000 1000000)" << endl;
+  cout << "  -shapes <name>..." << endl;
+  cout << "      Names of synthetic shapes, i.e., sphere, ellipsoid, and/or gyrified. (default: all)" << endl;
+  cout << "  -radius <r>" << endl;
+  cout << "      Radius of synthetic shapes in mm. (default: 50)" << endl;
+  cout << "  -spacing <d>" << endl;
+  cout << "      Voxel size of synthetic images in mm. (default: 1)" << endl;
+  cout << "  -repeat <n>" << endl;
+  cout << "      Number of times each operation is timed. (default: 3)" << endl;
+  cout << "  -steps <n>" << endl;
+  cout << "      Number of integration steps per integrator run. (default: 5)" << endl;
+  cout << "  -active <ratio>" << endl;
+  cout << "      Ratio of active nodes used by active set benchmark. (default: 0.05)" << endl;
+  cout << "  -[no]terms, -[no]ray-profile, -[no]integrators, -[no]euler-state, -[no]remesh," << endl;
+  cout << "  -[no]collisions, -[no]lowpass, -[no]active-set, -[no]distortion, -[no]curvature," << endl;
+  cout << "  -[no]local-stats" << endl;
+  cout << "      Enable/disable groups of benchmarks. (default: on)" << endl;
+  PrintStandardOptions(cout);
+  cout << endl;
+}
+
+// =============================================================================
+// Measurements
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+/// Timing result of a benchmarked operation
+struct Measurement
+{
+  string shape;    ///< Name of synthetic input shape
+  int    points;   ///< Number of surface vertices
+  int    threads;  ///< Number of threads (0: default)
+  string group;    ///< Benchmark group, e.g., "term", "integrator"
+  string name;     ///< Name of benchmarked object, e.g., energy term name
+  string op;       ///< Benchmarked operation, e.g., "Update", "Gradient"
+  int    repeat;   ///< Number of timed executions
+  double min;      ///< Minimum wall clock time in ms
+  double mean;     ///< Mean wall clock time in ms
+  double max;      ///< Maximum wall clock time in ms
+};
+
+// -----------------------------------------------------------------------------
+/// Collection of benchmark results for a given input
+class Benchmark
+{
+  typedef std::chrono::steady_clock Clock;
+
+  Array<Measurement> &_Results;
+  string              _Shape;
+  int                 _Points;
+  int                 _Repeat;
+
+public:
+
+  Benchmark(Array<Measurement> &results, const string &shape, int npoints, int repeat)
+  :
+    _Results(results), _Shape(shape), _Points(npoints), _Repeat(max(1, repeat))
+  {}
+
+  /// Time operation, where setup is executed without timing before each run
+  ///
+  /// \param[in] group Benchmark group.
+  /// \param[in] name  Name of benchmarked object.
+  /// \param[in] op    Name of benchmarked operation.
+  /// \param[in] run   Benchmarked operation.
+  /// \param[in] setup Untimed preparation of each run of the operation.
+  /// \param[in] scale Factor by which measured times are divided, e.g.,
+  ///                  the number of steps performed by each run.
+  ///
+  /// \returns Timing result, which is also added to the collection.
+  Measurement Time(const string &group, const string &name, const string &op,
+            std::function<void()> run,
+            std::function<void()> setup = std::function<void()>(),
+            double scale = 1.0)
+  {
+    Measurement m;
+    m.shape   = _Shape;
+    m.points  = _Points;
+    m.threads = tbb_no_threads;
+    m.group   = group;
+    m.name    = name;
+    m.op      = op;
+    m.repeat  = _Repeat;
+    m.min     = +inf;
+    m.max     = -inf;
+    m.mean    = 0.;
+    for (int i = 0; i < _Repeat; ++i) {
+      if (setup) setup();
+      const auto start = Clock::now();
+      run();
+      const auto end = Clock::now();
+      const double t = std::chrono::duration<double, std::milli>(end - start).count() / scale;
+      m.min   = min(m.min, t);
+      m.max   = max(m.max, t);
+      m.mean += t;
+    }
+    m.mean /= _Repeat;
+    if (verbose > 0) {
+      cout << "  " << left << setw(12) << group << setw(32) << name << setw(10) << op
+           << right << fixed << setprecision(3) << setw(12) << m.mean << " ms" << endl;
+      cout.unsetf(ios::floatfield);
+    }
+    _Results.push_back(m);
+    return m;
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Write results in CSV format
+void WriteCSV(ostream &os, const Array<Measurement> &results)
+{
+  os << "shape,points,threads,group,name,operation,repeat,min_ms,mean_ms,max_ms\n";
+  for (const auto &m : results) {
+    os << m.shape << "," << m.points << "," << m.threads << ","
+       << m.group << ",\"" << m.name << "\"," << m.op << "," << m.repeat << ","
+       << m.min << "," << m.mean << "," << m.max << "\n";
+  }
+}
+
+// -----------------------------------------------------------------------------
+/// Write results in JSON format
+void WriteJSON(ostream &os, const Array<Measurement> &results)
+{
+  os << "{\n  \"results\": [";
+  for (size_t i = 0; i < results.size(); ++i) {
+    const Measurement &m = results[i];
+    if (i > 0) os << ",";
+    os << "\n    {";
+    os << "\"shape\": \""     << m.shape   << "\", ";
+    os << "\"points\": "      << m.points  << ", ";
+    os << "\"threads\": "     << m.threads << ", ";
+    os << "\"group\": \""     << m.group   << "\", ";
+    os << "\"name\": \""      << m.name    << "\", ";
+    os << "\"operation\": \"" << m.op      << "\", ";
+    os << "\"repeat\": "      << m.repeat  << ", ";
+    os << "\"min_ms\": "      << m.min     << ", ";
+    os << "\"mean_ms\": "     << m.mean    << ", ";
+    os << "\"max_ms\": "      << m.max     << "}";
+  }
+  os << "\n  ]\n}\n";
+}
+
+// =============================================================================
+// Benchmarks
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+/// Time Update, Gradient, and Evaluate of each energy term
+void BenchmarkEnergyTerms(Benchmark &benchmark, vtkPolyData *surface,
+                          RegisteredImage &image, RegisteredImage &dmap)
+{
+  const double h = AverageEdgeLength(surface);
+
+  BalloonForce                  balloon   ("Balloon force");
+  ImageEdgeForce                edges     ("Edge force");
+  ImageEdgeDistance             dedges    ("Edge distance");
+  ImplicitSurfaceDistance       distance  ("Distance");
+  NormalForce                   nforce    ("Normal force");
+  SpringForce                   spring    ("Bending");
+  InflationForce                inflation ("Inflation");
+  CurvatureConstraint           curvature ("Curvature");
+  GaussCurvatureConstraint      gcurvature("Gauss curvature");
+  MeanCurvatureConstraint       mcurvature("Mean curvature");
+  MaximumCurvatureConstraint    pcurvature("Maximum curvature");
+  QuadraticCurvatureConstraint  qcurvature("Quadratic fit");
+  MetricDistortion              distortion("Metric distortion");
+  StretchingForce               stretching("Stretching");
+  RepulsiveForce                repulsion ("Repulsion");
+  RepulsiveForce                grid      ("Repulsion (grid)");
+  NonSelfIntersectionConstraint collision ("Collision");
+
+  repulsion.FrontfaceRadius(h);
+  grid     .FrontfaceRadius(h);
+  grid     .NeighborSearch(RepulsiveForce::GridSearch);
+  collision.MinDistance(.5 * h);
+
+  DeformableSurfaceModel model;
+  model.Input(Copy(surface));
+  model.Image(&image);
+  model.ImplicitSurface(&dmap);
+  model.Add(&balloon,    false);
+  model.Add(&edges,      false);
+  model.Add(&dedges,     false);
+  model.Add(&distance,   false);
+  model.Add(&nforce,     false);
+  model.Add(&spring,     false);
+  model.Add(&inflation,  false);
+  model.Add(&curvature,  false);
+  model.Add(&gcurvature, false);
+  model.Add(&mcurvature, false);
+  model.Add(&pcurvature, false);
+  model.Add(&qcurvature, false);
+  model.Add(&distortion, false);
+  model.Add(&stretching, false);
+  model.Add(&repulsion,  false);
+  model.Add(&grid,       false);
+  model.Add(&collision,  false);
+  model.Initialize();
+  model.Update(true);
+
+  Array<double> gradient(model.NumberOfDOFs());
+  for (int i = 0; i < model.NumberOfTerms(); ++i) {
+    EnergyTerm * const term = model.Term(i);
+    const string name = term->Name();
+    benchmark.Time("term", name, "Update", [term]() {
+      term->Update(true);
+    });
+    benchmark.Time("term", name, "Gradient", [term, &gradient]() {
+      term->Gradient(gradient.data(), .0);
+    }, [&gradient]() {
+      std::fill(gradient.begin(), gradient.end(), 0.);
+    });
+    benchmark.Time("term", name, "Evaluate", [term]() {
+      term->Value();
+    }, [term]() {
+      term->ResetValue();
+    });
+  }
+}
+
+// -----------------------------------------------------------------------------
+/// Time sampling of image values and directional derivatives along the normal
+/// rays of the edge distance force, evaluating the interpolator at each ray
+/// point separately and all points of a ray in a single pass
+void BenchmarkRayProfiles(Benchmark &benchmark, vtkPolyData *surface, RealImage &input)
+{
+  typedef ImageEdgeDistance::DiscreteImage   DiscreteImage;
+  typedef ImageEdgeDistance::ContinuousImage ContinuousImage;
+
+  DiscreteImage image(input);
+  ContinuousImage func;
+  func.Input(&image);
+  func.Initialize();
+
+  // Rays along the radial directions with the default length and step of
+  // ImageEdgeDistance, i.e., 4 voxel diagonals and a quarter voxel diagonal
+  const int    n      = static_cast<int>(surface->GetNumberOfPoints());
+  const double res    = sqrt(pow(image.XSize(), 2) + pow(image.YSize(), 2) + pow(image.ZSize(), 2));
+  const double step   = .25 * res;
+  const int    radius = ifloor(4. * res / step);
+  const int    nsamples = 2 * radius + 1;
+
+  Array<Point>   origin(n);
+  Array<Vector3> dir(n);
+  for (int ptId = 0; ptId < n; ++ptId) {
+    Point p, q;
+    surface->GetPoint(ptId, p);
+    const double s = step / sqrt(p._x * p._x + p._y * p._y + p._z * p._z);
+    q._x = (1. + s) * p._x;
+    q._y = (1. + s) * p._y;
+    q._z = (1. + s) * p._z;
+    image.WorldToImage(p);
+    image.WorldToImage(q);
+    dir[ptId]    = Vector3(q._x - p._x, q._y - p._y, q._z - p._z);
+    origin[ptId] = p - double(radius) * dir[ptId];
+  }
+
+  const size_t size = static_cast<size_t>(n) * static_cast<size_t>(nsamples);
+  Array<double> f1(size), g1(size), f2(size), g2(size);
+  const blocked_range<int> ptIds(0, n);
+
+  benchmark.Time("ray-profile", "ContinuousImage", "PerSample", [&]() {
+    parallel_for(ptIds, [&](const blocked_range<int> &range) {
+      Matrix  jac(1, 3);
+      Point   q;
+      Vector3 d;
+      for (int ptId = range.begin(); ptId != range.end(); ++ptId) {
+        d = dir[ptId];
+        d.Normalize();
+        double * const f = f1.data() + static_cast<size_t>(ptId) * nsamples;
+        double * const g = g1.data() + static_cast<size_t>(ptId) * nsamples;
+        for (int s = 0; s < nsamples; ++s) {
+          q._x = origin[ptId]._x + s * dir[ptId]._x;
+          q._y = origin[ptId]._y + s * dir[ptId]._y;
+          q._z = origin[ptId]._z + s * dir[ptId]._z;
+          f[s] = func.Evaluate(q._x, q._y, q._z);
+          func.Jacobian3D(jac, q._x, q._y, q._z);
+          g[s] = d._x * jac(0, 0) + d._y * jac(0, 1) + d._z * jac(0, 2);
+        }
+      }
+    });
+  });
+  benchmark.Time("ray-profile", "ContinuousImage", "Batch", [&]() {
+    parallel_for(ptIds, [&](const blocked_range<int> &range) {
+      Matrix jac(1, 3);
+      for (int ptId = range.begin(); ptId != range.end(); ++ptId) {
+        double * const f = f2.data() + static_cast<size_t>(ptId) * nsamples;
+        double * const g = g2.data() + static_cast<size_t>(ptId) * nsamples;
+        ImageEdgeDistance::EvaluateRayProfile(f, g, &func, origin[ptId], dir[ptId], 0, nsamples, jac);
+      }
+    });
+  });
+
+  if (verbose > 0) {
+    double max_diff = 0.;
+    for (size_t i = 0; i < size; ++i) {
+      max_diff = max(max_diff, abs(f1[i] - f2[i]));
+      max_diff = max(max_diff, abs(g1[i] - g2[i]));
+    }
+    cout << "  " << left << setw(12) << "ray-profile" << setw(32) << "ContinuousImage"
+         << "no. of samples = " << size << ", max. difference = " << max_diff << endl;
+  }
+}
+
+// -----------------------------------------------------------------------------
+/// Initialize deformable surface model used for integrator and remeshing benchmarks
+void InitializeModel(DeformableSurfaceModel &model, vtkPolyData *surface,
+                     RegisteredImage &dmap, ImplicitSurfaceDistance &distance,
+                     CurvatureConstraint &curvature)
+{
+  model.Clear();
+  model.Input(Copy(surface));
+  model.ImplicitSurface(&dmap);
+  model.Add(&distance,  false);
+  model.Add(&curvature, false);
+  model.Initialize();
+}
+
+// -----------------------------------------------------------------------------
+/// Time integration steps of each Euler method
+void BenchmarkIntegrators(Benchmark &benchmark, vtkPolyData *surface,
+                          RegisteredImage &dmap, int nsteps)
+{
+  ImplicitSurfaceDistance distance ("Distance",  1.0);
+  CurvatureConstraint     curvature("Curvature", .5);
+  DeformableSurfaceModel  model;
+
+  UniquePtr<LocalOptimizer> optimizers[6];
+  optimizers[0].reset(new EulerMethod());
+  optimizers[1].reset(new EulerMethodWithMomentum());
+  optimizers[2].reset(new EulerMethodWithDamping());
+  optimizers[3].reset(new SemiImplicitEulerMethod());
+  optimizers[4].reset(new AdaptiveRungeKuttaMethod());
+  optimizers[5].reset(new FastInertialRelaxationEngine());
+
+  for (auto &optimizer : optimizers) {
+    optimizer->Function(&model);
+    optimizer->NumberOfSteps(nsteps);
+    optimizer->Delta(0.);
+    optimizer->Set("Epsilon", "0");
+    benchmark.Time("integrator", optimizer->NameOfClass(), "Step", [&optimizer]() {
+      optimizer->Run();
+    }, [&]() {
+      InitializeModel(model, surface, dmap, distance, curvature);
+    }, static_cast<double>(nsteps));
+  }
+}
+
+// -----------------------------------------------------------------------------
+/// Time per-iteration node state update of the Euler methods, i.e., computation
+/// of node displacements from the gradient, clamping of their magnitudes, and
+/// accumulation of normal displacements, using virtual vtkDataArray tuple
+/// accessors per node as done previously and raw contiguous double buffers
+void BenchmarkIntegratorState(Benchmark &benchmark, vtkPolyData *surface)
+{
+  const int    n       = static_cast<int>(surface->GetNumberOfPoints());
+  const double h       = AverageEdgeLength(surface);
+  const double s       = -.5 * h;
+  const double max_dx2 = .25 * h * h;
+
+  Array<double> gradient(3 * n);
+  vtkSmartPointer<vtkDoubleArray> displacement = vtkSmartPointer<vtkDoubleArray>::New();
+  vtkSmartPointer<vtkFloatArray>  normals      = vtkSmartPointer<vtkFloatArray>::New();
+  vtkSmartPointer<vtkFloatArray>  tracked      = vtkSmartPointer<vtkFloatArray>::New();
+  displacement->SetNumberOfComponents(3);
+  displacement->SetNumberOfTuples(n);
+  normals->SetNumberOfComponents(3);
+  normals->SetNumberOfTuples(n);
+  tracked->SetNumberOfComponents(1);
+  tracked->SetNumberOfTuples(n);
+
+  double p[3], r;
+  for (int ptId = 0; ptId < n; ++ptId) {
+    surface->GetPoint(ptId, p);
+    r = sqrt(p[0]*p[0] + p[1]*p[1] + p[2]*p[2]);
+    for (int d = 0; d < 3; ++d) {
+      normals->SetComponent(ptId, d, p[d] / r);
+      gradient[3 * ptId + d] = ((ptId + d) % 7 - 3) * p[d] / r;
+    }
+  }
+  const blocked_range<int> ptIds(0, n);
+  auto reset = [&]() { tracked->FillComponent(0, 0.); };
+
+  benchmark.Time("euler-state", "vtkDataArray", "Update", [&]() {
+    parallel_for(ptIds, [&](const blocked_range<int> &range) {
+      double d[3];
+      const double *g = gradient.data() + 3 * range.begin();
+      for (int ptId = range.begin(); ptId != range.end(); ++ptId, g += 3) {
+        d[0] = s * g[0], d[1] = s * g[1], d[2] = s * g[2];
+        displacement->SetTuple(ptId, d);
+      }
+    });
+    parallel_for(ptIds, [&](const blocked_range<int> &range) {
+      double norm, d[3];
+      for (int ptId = range.begin(); ptId != range.end(); ++ptId) {
+        displacement->GetTuple(ptId, d);
+        norm = d[0]*d[0] + d[1]*d[1] + d[2]*d[2];
+        if (norm > max_dx2) {
+          norm = sqrt(max_dx2 / norm);
+          d[0] *= norm, d[1] *= norm, d[2] *= norm;
+          displacement->SetTuple(ptId, d);
+        }
+      }
+    });
+    double m, nrm[3], d[3];
+    for (int ptId = 0; ptId < n; ++ptId) {
+      normals->GetTuple(ptId, nrm);
+      displacement->GetTuple(ptId, d);
+      m  = tracked->GetComponent(ptId, 0);
+      m += d[0]*nrm[0] + d[1]*nrm[1] + d[2]*nrm[2];
+      tracked->SetComponent(ptId, 0, m);
+    }
+  }, reset);
+  Array<float> before(tracked->GetPointer(0), tracked->GetPointer(0) + n);
+
+  benchmark.Time("euler-state", "raw pointer", "Update", [&]() {
+    const double *g   = gradient.data();
+    double       *dx  = displacement->GetPointer(0);
+    const float  *nrm = normals->GetPointer(0);
+    float        *v   = tracked->GetPointer(0);
+    parallel_for(ptIds, [&](const blocked_range<int> &range) {
+      const int end = 3 * range.end();
+      for (int i = 3 * range.begin(); i < end; ++i) dx[i] = s * g[i];
+    });
+    parallel_for(ptIds, [&](const blocked_range<int> &range) {
+      double norm, *d = dx + 3 * range.begin();
+      for (int ptId = range.begin(); ptId != range.end(); ++ptId, d += 3) {
+        norm = d[0]*d[0] + d[1]*d[1] + d[2]*d[2];
+        if (norm > max_dx2) {
+          norm = sqrt(max_dx2 / norm);
+          d[0] *= norm, d[1] *= norm, d[2] *= norm;
+        }
+      }
+    });
+    parallel_for(ptIds, [&](const blocked_range<int> &range) {
+      const double *d = dx  + 3 * range.begin();
+      const float  *m = nrm + 3 * range.begin();
+      for (int ptId = range.begin(); ptId != range.end(); ++ptId, d += 3, m += 3) {
+        v[ptId] += static_cast<float>(d[0]*m[0] + d[1]*m[1] + d[2]*m[2]);
+      }
+    });
+  }, reset);
+
+  if (verbose > 0) {
+    double max_diff = 0.;
+    for (int ptId = 0; ptId < n; ++ptId) {
+      max_diff = max(max_diff, abs(static_cast<double>(tracked->GetValue(ptId) - before[ptId])));
+    }
+    cout << "  " << left << setw(12) << "euler-state" << setw(32) << "raw pointer"
+         << "max. normal displacement difference = " << max_diff << endl;
+  }
+}
+
+// -----------------------------------------------------------------------------
+/// Time integration until convergence with a stiff spring force, where the
+/// semi-implicit Euler method permits a larger step length than forward Euler
+/// and the adaptive Runge-Kutta method chooses its time step automatically,
+/// as well as damped dynamics with a constant and adaptive (FIRE) damping
+///
+/// In verbose mode, the final energy and the time until convergence of each
+/// method are compared to those of the forward Euler method.
+void BenchmarkStiffIntegration(Benchmark &benchmark, vtkPolyData *surface,
+                               RegisteredImage &dmap)
+{
+  ImplicitSurfaceDistance distance ("Distance",  1.0);
+  CurvatureConstraint     curvature("Curvature", .5);
+  SpringForce             spring   ("Spring",    10.);
+  DeformableSurfaceModel  model;
+
+  UniquePtr<EulerMethod> optimizers[5];
+  optimizers[0].reset(new EulerMethod());
+  optimizers[0]->StepLength(.1);
+  optimizers[1].reset(new SemiImplicitEulerMethod());
+  optimizers[1]->StepLength(1.);
+  optimizers[1]->Set("Implicit smoothing", "2");
+  optimizers[2].reset(new AdaptiveRungeKuttaMethod());
+  optimizers[2]->StepLength(1.);
+  optimizers[3].reset(new EulerMethodWithDamping());
+  optimizers[3]->StepLength(.1);
+  optimizers[4].reset(new FastInertialRelaxationEngine());
+  optimizers[4]->StepLength(.1);
+
+  const double h = AverageEdgeLength(surface);
+  double euler_value = 0., euler_time = 0.;
+  for (auto &optimizer : optimizers) {
+    double value = 0.;
+    optimizer->Function(&model);
+    optimizer->NumberOfSteps(1000);
+    optimizer->Delta(1e-3 * h);
+    const Measurement m = benchmark.Time("integrator", optimizer->NameOfClass(), "Converge", [&]() {
+      value = optimizer->Run();
+    }, [&]() {
+      model.Clear();
+      model.Input(Copy(surface));
+      model.ImplicitSurface(&dmap);
+      model.Add(&distance,  false);
+      model.Add(&curvature, false);
+      model.Add(&spring,    false);
+      model.Initialize();
+    });
+    if (optimizer == optimizers[0]) {
+      euler_value = value;
+      euler_time  = m.mean;
+    }
+    if (verbose > 0) {
+      cout << "  " << left << setw(12) << "integrator" << setw(32) << optimizer->NameOfClass()
+           << "no. of steps = " << optimizer->StepCount() << ", energy = " << value;
+      if (optimizer != optimizers[0]) {
+        cout << ", rel. energy difference = " << (value - euler_value) / max(abs(euler_value), 1e-12)
+             << ", speedup = " << euler_time / m.mean;
+      }
+      const auto rk = dynamic_cast<const AdaptiveRungeKuttaMethod *>(optimizer.get());
+      if (rk) {
+        cout << ", no. of rejected steps = " << rk->NumberOfRejectedSteps()
+             << ", no. of gradient evaluations = " << rk->NumberOfGradientEvaluations();
+      }
+      const auto fire = dynamic_cast<const FastInertialRelaxationEngine *>(optimizer.get());
+      if (fire) {
+        cout << ", no. of restarts = " << fire->NumberOfRestarts();
+      }
+      cout << endl;
+    }
+  }
+}
+
+// -----------------------------------------------------------------------------
+/// Time local adaptive remeshing with SurfaceRemeshing and ParallelSurfaceRemeshing
+void BenchmarkRemeshing(Benchmark &benchmark, vtkPolyData *surface, RegisteredImage &dmap)
+{
+  ImplicitSurfaceDistance distance ("Distance",  1.0);
+  CurvatureConstraint     curvature("Curvature", .5);
+  DeformableSurfaceModel  model;
+
+  // Coarsen mesh to exercise edge collapses, splits, and flips
+  const double h = AverageEdgeLength(surface);
+  model.MinEdgeLength(1.1 * h);
+  model.MaxEdgeLength(2.5 * h);
+  model.RemeshInterval(1);
+
+  for (int parallel = 0; parallel <= 1; ++parallel) {
+    model.ParallelRemeshing(parallel != 0);
+    benchmark.Time("remesh", "DeformableSurfaceModel", parallel ? "ParallelRemesh" : "Remesh", [&model]() {
+      model.Remesh();
+    }, [&]() {
+      InitializeModel(model, surface, dmap, distance, curvature);
+    });
+  }
+
+  if (verbose > 0) {
+    ParallelSurfaceRemeshing remesher;
+    remesher.Input(Copy(surface));
+    remesher.MinEdgeLength(1.1 * h);
+    remesher.MaxEdgeLength(2.5 * h);
+    remesher.Run();
+    cout << "  " << left << setw(12) << "remesh" << setw(32) << "ParallelSurfaceRemeshing"
+         << "no. of collapses = " << remesher.NumberOfCollapses()
+         << ", no. of splits = " << remesher.NumberOfSplits()
+         << ", no. of rounds = " << remesher.NumberOfRounds() << endl;
+  }
+}
+
+// -----------------------------------------------------------------------------
+/// Time model step with and without resolution of surface collisions
+void BenchmarkCollisions(Benchmark &benchmark, vtkPolyData *surface, RegisteredImage &dmap)
+{
+  ImplicitSurfaceDistance distance ("Distance",  1.0);
+  CurvatureConstraint     curvature("Curvature", .5);
+  DeformableSurfaceModel  model;
+
+  const double h = AverageEdgeLength(surface);
+
+  // Displace nodes towards center by a fraction of the edge length
+  Array<double> dx(3 * surface->GetNumberOfPoints());
+  Array<double> step(dx.size());
+  double p[3], r;
+  for (vtkIdType ptId = 0; ptId < surface->GetNumberOfPoints(); ++ptId) {
+    surface->GetPoint(ptId, p);
+    r = sqrt(p[0]*p[0] + p[1]*p[1] + p[2]*p[2]);
+    for (int d = 0; d < 3; ++d) dx[3 * ptId + d] = -.3 * h * p[d] / r;
+  }
+
+  // Step modifies the displacements in-place, so each repetition starts from a
+  // copy of dx. Non-zero minimum face distances enable collision resolution.
+  for (int nsi = 0; nsi <= 1; ++nsi) {
+    model.HardNonSelfIntersection(nsi != 0);
+    model.MinFrontfaceDistance(nsi ? .5 * h : 0.);
+    model.MinBackfaceDistance (nsi ? .5 * h : 0.);
+    benchmark.Time("collision", "DeformableSurfaceModel",
+                   nsi ? "Step+ResolveSurfaceCollisions" : "Step", [&]() {
+      model.Step(step.data());
+    }, [&]() {
+      InitializeModel(model, surface, dmap, distance, curvature);
+      model.Update(true);
+      step = dx;
+    });
+  }
+}
+
+// -----------------------------------------------------------------------------
+/// Time model step with and without low-pass filtering, and the low-pass
+/// filtering with vtkWindowedSincPolyDataFilter as done previously, of the
+/// closed surface and an open surface with the top quarter of it removed
+void BenchmarkLowPass(Benchmark &benchmark, vtkPolyData *closed, RegisteredImage &dmap)
+{
+  const int    niter    = 100;
+  const double passband = .75;
+
+  double bounds[6];
+  closed->GetBounds(bounds);
+  vtkSmartPointer<vtkPolyData> open = CutSurface(closed, bounds[4] + .75 * (bounds[5] - bounds[4]));
+
+  ImplicitSurfaceDistance distance("Distance", 1.0);
+  DeformableSurfaceModel  model;
+  model.LowPassIterations(niter);
+  model.LowPassBand(passband);
+
+  for (int is_open = 0; is_open <= 1; ++is_open) {
+    vtkPolyData * const surface = (is_open ? open.GetPointer() : closed);
+    const string        name    = string("DeformableSurfaceModel (") + (is_open ? "open" : "closed") + ")";
+    const int           n       = static_cast<int>(surface->GetNumberOfPoints());
+    const double        h       = AverageEdgeLength(surface);
+
+    // Oscillating radial displacements to be smoothed
+    Array<double> dx(3 * n), step(dx.size());
+    double p[3], r;
+    for (int ptId = 0; ptId < n; ++ptId) {
+      surface->GetPoint(ptId, p);
+      r = sqrt(p[0]*p[0] + p[1]*p[1] + p[2]*p[2]);
+      for (int d = 0; d < 3; ++d) {
+        dx[3 * ptId + d] = .2 * h * sin(7. * p[0] / r) * cos(5. * p[1] / r) * p[d] / r;
+      }
+    }
+
+    // Step modifies the displacements in-place, so each repetition starts from a copy of dx
+    for (int lowpass = 0; lowpass <= 1; ++lowpass) {
+      model.LowPassInterval(lowpass);
+      benchmark.Time("lowpass", name, lowpass ? "Step+LowPass" : "Step", [&]() {
+        model.Step(step.data());
+      }, [&]() {
+        model.Clear();
+        model.Input(Copy(surface));
+        model.ImplicitSurface(&dmap);
+        model.Add(&distance, false);
+        model.Initialize();
+        step = dx;
+      });
+    }
+    Array<double> expected(dx.size());
+    benchmark.Time("lowpass", name, "vtkWindowedSinc", [&]() {
+      WindowedSincLowPass(surface, expected.data(), niter, passband);
+    }, [&]() {
+      expected = dx;
+    });
+
+    // Compare nodes moved by last step with low-pass filtering to reference
+    if (verbose > 0) {
+      vtkPointSet * const output = model.Output();
+      double q[3], max_dist = 0.;
+      for (int ptId = 0; ptId < n; ++ptId) {
+        surface->GetPoint(ptId, p);
+        output ->GetPoint(ptId, q);
+        for (int d = 0; d < 3; ++d) p[d] += expected[3 * ptId + d];
+        max_dist = max(max_dist, sqrt(vtkMath::Distance2BetweenPoints(p, q)));
+      }
+      cout << "  " << left << setw(12) << "lowpass" << setw(32) << name
+           << "max. distance to vtkWindowedSincPolyDataFilter result = " << max_dist
+           << " (" << max_dist / h << " x avg. edge length)" << endl;
+    }
+  }
+}
+
+// -----------------------------------------------------------------------------
+/// Time model gradient with and without active set evaluation
+void BenchmarkActiveSet(Benchmark &benchmark, vtkPolyData *surface,
+                        RegisteredImage &dmap, double ratio)
+{
+  const double h = AverageEdgeLength(surface);
+
+  ImplicitSurfaceDistance distance  ("Distance",  1.0);
+  CurvatureConstraint     curvature ("Curvature", .5);
+  SpringForce             spring    ("Bending",   .5);
+  MetricDistortion        distortion("Metric distortion", .1);
+  RepulsiveForce          repulsion ("Repulsion", .1);
+  DeformableSurfaceModel  model;
+
+  repulsion.FrontfaceRadius(h);
+
+  model.Input(Copy(surface));
+  model.ImplicitSurface(&dmap);
+  model.Add(&distance,   false);
+  model.Add(&curvature,  false);
+  model.Add(&spring,     false);
+  model.Add(&distortion, false);
+  model.Add(&repulsion,  false);
+  model.Initialize();
+
+  // Mark nodes in a cap of the surface as active and all other nodes as passive
+  vtkPointSet * const output  = model.Output();
+  const int           npoints = static_cast<int>(output->GetNumberOfPoints());
+  MarkActiveCap(output, ratio);
+  model.Update(true);
+
+  const string name = "DeformableSurfaceModel (" + ToString(100. * ratio) + "% active)";
+  Array<double> full(model.NumberOfDOFs());
+  Array<double> part(model.NumberOfDOFs());
+  model.ActiveSet(false);
+  const Measurement t_full = benchmark.Time("active-set", name, "Gradient", [&]() {
+    model.Gradient(full.data());
+  });
+  model.ActiveSet(true);
+  const Measurement t_part = benchmark.Time("active-set", name, "Gradient+ActiveSet", [&]() {
+    model.Gradient(part.data());
+  });
+
+  double max_diff = 0.;
+  for (size_t i = 0; i < full.size(); ++i) {
+    max_diff = max(max_diff, abs(full[i] - part[i]));
+  }
+  if (verbose > 0) {
+    cout << "  " << left << setw(12) << "active-set" << setw(32) << name
+         << "no. of evaluated nodes = " << model.ActivePoints().size() << " / " << npoints
+         << ", max. gradient difference = " << max_diff
+         << ", speedup = " << t_full.mean / t_part.mean << endl;
+  }
+}
+
+// -----------------------------------------------------------------------------
+/// Time initialization and update of the metric distortion neighbor distances
+/// stored in compressed sparse row format, and of the previous layout with one
+/// heap array of distances per node whose neighbors are looked up in each pass
+void BenchmarkMetricDistortion(Benchmark &benchmark, vtkPolyData *surface,
+                               RegisteredImage &dmap)
+{
+  typedef MetricDistortion::NodeDistances   NodeDistances;
+  typedef RegisteredPointSet::NodeNeighbors NodeNeighbors;
+
+  ImplicitSurfaceDistance distance  ("Distance", 1.0);
+  MetricDistortion        distortion("Metric distortion", .1);
+  DeformableSurfaceModel  model;
+
+  model.Input(Copy(surface));
+  model.ImplicitSurface(&dmap);
+  model.Add(&distance,   false);
+  model.Add(&distortion, false);
+  model.Initialize();
+  model.Update(true);
+
+  const int            n         = static_cast<int>(surface->GetNumberOfPoints());
+  const NodeNeighbors *neighbors = model.PointSet().SurfaceNeighbors(distortion.Radius());
+  vtkPoints * const    points    = model.PointSet().SurfacePoints();
+  const int            radius    = distortion.Radius();
+
+  // Previous layout, where Init resized the distances array of each node
+  Array<Array<NodeDistances> > nested;
+  benchmark.Time("distortion", "MetricDistortion (nested arrays)", "Init", [&]() {
+    nested.resize(n);
+    parallel_for(blocked_range<int>(0, n), [&](const blocked_range<int> &ptIds) {
+      int        numNbrPts;
+      const int *nbrPtIds;
+      double     c[3], p[3];
+      for (int ptId = ptIds.begin(); ptId != ptIds.end(); ++ptId) {
+        surface->GetPoint(ptId, c);
+        neighbors->GetConnectedPoints(ptId, numNbrPts, nbrPtIds, radius);
+        Array<NodeDistances> &dists = nested[ptId];
+        dists.resize(numNbrPts);
+        for (int i = 0; i < numNbrPts; ++i) {
+          surface->GetPoint(nbrPtIds[i], p);
+          dists[i]._Distance0 = sqrt(vtkMath::Distance2BetweenPoints(c, p));
+        }
+      }
+    });
+    Area(surface);
+  }, [&]() {
+    Array<Array<NodeDistances> >().swap(nested);
+  });
+  benchmark.Time("distortion", "MetricDistortion (nested arrays)", "Update", [&]() {
+    parallel_for(blocked_range<int>(0, n), [&](const blocked_range<int> &ptIds) {
+      int        numNbrPts;
+      const int *nbrPtIds;
+      double     c[3], p[3];
+      for (int ptId = ptIds.begin(); ptId != ptIds.end(); ++ptId) {
+        points->GetPoint(ptId, c);
+        neighbors->GetConnectedPoints(ptId, numNbrPts, nbrPtIds, radius);
+        Array<NodeDistances> &dists = nested[ptId];
+        for (int i = 0; i < numNbrPts; ++i) {
+          points->GetPoint(nbrPtIds[i], p);
+          dists[i]._Distance = sqrt(vtkMath::Distance2BetweenPoints(c, p));
+        }
+      }
+    });
+  });
+
+  // Current layout, timed through the energy term itself which also
+  // reinitializes its base class as done after each remeshing and which
+  // reuses the capacity of its three arrays
+  Array<double> gradient(model.NumberOfDOFs());
+  benchmark.Time("distortion", "MetricDistortion (CSR)", "Init", [&]() {
+    distortion.Reinitialize();
+  });
+  benchmark.Time("distortion", "MetricDistortion (CSR)", "Update", [&]() {
+    distortion.Update(true);
+  });
+  benchmark.Time("distortion", "MetricDistortion (CSR)", "Gradient", [&]() {
+    distortion.Gradient(gradient.data(), .0);
+  }, [&gradient]() {
+    std::fill(gradient.begin(), gradient.end(), 0.);
+  });
+
+  if (verbose > 0) {
+    // Heap memory of the distances, where the previous layout did not copy
+    // the neighbor indices, but allocated one array per node
+    size_t nested_bytes = nested.capacity() * sizeof(Array<NodeDistances>);
+    for (const auto &dists : nested) {
+      nested_bytes += dists.capacity() * sizeof(NodeDistances);
+    }
+    const size_t csr_bytes = distortion.NeighborOffsets().capacity() * sizeof(int)
+                           + distortion.NeighborIds().capacity() * sizeof(int)
+                           + distortion.Distances().capacity() * sizeof(NodeDistances);
+    cout << "  " << left << setw(12) << "distortion" << setw(32) << "MetricDistortion"
+         << "no. of entries = " << distortion.Distances().size()
+         << ", nested arrays = " << nested_bytes / 1024 << " kB in " << (nested.size() + 1) << " allocations"
+         << ", CSR = " << csr_bytes / 1024 << " kB in 3 allocations" << endl;
+  }
+}
+
+// -----------------------------------------------------------------------------
+/// Time update of multiple curvature constraints after the surface deformed,
+/// where these share the curvature cache of the model or each computes and
+/// smoothes the surface curvatures on its own
+void BenchmarkCurvatureCache(Benchmark &benchmark, vtkPolyData *surface,
+                             RegisteredImage &dmap)
+{
+  ImplicitSurfaceDistance    distance  ("Distance", 1.0);
+  CurvatureConstraint        curvature ("Curvature");
+  GaussCurvatureConstraint   gcurvature("Gauss curvature");
+  MeanCurvatureConstraint    mcurvature("Mean curvature");
+  MaximumCurvatureConstraint pcurvature("Maximum curvature");
+  DeformableSurfaceModel     model;
+
+  model.Input(Copy(surface));
+  model.ImplicitSurface(&dmap);
+  model.Add(&distance,   false);
+  model.Add(&curvature,  false);
+  model.Add(&gcurvature, false);
+  model.Add(&mcurvature, false);
+  model.Add(&pcurvature, false);
+  model.Initialize();
+  model.Update(true);
+
+  SurfaceConstraint * const terms[] = { &curvature, &gcurvature, &mcurvature, &pcurvature };
+  vtkPoints * const points = model.PointSet().SurfacePoints();
+
+  Array<double> gradient[2];
+  for (int shared = 1; shared >= 0; --shared) {
+    if (!shared) {
+      for (auto term : terms) {
+        term->SharedCurvatureCache(nullptr);
+        term->Initialize();
+      }
+    }
+    const string name = string("Curvature constraints (") + (shared ? "shared" : "separate") + " cache)";
+    benchmark.Time("curvature", name, "Update", [&]() {
+      for (auto term : terms) term->Update(true);
+    }, [points]() {
+      points->Modified();
+    });
+    Array<double> &g = gradient[shared];
+    g.resize(model.NumberOfDOFs(), 0.);
+    for (auto term : terms) term->Gradient(g.data(), .0);
+  }
+
+  if (verbose > 0) {
+    double max_diff = 0.;
+    for (size_t i = 0; i < gradient[0].size(); ++i) {
+      max_diff = max(max_diff, abs(gradient[0][i] - gradient[1][i]));
+    }
+    cout << "  " << left << setw(12) << "curvature" << setw(32) << "Curvature constraints"
+         << "no. of terms = " << sizeof(terms) / sizeof(terms[0])
+         << ", max. gradient difference = " << max_diff << endl;
+  }
+}
+
+// -----------------------------------------------------------------------------
+/// Time local window statistics computed with running sums and brute-force window sums
+void BenchmarkLocalStatistics(Benchmark &benchmark, RealImage &image)
+{
+  const int width = 7;
+  BinaryImage mask(image.Attributes());
+  for (int idx = 0; idx < image.NumberOfVoxels(); ++idx) {
+    mask(idx) = static_cast<BinaryPixel>(image(idx) > 60.f);
+  }
+  LocalBoxStatistics sums(width / 2);
+  benchmark.Time("local-stats", "LocalBoxStatistics", "Compute", [&]() {
+    sums.Compute(&image, &mask);
+  });
+  benchmark.Time("local-stats", "LocalBoxStatistics", "BruteForce", [&]() {
+    sums.ComputeBruteForce(&image, &mask);
+  });
+}
+
+// =============================================================================
+// Main
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+  verbose = 1;
+  EXPECTS_POSARGS(1);
+
+  InitializeNumericsLibrary();
+  InitializeDeformableLibrary();
+
+  const char *output_name = POSARG(1);
+
+  Array<int>            sizes;
+  Array<SyntheticShape> shapes;
+  double radius       = 50.;
+  double spacing      = 1.;
+  int    repeat       = 3;
+  int    nsteps       = 5;
+  double active_ratio = .05;
+  bool   terms        = true;
+  bool   ray_profile  = true;
+  bool   integrators  = true;
+  bool   euler_state  = true;
+  bool   remesh       = true;
+  bool   collisions   = true;
+  bool   lowpass      = true;
+  bool   active_set   = true;
+  bool   distortion   = true;
+  bool   curvature    = true;
+  bool   local_stats  = true;
+
+  for (ALL_OPTIONS) {
+    if (OPTION("-sizes")) {
+      do {
+        int n;
+        PARSE_ARGUMENT(n);
+        sizes.push_back(n);
+      } while (HAS_ARGUMENT);
+    }
+    else if (OPTION("-shapes")) {
+      do {
+        SyntheticShape shape;
+        PARSE_ARGUMENT(shape);
+        shapes.push_back(shape);
+      } while (HAS_ARGUMENT);
+    }
+    else if (OPTION("-radius"))  PARSE_ARGUMENT(radius);
+    else if (OPTION("-spacing")) PARSE_ARGUMENT(spacing);
+    else if (OPTION("-repeat"))  PARSE_ARGUMENT(repeat);
+    else if (OPTION("-steps"))   PARSE_ARGUMENT(nsteps);
+    else if (OPTION("-active"))  PARSE_ARGUMENT(active_ratio);
+    else HANDLE_BOOLEAN_OPTION("terms",       terms);
+    else HANDLE_BOOLEAN_OPTION("ray-profile", ray_profile);
+    else HANDLE_BOOLEAN_OPTION("integrators", integrators);
+    else HANDLE_BOOLEAN_OPTION("euler-state", euler_state);
+    else HANDLE_BOOLEAN_OPTION("remesh",      remesh);
+    else HANDLE_BOOLEAN_OPTION("collisions",  collisions);
+    else HANDLE_BOOLEAN_OPTION("lowpass",     lowpass);
+    else HANDLE_BOOLEAN_OPTION("active-set",  active_set);
+    else HANDLE_BOOLEAN_OPTION("distortion",  distortion);
+    else HANDLE_BOOLEAN_OPTION("curvature",   curvature);
+    else HANDLE_BOOLEAN_OPTION("local-stats", local_stats);
+    else HANDLE_STANDARD_OR_UNKNOWN_OPTION();
+  }
+
+  if (sizes.empty()) {
+    sizes.push_back(10000);
+    sizes.push_back(100000);
+    sizes.push_back(1000000);
+  }
+  if (shapes.empty()) {
+    shapes.push_back(SS_Sphere);
+    shapes.push_back(SS_Ellipsoid);
+    shapes.push_back(SS_Gyrified);
+  }
+
+  Array<Measurement> results;
+
+  for (auto shape_type : shapes) {
+    ImplicitShape shape;
+    shape._Shape  = shape_type;
+    shape._Radius = radius;
+
+    RealImage input_image, input_dmap;
+    SyntheticImages(shape, spacing, input_dmap, input_image);
+
+    RegisteredImage image, dmap;
+    InitializeRegisteredImage(image, input_image);
+    InitializeRegisteredImage(dmap,  input_dmap);
+
+    if (local_stats) {
+      if (verbose > 0) {
+        cout << "\nShape = " << ToString(shape_type) << ", image size = " << input_image.NumberOfVoxels() << "\n" << endl;
+      }
+      Benchmark benchmark(results, ToString(shape_type), 0, repeat);
+      BenchmarkLocalStatistics(benchmark, input_image);
+    }
+
+    for (auto size : sizes) {
+      vtkSmartPointer<vtkPolyData> surface = SyntheticSurface(shape, size);
+      const int npoints = static_cast<int>(surface->GetNumberOfPoints());
+      if (verbose > 0) {
+        cout << "\nShape = " << ToString(shape_type) << ", no. of points = " << npoints << "\n" << endl;
+      }
+      Benchmark benchmark(results, ToString(shape_type), npoints, repeat);
+      if (terms)       BenchmarkEnergyTerms(benchmark, surface, image, dmap);
+      if (ray_profile) BenchmarkRayProfiles(benchmark, surface, input_image);
+      if (integrators) BenchmarkIntegrators(benchmark, surface, dmap, nsteps);
+      if (integrators) BenchmarkStiffIntegration(benchmark, surface, dmap);
+      if (euler_state) BenchmarkIntegratorState(benchmark, surface);
+      if (remesh)      BenchmarkRemeshing  (benchmark, surface, dmap);
+      if (collisions)  BenchmarkCollisions (benchmark, surface, dmap);
+      if (lowpass)     BenchmarkLowPass    (benchmark, surface, dmap);
+      if (active_set)  BenchmarkActiveSet  (benchmark, surface, dmap, active_ratio);
+      if (distortion)  BenchmarkMetricDistortion(benchmark, surface, dmap);
+      if (curvature)   BenchmarkCurvatureCache  (benchmark, surface, dmap);
+    }
+  }
+
+  ofstream ofs(output_name);
+  if (!ofs) FatalError("Failed to open output file: " << output_name);
+  ofs.precision(6);
+  if (Extension(output_name) == ".csv") {
+    WriteCSV(ofs, results);
+  } else {
+    WriteJSON(ofs, results);
+  }
+  ofs.close();
+
+  return 0;
+}
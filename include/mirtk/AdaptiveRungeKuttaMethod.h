@@ -0,0 +1,146 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright 2013-2017 Imperial College London
+ * Copyright 2013-2017 Andreas Schuh
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MIRTK_AdaptiveRungeKuttaMethod_H
+#define MIRTK_AdaptiveRungeKuttaMethod_H
+
+#include "mirtk/EulerMethod.h"
+
+#include "mirtk/Array.h"
+
+
+namespace mirtk {
+
+
+/**
+ * Minimizes deformable surface model using an adaptive Runge-Kutta method
+ *
+ * The equation of motion of the surface nodes is integrated using the
+ * embedded Runge-Kutta pair of order 3(2) of Bogacki and Shampine:
+ *
+ *   Bogacki and Shampine (1989), A 3(2) pair of Runge-Kutta formulas,
+ *   Applied Mathematics Letters, 2(4), 321–325
+ *
+ * The difference between the third and second order solutions is used as an
+ * estimate of the local error of each step. A step is accepted when the
+ * maximum error of any node is below the tolerance, and rejected otherwise.
+ * The time step is then adjusted for the next step based on this estimate.
+ * Because the last stage of the method evaluates the forces at the new node
+ * positions, an accepted step requires only three force evaluations.
+ *
+ * The first trial step moves the node with the largest force by the step
+ * length. When the integration is resumed from a checkpoint, the time step
+ * saved by the checkpoint is used instead. Accepted steps must also satisfy the maximum node displacement limit,
+ * and the hard constraints of the deformable surface model are enforced at each
+ * stage. The periodic low-pass filtering of the node displacements is only
+ * applied when the nodes are moved to the positions of a new step.
+ *
+ * \note This optimizer has no OptimizationMethod enumeration value of its own,
+ *       and thus cannot be created by LocalOptimizer::New. Its
+ *       OptimizationMethod is the one of the EulerMethod base class.
+ */
+class AdaptiveRungeKuttaMethod : public EulerMethod
+{
+  mirtkObjectMacro(AdaptiveRungeKuttaMethod);
+
+  // ---------------------------------------------------------------------------
+  // Attributes
+
+  /// Tolerated local error of node positions relative to the maximum node displacement
+  mirtkPublicAttributeMacro(double, Tolerance);
+
+  /// Current time step
+  mirtkReadOnlyAttributeMacro(double, TimeStep);
+
+  /// Number of accepted steps of last run
+  mirtkReadOnlyAttributeMacro(int, NumberOfAcceptedSteps);
+
+  /// Number of rejected steps of last run
+  mirtkReadOnlyAttributeMacro(int, NumberOfRejectedSteps);
+
+  /// Number of force evaluations of last run
+  mirtkReadOnlyAttributeMacro(int, NumberOfGradientEvaluations);
+
+  /// Copy attributes of this class from another instance
+  void CopyAttributes(const AdaptiveRungeKuttaMethod &);
+
+  // ---------------------------------------------------------------------------
+  // Construction/Destruction
+public:
+
+  /// Constructor
+  AdaptiveRungeKuttaMethod(ObjectiveFunction * = NULL);
+
+  /// Copy constructor
+  AdaptiveRungeKuttaMethod(const AdaptiveRungeKuttaMethod &);
+
+  /// Assignment operator
+  AdaptiveRungeKuttaMethod &operator =(const AdaptiveRungeKuttaMethod &);
+
+  /// Destructor
+  virtual ~AdaptiveRungeKuttaMethod();
+
+  // ---------------------------------------------------------------------------
+  // Parameters
+  using LocalOptimizer::Parameter;
+
+  /// Set parameter value from string
+  virtual bool Set(const char *, const char *);
+
+  /// Get parameters as key/value as string map
+  virtual ParameterList Parameter() const;
+
+  // ---------------------------------------------------------------------------
+  // Execution
+
+  /// Integrate deformable surface model
+  virtual double Run();
+
+protected:
+
+  /// Evaluate node forces at current node positions
+  ///
+  /// \param[out] f Unnormalized node forces.
+  void EvaluateForce(Array<double> &f);
+
+  /// Move nodes to given displacement from positions at start of the step
+  ///
+  /// The _Displacement of the nodes from their positions at the start of the
+  /// step is updated to the displacement after enforcing hard constraints.
+  ///
+  /// \param[in] dx Node displacements relative to start of step.
+  void MoveTo(const Array<double> &dx);
+
+  /// Add integration state, including the current time step, to field data
+  virtual void SaveState(vtkFieldData *) const;
+
+  /// Restore integration state, including the time step of the next step
+  virtual void RestoreState(vtkFieldData *);
+
+private:
+
+  /// Node displacements by which model is moved
+  Array<double> _Move;
+
+};
+
+
+} // namespace mirtk
+
+#endif // MIRTK_AdaptiveRungeKuttaMethod_H
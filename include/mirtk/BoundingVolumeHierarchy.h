@@ -0,0 +1,228 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright 2013-2017 Imperial College London
+ * Copyright 2013-2017 Andreas Schuh
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MIRTK_BoundingVolumeHierarchy_H
+#define MIRTK_BoundingVolumeHierarchy_H
+
+#include "mirtk/Object.h"
+
+#include "mirtk/Array.h"
+
+#include "vtkType.h"
+#include "vtkSmartPointer.h"
+#include "vtkPolyData.h"
+#include "vtkIdList.h"
+#include "vtkGenericCell.h"
+
+
+namespace mirtk {
+
+
+/**
+ * Axis-aligned bounding box hierarchy of surface mesh cells
+ *
+ * Unlike a VTK cell locator, which has to be rebuilt from scratch whenever the
+ * points of the surface mesh have moved, the topology of this hierarchy is kept
+ * fixed between calls of Build and only the bounding boxes of its nodes are
+ * updated in place by Refit. This is much cheaper for a deformable surface
+ * whose points move only a small distance at each iteration. A full rebuild is
+ * only required after the mesh connectivity has changed, e.g., by remeshing.
+ */
+class BoundingVolumeHierarchy : public Object
+{
+  mirtkObjectMacro(BoundingVolumeHierarchy);
+
+  // ---------------------------------------------------------------------------
+  // Types
+public:
+
+  /// Node of bounding volume hierarchy
+  struct Node
+  {
+    double _Bounds[6]; ///< Bounding box (xmin, xmax, ymin, ymax, zmin, zmax)
+    int    _Left;      ///< Index of left child node or -1 if leaf node
+    int    _Right;     ///< Index of right child node or -1 if leaf node
+    int    _Begin;     ///< Index of first cell of leaf node in _CellIds
+    int    _End;       ///< Index one past the last cell of leaf node in _CellIds
+
+    bool IsLeaf() const { return _Left < 0; }
+  };
+
+  // ---------------------------------------------------------------------------
+  // Attributes
+
+  /// Surface mesh whose cells are enclosed by the bounding volumes
+  mirtkReadOnlyAttributeMacro(vtkSmartPointer<vtkPolyData>, DataSet);
+
+  /// Maximum number of cells stored in a leaf node
+  mirtkPublicAttributeMacro(int, MaxCellsPerLeaf);
+
+  /// Number of times the hierarchy was built from scratch
+  mirtkReadOnlyAttributeMacro(int, NumberOfBuilds);
+
+  /// Number of times the bounding volumes were refitted since the last build
+  mirtkReadOnlyAttributeMacro(int, NumberOfRefits);
+
+  /// Wall clock time in seconds spent by the last Build or Refit
+  mirtkReadOnlyAttributeMacro(double, LastUpdateTime);
+
+  /// Total wall clock time in seconds spent building and refitting the hierarchy
+  mirtkReadOnlyAttributeMacro(double, TotalUpdateTime);
+
+protected:
+
+  /// Nodes of hierarchy, where the index of a child is always greater than
+  /// the index of its parent node with the root node stored at index 0
+  Array<Node> _Nodes;
+
+  /// Indices of leaf nodes
+  Array<int> _Leaves;
+
+  /// IDs of cells sorted such that cells of each leaf node are contiguous
+  Array<vtkIdType> _CellIds;
+
+  /// Bounding boxes of cells, six values per cell
+  Array<double> _CellBounds;
+
+  /// Copy attributes of this class from another instance
+  void CopyAttributes(const BoundingVolumeHierarchy &);
+
+  // ---------------------------------------------------------------------------
+  // Construction/Destruction
+public:
+
+  /// Constructor
+  BoundingVolumeHierarchy();
+
+  /// Copy constructor
+  BoundingVolumeHierarchy(const BoundingVolumeHierarchy &);
+
+  /// Assignment operator
+  BoundingVolumeHierarchy &operator =(const BoundingVolumeHierarchy &);
+
+  /// Destructor
+  virtual ~BoundingVolumeHierarchy();
+
+  /// Remove all nodes
+  void Clear();
+
+  /// Whether the hierarchy has no nodes
+  bool Empty() const;
+
+  /// Number of nodes
+  int NumberOfNodes() const;
+
+  /// Number of cells
+  int NumberOfCells() const;
+
+  /// Get n-th node
+  const Node &GetNode(int) const;
+
+  // ---------------------------------------------------------------------------
+  // Update
+
+  /// Build hierarchy of bounding volumes from scratch
+  ///
+  /// This must be called initially and whenever the connectivity of the
+  /// surface mesh has changed, e.g., after the surface was remeshed.
+  void Build(vtkPolyData *);
+
+  /// Update bounding volumes after the points of the surface mesh have moved
+  ///
+  /// The topology of the hierarchy remains unchanged. When the number of cells
+  /// of the surface mesh differs from the number of cells when the hierarchy
+  /// was last built, the hierarchy is rebuilt from scratch instead.
+  void Refit();
+
+  // ---------------------------------------------------------------------------
+  // Queries
+
+  /// Find cells whose bounding box intersects the given bounds
+  ///
+  /// This function is thread-safe as long as the hierarchy is not modified.
+  ///
+  /// \param[in]  bounds  Bounding box (xmin, xmax, ymin, ymax, zmin, zmax).
+  /// \param[out] cellIds IDs of cells whose bounding box overlaps \p bounds.
+  void FindCellsWithinBounds(const double bounds[6], vtkIdList *cellIds) const;
+
+  /// Squared distance of point to cell
+  ///
+  /// This function is thread-safe as long as each thread uses its own cell.
+  ///
+  /// \param[in] p      Query point.
+  /// \param[in] cellId ID of surface mesh cell.
+  /// \param[in] cell   Generic cell used to evaluate the distance.
+  double Distance2ToCell(const double p[3], vtkIdType cellId, vtkGenericCell *cell) const;
+
+  /// Find a cell within the given distance of a point
+  ///
+  /// Nodes whose bounding box is further away from the point than the given
+  /// distance are skipped, and the search stops at the first cell found.
+  /// This function is thread-safe as long as the hierarchy is not modified
+  /// and each thread uses its own cell.
+  ///
+  /// \param[in] p         Query point.
+  /// \param[in] max_dist2 Squared maximum distance of cell from point.
+  /// \param[in] cell      Generic cell used to evaluate distances.
+  ///
+  /// \returns ID of a cell within the given distance, or -1 if none exists.
+  vtkIdType FindCellWithinDistance(const double p[3], double max_dist2, vtkGenericCell *cell) const;
+
+protected:
+
+  /// Compute bounding boxes of cells
+  void ComputeCellBounds();
+
+  /// Compute bounding boxes of nodes from cell bounding boxes
+  void ComputeNodeBounds();
+
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Inline definitions
+////////////////////////////////////////////////////////////////////////////////
+
+// -----------------------------------------------------------------------------
+inline bool BoundingVolumeHierarchy::Empty() const
+{
+  return _Nodes.empty();
+}
+
+// -----------------------------------------------------------------------------
+inline int BoundingVolumeHierarchy::NumberOfNodes() const
+{
+  return static_cast<int>(_Nodes.size());
+}
+
+// -----------------------------------------------------------------------------
+inline int BoundingVolumeHierarchy::NumberOfCells() const
+{
+  return static_cast<int>(_CellIds.size());
+}
+
+// -----------------------------------------------------------------------------
+inline const BoundingVolumeHierarchy::Node &BoundingVolumeHierarchy::GetNode(int i) const
+{
+  return _Nodes[i];
+}
+
+
+} // namespace mirtk
+
+#endif // MIRTK_BoundingVolumeHierarchy_H
@@ -32,11 +32,15 @@
 #include "mirtk/InternalForce.h"
 #include "mirtk/TransformationConstraint.h"
 #include "mirtk/MeshSmoothing.h"
+#include "mirtk/BoundingVolumeHierarchy.h"
+#include "mirtk/SurfaceInsideMask.h"
+#include "mirtk/SurfaceCurvatureCache.h"
+#include "mirtk/DeformableSurfaceTracer.h"
 
 #include "vtkSmartPointer.h"
 #include "vtkPointSet.h"
 #include "vtkPolyData.h"
-#include "vtkAbstractCellLocator.h"
+#include "vtkFieldData.h"
 
 
 namespace mirtk {
@@ -110,6 +114,12 @@ class DeformableSurfaceModel : public ObjectiveFunction
   /// Remesh surface using an adaptive edge length interval based on local curvature
   mirtkPublicAttributeMacro(bool, RemeshAdaptively);
 
+  /// Remesh surface by concurrent independent edge collapses and splits
+  ///
+  /// When enabled, ParallelSurfaceRemeshing is used instead of SurfaceRemeshing
+  /// unless the surface is remeshed adaptively or the model is parametric.
+  mirtkPublicAttributeMacro(bool, ParallelRemeshing);
+
   /// Low-pass filter surface mesh every n-th iteration
   mirtkPublicAttributeMacro(int, LowPassInterval);
 
@@ -121,7 +131,13 @@ class DeformableSurfaceModel : public ObjectiveFunction
 
   /// Maximum distance of deformed surface points from input surface
   mirtkPublicAttributeMacro(double, MaxInputDistance);
-  vtkSmartPointer<vtkAbstractCellLocator> _InputCellLocator;
+
+  /// Bounding volume hierarchy of input surface mesh cells
+  BoundingVolumeHierarchy _InputLocator;
+
+  /// ID of input surface mesh cell within MaxInputDistance of each node found
+  /// last, which is tested first when the constraint is enforced again
+  mutable Array<vtkIdType> _InputCell;
 
   /// Enforce non-self-intersection of deformed surface mesh
   mirtkPublicAttributeMacro(bool, HardNonSelfIntersection);
@@ -162,11 +178,76 @@ class DeformableSurfaceModel : public ObjectiveFunction
   /// Whether to only minimize the energy of external forces
   mirtkPublicAttributeMacro(bool, MinimizeExtrinsicEnergy);
 
+  /// Whether to evaluate the energy terms concurrently
+  ///
+  /// When enabled, the energy terms of a non-parametric deformable surface
+  /// model are updated in parallel and each term evaluates its gradient into
+  /// a separate buffer. These buffers are summed in the fixed order of the
+  /// terms, such that the result does not depend on the task scheduling.
+  mirtkPublicAttributeMacro(bool, ConcurrentTerms);
+
+  /// Whether to evaluate the gradient only at active nodes
+  ///
+  /// When enabled, energy terms which support it evaluate their gradient only
+  /// at nodes with non-zero "Status" (cf. MinActiveStoppingCriterion). The
+  /// gradient at the remaining passive nodes is zero also when it is evaluated
+  /// at all nodes.
+  mirtkPublicAttributeMacro(bool, ActiveSet);
+
+  /// Indices of active nodes in ascending order
+  mirtkReadOnlyAttributeMacro(Array<int>, ActivePoints);
+
+  /// Optional tracer which records scoped events of energy term evaluations
+  /// and model operations, i.e., nothing is recorded when \c nullptr
+  mirtkPublicAggregateMacro(DeformableSurfaceTracer, Tracer);
+
 protected:
 
   /// Number of iterations since last low-pass filtering
   mutable int _LowPassCounter;
 
+  /// Bounding volume hierarchy of deformed surface mesh cells used to find
+  /// cells near detected collisions, refitted after each step and only
+  /// rebuilt from scratch after the surface mesh was remeshed
+  mutable BoundingVolumeHierarchy _SurfaceLocator;
+
+  /// Wall clock time in seconds spent updating the surface locator during last step
+  mutable double _SurfaceLocatorTime;
+
+  /// Inside mask of deformed surface shared by the surface forces
+  SurfaceInsideMask _InsideMask;
+
+  /// Curvatures of deformed surface shared by the surface constraints
+  SurfaceCurvatureCache _CurvatureCache;
+
+  /// Offsets of the active nodes of each block of nodes in _ActivePoints
+  Array<int> _ActiveBlockOffsets;
+
+  /// Gradient buffers of energy terms evaluated concurrently
+  Array<Array<double> > _TermGradient;
+
+  /// Total wall clock time in seconds spent updating each energy term
+  Array<double> _TermUpdateTime;
+
+  /// Total wall clock time in seconds spent evaluating the gradient of each energy term
+  Array<double> _TermGradientTime;
+
+  /// Whether next update of energy terms must be serial, e.g., because the
+  /// terms were (re-)initialized and the shared point set is not up-to-date
+  bool _SerialUpdatePending;
+
+  /// Whether to evaluate the energy terms concurrently at this time
+  bool EvaluateTermsConcurrently() const;
+
+  /// Precompute lazily evaluated attributes of the deformed point set
+  /// such that energy terms evaluated concurrently only read these
+  void PrepareConcurrentEvaluation();
+
+  /// Update indices of active nodes
+  ///
+  /// \returns Whether the gradient is evaluated only at these nodes.
+  bool UpdateActivePoints();
+
   /// Energy terms corresponding to external forces
   Array<class ExternalForce *> _ExternalForce;
   Array<bool>                  _ExternalForceOwner;
@@ -359,6 +440,16 @@ public:
   ///          the energy and/or gradient of the deformable surface model.
   virtual bool Remesh();
 
+  /// Add counters of periodic remeshing and low-pass filtering as well as the
+  /// initial values of energy terms divided by these to field data
+  ///
+  /// Used together with RestoreState to checkpoint the state of the model
+  /// such that an interrupted integration can be resumed later on.
+  void SaveState(vtkFieldData *) const;
+
+  /// Restore counters and initial energy term values from field data
+  void RestoreState(vtkFieldData *);
+
   // ---------------------------------------------------------------------------
   // Evaluation
 
@@ -453,6 +544,26 @@ public:
   /// Write gradient of force terms
   virtual void WriteGradient(const char *, const char *) const;
 
+  /// Wall clock time in seconds spent building or refitting the bounding
+  /// volume hierarchy used for collision queries during the last step
+  /// \remarks Use for progress reporting only.
+  double SurfaceLocatorTime() const;
+
+  /// Whether a bounding volume hierarchy is used for collision queries
+  /// \remarks Use for progress reporting only.
+  bool HasSurfaceLocator() const;
+
+  /// Total wall clock time in seconds spent updating the n-th energy term
+  /// \remarks Use for progress reporting only.
+  double TermUpdateTime(int) const;
+
+  /// Total wall clock time in seconds spent evaluating the gradient of the n-th energy term
+  /// \remarks Use for progress reporting only.
+  double TermGradientTime(int) const;
+
+  /// Reset timing of energy terms
+  void ResetTermTimes();
+
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -471,6 +582,30 @@ inline int DeformableSurfaceModel::NumberOfPoints() const
   return _PointSet.NumberOfPoints();
 }
 
+// -----------------------------------------------------------------------------
+inline double DeformableSurfaceModel::SurfaceLocatorTime() const
+{
+  return _SurfaceLocatorTime;
+}
+
+// -----------------------------------------------------------------------------
+inline bool DeformableSurfaceModel::HasSurfaceLocator() const
+{
+  return !_SurfaceLocator.Empty();
+}
+
+// -----------------------------------------------------------------------------
+inline double DeformableSurfaceModel::TermUpdateTime(int i) const
+{
+  return (i < static_cast<int>(_TermUpdateTime.size()) ? _TermUpdateTime[i] : 0.);
+}
+
+// -----------------------------------------------------------------------------
+inline double DeformableSurfaceModel::TermGradientTime(int i) const
+{
+  return (i < static_cast<int>(_TermGradientTime.size()) ? _TermGradientTime[i] : 0.);
+}
+
 
 } // namespace mirtk
 
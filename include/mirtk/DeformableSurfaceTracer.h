@@ -0,0 +1,194 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright 2013-2017 Imperial College London
+ * Copyright 2013-2017 Andreas Schuh
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MIRTK_DeformableSurfaceTracer_H
+#define MIRTK_DeformableSurfaceTracer_H
+
+#include "mirtk/Observer.h"
+
+#include "mirtk/Array.h"
+
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <map>
+
+
+namespace mirtk {
+
+
+/**
+ * Records scoped events of a deformable surface model run in Chrome trace format
+ *
+ * This object observes the optimizer of the deformable surface model, which
+ * must be attached to the respective LocalOptimizer instance to record the
+ * iterations. Additionally, the deformable surface model and optimizer
+ * record a scoped event for each energy term update, gradient and value
+ * evaluation, as well as for each step, remeshing, gradient smoothing,
+ * collision resolution, hard constraint enforcement, and test of the stopping
+ * criteria when this tracer is set as DeformableSurfaceModel::Tracer.
+ *
+ * The recorded events are written in the Chrome trace event JSON format,
+ * which can be opened with chrome://tracing or the Perfetto UI.
+ * When no tracer is set, the overhead of the instrumentation is a null
+ * pointer check per traced scope.
+ */
+class DeformableSurfaceTracer : public Observer
+{
+  mirtkObjectMacro(DeformableSurfaceTracer);
+
+  // ---------------------------------------------------------------------------
+  // Types
+public:
+
+  typedef std::chrono::steady_clock Clock;
+
+  /// Recorded complete event
+  struct TraceEvent
+  {
+    string name;      ///< Name of event, i.e., category followed by name of object
+    string category;  ///< Category of event, e.g., "Update", "Gradient", "Step"
+    double start;     ///< Start time in microseconds
+    double duration;  ///< Duration in microseconds
+    int    thread;    ///< Thread index
+    int    iteration; ///< Iteration during which event occurred
+  };
+
+  /// Scoped event which is recorded when going out of scope
+  class Scope
+  {
+    DeformableSurfaceTracer *_Tracer;
+    const char              *_Category;
+    const char              *_Name;
+    double                   _Start;
+
+  public:
+
+    /// Begin scoped event, does nothing when tracer is \c nullptr
+    Scope(DeformableSurfaceTracer *tracer, const char *category, const char *name);
+
+    /// End scoped event
+    ~Scope();
+  };
+
+  // ---------------------------------------------------------------------------
+  // Attributes
+
+  /// Current iteration number
+  mirtkReadOnlyAttributeMacro(int, Iteration);
+
+  /// Recorded events
+  mirtkReadOnlyAttributeMacro(Array<TraceEvent>, Events);
+
+protected:
+
+  /// Start time of trace
+  Clock::time_point _Epoch;
+
+  /// Start time of current iteration in microseconds
+  double _IterationStart;
+
+  /// Start time of current run in microseconds
+  double _RunStart;
+
+  /// Indices of threads in order of their first recorded event
+  std::map<std::thread::id, int> _Threads;
+
+  /// Mutex used to serialize recording of events by concurrent threads
+  std::mutex _Mutex;
+
+  // ---------------------------------------------------------------------------
+  // Construction/Destruction
+private:
+
+  /// Copy construction
+  /// \note Intentionally not implemented.
+  DeformableSurfaceTracer(const DeformableSurfaceTracer &);
+
+  /// Assignment operator
+  /// \note Intentionally not implemented.
+  DeformableSurfaceTracer &operator =(const DeformableSurfaceTracer &);
+
+public:
+
+  /// Constructor
+  DeformableSurfaceTracer();
+
+  /// Destructor
+  virtual ~DeformableSurfaceTracer();
+
+  /// Discard recorded events
+  void Clear();
+
+  // ---------------------------------------------------------------------------
+  // Recording
+
+  /// Current time since start of trace in microseconds
+  double Now() const;
+
+  /// Record complete event
+  ///
+  /// \param[in] category Category of event, e.g., name of operation.
+  /// \param[in] name     Name of object, e.g., energy term. May be \c nullptr.
+  /// \param[in] start    Start time in microseconds as returned by Now().
+  /// \param[in] end      End time in microseconds as returned by Now().
+  void Record(const char *category, const char *name, double start, double end);
+
+  /// Record iterations of observed optimizer
+  void HandleEvent(Observable *, Event, const void *);
+
+  // ---------------------------------------------------------------------------
+  // Output
+
+  /// Write recorded events in Chrome trace event JSON format
+  ///
+  /// \returns Whether the file was written successfully.
+  bool Write(const char *fname) const;
+
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Inline definitions
+////////////////////////////////////////////////////////////////////////////////
+
+// -----------------------------------------------------------------------------
+inline double DeformableSurfaceTracer::Now() const
+{
+  return std::chrono::duration<double, std::micro>(Clock::now() - _Epoch).count();
+}
+
+// -----------------------------------------------------------------------------
+inline DeformableSurfaceTracer::Scope
+::Scope(DeformableSurfaceTracer *tracer, const char *category, const char *name)
+:
+  _Tracer(tracer), _Category(category), _Name(name), _Start(0.)
+{
+  if (_Tracer) _Start = _Tracer->Now();
+}
+
+// -----------------------------------------------------------------------------
+inline DeformableSurfaceTracer::Scope::~Scope()
+{
+  if (_Tracer) _Tracer->Record(_Category, _Name, _Start, _Tracer->Now());
+}
+
+
+} // namespace mirtk
+
+#endif // MIRTK_DeformableSurfaceTracer_H
@@ -24,6 +24,7 @@
 
 #include "vtkSmartPointer.h"
 #include "vtkDataArray.h"
+#include "vtkPointSet.h"
 
 
 namespace mirtk {
@@ -70,6 +71,11 @@ class EulerMethod : public LocalOptimizer
   mirtkPublicAttributeMacro(double, MaximumDisplacement);
 
   /// Point data array of current node displacement
+  ///
+  /// This array is converted to a vtkDoubleArray upon initialization such that
+  /// the integration steps can operate directly on its contiguous memory.
+  /// It is thus also the state which is interpolated by the remesher and
+  /// accessed by observers without any further synchronization.
   mirtkPublicAttributeMacro(vtkSmartPointer<vtkDataArray>, Displacement);
 
   /// Point data array used to track node displacement in normal direction (optional)
@@ -81,7 +87,14 @@ class EulerMethod : public LocalOptimizer
   /// Last maximum node displacement
   mirtkReadOnlyAttributeMacro(double, LastDelta);
 
-private:
+  /// Number of integration steps performed by the current run, including
+  /// those performed before the integration was resumed from a checkpoint
+  mirtkReadOnlyAttributeMacro(int, StepCount);
+
+protected:
+
+  /// Checkpoint from which to resume the integration upon next Run
+  vtkSmartPointer<vtkPointSet> _Checkpoint;
 
   /// Size of allocated vectors, may be larger than actual number of model DoFs!
   int _NumberOfDOFs;
@@ -126,8 +139,64 @@ public:
   /// Integrate deformable surface model
   virtual double Run();
 
+  // ---------------------------------------------------------------------------
+  // Checkpointing
+
+  /// Get copy of deformed surface with current integration state
+  ///
+  /// The point data of the returned point set includes the node displacements,
+  /// velocities, and any other point data arrays of the deformable surface
+  /// model, such as the node status and the "LastModified" state of the
+  /// MinActiveStoppingCriterion. The number of performed steps, the last
+  /// objective function values, the counters of the periodic remeshing and
+  /// low-pass filtering and the initial energy values of the model, as well
+  /// as any state added by SaveState of a subclass are stored as field data.
+  ///
+  /// This function is intended to be called by an observer upon
+  /// IterationEndEvent, after the model was updated for the next step.
+  vtkSmartPointer<vtkPointSet> Checkpoint() const;
+
+  /// Resume integration from given checkpoint upon next Run
+  ///
+  /// The checkpoint must have been created by Checkpoint() for a deformable
+  /// surface model with the same input mesh. After initialization, Run replaces
+  /// the deformed surface and integration state by those of the checkpoint and
+  /// continues the integration with the next step.
+  ///
+  /// \param[in] checkpoint Checkpoint or \c nullptr to start a new integration.
+  void Resume(vtkPointSet *checkpoint);
+
 protected:
 
+  /// Restore integration state from checkpoint set by Resume
+  ///
+  /// \returns Number of steps performed before checkpoint was created.
+  virtual int RestoreCheckpoint();
+
+  /// Add integration state other than point data to field data of checkpoint
+  ///
+  /// Subclasses which keep additional state between integration steps, e.g.,
+  /// an adaptive time step, must override this function and call the base
+  /// class implementation. Their Initialize function resets this state, which
+  /// is afterwards replaced by RestoreState when the integration is resumed.
+  virtual void SaveState(vtkFieldData *) const;
+
+  /// Restore integration state saved by SaveState from field data of checkpoint
+  virtual void RestoreState(vtkFieldData *);
+
+  /// Add named scalar value to field data
+  static void SaveValue(vtkFieldData *, const char *, double);
+
+  /// Get named scalar value from field data
+  ///
+  /// \returns Whether field data contains the named value.
+  static bool RestoreValue(vtkFieldData *, const char *, double &);
+
+  /// Get named integer value from field data
+  ///
+  /// \returns Whether field data contains the named value.
+  static bool RestoreValue(vtkFieldData *, const char *, int &);
+
   /// Perform local adaptive remeshing (optional)
   virtual bool RemeshModel();
 
@@ -147,6 +216,13 @@ protected:
   /// Update recorded node displacement in normal direction
   virtual void UpdateNormalDisplacement();
 
+  /// Add given node displacements times scaling factor projected onto the
+  /// current surface normals to the recorded node displacement in normal direction
+  ///
+  /// \param[in] dx    Interleaved node displacement vectors (x, y, z).
+  /// \param[in] scale Scaling factor of node displacements.
+  void AddNormalDisplacement(const double *dx, double scale = 1.0);
+
   /// Finalize optimization
   virtual void Finalize();
 
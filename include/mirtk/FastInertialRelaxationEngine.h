@@ -0,0 +1,146 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright 2013-2017 Imperial College London
+ * Copyright 2013-2017 Andreas Schuh
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MIRTK_FastInertialRelaxationEngine_H
+#define MIRTK_FastInertialRelaxationEngine_H
+
+#include "mirtk/EulerMethod.h"
+
+
+namespace mirtk {
+
+
+/**
+ * Minimizes deformable surface model using the Fast Inertial Relaxation Engine
+ *
+ * This method is described in the following paper:
+ *
+ *   Bitzek et al. (2006), Structural relaxation made simple,
+ *   Physical Review Letters, 97(17), 170201
+ *
+ * The nodes move with unit mass according to the node forces, where the
+ * velocities are mixed with the force directions at each step. As long as
+ * the power, i.e., the dot product of forces and velocities, is positive,
+ * the time step increases and the mixing decreases after a minimum number
+ * of such steps. When the power is negative, i.e., the surface moves uphill,
+ * the velocities are set to zero, the time step is decreased, and the mixing
+ * is reset to its initial value.
+ *
+ * The node displacements of each step are truncated to the maximum node
+ * displacement of EulerMethod, and the velocities are adjusted accordingly.
+ * The node velocities are stored in the "Velocity" point data array such
+ * that these are interpolated by the remesher. The time step, mixing weight,
+ * and number of steps with positive power are saved by a checkpoint, such
+ * that a resumed relaxation continues with the same state.
+ *
+ * \note This optimizer has no OptimizationMethod enumeration value of its own,
+ *       and thus cannot be created by LocalOptimizer::New. Its
+ *       OptimizationMethod is the one of the EulerMethod base class.
+ */
+class FastInertialRelaxationEngine : public EulerMethod
+{
+  mirtkObjectMacro(FastInertialRelaxationEngine);
+
+  // ---------------------------------------------------------------------------
+  // Attributes
+
+  /// Maximum time step relative to the initial step length
+  mirtkPublicAttributeMacro(double, MaximumTimeStepFactor);
+
+  /// Factor by which time step is increased after steps with positive power
+  mirtkPublicAttributeMacro(double, TimeStepIncrease);
+
+  /// Factor by which time step is decreased after a step with negative power
+  mirtkPublicAttributeMacro(double, TimeStepDecrease);
+
+  /// Initial weight of force direction when mixing it with the velocity
+  mirtkPublicAttributeMacro(double, InitialMixing);
+
+  /// Factor by which mixing weight is decreased after steps with positive power
+  mirtkPublicAttributeMacro(double, MixingDecrease);
+
+  /// Minimum number of steps with positive power before time step is increased
+  mirtkPublicAttributeMacro(int, MinimumNumberOfPositiveSteps);
+
+  /// Current time step
+  mirtkReadOnlyAttributeMacro(double, TimeStep);
+
+  /// Current weight of force direction when mixing it with the velocity
+  mirtkReadOnlyAttributeMacro(double, Mixing);
+
+  /// Number of steps since the last step with negative power
+  mirtkReadOnlyAttributeMacro(int, NumberOfPositiveSteps);
+
+  /// Number of restarts after a step with negative power during last run
+  mirtkReadOnlyAttributeMacro(int, NumberOfRestarts);
+
+  /// Copy attributes of this class from another instance
+  void CopyAttributes(const FastInertialRelaxationEngine &);
+
+  // ---------------------------------------------------------------------------
+  // Construction/Destruction
+public:
+
+  /// Constructor
+  FastInertialRelaxationEngine(ObjectiveFunction * = NULL);
+
+  /// Copy constructor
+  FastInertialRelaxationEngine(const FastInertialRelaxationEngine &);
+
+  /// Assignment operator
+  FastInertialRelaxationEngine &operator =(const FastInertialRelaxationEngine &);
+
+  /// Destructor
+  virtual ~FastInertialRelaxationEngine();
+
+  // ---------------------------------------------------------------------------
+  // Parameters
+  using LocalOptimizer::Parameter;
+
+  /// Set parameter value from string
+  virtual bool Set(const char *, const char *);
+
+  /// Get parameters as key/value as string map
+  virtual ParameterList Parameter() const;
+
+  // ---------------------------------------------------------------------------
+  // Execution
+
+  /// Initialize optimization
+  ///
+  /// This member funtion is implicitly called by Run.
+  virtual void Initialize();
+
+  /// Update node displacements
+  virtual void UpdateDisplacement();
+
+protected:
+
+  /// Add integration state, including the time step and mixing weight, to field data
+  virtual void SaveState(vtkFieldData *) const;
+
+  /// Restore integration state, including the time step and mixing weight
+  virtual void RestoreState(vtkFieldData *);
+
+};
+
+
+} // namespace mirtk
+
+#endif // MIRTK_FastInertialRelaxationEngine_H
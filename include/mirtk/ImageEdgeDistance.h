@@ -23,6 +23,9 @@
 #include "mirtk/SurfaceForce.h"
 
 #include "mirtk/FastCubicBSplineInterpolateImageFunction.h"
+#include "mirtk/Parallel.h"
+
+#include <mutex>
 
 
 namespace mirtk {
@@ -49,6 +52,15 @@ public:
   /// Type of interpolated image / image interpolation function
   typedef GenericFastCubicBSplineInterpolateImageFunction<DiscreteImage> ContinuousImage;
 
+  /// Type of buffer of image values sampled along the normal rays
+  typedef Array<double, cache_aligned_allocator<double> > SampleBuffer;
+
+  /// Buffers of a fixed block of points reused by subsequent updates
+  struct BlockWorkspace;
+
+  /// Maximum number of blocks of points processed in parallel
+  static const int MaxNumberOfBlocks = 32;
+
   /// Enumeration of edge force modes based on directional derivative of image intensities
   enum EdgeType
   {
@@ -63,6 +75,59 @@ public:
     NeonatalPialSurface   ///< T2-weighted MRI cGM/CSF edge at neonatal age
   };
 
+  /// Image intensity statistics and interpolators computed upon initialization
+  ///
+  /// These only depend on the input images and parameters of the force term,
+  /// but not on the surface mesh. They can thus be reused by instances which
+  /// deform different surfaces within the same images.
+  struct ImageStatistics
+  {
+    // Input of computation
+    const RegisteredImage *_Image;
+    const RealImage       *_T1WeightedImage;
+    const BinaryImage     *_WhiteMatterMask;
+    const BinaryImage     *_GreyMatterMask;
+    const RealImage       *_VentriclesDistance;
+    enum EdgeType          _EdgeType;
+    double                 _WindowWidth[3];
+    double                 _Thresholds[6];
+
+    // Output of computation
+    double                     _GlobalWhiteMatterMean;
+    double                     _GlobalWhiteMatterVariance;
+    double                     _GlobalWhiteMatterThreshold;
+    double                     _GlobalGreyMatterMean;
+    double                     _GlobalGreyMatterVariance;
+    LocalStatsImage            _LocalWhiteMatterMean;
+    LocalStatsImage            _LocalWhiteMatterVariance;
+    LocalStatsImage            _LocalGreyMatterMean;
+    LocalStatsImage            _LocalGreyMatterVariance;
+    LocalStatsImage            _LocalGreyMatterT1Mean;
+    LocalStatsImage            _LocalGreyMatterT1Variance;
+    Array<int>                 _CorticalDeepGreyMatterBoundingBox;
+    SharedPtr<ContinuousImage> _T1WeightedImageFunction;
+    SharedPtr<ContinuousImage> _T2WeightedImageFunction;
+    double                     _InitializedThresholds[6];
+  };
+
+  /// Image statistics computed by instances sharing this cache
+  ///
+  /// The mutex only guards the list of entries. The statistics of an entry are
+  /// computed by the first instance which calls std::call_once for it, such
+  /// that statistics of different input images are computed concurrently.
+  struct ImageStatisticsCache
+  {
+    /// Cached image statistics of a given input
+    struct Entry
+    {
+      ImageStatistics _Statistics; ///< Input and computed image statistics
+      std::once_flag  _Computed;   ///< Whether statistics were computed
+    };
+
+    Array<SharedPtr<Entry> > _Entries; ///< Cached image statistics
+    std::mutex               _Mutex;   ///< Serializes access to list of entries
+  };
+
   // ---------------------------------------------------------------------------
   // Attributes
 
@@ -195,8 +260,51 @@ private:
   /// Continuous T2-weighted image
   mirtkAttributeMacro(SharedPtr<ContinuousImage>, T2WeightedImageFunction);
 
+  /// Cache of image statistics shared with other instances (optional)
+  ///
+  /// When set, the image statistics and interpolators are computed only by
+  /// the first instance initialized with given input images and parameters.
+  /// Other instances with the same input copy these from the cache instead.
+  /// Because the cached interpolators refer to the intensity image of the
+  /// first instance, these instances must share the same RegisteredImage,
+  /// which must not be modified or destroyed while the cache is in use.
+  mirtkPublicAggregateMacro(ImageStatisticsCache, SharedImageStatistics);
+
 private:
 
+  /// T1-weighted image intensities sampled along normal rays
+  ///
+  /// The sample buffers are reused by subsequent updates and only reallocated
+  /// when their size increases, i.e., after the surface was remeshed.
+  SampleBuffer _T1IntensitySamples;
+
+  /// T1-weighted image directional derivatives sampled along normal rays
+  SampleBuffer _T1GradientSamples;
+
+  /// T2-weighted image intensities sampled along normal rays
+  SampleBuffer _T2IntensitySamples;
+
+  /// T2-weighted image directional derivatives sampled along normal rays
+  SampleBuffer _T2GradientSamples;
+
+  /// Edge distances copied before median filtering or smoothing
+  SampleBuffer _InputDistances;
+
+  /// Edge distances of previous smoothing iteration
+  SampleBuffer _SmoothedDistances;
+
+  /// Edge distances of each node and its neighbors, sorted by median filter
+  SampleBuffer _NeighborDistances;
+
+  /// Offsets of node neighborhoods in _NeighborDistances
+  Array<int> _NeighborOffsets;
+
+  /// Absolute edge distances of active nodes used to set distance threshold
+  SampleBuffer _AbsDistances;
+
+  /// Workspaces of the fixed blocks of points processed in parallel
+  Array<SharedPtr<BlockWorkspace> > _BlockWorkspaces;
+
   /// Copy attributes of this class from another instance
   void CopyAttributes(const ImageEdgeDistance &);
 
@@ -239,6 +347,25 @@ public:
   /// Initialize external force once input and parameters have been set
   virtual void Initialize();
 
+protected:
+
+  /// Compute image intensity statistics and initialize image interpolators
+  void InitializeImageStatistics();
+
+  /// Get input of image statistics computation
+  void GetImageStatisticsInput(ImageStatistics &) const;
+
+  /// Whether image statistics were computed with the same input
+  bool HasImageStatisticsInput(const ImageStatistics &) const;
+
+  /// Store computed image statistics
+  void SaveImageStatistics(ImageStatistics &) const;
+
+  /// Restore previously computed image statistics
+  void LoadImageStatistics(const ImageStatistics &);
+
+public:
+
   // ---------------------------------------------------------------------------
   // Evaluation
 
@@ -247,6 +374,29 @@ public:
   /// Update moving input points and internal state of force term
   virtual void Update(bool = true);
 
+  /// Build node neighborhoods used by median filter before concurrent evaluation
+  virtual void PrepareConcurrentEvaluation() const;
+
+  /// Evaluate interpolated image and its directional derivative along a ray
+  ///
+  /// Evaluates the image values and/or directional derivatives at the ray
+  /// points p + i * dp, with i in [begin, end), in a single pass which reuses
+  /// the B-spline coefficients of consecutive samples. Used by Update to
+  /// sample the intensity profiles along the node normals.
+  ///
+  /// \param[out] f     Image values at ray points. Not evaluated if \c nullptr.
+  /// \param[out] g     Directional derivatives along normalized dp at ray points.
+  ///                   Not evaluated if \c nullptr.
+  /// \param[in]  func  Cubic B-spline interpolated image.
+  /// \param[in]  p     Ray point with index 0 in image coordinates.
+  /// \param[in]  dp    Ray step in image coordinates.
+  /// \param[in]  begin Index of first ray point.
+  /// \param[in]  end   Index one past the last ray point.
+  /// \param[in]  jac   Pre-allocated 1x3 matrix used for boundary samples.
+  static void EvaluateRayProfile(double *f, double *g, const ContinuousImage *func,
+                                 const Point &p, const Vector3 &dp, int begin, int end,
+                                 Matrix &jac);
+
 protected:
 
   /// Evaluate external force term
@@ -0,0 +1,168 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright 2013-2017 Imperial College London
+ * Copyright 2013-2017 Andreas Schuh
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MIRTK_LocalBoxStatistics_H
+#define MIRTK_LocalBoxStatistics_H
+
+#include "mirtk/Object.h"
+
+#include "mirtk/Array.h"
+#include "mirtk/ImageAttributes.h"
+#include "mirtk/GenericImage.h"
+
+
+namespace mirtk {
+
+
+/**
+ * Masked intensity sums within a box window centered at each voxel
+ *
+ * For each voxel, the number of foreground voxels and the sum of their
+ * intensities and squared intensities within a cubic window of given radius
+ * (clipped at the image boundary) are computed using separable running sums
+ * along each image axis. The cost is thus linear in the number of voxels
+ * and independent of the window size, unlike a brute-force evaluation of the
+ * window sums at each voxel. The memory required to store the window sums is
+ * 20 bytes per voxel.
+ */
+class LocalBoxStatistics : public Object
+{
+  mirtkObjectMacro(LocalBoxStatistics);
+
+  // ---------------------------------------------------------------------------
+  // Attributes
+
+  /// Radius of box window in number of voxels, i.e., the window size is 2 * radius + 1
+  mirtkPublicAttributeMacro(int, Radius);
+
+  /// Image domain of computed window sums
+  mirtkReadOnlyAttributeMacro(ImageAttributes, Domain);
+
+protected:
+
+  /// Number of foreground voxels within window
+  Array<int> _Count;
+
+  /// Sum of foreground intensities within window
+  Array<double> _Sum;
+
+  /// Sum of squared foreground intensities within window
+  Array<double> _Sum2;
+
+  /// Copy attributes of this class from another instance
+  void CopyAttributes(const LocalBoxStatistics &);
+
+  // ---------------------------------------------------------------------------
+  // Construction/Destruction
+public:
+
+  /// Constructor
+  LocalBoxStatistics(int radius = 0);
+
+  /// Copy constructor
+  LocalBoxStatistics(const LocalBoxStatistics &);
+
+  /// Assignment operator
+  LocalBoxStatistics &operator =(const LocalBoxStatistics &);
+
+  /// Destructor
+  virtual ~LocalBoxStatistics();
+
+  /// Free memory of window sums
+  void Clear();
+
+  // ---------------------------------------------------------------------------
+  // Execution
+
+  /// Compute window sums of input intensities
+  ///
+  /// \param[in] image Intensity image. Only the first channel/frame is used.
+  /// \param[in] mask  Foreground mask. When \c nullptr, all voxels are foreground.
+  void Compute(const BaseImage *image, const BinaryImage *mask = nullptr);
+
+  /// Compute window sums of input intensities by summing over each window
+  ///
+  /// This reference implementation visits all voxels of the window centered
+  /// at each voxel, i.e., its cost grows with the cube of the window size.
+  /// It is used to verify the results of Compute.
+  ///
+  /// \param[in] image Intensity image. Only the first channel/frame is used.
+  /// \param[in] mask  Foreground mask. When \c nullptr, all voxels are foreground.
+  void ComputeBruteForce(const BaseImage *image, const BinaryImage *mask = nullptr);
+
+  // ---------------------------------------------------------------------------
+  // Results
+
+  /// Number of foreground voxels within window centered at the specified voxel
+  int Count(int idx) const;
+
+  /// Sum of foreground intensities within window centered at the specified voxel
+  double Sum(int idx) const;
+
+  /// Sum of squared foreground intensities within window centered at the specified voxel
+  double SumOfSquares(int idx) const;
+
+  /// Mean foreground intensity within window centered at the specified voxel
+  double Mean(int idx) const;
+
+  /// Variance of foreground intensities within window centered at the specified voxel
+  double Variance(int idx) const;
+
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Inline definitions
+////////////////////////////////////////////////////////////////////////////////
+
+// -----------------------------------------------------------------------------
+inline int LocalBoxStatistics::Count(int idx) const
+{
+  return _Count[idx];
+}
+
+// -----------------------------------------------------------------------------
+inline double LocalBoxStatistics::Sum(int idx) const
+{
+  return _Sum[idx];
+}
+
+// -----------------------------------------------------------------------------
+inline double LocalBoxStatistics::SumOfSquares(int idx) const
+{
+  return _Sum2[idx];
+}
+
+// -----------------------------------------------------------------------------
+inline double LocalBoxStatistics::Mean(int idx) const
+{
+  return (_Count[idx] == 0 ? 0. : _Sum[idx] / _Count[idx]);
+}
+
+// -----------------------------------------------------------------------------
+inline double LocalBoxStatistics::Variance(int idx) const
+{
+  if (_Count[idx] == 0) return 0.;
+  const double mean = _Sum[idx] / _Count[idx];
+  return _Sum2[idx] / _Count[idx] - mean * mean;
+}
+
+
+} // namespace mirtk
+
+#endif // MIRTK_LocalBoxStatistics_H
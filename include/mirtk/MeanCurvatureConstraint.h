@@ -22,6 +22,8 @@
 
 #include "mirtk/SurfaceConstraint.h"
 
+#include "mirtk/Array.h"
+
 #include "vtkSmartPointer.h"
 #include "vtkDataArray.h"
 
@@ -42,6 +44,24 @@ class MeanCurvatureConstraint : public SurfaceConstraint
   /// Maximum absolute mean curvature
   mirtkAttributeMacro(double, MaxMeanCurvature);
 
+protected:
+
+  /// Indices of points (i, j, k, l) of each pair of adjacent triangles (i, j, k)
+  /// and (i, k, l) sharing the edge (i, k), computed once after each remeshing
+  Array<int> _EdgeQuads;
+
+  /// Offsets of points in _PointQuadSlots, i.e., point to quad adjacency
+  Array<int> _PointQuadOffsets;
+
+  /// Indices 4 * quad + vertex of quad vertices ordered by point index
+  Array<int> _PointQuadSlots;
+
+  /// Gradient contributions of each edge quad to its four points
+  Array<GradientType> _QuadGradient;
+
+  /// Whether an edge quad contributes to the gradient of its points
+  Array<char> _QuadContributes;
+
   /// Copy attributes of this class from another instance
   void CopyAttributes(const MeanCurvatureConstraint &);
 
@@ -68,11 +88,17 @@ public:
   /// Initialize force term once input and parameters have been set
   virtual void Initialize();
 
+  /// Reinitialize internal force term after change of input topology
+  virtual void Reinitialize();
+
   /// Update internal force data structures
   virtual void Update(bool);
 
 protected:
 
+  /// Common (re-)initialization code of this class only (non-virtual function!)
+  void Init();
+
   /// Evaluate energy of internal force term
   virtual double Evaluate();
 
@@ -54,9 +54,6 @@ public:
     double _Distance;  ///< Current node distance
   };
 
-  /// Array of computed distances to neighboring nodes
-  typedef Array<NodeDistances> DistancesArray;
-
   // ---------------------------------------------------------------------------
   // Attributes
 
@@ -66,8 +63,15 @@ public:
   /// Area of initial surface mesh
   mirtkAttributeMacro(double, InitialArea);
 
-  /// For each node, the initial and current distances to their neighboring nodes
-  mirtkAttributeMacro(Array<DistancesArray>, Distances);
+  /// Offsets of first neighbor of each node in _NeighborIds and _Distances,
+  /// where the last entry is the total number of neighbor entries
+  mirtkAttributeMacro(Array<int>, NeighborOffsets);
+
+  /// Indices of neighboring nodes in compressed sparse row format
+  mirtkAttributeMacro(Array<int>, NeighborIds);
+
+  /// Initial and current distances to neighboring nodes in compressed sparse row format
+  mirtkAttributeMacro(Array<NodeDistances>, Distances);
 
   /// Copy attributes of this class from another instance
   void CopyAttributes(const MetricDistortion &);
@@ -0,0 +1,201 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright 2013-2017 Imperial College London
+ * Copyright 2013-2017 Andreas Schuh
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MIRTK_ParallelSurfaceRemeshing_H
+#define MIRTK_ParallelSurfaceRemeshing_H
+
+#include "mirtk/Object.h"
+
+#include "mirtk/Array.h"
+
+#include "vtkSmartPointer.h"
+#include "vtkPolyData.h"
+#include "vtkDataArray.h"
+
+
+namespace mirtk {
+
+
+/**
+ * Local remeshing of a triangulated surface mesh by concurrent edge operations
+ *
+ * Edges shorter than the minimum edge length are collapsed and edges longer
+ * than the maximum edge length are split. Unlike SurfaceRemeshing, which
+ * processes the edges one at a time, each round of this filter selects an
+ * independent set of edits whose neighborhoods do not overlap, and applies
+ * these in parallel. An edit is selected when it has the highest priority
+ * within its neighborhood, where shorter edges are collapsed and longer edges
+ * are split first, and ties are broken by the node indices. The selected
+ * edits and thus the output mesh depend only on the input mesh, but neither
+ * on the number of threads nor on the task scheduling.
+ *
+ * An edge is collapsed into its midpoint only when this preserves the manifold
+ * topology and does not flip the normal of any adjacent triangle. The point
+ * data of a node inserted by an edge split or moved by an edge collapse is
+ * the average of the point data of the edge end points. New triangles copy
+ * the cell data of the triangle they were split from. Nodes whose mask value
+ * is zero are neither moved nor removed, and their edges are not split.
+ *
+ * In contrast to SurfaceRemeshing, triangles are neither inverted nor melted,
+ * and all edges share the same edge length interval.
+ */
+class ParallelSurfaceRemeshing : public Object
+{
+  mirtkObjectMacro(ParallelSurfaceRemeshing);
+
+  // ---------------------------------------------------------------------------
+  // Attributes
+
+  /// Input triangulated surface mesh
+  mirtkPublicAttributeMacro(vtkSmartPointer<vtkPolyData>, Input);
+
+  /// Mask of nodes which may be modified, all nodes when \c nullptr
+  mirtkPublicAttributeMacro(vtkSmartPointer<vtkDataArray>, PointMask);
+
+  /// Minimum edge length, shorter edges are collapsed
+  mirtkPublicAttributeMacro(double, MinEdgeLength);
+
+  /// Maximum edge length, longer edges are split
+  mirtkPublicAttributeMacro(double, MaxEdgeLength);
+
+  /// Minimum angle between edge node normals for an edge be excluded from collapsing
+  mirtkPublicAttributeMacro(double, MinFeatureAngle);
+
+  /// Maximum angle between edge node normals for an edge be excluded from splitting
+  mirtkPublicAttributeMacro(double, MaxFeatureAngle);
+
+  /// Maximum number of rounds of concurrent edge collapses and splits, respectively
+  mirtkPublicAttributeMacro(int, MaxNumberOfRounds);
+
+  /// Output surface mesh, same as input when no edge was modified
+  mirtkReadOnlyAttributeMacro(vtkSmartPointer<vtkPolyData>, Output);
+
+  /// Number of collapsed edges
+  mirtkReadOnlyAttributeMacro(int, NumberOfCollapses);
+
+  /// Number of split edges
+  mirtkReadOnlyAttributeMacro(int, NumberOfSplits);
+
+  /// Number of rounds of concurrent edits
+  mirtkReadOnlyAttributeMacro(int, NumberOfRounds);
+
+protected:
+
+  /// Node positions, three values per node
+  Array<double> _Points;
+
+  /// Node normals, three values per node, only used to detect feature edges
+  Array<double> _Normals;
+
+  /// Whether node must not be modified
+  Array<char> _Fixed;
+
+  /// Whether node was removed by an edge collapse
+  Array<char> _Deleted;
+
+  /// Point data of nodes, _PointDataSize values per node
+  Array<double> _PointData;
+
+  /// Number of point data components
+  int _PointDataSize;
+
+  /// Node indices of triangles, where removed triangles have indices -1
+  Array<int> _Triangles;
+
+  /// Cell data of triangles, _CellDataSize values per triangle
+  Array<double> _CellData;
+
+  /// Number of cell data components
+  int _CellDataSize;
+
+  /// Offsets of first triangle adjacent to each node in _Links
+  Array<int> _LinkOffsets;
+
+  /// Indices of triangles adjacent to each node in compressed sparse row format
+  Array<int> _Links;
+
+  /// Number of adjacent nodes of a closed manifold neighborhood, -1 otherwise
+  Array<int> _Valence;
+
+  // ---------------------------------------------------------------------------
+  // Construction/Destruction
+private:
+
+  /// Copy construction
+  /// \note Intentionally not implemented.
+  ParallelSurfaceRemeshing(const ParallelSurfaceRemeshing &);
+
+  /// Assignment operator
+  /// \note Intentionally not implemented.
+  ParallelSurfaceRemeshing &operator =(const ParallelSurfaceRemeshing &);
+
+public:
+
+  /// Constructor
+  ParallelSurfaceRemeshing();
+
+  /// Destructor
+  virtual ~ParallelSurfaceRemeshing();
+
+  // ---------------------------------------------------------------------------
+  // Execution
+
+  /// Remesh input surface
+  void Run();
+
+protected:
+
+  /// Copy input surface mesh
+  void Initialize();
+
+  /// Build node to triangle links of current mesh
+  ///
+  /// The links are rebuilt at the start of every round, because the edits of
+  /// the previous round modify the triangles of many nodes. Triangles are
+  /// counted and inserted in parallel, and only the prefix sum over the nodes
+  /// is serial. The links of each node are sorted by triangle index, such that
+  /// the edits selected next do not depend on the number of threads.
+  void BuildLinks();
+
+  /// Compute node normals of current mesh
+  void ComputeNormals();
+
+  /// Perform one round of concurrent edge collapses
+  ///
+  /// \returns Number of collapsed edges.
+  int CollapseEdges();
+
+  /// Perform one round of concurrent edge splits
+  ///
+  /// \returns Number of split edges.
+  int SplitEdges();
+
+  /// Assemble output surface mesh
+  ///
+  /// The indices of remaining nodes and triangles are compacted by a serial
+  /// scan, whereas the points, triangles, and attributes are copied in
+  /// parallel. The links of the output mesh are built by VTK in serial.
+  void Finalize();
+
+};
+
+
+} // namespace mirtk
+
+#endif // MIRTK_ParallelSurfaceRemeshing_H
@@ -22,6 +22,7 @@
 
 #include "mirtk/EnergyTerm.h"
 
+#include "mirtk/Array.h"
 #include "mirtk/UnorderedMap.h"
 #include "mirtk/Vector3D.h"
 #include "mirtk/RegisteredPointSet.h"
@@ -86,6 +87,12 @@ protected:
   /// Number of points
   mirtkReadOnlyAttributeMacro(int, NumberOfPoints);
 
+  /// Indices of nodes at which subclasses supporting it evaluate the gradient
+  ///
+  /// Set by DeformableSurfaceModel when active set evaluation is enabled.
+  /// The gradient is evaluated at all nodes when \c nullptr.
+  mirtkPublicAggregateMacro(const Array<int>, ActivePoints);
+
   /// Negative node forces/gradient of external force term
   mirtkComponentMacro(GradientType, Gradient);
 
@@ -130,6 +137,15 @@ protected:
   /// Get point status array
   vtkDataArray *Status() const;
 
+  /// Get number of nodes at which the gradient is evaluated
+  int NumberOfActivePoints() const;
+
+  /// Get indices of nodes at which the gradient is evaluated
+  ///
+  /// \returns Pointer to NumberOfActivePoints() node indices, or \c nullptr
+  ///          when the gradient is evaluated at all nodes.
+  const int *ActivePointIds() const;
+
   /// Get point normals array
   vtkDataArray *Normals() const;
 
@@ -263,12 +279,27 @@ public:
   /// reparameterized, e.g., by a local remeshing filter.
   virtual void Reinitialize();
 
+  using EnergyTerm::InitialValue;
+
+  /// Set initial value of force term
+  ///
+  /// Used to restore the value by which the energy is divided when
+  /// DivideByInitialValue is enabled and an integration is resumed.
+  void InitialValue(double);
+
   // ---------------------------------------------------------------------------
   // Evaluation
 
   /// Update moving input points and internal state of force term
   virtual void Update(bool = true);
 
+  /// Build lazily initialized shared state of the point set used by this term
+  ///
+  /// This function is called before force terms are updated and evaluated
+  /// concurrently such that no two terms build the same shared data, e.g.,
+  /// the node neighborhoods of a given radius, at the same time.
+  virtual void PrepareConcurrentEvaluation() const;
+
 protected:
 
   /// Evaluate gradient of force term
@@ -339,6 +370,18 @@ inline vtkDataArray *PointSetForce::Status() const
   return _SurfaceForce ? _PointSet->SurfaceStatus() : _PointSet->Status();
 }
 
+// -----------------------------------------------------------------------------
+inline int PointSetForce::NumberOfActivePoints() const
+{
+  return _ActivePoints ? static_cast<int>(_ActivePoints->size()) : _NumberOfPoints;
+}
+
+// -----------------------------------------------------------------------------
+inline const int *PointSetForce::ActivePointIds() const
+{
+  return _ActivePoints ? _ActivePoints->data() : nullptr;
+}
+
 // -----------------------------------------------------------------------------
 inline vtkDataArray *PointSetForce::Normals() const
 {
@@ -72,6 +72,9 @@ public:
   /// Update internal force data structures
   virtual void Update(bool);
 
+  /// Build node neighborhoods used by quadratic fit before concurrent evaluation
+  virtual void PrepareConcurrentEvaluation() const;
+
 protected:
 
   /// Compute penalty for current transformation estimate
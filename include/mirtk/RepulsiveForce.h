@@ -22,6 +22,8 @@
 
 #include "mirtk/SurfaceConstraint.h"
 
+#include "mirtk/Array.h"
+
 #include "vtkSmartPointer.h"
 #include "vtkAbstractPointLocator.h"
 
@@ -39,6 +41,29 @@ class RepulsiveForce : public SurfaceConstraint
 {
   mirtkEnergyTermMacro(RepulsiveForce, EM_RepulsiveForce);
 
+  // ---------------------------------------------------------------------------
+  // Types
+
+public:
+
+  /// Enumeration of data structures used to find nodes within the force radius
+  enum NeighborSearchMethod
+  {
+    OctreeSearch, ///< VTK octree point locator
+    GridSearch    ///< Uniform grid with cell size equal to the force radius
+  };
+
+  /// Uniform grid of nodes used for fixed radius neighbor queries
+  struct PointGrid
+  {
+    double     _Origin[3]; ///< World coordinates of first grid cell corner
+    double     _CellSize;  ///< Side length of grid cells
+    int        _Size[3];   ///< Number of grid cells along each dimension
+    Array<int> _Offsets;   ///< Offset of first node of each grid cell in _PointIds
+    Array<int> _PointIds;  ///< Indices of nodes ordered by grid cell
+    Array<int> _CellIds;   ///< Index of grid cell containing each node
+  };
+
   // ---------------------------------------------------------------------------
   // Attributes
 
@@ -56,9 +81,19 @@ class RepulsiveForce : public SurfaceConstraint
   /// weight of this force term.
   mirtkPublicAttributeMacro(double, BackfaceRadius);
 
-  /// Point locator
+  /// Data structure used to find nodes within the force radius (default: OctreeSearch)
+  ///
+  /// Both methods find the same neighbors, but sum their forces in a
+  /// different order. The octree is the default for reproducibility of
+  /// results obtained before the uniform grid was available.
+  mirtkPublicAttributeMacro(NeighborSearchMethod, NeighborSearch);
+
+  /// Point locator used by OctreeSearch
   mirtkAttributeMacro(vtkSmartPointer<vtkAbstractPointLocator>, Locator);
 
+  /// Uniform grid of nodes used by GridSearch
+  mirtkAttributeMacro(PointGrid, Grid);
+
   /// Copy attributes of this class from another instance
   void CopyAttributes(const RepulsiveForce &);
 
@@ -120,6 +155,13 @@ protected:
 
 };
 
+////////////////////////////////////////////////////////////////////////////////
+// Enum <-> string conversion
+////////////////////////////////////////////////////////////////////////////////
+
+template <> bool FromString(const char *, enum RepulsiveForce::NeighborSearchMethod &);
+template <> string ToString(const enum RepulsiveForce::NeighborSearchMethod &, int, char, bool);
+
 
 } // namespace mirtk
 
@@ -0,0 +1,144 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright 2013-2017 Imperial College London
+ * Copyright 2013-2017 Andreas Schuh
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MIRTK_SemiImplicitEulerMethod_H
+#define MIRTK_SemiImplicitEulerMethod_H
+
+#include "mirtk/EulerMethod.h"
+
+#include "mirtk/Array.h"
+
+
+namespace mirtk {
+
+
+/**
+ * Minimizes deformable surface model using Euler steps with a smoothed gradient
+ *
+ * The node forces are evaluated at the current node positions as in
+ * EulerMethod, but the resulting explicit displacements \f$d^*\f$ are
+ * replaced by the solution of the sparse linear system
+ * \f$(I + \lambda L) d = d^*\f$, where \f$L\f$ is the graph Laplacian of
+ * the surface mesh. Each step is thus an explicit Euler step whose descent
+ * direction is preconditioned by the smoothing operator
+ * \f$(I + \lambda L)^{-1}\f$, i.e., a Sobolev gradient step. This damps the
+ * high frequency components of the node displacements that limit the step
+ * length of the explicit methods when spring or curvature forces are strong.
+ * It is not an implicit integration of the model forces themselves, which
+ * are neither linearized nor evaluated at the new node positions. The name
+ * refers to the backward Euler step of the additional membrane smoothing
+ * term (implicit fairing) by which the displacements are preconditioned.
+ * The system is solved by a conjugate gradient method with Jacobi
+ * preconditioner, using the explicit displacements as initial guess.
+ * The workspace of the solver is kept across steps.
+ *
+ * Because \f$(I + \lambda L)^{-1}\f$ is an averaging operator, the maximum
+ * node displacement does not increase. Passive nodes, i.e., nodes whose
+ * "Status" is zero, are not displaced.
+ *
+ * \note This optimizer has no OptimizationMethod enumeration value of its own,
+ *       and thus cannot be created by LocalOptimizer::New. Its
+ *       OptimizationMethod is the one of the EulerMethod base class.
+ */
+class SemiImplicitEulerMethod : public EulerMethod
+{
+  mirtkObjectMacro(SemiImplicitEulerMethod);
+
+  // ---------------------------------------------------------------------------
+  // Attributes
+
+  /// Weight \f$\lambda\f$ of implicit Laplacian smoothing of node displacements
+  mirtkPublicAttributeMacro(double, ImplicitSmoothing);
+
+  /// Maximum number of conjugate gradient iterations per integration step
+  mirtkPublicAttributeMacro(int, MaximumNumberOfCGIterations);
+
+  /// Relative residual norm at which conjugate gradient iterations stop
+  mirtkPublicAttributeMacro(double, CGTolerance);
+
+  /// Number of conjugate gradient iterations of last integration step
+  mirtkReadOnlyAttributeMacro(int, LastNumberOfCGIterations);
+
+  /// Copy attributes of this class from another instance
+  void CopyAttributes(const SemiImplicitEulerMethod &);
+
+  // ---------------------------------------------------------------------------
+  // Construction/Destruction
+public:
+
+  /// Constructor
+  SemiImplicitEulerMethod(ObjectiveFunction * = NULL);
+
+  /// Copy constructor
+  SemiImplicitEulerMethod(const SemiImplicitEulerMethod &);
+
+  /// Assignment operator
+  SemiImplicitEulerMethod &operator =(const SemiImplicitEulerMethod &);
+
+  /// Destructor
+  virtual ~SemiImplicitEulerMethod();
+
+  // ---------------------------------------------------------------------------
+  // Parameters
+  using LocalOptimizer::Parameter;
+
+  /// Set parameter value from string
+  virtual bool Set(const char *, const char *);
+
+  /// Get parameters as key/value as string map
+  virtual ParameterList Parameter() const;
+
+  // ---------------------------------------------------------------------------
+  // Execution
+
+  /// Update node displacements
+  virtual void UpdateDisplacement();
+
+protected:
+
+  /// Precondition node displacements by the smoothing operator, i.e.,
+  /// solve \f$(I + \lambda L) d = d^*\f$ in-place for \f$d\f$
+  ///
+  /// \returns Number of conjugate gradient iterations.
+  virtual int PreconditionDisplacement();
+
+  /// Whether node is passive, i.e., not displaced
+  Array<char> _Passive;
+
+  /// Diagonal of system matrix, which is also the Jacobi preconditioner
+  Array<double> _Diagonal;
+
+  /// Residual of conjugate gradient iterations
+  Array<double> _Residual;
+
+  /// Jacobi preconditioned residual
+  Array<double> _Preconditioned;
+
+  /// Conjugate search direction
+  Array<double> _Direction;
+
+  /// System matrix times conjugate search direction
+  Array<double> _MatrixTimesDirection;
+
+};
+
+
+} // namespace mirtk
+
+#endif // MIRTK_SemiImplicitEulerMethod_H
@@ -22,6 +22,8 @@
 
 #include "mirtk/InternalForce.h"
 
+#include "mirtk/SurfaceCurvatureCache.h"
+
 
 namespace mirtk {
 
@@ -36,6 +38,21 @@ class SurfaceConstraint : public InternalForce
 {
   mirtkAbstractMacro(SurfaceConstraint);
 
+  // ---------------------------------------------------------------------------
+  // Attributes
+
+  /// Curvature cache of deformed surface shared with other surface constraints
+  ///
+  /// When set, e.g., by the deformable surface model, all terms which require
+  /// curvatures of the deformed surface share a single cache, such that these
+  /// are computed only once after the surface has deformed.
+  mirtkPublicAggregateMacro(SurfaceCurvatureCache, SharedCurvatureCache);
+
+protected:
+
+  /// Curvature cache used when no shared curvature cache is set
+  SurfaceCurvatureCache _LocalCurvatureCache;
+
   // ---------------------------------------------------------------------------
   // Construction/Destruction
 
@@ -50,11 +67,19 @@ protected:
   /// Assignment operator
   SurfaceConstraint &operator =(const SurfaceConstraint &);
 
+  /// Copy attributes of this class from another instance
+  void CopyAttributes(const SurfaceConstraint &);
+
 public:
 
   /// Destructor
   virtual ~SurfaceConstraint();
 
+protected:
+
+  /// Get curvature cache of deformed surface
+  SurfaceCurvatureCache &CurvatureCache();
+
 };
 
 
@@ -0,0 +1,149 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright 2013-2017 Imperial College London
+ * Copyright 2013-2017 Andreas Schuh
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MIRTK_SurfaceCurvatureCache_H
+#define MIRTK_SurfaceCurvatureCache_H
+
+#include "mirtk/Object.h"
+
+#include "mirtk/Memory.h"
+#include "mirtk/EdgeTable.h"
+
+#include "vtkSmartPointer.h"
+#include "vtkPolyData.h"
+#include "vtkPointData.h"
+#include "vtkDataArray.h"
+#include "vtkPoints.h"
+
+#include <mutex>
+
+
+namespace mirtk {
+
+
+/**
+ * Cached smoothed curvatures and node neighborhood centroids of a deformed surface
+ *
+ * The curvatures are computed by SurfaceCurvature using the vtkCurvatures
+ * definitions, and subsequently smoothed by MeshSmoothing. The cached values
+ * are valid as long as the surface and the modification time of its points
+ * are unchanged. Energy terms register the curvature types they require upon
+ * initialization, such that all curvatures required by any of the terms are
+ * computed by a single update after the surface has deformed. A single
+ * instance can thus be shared by all curvature based energy terms of a
+ * deformable surface model.
+ */
+class SurfaceCurvatureCache : public Object
+{
+  mirtkObjectMacro(SurfaceCurvatureCache);
+
+  // ---------------------------------------------------------------------------
+  // Attributes
+
+  /// Types of curvatures computed by an update, see SurfaceCurvature::Type
+  mirtkReadOnlyAttributeMacro(int, CurvatureTypes);
+
+  /// Number of iterations of curvature smoothing
+  mirtkPublicAttributeMacro(int, NumberOfSmoothingIterations);
+
+  /// Number of times curvatures were computed
+  mirtkReadOnlyAttributeMacro(int, NumberOfUpdates);
+
+protected:
+
+  /// Surface mesh of last update
+  vtkSmartPointer<vtkPolyData> _Surface;
+
+  /// Modification time of surface points at last update
+  vtkMTimeType _PointsMTime;
+
+  /// Types of curvatures computed since last change of surface points
+  int _ComputedTypes;
+
+  /// Smoothed curvature arrays
+  vtkSmartPointer<vtkPointData> _Curvatures;
+
+  /// Centroids of adjacent nodes
+  vtkSmartPointer<vtkPoints> _Centroids;
+
+  /// Serializes concurrent updates by energy terms updated in parallel
+  std::mutex _Mutex;
+
+  /// Copy attributes of this class from another instance
+  void CopyAttributes(const SurfaceCurvatureCache &);
+
+  // ---------------------------------------------------------------------------
+  // Construction/Destruction
+public:
+
+  /// Constructor
+  SurfaceCurvatureCache();
+
+  /// Copy constructor
+  SurfaceCurvatureCache(const SurfaceCurvatureCache &);
+
+  /// Assignment operator
+  SurfaceCurvatureCache &operator =(const SurfaceCurvatureCache &);
+
+  /// Destructor
+  virtual ~SurfaceCurvatureCache();
+
+  /// Discard cached values and registered curvature types
+  void Clear();
+
+  /// Add types of curvatures to compute upon next update
+  void AddCurvatureTypes(int);
+
+  // ---------------------------------------------------------------------------
+  // Update
+
+  /// Get smoothed curvature of given surface
+  ///
+  /// Concurrent calls are serialized. When the surface points changed since
+  /// the last update, all registered curvature types are computed at once.
+  /// The returned array is not modified by subsequent updates.
+  ///
+  /// \param[in] surface   Surface mesh.
+  /// \param[in] type      Type of curvature, e.g., SurfaceCurvature::Mean.
+  /// \param[in] edgeTable Edge table of surface mesh. Computed if \c nullptr.
+  ///
+  /// \returns Smoothed curvature array, or \c nullptr if type is not supported.
+  vtkSmartPointer<vtkDataArray> Curvature(vtkPolyData *surface, int type,
+                                          SharedPtr<const EdgeTable> edgeTable = nullptr);
+
+  /// Get centroids of adjacent nodes of given surface
+  ///
+  /// Concurrent calls are serialized. The returned points are not modified by
+  /// subsequent updates.
+  ///
+  /// \param[in] surface   Surface mesh.
+  /// \param[in] edgeTable Edge table of surface mesh.
+  vtkSmartPointer<vtkPoints> Centroids(vtkPolyData *surface, const EdgeTable *edgeTable);
+
+protected:
+
+  /// Discard cached values if surface points changed since last update
+  void Invalidate(vtkPolyData *surface);
+
+};
+
+
+} // namespace mirtk
+
+#endif // MIRTK_SurfaceCurvatureCache_H
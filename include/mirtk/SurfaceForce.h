@@ -21,6 +21,7 @@
 #define MIRTK_SurfaceForce_H
 
 #include "mirtk/ExternalForce.h"
+#include "mirtk/SurfaceInsideMask.h"
 
 
 namespace mirtk {
@@ -38,6 +39,21 @@ class SurfaceForce : public ExternalForce
 {
   mirtkAbstractMacro(SurfaceForce);
 
+  // ---------------------------------------------------------------------------
+  // Attributes
+
+  /// Inside mask cache of deformed surface shared with other surface forces
+  ///
+  /// When set, e.g., by the deformable surface model, all forces which require
+  /// the inside mask of the deformed surface share a single incrementally
+  /// updated mask instead of each rasterizing the surface on their own.
+  mirtkPublicAggregateMacro(SurfaceInsideMask, SharedInsideMask);
+
+protected:
+
+  /// Inside mask cache used when no shared inside mask cache is set
+  SurfaceInsideMask _LocalInsideMask;
+
   // ---------------------------------------------------------------------------
   // Construction/Destruction
 protected:
@@ -87,6 +103,14 @@ public:
   ///          distance equal to length of rays \p l.
   double SelfDistance(const double p[3], const double n[3], double maxd = .0) const;
 
+protected:
+
+  /// Get binary mask of image voxels inside the deformed surface
+  ///
+  /// The mask is defined on the image lattice of the external force and is
+  /// updated incrementally upon each call after the surface has deformed.
+  const BinaryImage &InsideMask();
+
 };
 
 
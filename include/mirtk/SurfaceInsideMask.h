@@ -0,0 +1,161 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright 2013-2017 Imperial College London
+ * Copyright 2013-2017 Andreas Schuh
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MIRTK_SurfaceInsideMask_H
+#define MIRTK_SurfaceInsideMask_H
+
+#include "mirtk/Object.h"
+
+#include "mirtk/ImageAttributes.h"
+#include "mirtk/GenericImage.h"
+#include "mirtk/Array.h"
+
+#include "vtkSmartPointer.h"
+#include "vtkPolyData.h"
+#include "vtkPoints.h"
+
+#include <mutex>
+
+
+namespace mirtk {
+
+
+/**
+ * Cached binary mask of image voxels inside a closed deformable surface
+ *
+ * The mask is updated incrementally. When the surface topology and the image
+ * lattice are unchanged since the last update, only the voxels of the region
+ * swept by the cells adjacent to points that moved since the last update are
+ * rasterized again. This region is the set of bricks, i.e., cubic blocks of
+ * voxels of size BrickSize, which overlap the voxel bounding box of any such
+ * cell, such that scattered motion at distant surface patches does not lead
+ * to the rasterization of the voxels in between. The dirty bricks are
+ * rasterized as a few disjoint boxes. Only the cells crossing the z slices of
+ * these boxes are mapped to voxel coordinates for this, and only the moved
+ * points are copied for the next update. When the boxes cover more than the
+ * MaxPartialUpdateRatio of the image volume, the entire mask is rasterized
+ * instead, because each box requires a separate stencil computation.
+ *
+ * A single instance can thus be shared by multiple surface forces which require
+ * the inside mask of the same deformed surface within the same iteration.
+ */
+class SurfaceInsideMask : public Object
+{
+  mirtkObjectMacro(SurfaceInsideMask);
+
+  // ---------------------------------------------------------------------------
+  // Attributes
+
+  /// Side length of cubic bricks of voxels marked as swept by moving cells
+  mirtkPublicAttributeMacro(int, BrickSize);
+
+  /// Maximum ratio of swept voxels to all voxels for which a partial update is done
+  mirtkPublicAttributeMacro(double, MaxPartialUpdateRatio);
+
+  /// Binary mask of voxels inside the surface
+  mirtkReadOnlyAttributeMacro(BinaryImage, Mask);
+
+  /// Number of times the entire mask was rasterized
+  mirtkReadOnlyAttributeMacro(int, NumberOfFullUpdates);
+
+  /// Number of times only a sub-region of the mask was rasterized
+  mirtkReadOnlyAttributeMacro(int, NumberOfPartialUpdates);
+
+protected:
+
+  /// Surface mesh of last update
+  vtkSmartPointer<vtkPolyData> _Surface;
+
+  /// Copy of surface points at last update
+  vtkSmartPointer<vtkPoints> _Points;
+
+  /// Number of surface cells at last update
+  vtkIdType _NumberOfCells;
+
+  /// Flags of points which moved since the last update
+  Array<char> _Moved;
+
+  /// Flags of cells which intersect the z slabs of the mask regions to update
+  Array<char> _SelectedCells;
+
+  /// Indices of surface points in extracted slabs or -1 if not extracted
+  Array<vtkIdType> _PointIds;
+
+  /// Serializes concurrent updates by surface forces evaluated in parallel
+  std::mutex _Mutex;
+
+  /// Copy attributes of this class from another instance
+  void CopyAttributes(const SurfaceInsideMask &);
+
+  // ---------------------------------------------------------------------------
+  // Construction/Destruction
+public:
+
+  /// Constructor
+  SurfaceInsideMask();
+
+  /// Copy constructor
+  SurfaceInsideMask(const SurfaceInsideMask &);
+
+  /// Assignment operator
+  SurfaceInsideMask &operator =(const SurfaceInsideMask &);
+
+  /// Destructor
+  virtual ~SurfaceInsideMask();
+
+  /// Discard cached mask such that next update rasterizes the entire surface
+  void Clear();
+
+  // ---------------------------------------------------------------------------
+  // Update
+
+  /// Update inside mask of given surface
+  ///
+  /// Concurrent calls are serialized. The returned mask must not be accessed
+  /// while another thread may update it, i.e., during concurrent evaluation of
+  /// multiple energy terms, each term should call this function only once.
+  ///
+  /// \param[in] surface Closed surface mesh with points in world coordinates.
+  /// \param[in] attr    Image lattice attributes of inside mask.
+  ///
+  /// \returns Reference to updated inside mask.
+  const BinaryImage &Update(vtkPolyData *surface, const ImageAttributes &attr);
+
+protected:
+
+  /// Rasterize surface within given voxel extent of mask
+  ///
+  /// \param[in] pointset Surface mesh with points in voxel coordinates of mask.
+  /// \param[in] extent   Voxel extent of mask region to rasterize.
+  void Rasterize(vtkPointSet *pointset, const int extent[6]);
+
+  /// Extract cells of surface which intersect given z slabs of mask
+  ///
+  /// \param[in] surface Closed surface mesh with points in world coordinates.
+  /// \param[in] slabs   Pairs of first and last voxel z index of each slab.
+  ///
+  /// \returns Extracted cells with points in voxel coordinates of mask.
+  vtkSmartPointer<vtkPolyData> ExtractSlabs(vtkPolyData *surface, const Array<int> &slabs);
+
+};
+
+
+} // namespace mirtk
+
+#endif // MIRTK_SurfaceInsideMask_H
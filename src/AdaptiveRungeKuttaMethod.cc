@@ -0,0 +1,446 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright 2013-2017 Imperial College London
+ * Copyright 2013-2017 Andreas Schuh
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "mirtk/AdaptiveRungeKuttaMethod.h"
+
+#include "mirtk/Math.h"
+#include "mirtk/Parallel.h"
+#include "mirtk/DeformableSurfaceModel.h"
+
+#include "vtkDataArray.h"
+
+
+namespace mirtk {
+
+
+// =============================================================================
+// Auxiliary functors
+// =============================================================================
+
+namespace AdaptiveRungeKuttaMethodUtils {
+
+
+// -----------------------------------------------------------------------------
+/// Coefficients of the Bogacki-Shampine method
+const double A21 = 1. / 2.;
+const double A32 = 3. / 4.;
+const double B[3] = {2. / 9., 1. / 3., 4. / 9.};
+const double E[4] = {B[0] - 7. / 24., B[1] - 1. / 4., B[2] - 1. / 3., -1. / 8.};
+
+// -----------------------------------------------------------------------------
+/// Bounds of the factor by which the time step is changed after each step
+const double MinStepFactor = .2;
+const double MaxStepFactor = 5.;
+const double SafetyFactor  = .9;
+
+// -----------------------------------------------------------------------------
+/// Scale node vectors
+struct ScaleVectors
+{
+  const double *_Input;
+  double       *_Output;
+  double        _Scale;
+
+  void operator ()(const blocked_range<int> &re) const
+  {
+    for (int i = re.begin(); i != re.end(); ++i) {
+      _Output[i] = _Scale * _Input[i];
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Linear combination of up to four node vectors
+struct LinearCombination
+{
+  const double *_Input[4];
+  double        _Coeff[4];
+  int           _Number;
+  double       *_Output;
+
+  void operator ()(const blocked_range<int> &re) const
+  {
+    for (int i = re.begin(); i != re.end(); ++i) {
+      _Output[i] = 0.;
+      for (int j = 0; j < _Number; ++j) {
+        _Output[i] += _Coeff[j] * _Input[j][i];
+      }
+    }
+  }
+
+  static void Run(Array<double> &out, double h, int n, const Array<double> *k, const double *c)
+  {
+    LinearCombination eval;
+    for (int j = 0; j < n; ++j) {
+      eval._Input[j] = k[j].data();
+      eval._Coeff[j] = h * c[j];
+    }
+    eval._Number = n;
+    eval._Output = out.data();
+    parallel_for(blocked_range<int>(0, static_cast<int>(out.size())), eval);
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Difference of node vectors
+struct Subtract
+{
+  const double *_A;
+  const double *_B;
+  double       *_Output;
+
+  void operator ()(const blocked_range<int> &re) const
+  {
+    for (int i = re.begin(); i != re.end(); ++i) {
+      _Output[i] = _A[i] - _B[i];
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Add node vectors
+struct Add
+{
+  const double *_Input;
+  double       *_Output;
+
+  void operator ()(const blocked_range<int> &re) const
+  {
+    for (int i = re.begin(); i != re.end(); ++i) {
+      _Output[i] += _Input[i];
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Determine maximum norm of node vectors
+class MaxNorm
+{
+  const double *_Vectors;
+
+public:
+
+  double _Max;
+
+  MaxNorm(const double *v) : _Vectors(v), _Max(0.) {}
+
+  MaxNorm(const MaxNorm &other, split) : _Vectors(other._Vectors), _Max(0.) {}
+
+  void join(const MaxNorm &other)
+  {
+    if (other._Max > _Max) _Max = other._Max;
+  }
+
+  void operator ()(const blocked_range<int> &ptIds)
+  {
+    double norm;
+    const double *v = _Vectors + 3 * ptIds.begin();
+    for (int ptId = ptIds.begin(); ptId != ptIds.end(); ++ptId, v += 3) {
+      norm = v[0] * v[0] + v[1] * v[1] + v[2] * v[2];
+      if (norm > _Max) _Max = norm;
+    }
+  }
+
+  static double Run(const double *v, int n)
+  {
+    MaxNorm eval(v);
+    parallel_reduce(blocked_range<int>(0, n), eval);
+    return sqrt(eval._Max);
+  }
+};
+
+
+} // namespace AdaptiveRungeKuttaMethodUtils
+using namespace AdaptiveRungeKuttaMethodUtils;
+
+// =============================================================================
+// Construction/Destruction
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+AdaptiveRungeKuttaMethod::AdaptiveRungeKuttaMethod(ObjectiveFunction *f)
+:
+  EulerMethod(f),
+  _Tolerance(.1),
+  _TimeStep(0.),
+  _NumberOfAcceptedSteps(0),
+  _NumberOfRejectedSteps(0),
+  _NumberOfGradientEvaluations(0)
+{
+}
+
+// -----------------------------------------------------------------------------
+void AdaptiveRungeKuttaMethod::CopyAttributes(const AdaptiveRungeKuttaMethod &other)
+{
+  _Tolerance                   = other._Tolerance;
+  _TimeStep                    = other._TimeStep;
+  _NumberOfAcceptedSteps       = other._NumberOfAcceptedSteps;
+  _NumberOfRejectedSteps       = other._NumberOfRejectedSteps;
+  _NumberOfGradientEvaluations = other._NumberOfGradientEvaluations;
+}
+
+// -----------------------------------------------------------------------------
+AdaptiveRungeKuttaMethod::AdaptiveRungeKuttaMethod(const AdaptiveRungeKuttaMethod &other)
+:
+  EulerMethod(other)
+{
+  CopyAttributes(other);
+}
+
+// -----------------------------------------------------------------------------
+AdaptiveRungeKuttaMethod &AdaptiveRungeKuttaMethod::operator =(const AdaptiveRungeKuttaMethod &other)
+{
+  if (this != &other) {
+    EulerMethod::operator =(other);
+    CopyAttributes(other);
+  }
+  return *this;
+}
+
+// -----------------------------------------------------------------------------
+AdaptiveRungeKuttaMethod::~AdaptiveRungeKuttaMethod()
+{
+}
+
+// =============================================================================
+// Parameters
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+bool AdaptiveRungeKuttaMethod::Set(const char *name, const char *value)
+{
+  if (strcmp(name, "Integration error tolerance") == 0) {
+    return FromString(value, _Tolerance) && _Tolerance > 0.;
+  }
+  return EulerMethod::Set(name, value);
+}
+
+// -----------------------------------------------------------------------------
+ParameterList AdaptiveRungeKuttaMethod::Parameter() const
+{
+  ParameterList params = EulerMethod::Parameter();
+  Insert(params, "Integration error tolerance", _Tolerance);
+  return params;
+}
+
+// =============================================================================
+// Execution
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+void AdaptiveRungeKuttaMethod::EvaluateForce(Array<double> &f)
+{
+  _Model->Gradient(_Gradient);
+  ScaleVectors eval;
+  eval._Input  = _Gradient;
+  eval._Output = f.data();
+  eval._Scale  = -static_cast<double>(_Model->NumberOfPoints());
+  parallel_for(blocked_range<int>(0, static_cast<int>(f.size())), eval);
+  ++_NumberOfGradientEvaluations;
+}
+
+// -----------------------------------------------------------------------------
+void AdaptiveRungeKuttaMethod::MoveTo(const Array<double> &dx)
+{
+  const int n  = static_cast<int>(dx.size());
+  double   *d0 = static_cast<double *>(_Displacement->GetVoidPointer(0));
+  _Move.resize(n);
+
+  Subtract sub;
+  sub._A      = dx.data();
+  sub._B      = d0;
+  sub._Output = _Move.data();
+  parallel_for(blocked_range<int>(0, n), sub);
+
+  _Model->Step(_Move.data());
+
+  Add add;
+  add._Input  = _Move.data();
+  add._Output = d0;
+  parallel_for(blocked_range<int>(0, n), add);
+}
+
+// -----------------------------------------------------------------------------
+double AdaptiveRungeKuttaMethod::Run()
+{
+  double *dx;
+
+  // Initialize
+  this->Initialize();
+
+  // Restore state of interrupted integration, including the time step
+  _TimeStep = 0.;
+  const bool resume = (_Checkpoint != nullptr);
+  const int  iter0  = (resume ? this->RestoreCheckpoint() : 0);
+  _StepCount = iter0;
+
+  _NumberOfAcceptedSteps       = 0;
+  _NumberOfRejectedSteps       = 0;
+  _NumberOfGradientEvaluations = 0;
+
+  // Initial update of deformable surface model before start event
+  _Model->Update(true);
+
+  // Notify observers about start of optimization
+  Broadcast(StartEvent);
+
+  // Get initial energy value
+  double value = _Model->Value();
+  if (!resume) {
+    _LastValues.clear();
+    _LastValues.push_back(value);
+  }
+
+  // Maximum node displacement of each step and tolerated local error
+  double max_dx = _MaximumDisplacement;
+  if (max_dx <= .0) max_dx = _NormalizeStepLength ? _StepLength : 1.0;
+  const double tol = _Tolerance * max_dx;
+
+  // Low-pass filtering is only applied when moving nodes to a new step
+  const int lowpass = _Model->LowPassInterval();
+
+  // Stage forces, where the last stage of a step is the first of the next
+  int n = 3 * _Model->NumberOfPoints();
+  Array<double> k[4], x0(n), x(n), err(n);
+  for (int i = 0; i < 4; ++i) k[i].resize(n);
+  EvaluateForce(k[0]);
+
+  // Initial time step moves node with largest force by the step length,
+  // unless the time step of the interrupted integration was restored
+  double fmax = MaxNorm::Run(k[0].data(), n / 3);
+  if (_TimeStep <= 0.) {
+    _TimeStep = (fmax > 0. ? min(_StepLength, max_dx) / fmax : 0.);
+  }
+
+  // Perform adaptive integration steps
+  _Converged = (_TimeStep <= 0.);
+  Iteration step(0, max(0, _NumberOfSteps - iter0));
+  while (!_Converged && step.Next()) {
+
+    // Notify observers about start of iteration
+    Broadcast(IterationStartEvent, &step);
+
+    dx = static_cast<double *>(_Displacement->GetVoidPointer(0));
+    _Model->Get(x0.data());
+
+    double error, delta, factor;
+    while (true) {
+      memset(dx, 0, n * sizeof(double));
+
+      // Intermediate stages
+      _Model->LowPassInterval(0);
+      LinearCombination::Run(x, _TimeStep, 1, k, &A21);
+      MoveTo(x);
+      _Model->Update(true);
+      EvaluateForce(k[1]);
+      LinearCombination::Run(x, _TimeStep, 1, k + 1, &A32);
+      MoveTo(x);
+      _Model->Update(true);
+      EvaluateForce(k[2]);
+      _Model->LowPassInterval(lowpass);
+
+      // Third order solution and force at new node positions
+      LinearCombination::Run(x, _TimeStep, 3, k, B);
+      MoveTo(x);
+      _Model->Update(true);
+      EvaluateForce(k[3]);
+
+      // Local error estimate and step size control
+      LinearCombination::Run(err, _TimeStep, 4, k, E);
+      error  = MaxNorm::Run(err.data(), n / 3);
+      delta  = MaxNorm::Run(dx, n / 3);
+      factor = (error > 0. ? SafetyFactor * pow(tol / error, 1. / 3.) : MaxStepFactor);
+      factor = max(MinStepFactor, min(factor, MaxStepFactor));
+      if (delta > max_dx) factor = min(factor, SafetyFactor * max_dx / delta);
+      if (error <= tol && delta <= max_dx) break;
+
+      // Reject step and restore node positions at start of step
+      ++_NumberOfRejectedSteps;
+      _TimeStep *= factor;
+      _Model->Put(x0.data());
+      memset(dx, 0, n * sizeof(double));
+      if (_TimeStep * fmax <= _Delta) {
+        _Model->Update(true);
+        delta = 0.;
+        break;
+      }
+    }
+
+    _LastDelta = delta;
+    if (_LastDelta <= _Delta) break;
+    ++_NumberOfAcceptedSteps;
+    ++_StepCount;
+    _TimeStep *= factor;
+
+    // Track node displacement in normal direction
+    this->UpdateNormalDisplacement();
+
+    // Perform local adaptive remeshing, after which the forces at the
+    // new node positions must be re-evaluated
+    if (this->RemeshModel()) {
+      dx = static_cast<double *>(_Displacement->GetVoidPointer(0));
+      n  = 3 * _Model->NumberOfPoints();
+      for (int i = 0; i < 4; ++i) k[i].resize(n);
+      x0.resize(n), x.resize(n), err.resize(n);
+      _Model->Update(true);
+      EvaluateForce(k[3]);
+    }
+    k[0].swap(k[3]);
+    fmax = MaxNorm::Run(k[0].data(), n / 3);
+
+    // Test stopping criteria
+    if (!IsInf(value)) value = _Model->Value();
+    {
+      DeformableSurfaceTracer::Scope trace(_Model->Tracer(), "Converged", nullptr);
+      _Converged = Converged(iter0 + step.Iter(), value, dx);
+    }
+
+    // Notify observers about end of iteration
+    Broadcast(IterationEndEvent, &step);
+  }
+
+  // Notify observers about end of optimization
+  Broadcast(EndEvent, &value);
+
+  // Finalize
+  this->Finalize();
+
+  return value;
+}
+
+// =============================================================================
+// Checkpointing
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+void AdaptiveRungeKuttaMethod::SaveState(vtkFieldData *data) const
+{
+  EulerMethod::SaveState(data);
+  SaveValue(data, "TimeStep", _TimeStep);
+}
+
+// -----------------------------------------------------------------------------
+void AdaptiveRungeKuttaMethod::RestoreState(vtkFieldData *data)
+{
+  EulerMethod::RestoreState(data);
+  RestoreValue(data, "TimeStep", _TimeStep);
+}
+
+
+} // namespace mirtk
@@ -53,53 +53,6 @@ typedef GenericLinearInterpolateImageFunction<
            GenericImage<RegisteredImage::VoxelType>
          > ImageFunction;
 
-// -----------------------------------------------------------------------------
-/// Convert MIRTK image to VTK image
-///
-/// Note that vtkImageData has no implicit orientation. Therefore we just
-/// convert the image in voxel coordinates (origin at 0 and voxel size 1x1x1).
-vtkSmartPointer<vtkImageData> ConvertImage(const RegisteredImage *image)
-{
-  vtkSmartPointer<vtkImageData> imagedata = vtkSmartPointer<vtkImageData>::New();
-  imagedata->SetOrigin(.0, .0, .0);
-  imagedata->SetDimensions(image->X(), image->Y(), image->Z());
-  imagedata->SetSpacing(1.0, 1.0, 1.0);
-#if VTK_MAJOR_VERSION >= 6
-  imagedata->AllocateScalars(VTK_FLOAT, 1);
-#else
-  imagedata->SetScalarType(VTK_FLOAT);
-  imagedata->AllocateScalars();
-#endif
-  const int nvox = image->NumberOfSpatialVoxels();
-  const RegisteredImage::VoxelType *ptr1 = image->Data();
-  float *ptr2 = reinterpret_cast<float *>(imagedata->GetScalarPointer());
-  for (int i = 0; i < nvox; ++i, ++ptr1, ++ptr2) {
-    *ptr2 = static_cast<float>(*ptr1);
-  }
-  return imagedata;
-}
-
-// -----------------------------------------------------------------------------
-/// Convert surface image stencil to binary mask, e.g., for debugging purposes
-BinaryImage ImageStencilToMask(const ImageAttributes &attr,
-                               vtkImageData          *data,
-                               vtkImageStencilData   *stencil)
-{
-  BinaryImage mask(attr);
-  const float * const start = reinterpret_cast<float *>(data->GetScalarPointer());
-  vtkImageStencilIterator<float> it;
-  it.Initialize(data, stencil, data->GetExtent());
-  while (!it.IsAtEnd()) {
-    if (it.IsInStencil()) {
-      for (const float *cur = it.BeginSpan(); cur != it.EndSpan(); ++cur) {
-        mask(cur - start) = true;
-      }
-    }
-    it.NextSpan();
-  }
-  return mask;
-}
-
 // -----------------------------------------------------------------------------
 /// Convert surface image stencil to binary mask, e.g., for debugging purposes
 BinaryImage ImageStencilToMask(const ImageAttributes &attr,
@@ -583,13 +536,8 @@ void BalloonForce::ComputeLocalIntensityAttributes(bool thresholds, bool bg_fg_s
 {
   if (!thresholds && !bg_fg_stats) return;
 
-  BinaryImage fg_mask;
-  if (_ForegroundMask == nullptr) {
-    vtkSmartPointer<vtkImageData>        imagedata = ConvertImage(_Image);
-    vtkSmartPointer<vtkPointSet>         surface   = WorldToImage(_PointSet->Surface(), _Image);
-    vtkSmartPointer<vtkImageStencilData> stencil   = ImageStencil(imagedata, surface);
-    fg_mask = ImageStencilToMask(_Image->Attributes(), imagedata, stencil);
-  }
+  const BinaryImage *fg_mask = _ForegroundMask;
+  if (fg_mask == nullptr) fg_mask = &InsideMask();
 
   if (thresholds) {
     const bool optional = true;
@@ -597,7 +545,7 @@ void BalloonForce::ComputeLocalIntensityAttributes(bool thresholds, bool bg_fg_s
     eval._Points         = Points();
     eval._Status         = Status();
     eval._Image          = _Image;
-    eval._Mask           = (_ForegroundMask ? _ForegroundMask : &fg_mask);
+    eval._Mask           = fg_mask;
     eval._RadiusX        = _Radius / _Image->XSize();
     eval._RadiusY        = _Radius / _Image->YSize();
     eval._RadiusZ        = _Radius / _Image->ZSize();
@@ -613,7 +561,7 @@ void BalloonForce::ComputeLocalIntensityAttributes(bool thresholds, bool bg_fg_s
     eval._Points               = _PointSet->Points();
     eval._Status               = _PointSet->Status();
     eval._Image                = _Image;
-    eval._ForegroundMask       = (_ForegroundMask ? _ForegroundMask : &fg_mask);
+    eval._ForegroundMask       = fg_mask;
     eval._BackgroundMask       = nullptr; // use foreground region of _Image
     eval._RadiusX              = _Radius / _Image->XSize();
     eval._RadiusY              = _Radius / _Image->YSize();
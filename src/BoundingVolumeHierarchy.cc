@@ -0,0 +1,431 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright 2013-2017 Imperial College London
+ * Copyright 2013-2017 Andreas Schuh
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "mirtk/BoundingVolumeHierarchy.h"
+
+#include "mirtk/Math.h"
+#include "mirtk/Parallel.h"
+
+#include <algorithm> // nth_element
+#include <chrono>    // steady_clock
+
+
+namespace mirtk {
+
+
+// =============================================================================
+// Auxiliary functors
+// =============================================================================
+
+namespace BoundingVolumeHierarchyUtils {
+
+
+// -----------------------------------------------------------------------------
+/// Wall clock time in seconds
+inline double Now()
+{
+  using namespace std::chrono;
+  return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+// -----------------------------------------------------------------------------
+/// Initialize bounding box such that it contains no point
+inline void ResetBounds(double *b)
+{
+  b[0] = b[2] = b[4] = +inf;
+  b[1] = b[3] = b[5] = -inf;
+}
+
+// -----------------------------------------------------------------------------
+/// Enlarge bounding box such that it contains another bounding box
+inline void AddBounds(double *b, const double *other)
+{
+  if (other[0] < b[0]) b[0] = other[0];
+  if (other[1] > b[1]) b[1] = other[1];
+  if (other[2] < b[2]) b[2] = other[2];
+  if (other[3] > b[3]) b[3] = other[3];
+  if (other[4] < b[4]) b[4] = other[4];
+  if (other[5] > b[5]) b[5] = other[5];
+}
+
+// -----------------------------------------------------------------------------
+/// Whether two bounding boxes overlap
+inline bool Overlap(const double *a, const double *b)
+{
+  return a[0] <= b[1] && b[0] <= a[1] &&
+         a[2] <= b[3] && b[2] <= a[3] &&
+         a[4] <= b[5] && b[4] <= a[5];
+}
+
+// -----------------------------------------------------------------------------
+/// Squared distance of point to bounding box
+inline double Distance2(const double *b, const double *p)
+{
+  double d, dist2 = 0.;
+  for (int i = 0; i < 3; ++i) {
+    if      (p[i] < b[2*i  ]) d = b[2*i  ] - p[i];
+    else if (p[i] > b[2*i+1]) d = p[i] - b[2*i+1];
+    else continue;
+    dist2 += d * d;
+  }
+  return dist2;
+}
+
+// -----------------------------------------------------------------------------
+/// Compute bounding boxes of surface mesh cells
+struct ComputeCellBoundingBoxes
+{
+  vtkPolyData *_DataSet;
+  double      *_Bounds;
+
+  void operator ()(const blocked_range<vtkIdType> &re) const
+  {
+    vtkIdType npts, *pts;
+    double    p[3], *b = _Bounds + 6 * re.begin();
+    for (vtkIdType cellId = re.begin(); cellId != re.end(); ++cellId, b += 6) {
+      ResetBounds(b);
+      _DataSet->GetCellPoints(cellId, npts, pts);
+      for (vtkIdType i = 0; i < npts; ++i) {
+        _DataSet->GetPoint(pts[i], p);
+        if (p[0] < b[0]) b[0] = p[0];
+        if (p[0] > b[1]) b[1] = p[0];
+        if (p[1] < b[2]) b[2] = p[1];
+        if (p[1] > b[3]) b[3] = p[1];
+        if (p[2] < b[4]) b[4] = p[2];
+        if (p[2] > b[5]) b[5] = p[2];
+      }
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Compute bounding boxes of leaf nodes from bounding boxes of their cells
+struct ComputeLeafBounds
+{
+  typedef BoundingVolumeHierarchy::Node Node;
+
+  Node            *_Nodes;
+  const int       *_Leaves;
+  const vtkIdType *_CellIds;
+  const double    *_CellBounds;
+
+  void operator ()(const blocked_range<int> &re) const
+  {
+    for (int i = re.begin(); i != re.end(); ++i) {
+      Node &node = _Nodes[_Leaves[i]];
+      ResetBounds(node._Bounds);
+      for (int j = node._Begin; j < node._End; ++j) {
+        AddBounds(node._Bounds, _CellBounds + 6 * _CellIds[j]);
+      }
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Compare cells by the center of their bounding box along a given axis
+struct CompareCellCenters
+{
+  const double *_CellBounds;
+  int           _Axis;
+
+  bool operator ()(vtkIdType a, vtkIdType b) const
+  {
+    const double *ba = _CellBounds + 6 * a + 2 * _Axis;
+    const double *bb = _CellBounds + 6 * b + 2 * _Axis;
+    return ba[0] + ba[1] < bb[0] + bb[1];
+  }
+};
+
+
+} // namespace BoundingVolumeHierarchyUtils
+using namespace BoundingVolumeHierarchyUtils;
+
+// =============================================================================
+// Construction/Destruction
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+BoundingVolumeHierarchy::BoundingVolumeHierarchy()
+:
+  _MaxCellsPerLeaf(8),
+  _NumberOfBuilds(0),
+  _NumberOfRefits(0),
+  _LastUpdateTime(0.),
+  _TotalUpdateTime(0.)
+{
+}
+
+// -----------------------------------------------------------------------------
+void BoundingVolumeHierarchy::CopyAttributes(const BoundingVolumeHierarchy &other)
+{
+  _DataSet         = other._DataSet;
+  _MaxCellsPerLeaf = other._MaxCellsPerLeaf;
+  _NumberOfBuilds  = other._NumberOfBuilds;
+  _NumberOfRefits  = other._NumberOfRefits;
+  _LastUpdateTime  = other._LastUpdateTime;
+  _TotalUpdateTime = other._TotalUpdateTime;
+  _Nodes           = other._Nodes;
+  _Leaves          = other._Leaves;
+  _CellIds         = other._CellIds;
+  _CellBounds      = other._CellBounds;
+}
+
+// -----------------------------------------------------------------------------
+BoundingVolumeHierarchy::BoundingVolumeHierarchy(const BoundingVolumeHierarchy &other)
+:
+  Object(other)
+{
+  CopyAttributes(other);
+}
+
+// -----------------------------------------------------------------------------
+BoundingVolumeHierarchy &BoundingVolumeHierarchy::operator =(const BoundingVolumeHierarchy &other)
+{
+  if (this != &other) {
+    Object::operator =(other);
+    CopyAttributes(other);
+  }
+  return *this;
+}
+
+// -----------------------------------------------------------------------------
+BoundingVolumeHierarchy::~BoundingVolumeHierarchy()
+{
+}
+
+// -----------------------------------------------------------------------------
+void BoundingVolumeHierarchy::Clear()
+{
+  _DataSet = nullptr;
+  _Nodes.clear();
+  _Leaves.clear();
+  _CellIds.clear();
+  _CellBounds.clear();
+  _NumberOfRefits = 0;
+}
+
+// =============================================================================
+// Update
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+void BoundingVolumeHierarchy::ComputeCellBounds()
+{
+  const vtkIdType ncells = _DataSet->GetNumberOfCells();
+  _CellBounds.resize(6 * ncells);
+  ComputeCellBoundingBoxes eval;
+  eval._DataSet = _DataSet;
+  eval._Bounds  = _CellBounds.data();
+  parallel_for(blocked_range<vtkIdType>(0, ncells), eval);
+}
+
+// -----------------------------------------------------------------------------
+void BoundingVolumeHierarchy::ComputeNodeBounds()
+{
+  ComputeLeafBounds eval;
+  eval._Nodes      = _Nodes.data();
+  eval._Leaves     = _Leaves.data();
+  eval._CellIds    = _CellIds.data();
+  eval._CellBounds = _CellBounds.data();
+  parallel_for(blocked_range<int>(0, static_cast<int>(_Leaves.size())), eval);
+
+  // Children are stored after their parent, hence a reverse sweep visits
+  // both children of an internal node before the node itself
+  for (int i = NumberOfNodes() - 1; i >= 0; --i) {
+    Node &node = _Nodes[i];
+    if (!node.IsLeaf()) {
+      ResetBounds(node._Bounds);
+      AddBounds(node._Bounds, _Nodes[node._Left ]._Bounds);
+      AddBounds(node._Bounds, _Nodes[node._Right]._Bounds);
+    }
+  }
+}
+
+// -----------------------------------------------------------------------------
+void BoundingVolumeHierarchy::Build(vtkPolyData *surface)
+{
+  const double t0 = Now();
+
+  Clear();
+  _DataSet = surface;
+  if (_MaxCellsPerLeaf < 1) _MaxCellsPerLeaf = 1;
+
+  const int ncells = static_cast<int>(surface->GetNumberOfCells());
+  if (ncells > 0) {
+
+    // Bounding boxes of individual cells
+    if (surface->NeedToBuildCells()) surface->BuildCells();
+    ComputeCellBounds();
+    _CellIds.resize(ncells);
+    for (int i = 0; i < ncells; ++i) _CellIds[i] = i;
+
+    // Top-down median split of cell centers along longest axis
+    Node root;
+    root._Left  = root._Right = -1;
+    root._Begin = 0;
+    root._End   = ncells;
+    _Nodes.reserve(2 * (ncells / _MaxCellsPerLeaf + 1));
+    _Nodes.push_back(root);
+
+    CompareCellCenters compare;
+    compare._CellBounds = _CellBounds.data();
+
+    Array<int> active;
+    active.push_back(0);
+    double c[6], l, lmax, *b;
+    while (!active.empty()) {
+      const int i = active.back();
+      active.pop_back();
+      const int begin = _Nodes[i]._Begin;
+      const int end   = _Nodes[i]._End;
+      if (end - begin <= _MaxCellsPerLeaf) {
+        _Leaves.push_back(i);
+        continue;
+      }
+      ResetBounds(c);
+      for (int j = begin; j < end; ++j) {
+        b = _CellBounds.data() + 6 * _CellIds[j];
+        const double x = .5 * (b[0] + b[1]);
+        const double y = .5 * (b[2] + b[3]);
+        const double z = .5 * (b[4] + b[5]);
+        if (x < c[0]) c[0] = x;
+        if (x > c[1]) c[1] = x;
+        if (y < c[2]) c[2] = y;
+        if (y > c[3]) c[3] = y;
+        if (z < c[4]) c[4] = z;
+        if (z > c[5]) c[5] = z;
+      }
+      compare._Axis = 0, lmax = c[1] - c[0];
+      if ((l = c[3] - c[2]) > lmax) compare._Axis = 1, lmax = l;
+      if ((l = c[5] - c[4]) > lmax) compare._Axis = 2, lmax = l;
+      if (lmax <= 0.) {
+        _Leaves.push_back(i);
+        continue;
+      }
+      const int mid = begin + (end - begin) / 2;
+      std::nth_element(_CellIds.begin() + begin,
+                       _CellIds.begin() + mid,
+                       _CellIds.begin() + end, compare);
+      Node left, right;
+      left ._Left  = left ._Right = -1;
+      right._Left  = right._Right = -1;
+      left ._Begin = begin, left ._End = mid;
+      right._Begin = mid,   right._End = end;
+      _Nodes[i]._Left  = NumberOfNodes();
+      _Nodes[i]._Right = NumberOfNodes() + 1;
+      _Nodes.push_back(left);
+      _Nodes.push_back(right);
+      active.push_back(_Nodes[i]._Left);
+      active.push_back(_Nodes[i]._Right);
+    }
+
+    // Bounding boxes of nodes
+    ComputeNodeBounds();
+  }
+
+  ++_NumberOfBuilds;
+  _LastUpdateTime   = Now() - t0;
+  _TotalUpdateTime += _LastUpdateTime;
+}
+
+// -----------------------------------------------------------------------------
+void BoundingVolumeHierarchy::Refit()
+{
+  if (!_DataSet) return;
+  if (_DataSet->GetNumberOfCells() != static_cast<vtkIdType>(NumberOfCells())) {
+    Build(_DataSet);
+    return;
+  }
+  const double t0 = Now();
+  ComputeCellBounds();
+  ComputeNodeBounds();
+  ++_NumberOfRefits;
+  _LastUpdateTime   = Now() - t0;
+  _TotalUpdateTime += _LastUpdateTime;
+}
+
+// =============================================================================
+// Queries
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+void BoundingVolumeHierarchy::FindCellsWithinBounds(const double bounds[6], vtkIdList *cellIds) const
+{
+  cellIds->Reset();
+  if (_Nodes.empty()) return;
+
+  int stack[128], n = 0;
+  stack[n++] = 0;
+  while (n > 0) {
+    const Node &node = _Nodes[stack[--n]];
+    if (!Overlap(node._Bounds, bounds)) continue;
+    if (node.IsLeaf()) {
+      for (int j = node._Begin; j < node._End; ++j) {
+        if (Overlap(_CellBounds.data() + 6 * _CellIds[j], bounds)) {
+          cellIds->InsertNextId(_CellIds[j]);
+        }
+      }
+    } else {
+      stack[n++] = node._Left;
+      stack[n++] = node._Right;
+    }
+  }
+}
+
+// -----------------------------------------------------------------------------
+double BoundingVolumeHierarchy
+::Distance2ToCell(const double p[3], vtkIdType cellId, vtkGenericCell *cell) const
+{
+  int    subId;
+  double q[3] = {p[0], p[1], p[2]};
+  double x[3], pcoords[3], dist2, weights[VTK_CELL_SIZE];
+  _DataSet->GetCell(cellId, cell);
+  if (cell->EvaluatePosition(q, x, subId, pcoords, dist2, weights) == -1) return inf;
+  return dist2;
+}
+
+// -----------------------------------------------------------------------------
+vtkIdType BoundingVolumeHierarchy
+::FindCellWithinDistance(const double p[3], double max_dist2, vtkGenericCell *cell) const
+{
+  if (_Nodes.empty()) return -1;
+
+  int stack[128], n = 0;
+  stack[n++] = 0;
+  while (n > 0) {
+    const Node &node = _Nodes[stack[--n]];
+    if (Distance2(node._Bounds, p) > max_dist2) continue;
+    if (node.IsLeaf()) {
+      for (int j = node._Begin; j < node._End; ++j) {
+        const vtkIdType cellId = _CellIds[j];
+        if (Distance2(_CellBounds.data() + 6 * cellId, p) <= max_dist2 &&
+            Distance2ToCell(p, cellId, cell) <= max_dist2) {
+          return cellId;
+        }
+      }
+    } else {
+      stack[n++] = node._Left;
+      stack[n++] = node._Right;
+    }
+  }
+  return -1;
+}
+
+
+} // namespace mirtk
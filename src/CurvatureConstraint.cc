@@ -45,37 +45,6 @@ mirtkAutoRegisterEnergyTermMacro(CurvatureConstraint);
 namespace CurvatureConstraintUtils {
 
 
-// -----------------------------------------------------------------------------
-/// Compute centroids of adjacent nodes
-struct ComputeCentroids
-{
-  vtkPoints       *_Points;
-  const EdgeTable *_EdgeTable;
-  vtkPoints       *_Centroids;
-
-  void operator ()(const blocked_range<int> &re) const
-  {
-    double     c[3], p[3];
-    const int *adjPtIds;
-    int        numAdjPts;
-
-    for (int ptId = re.begin(); ptId != re.end(); ++ptId) {
-      _EdgeTable->GetAdjacentPoints(ptId, numAdjPts, adjPtIds);
-      if (numAdjPts > 0) {
-        c[0] = c[1] = c[2] = .0;
-        for (int i = 0; i < numAdjPts; ++i) {
-          _Points->GetPoint(adjPtIds[i], p);
-          c[0] += p[0], c[1] += p[1], c[2] += p[2];
-        }
-        c[0] /= numAdjPts, c[1] /= numAdjPts, c[2] /= numAdjPts;
-      } else {
-        _Points->GetPoint(ptId, c);
-      }
-      _Centroids->SetPoint(ptId, c);
-    }
-  }
-};
-
 // -----------------------------------------------------------------------------
 /// Evaluate bending penalty
 struct Evaluate
@@ -120,6 +89,7 @@ struct EvaluateGradient
   vtkPoints       *_Points;
   vtkPoints       *_Centroids;
   vtkDataArray    *_Status;
+  const int       *_PointIds;
   const EdgeTable *_EdgeTable;
   Force           *_Gradient;
 
@@ -129,7 +99,8 @@ struct EvaluateGradient
     const int *adjPtIds;
     double     p[3], c[3], w;
 
-    for (int ptId = re.begin(); ptId != re.end(); ++ptId) {
+    for (int idx = re.begin(), ptId; idx != re.end(); ++idx) {
+      ptId = (_PointIds ? _PointIds[idx] : idx);
       if (_Status && _Status->GetComponent(ptId, 0) == .0) continue;
       // Derivative of sum terms of adjacent points
       _EdgeTable->GetAdjacentPoints(ptId, numAdjPts, adjPtIds);
@@ -228,10 +199,7 @@ void CurvatureConstraint::Reinitialize()
 // -----------------------------------------------------------------------------
 void CurvatureConstraint::Init()
 {
-  if (_Centroids == nullptr) {
-    _Centroids = vtkSmartPointer<vtkPoints>::New();
-  }
-  _Centroids->SetNumberOfPoints(_NumberOfPoints);
+  _Centroids = nullptr;
 }
 
 // -----------------------------------------------------------------------------
@@ -242,11 +210,7 @@ void CurvatureConstraint::Update(bool gradient)
 
   // Update centroids
   MIRTK_START_TIMING();
-  CurvatureConstraintUtils::ComputeCentroids eval;
-  eval._Points    = _PointSet->SurfacePoints();
-  eval._EdgeTable = _PointSet->SurfaceEdges();
-  eval._Centroids = _Centroids;
-  parallel_for(blocked_range<int>(0, _NumberOfPoints), eval);
+  _Centroids = CurvatureCache().Centroids(DeformedSurface(), _PointSet->SurfaceEdges());
   MIRTK_DEBUG_TIMING(3, "update of centroids");
 }
 
@@ -275,10 +239,11 @@ void CurvatureConstraint::EvaluateGradient(double *gradient, double step, double
   CurvatureConstraintUtils::EvaluateGradient eval;
   eval._Points    = _PointSet->SurfacePoints();
   eval._Status    = _PointSet->SurfaceStatus();
+  eval._PointIds  = ActivePointIds();
   eval._EdgeTable = _PointSet->SurfaceEdges();
   eval._Centroids = _Centroids;
   eval._Gradient  = _Gradient;
-  parallel_for(blocked_range<int>(0, _NumberOfPoints), eval);
+  parallel_for(blocked_range<int>(0, NumberOfActivePoints()), eval);
 
   SurfaceConstraint::EvaluateGradient(gradient, step, 2.0 * weight / _NumberOfPoints);
   MIRTK_DEBUG_TIMING(3, "evaluation of curvature force");
@@ -384,6 +384,12 @@ void DeformableSurfaceLogger::HandleEvent(Observable *obj, Event event, const vo
             PrintDelta(os, eulermethod->LastDelta(), eulermethod->StepLength());
             os << "mm";
           }
+          if (model->HasSurfaceLocator()) {
+            const ios::fmtflags fmt = os.flags();
+            os << ", locator = " << fixed << setprecision(1)
+               << 1000. * model->SurfaceLocatorTime() << "ms";
+            os.flags(fmt);
+          }
           os << "]";
         }
       }
@@ -415,6 +421,21 @@ void DeformableSurfaceLogger::HandleEvent(Observable *obj, Event event, const vo
         os << "\n";
         if (_Color) os << xreset;
       }
+      if (debug_time) {
+        const ios::fmtflags fmt = os.flags();
+        os << "\nWall clock time of energy terms (update + gradient):\n";
+        for (int i = 0; i < model->NumberOfTerms(); ++i) {
+          const EnergyTerm *term = model->Term(i);
+          if (term->Weight() != .0) {
+            string name = term->Name();
+            if (name.empty()) name = term->NameOfClass();
+            os << "  " << left << setw(40) << name << right << fixed << setprecision(3)
+               << setw(10) << model->TermUpdateTime(i) << " + "
+               << setw(10) << model->TermGradientTime(i) << " sec\n";
+          }
+        }
+        os.flags(fmt);
+      }
       break;
     }
 
@@ -32,25 +32,29 @@
 
 #include "mirtk/MeshSmoothing.h"
 #include "mirtk/SurfaceRemeshing.h"
+#include "mirtk/ParallelSurfaceRemeshing.h"
 #include "mirtk/SurfaceCurvature.h"
 #include "mirtk/SurfaceCollisions.h"
 #include "mirtk/PointSamples.h"
 #include "mirtk/PointSetUtils.h"
 #include "mirtk/PointSetIO.h"
 
+#include "mirtk/SurfaceForce.h"
+#include "mirtk/SurfaceConstraint.h"
 #include "mirtk/ImplicitSurfaceForce.h"
 #include "mirtk/ImplicitSurfaceUtils.h"
 
 #include "vtkCellData.h"
 #include "vtkPointData.h"
 #include "vtkUnsignedCharArray.h"
+#include "vtkIntArray.h"
 #include "vtkFloatArray.h"
 #include "vtkDoubleArray.h"
 #include "vtkPolyDataNormals.h"
-#include "vtkAbstractCellLocator.h"
 #include "vtkGenericCell.h"
-#include "vtkCellLocator.h"
-#include "vtkWindowedSincPolyDataFilter.h"
+
+#include <atomic>
+#include <chrono> // steady_clock
 
 
 namespace mirtk {
@@ -67,39 +71,437 @@ namespace DeformableSurfaceModelUtils {
 
 
 // -----------------------------------------------------------------------------
-/// Compute centroid of point set
-void GetCentroid(vtkPolyData *mesh, double centroid[3])
+/// Compute centroid or mean absolute deviation of points in fixed order
+///
+/// The points are summed in blocks of fixed size whose partial sums are added
+/// in order such that the result does not depend on the number of threads.
+struct SumCoordinates
 {
-  double p[3];
-  centroid[0] = centroid[1] = centroid[2] = .0;
-  const vtkIdType npoints = mesh->GetNumberOfPoints();
-  for (vtkIdType ptId = 0; ptId < npoints; ++ptId) {
-    mesh->GetPoint(ptId, p);
-    centroid[0] += p[0];
-    centroid[1] += p[1];
-    centroid[2] += p[2];
+  static const int BlockSize = 4096;
+
+  const double *_Points;
+  const double *_Center;
+  int           _NumberOfPoints;
+  double       *_Sums;
+
+  void operator ()(const blocked_range<int> &blocks) const
+  {
+    for (int b = blocks.begin(); b != blocks.end(); ++b) {
+      const int     end = min(_NumberOfPoints, (b + 1) * BlockSize);
+      const double *p   = _Points + 3 * b * BlockSize;
+      double       *s   = _Sums   + 3 * b;
+      s[0] = s[1] = s[2] = 0.;
+      if (_Center) {
+        for (int i = b * BlockSize; i < end; ++i, p += 3) {
+          s[0] += abs(p[0] - _Center[0]);
+          s[1] += abs(p[1] - _Center[1]);
+          s[2] += abs(p[2] - _Center[2]);
+        }
+      } else {
+        for (int i = b * BlockSize; i < end; ++i, p += 3) {
+          s[0] += p[0], s[1] += p[1], s[2] += p[2];
+        }
+      }
+    }
+  }
+
+  static void Run(const double *points, int n, const double *center, double mean[3])
+  {
+    const int nblocks = (n + BlockSize - 1) / BlockSize;
+    Array<double> sums(3 * nblocks);
+    SumCoordinates sum;
+    sum._Points         = points;
+    sum._Center         = center;
+    sum._NumberOfPoints = n;
+    sum._Sums           = sums.data();
+    parallel_for(blocked_range<int>(0, nblocks), sum);
+    mean[0] = mean[1] = mean[2] = 0.;
+    for (int b = 0; b < nblocks; ++b) {
+      mean[0] += sums[3 * b], mean[1] += sums[3 * b + 1], mean[2] += sums[3 * b + 2];
+    }
+    mean[0] /= n, mean[1] /= n, mean[2] /= n;
   }
-  centroid[0] /= npoints;
-  centroid[1] /= npoints;
-  centroid[2] /= npoints;
+};
+
+// -----------------------------------------------------------------------------
+/// Compute centroid of points
+inline void GetCentroid(const double *points, int n, double centroid[3])
+{
+  SumCoordinates::Run(points, n, nullptr, centroid);
+}
+
+// -----------------------------------------------------------------------------
+/// Get approximate scale of points
+inline void GetScale(const double *points, int n, const double centroid[3], double scale[3])
+{
+  SumCoordinates::Run(points, n, centroid, scale);
 }
 
 // -----------------------------------------------------------------------------
-/// Get approximate scale of point set
-void GetScale(vtkPolyData *mesh, const double centroid[3], double scale[3])
+/// Compute coefficients of windowed sinc low-pass filter
+///
+/// Chebyshev polynomial coefficients of the Hamming windowed sinc filter with
+/// offset of the pass band found by Newton-Raphson search, as computed by
+/// vtkWindowedSincPolyDataFilter (Taubin et al., 1996).
+void WindowedSincCoefficients(int niter, double passband, Array<double> &c)
 {
-  double p[3];
-  scale[0] = scale[1] = scale[2] = .0;
-  const vtkIdType npoints = mesh->GetNumberOfPoints();
-  for (vtkIdType ptId = 0; ptId < npoints; ++ptId) {
-    mesh->GetPoint(ptId, p);
-    scale[0] += abs(p[0] - centroid[0]);
-    scale[1] += abs(p[1] - centroid[1]);
-    scale[2] += abs(p[2] - centroid[2]);
+  const double k_pb     = passband;
+  const double theta_pb = acos(1. - .5 * k_pb);
+
+  Array<double> w(niter + 1), dc(niter + 1);
+  c.resize(niter + 1);
+
+  // Hamming window weights
+  for (int i = 0; i <= niter; ++i) {
+    w[i] = .54 + .46 * cos(double(i) * pi / double(niter + 1));
+  }
+
+  // Newton-Raphson search of offset such that filter value at pass band is one
+  double sigma = 0., f_kpb, df_kpb;
+  bool   done  = false;
+  for (int iter = 0; !done && iter < 500; ++iter) {
+    c[0] = w[0] * (theta_pb + sigma) / pi;
+    for (int i = 1; i <= niter; ++i) {
+      c[i] = 2. * w[i] * sin(double(i) * (theta_pb + sigma)) / (double(i) * pi);
+    }
+    dc[niter] = 0.;
+    if (niter > 0) dc[niter - 1] = 0.;
+    if (niter > 1) dc[niter - 2] = 2. * (niter - 1) * c[niter - 1];
+    for (int i = niter - 3; i >= 0; --i) {
+      dc[i] = dc[i + 2] + 2. * (i + 1) * c[i + 1];
+    }
+    f_kpb = c[0], df_kpb = dc[0];
+    for (int i = 1; i <= niter; ++i) {
+      const double t = (i == 1 ? 1. - .5 * k_pb : cos(double(i) * theta_pb));
+      f_kpb  += c [i] * t;
+      df_kpb += dc[i] * t;
+    }
+    if (niter > 1) {
+      if (abs(f_kpb - 1.) >= 1e-3) sigma -= (f_kpb - 1.) / df_kpb;
+      else                         done   = true;
+    } else {
+      done = true;
+    }
   }
-  scale[0] /= npoints;
-  scale[1] /= npoints;
-  scale[2] /= npoints;
+}
+
+// -----------------------------------------------------------------------------
+/// Get coordinates of moved points
+struct GetMovedPoints
+{
+  vtkPoints    *_Points;
+  const double *_Displacement;
+  double       *_Output;
+
+  void operator ()(const blocked_range<int> &ptIds) const
+  {
+    double       *x  = _Output       + 3 * ptIds.begin();
+    const double *dx = _Displacement + 3 * ptIds.begin();
+    for (int ptId = ptIds.begin(); ptId != ptIds.end(); ++ptId, x += 3, dx += 3) {
+      _Points->GetPoint(ptId, x);
+      x[0] += dx[0], x[1] += dx[1], x[2] += dx[2];
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Count cells sharing each edge of surface mesh
+struct CountEdgeCells
+{
+  vtkPolyData      *_Surface;
+  const EdgeTable  *_EdgeTable;
+  std::atomic<int> *_Counts;
+
+  void operator ()(const blocked_range<vtkIdType> &cellIds) const
+  {
+    vtkIdType npts, *pts;
+    int       edgeId;
+    for (vtkIdType cellId = cellIds.begin(); cellId != cellIds.end(); ++cellId) {
+      _Surface->GetCellPoints(cellId, npts, pts);
+      if (npts < 3) continue;
+      for (vtkIdType i = 0; i < npts; ++i) {
+        edgeId = _EdgeTable->EdgeId(static_cast<int>(pts[i]), static_cast<int>(pts[(i + 1) % npts]));
+        if (edgeId >= 0) _Counts[edgeId].fetch_add(1, std::memory_order_relaxed);
+      }
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Get neighbors of boundary and non-manifold nodes used by low-pass filter
+///
+/// As in vtkWindowedSincPolyDataFilter with boundary smoothing and without
+/// feature edge smoothing, a node with edges shared by one or more than two
+/// cells is only smoothed along these edges if it has exactly two of them
+/// and the angle between these is at most 15 degrees. Otherwise, the node is
+/// fixed. For each node, two indices are stored, where -1 denotes a node whose
+/// edges are all shared by two cells, and -2 a fixed node.
+struct GetLowPassBoundaryNeighbors
+{
+  const EdgeTable        *_EdgeTable;
+  const std::atomic<int> *_EdgeCells;
+  const double           *_Points;
+  int                    *_Output;
+  double                  _MinCosAngle;
+
+  void operator ()(const blocked_range<int> &ptIds) const
+  {
+    int        numAdjPts, nedges, adj[2];
+    const int *adjPtIds;
+    double     l1[3], l2[3];
+
+    for (int ptId = ptIds.begin(); ptId != ptIds.end(); ++ptId) {
+      int * const out = _Output + 2 * ptId;
+      _EdgeTable->GetAdjacentPoints(ptId, numAdjPts, adjPtIds);
+      nedges = 0;
+      for (int i = 0; i < numAdjPts; ++i) {
+        const int edgeId = _EdgeTable->EdgeId(ptId, adjPtIds[i]);
+        if (_EdgeCells[edgeId].load(std::memory_order_relaxed) != 2) {
+          if (nedges < 2) adj[nedges] = adjPtIds[i];
+          ++nedges;
+        }
+      }
+      if (nedges == 0) {
+        out[0] = out[1] = -1;
+      } else if (nedges == 2) {
+        const double *x  = _Points + 3 * ptId;
+        const double *x1 = _Points + 3 * adj[0];
+        const double *x2 = _Points + 3 * adj[1];
+        for (int k = 0; k < 3; ++k) {
+          l1[k] = x [k] - x1[k];
+          l2[k] = x2[k] - x [k];
+        }
+        vtkMath::Normalize(l1);
+        vtkMath::Normalize(l2);
+        if (vtkMath::Dot(l1, l2) < _MinCosAngle) {
+          out[0] = out[1] = -2;
+        } else {
+          out[0] = adj[0], out[1] = adj[1];
+        }
+      } else {
+        out[0] = out[1] = -2;
+      }
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Get nodes whose positions are averaged by low-pass filter for given node
+inline void GetLowPassNeighbors(const EdgeTable *edgeTable, const int *boundary,
+                                int ptId, int &numAdjPts, const int *&adjPtIds)
+{
+  const int * const adj = boundary + 2 * ptId;
+  if (adj[0] == -1) {
+    edgeTable->GetAdjacentPoints(ptId, numAdjPts, adjPtIds);
+  } else if (adj[0] == -2) {
+    numAdjPts = 0;
+    adjPtIds  = nullptr;
+  } else {
+    numAdjPts = 2;
+    adjPtIds  = adj;
+  }
+}
+
+// -----------------------------------------------------------------------------
+/// First iteration of windowed sinc low-pass filter
+///
+/// The negative Laplacian of nodes without neighbors, i.e., fixed nodes, is
+/// zero as in vtkWindowedSincPolyDataFilter.
+struct LowPassFirstIteration
+{
+  const EdgeTable *_EdgeTable;
+  const int       *_Boundary;
+  const double    *_X0;
+  double          *_X1;
+  double          *_X3;
+  double           _C0;
+  double           _C1;
+
+  void operator ()(const blocked_range<int> &ptIds) const
+  {
+    int           numAdjPts;
+    const int    *adjPtIds;
+    const double *y;
+    double        d[3];
+
+    for (int ptId = ptIds.begin(); ptId != ptIds.end(); ++ptId) {
+      const double *x0 = _X0 + 3 * ptId;
+      double       *x1 = _X1 + 3 * ptId;
+      double       *x3 = _X3 + 3 * ptId;
+      GetLowPassNeighbors(_EdgeTable, _Boundary, ptId, numAdjPts, adjPtIds);
+      // Negative Laplacian
+      d[0] = d[1] = d[2] = 0.;
+      for (int i = 0; i < numAdjPts; ++i) {
+        y = _X0 + 3 * adjPtIds[i];
+        d[0] += (x0[0] - y[0]) / numAdjPts;
+        d[1] += (x0[1] - y[1]) / numAdjPts;
+        d[2] += (x0[2] - y[2]) / numAdjPts;
+      }
+      for (int k = 0; k < 3; ++k) {
+        x1[k] = x0[k] - .5 * d[k];
+        x3[k] = _C0 * x0[k] + _C1 * x1[k];
+      }
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Subsequent iteration of windowed sinc low-pass filter
+struct LowPassIteration
+{
+  const EdgeTable *_EdgeTable;
+  const int       *_Boundary;
+  const double    *_X0;
+  const double    *_X1;
+  double          *_X2;
+  double          *_X3;
+  double           _C;
+
+  void operator ()(const blocked_range<int> &ptIds) const
+  {
+    int           numAdjPts;
+    const int    *adjPtIds;
+    const double *y;
+    double        d[3];
+
+    for (int ptId = ptIds.begin(); ptId != ptIds.end(); ++ptId) {
+      const double *x0 = _X0 + 3 * ptId;
+      const double *x1 = _X1 + 3 * ptId;
+      double       *x2 = _X2 + 3 * ptId;
+      double       *x3 = _X3 + 3 * ptId;
+      GetLowPassNeighbors(_EdgeTable, _Boundary, ptId, numAdjPts, adjPtIds);
+      // Negative Laplacian
+      d[0] = d[1] = d[2] = 0.;
+      for (int i = 0; i < numAdjPts; ++i) {
+        y = _X1 + 3 * adjPtIds[i];
+        d[0] += (x1[0] - y[0]) / numAdjPts;
+        d[1] += (x1[1] - y[1]) / numAdjPts;
+        d[2] += (x1[2] - y[2]) / numAdjPts;
+      }
+      // Chebyshev recurrence and filter update
+      for (int k = 0; k < 3; ++k) {
+        x2[k]  = x1[k] - x0[k] + x1[k] - d[k];
+        x3[k] += _C * x2[k];
+      }
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Add displacements from moved points to low-pass filtered points
+///
+/// The filtered points are translated and scaled such that their centroid
+/// and approximate scale are equal to those of the unfiltered points.
+struct AddLowPassDisplacements
+{
+  vtkPoints    *_Points;
+  const double *_Filtered;
+  double       *_Displacement;
+  double        _Centroid[3];
+  double        _Scale[3];
+  double        _FilteredCentroid[3];
+  double        _FilteredScale[3];
+
+  void operator ()(const blocked_range<int> &ptIds) const
+  {
+    double        p[3];
+    const double *x  = _Filtered     + 3 * ptIds.begin();
+    double       *dx = _Displacement + 3 * ptIds.begin();
+    for (int ptId = ptIds.begin(); ptId != ptIds.end(); ++ptId, x += 3, dx += 3) {
+      _Points->GetPoint(ptId, p);
+      p[0] += dx[0], p[1] += dx[1], p[2] += dx[2];
+      for (int k = 0; k < 3; ++k) {
+        dx[k] += (_Centroid[k] + _Scale[k] * (x[k] - _FilteredCentroid[k]) / _FilteredScale[k]) - p[k];
+      }
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Low-pass filter surface mesh nodes after displacement
+///
+/// Windowed sinc filter equivalent to vtkWindowedSincPolyDataFilter with
+/// boundary smoothing and without feature edge smoothing, which operates
+/// directly on the point coordinates using the edge table of the surface mesh.
+/// The displacements are modified such that the moved points are low-pass
+/// filtered.
+///
+/// The translation and scale "fix" is due to a bug in vtkWindowedSincPolyDataFilter:
+/// http://vtk.1045678.n5.nabble.com/Bug-in-vtkWindowedSincPolyDataFilter-td1234055.html
+/// Because the filtered points are rescaled, the normalization of the point
+/// coordinates done by the VTK filter is not needed.
+void LowPassFilter(vtkPoints *points, vtkPolyData *surface, const EdgeTable *edgeTable,
+                   double *dx, int niter, double passband)
+{
+  const int n = static_cast<int>(points->GetNumberOfPoints());
+  if (n == 0 || niter <= 0) return;
+
+  Array<double> c;
+  WindowedSincCoefficients(niter, passband, c);
+
+  Array<double> buffer(12 * n);
+  double *x[3] = { buffer.data(), buffer.data() + 3 * n, buffer.data() + 6 * n };
+  double *x3   = buffer.data() + 9 * n;
+
+  GetMovedPoints move;
+  move._Points       = points;
+  move._Displacement = dx;
+  move._Output       = x[0];
+  parallel_for(blocked_range<int>(0, n), move);
+
+  AddLowPassDisplacements add;
+  GetCentroid(x[0], n, add._Centroid);
+  GetScale   (x[0], n, add._Centroid, add._Scale);
+
+  // Restrict smoothing of nodes on boundary and non-manifold edges
+  const int nedges = edgeTable->NumberOfEdges();
+  UniquePtr<std::atomic<int>[]> edge_cells(new std::atomic<int>[nedges]());
+  if (surface->NeedToBuildCells()) surface->BuildCells();
+  CountEdgeCells count;
+  count._Surface   = surface;
+  count._EdgeTable = edgeTable;
+  count._Counts    = edge_cells.get();
+  parallel_for(blocked_range<vtkIdType>(0, surface->GetNumberOfCells()), count);
+
+  Array<int> boundary(2 * n);
+  GetLowPassBoundaryNeighbors adj;
+  adj._EdgeTable   = edgeTable;
+  adj._EdgeCells   = edge_cells.get();
+  adj._Points      = x[0];
+  adj._Output      = boundary.data();
+  adj._MinCosAngle = cos(15. * pi / 180.);
+  parallel_for(blocked_range<int>(0, n), adj);
+
+  LowPassFirstIteration first;
+  first._EdgeTable = edgeTable;
+  first._Boundary  = boundary.data();
+  first._X0        = x[0];
+  first._X1        = x[1];
+  first._X3        = x3;
+  first._C0        = c[0];
+  first._C1        = c[1];
+  parallel_for(blocked_range<int>(0, n), first);
+
+  LowPassIteration next;
+  next._EdgeTable = edgeTable;
+  next._Boundary  = boundary.data();
+  next._X3        = x3;
+  for (int iter = 2; iter <= niter; ++iter) {
+    next._X0 = x[0];
+    next._X1 = x[1];
+    next._X2 = x[2];
+    next._C  = c[iter];
+    parallel_for(blocked_range<int>(0, n), next);
+    double * const tmp = x[0];
+    x[0] = x[1], x[1] = x[2], x[2] = tmp;
+  }
+
+  GetCentroid(x3, n, add._FilteredCentroid);
+  GetScale   (x3, n, add._FilteredCentroid, add._FilteredScale);
+  add._Points       = points;
+  add._Filtered     = x3;
+  add._Displacement = dx;
+  parallel_for(blocked_range<int>(0, n), add);
 }
 
 // -----------------------------------------------------------------------------
@@ -191,6 +593,39 @@ struct MovePoints
   }
 };
 
+// -----------------------------------------------------------------------------
+/// Disallow nodes to move further away from the input surface than a given distance
+///
+/// The input surface cell found within the maximum distance of a node is
+/// remembered, and tested first the next time. Only when the moved node is no
+/// longer within the maximum distance of this cell, the bounding volume
+/// hierarchy is searched for another cell within this distance.
+struct EnforceMaxInputDistance
+{
+  vtkPoints                     *_Points;
+  const BoundingVolumeHierarchy *_Locator;
+  vtkIdType                     *_Cell;
+  double                        *_Displacement;
+  double                         _MaxDistance2;
+
+  void operator ()(const blocked_range<int> &ptIds) const
+  {
+    vtkIdType cellId;
+    double    p[3], *d = _Displacement + 3 * ptIds.begin();
+    vtkNew<vtkGenericCell> cell;
+    for (int ptId = ptIds.begin(); ptId != ptIds.end(); ++ptId, d += 3) {
+      _Points->GetPoint(ptId, p);
+      p[0] += d[0], p[1] += d[1], p[2] += d[2];
+      cellId = _Cell[ptId];
+      if (cellId < 0 || _Locator->Distance2ToCell(p, cellId, cell.GetPointer()) > _MaxDistance2) {
+        cellId = _Locator->FindCellWithinDistance(p, _MaxDistance2, cell.GetPointer());
+        if (cellId < 0) d[0] = d[1] = d[2] = 0.;
+        else            _Cell[ptId] = cellId;
+      }
+    }
+  }
+};
+
 // -----------------------------------------------------------------------------
 /// Perform one iteration of gradient averaging
 struct AverageGradient
@@ -683,6 +1118,135 @@ ComputeEdgeLengthRange(vtkPolyData *surface, double minl, double maxl, const Dis
 }
 
 
+// -----------------------------------------------------------------------------
+/// Wall clock time in seconds
+inline double WallClockTime()
+{
+  using namespace std::chrono;
+  return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+// -----------------------------------------------------------------------------
+/// Update energy terms
+struct UpdateTerms
+{
+  DeformableSurfaceModel *_Model;
+  bool                    _Gradient;
+  double                 *_Time;
+
+  void operator ()(const blocked_range<int> &re) const
+  {
+    for (int i = re.begin(); i != re.end(); ++i) {
+      EnergyTerm *term = _Model->Term(i);
+      if (term->Weight() != 0.) {
+        const string &name = term->Name();
+        DeformableSurfaceTracer::Scope trace(_Model->Tracer(), "Update", name.c_str());
+        const double t0 = WallClockTime();
+        term->Update(_Gradient);
+        term->ResetValue(); // in case energy term does not do this
+        _Time[i] += WallClockTime() - t0;
+      }
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Evaluate gradients of energy terms
+///
+/// When _Buffer is set, the gradient of each term is stored in its own buffer.
+/// Otherwise, the gradients of all terms are added to the _Output in order.
+struct EvaluateTermGradients
+{
+  DeformableSurfaceModel *_Model;
+  double                **_Buffer;
+  double                 *_Output;
+  int                     _NumberOfDOFs;
+  double                  _Step;
+  double                 *_Time;
+
+  void operator ()(const blocked_range<int> &re) const
+  {
+    for (int i = re.begin(); i != re.end(); ++i) {
+      EnergyTerm *term = _Model->Term(i);
+      if (term->Weight() != 0.) {
+        const string &name = term->Name();
+        DeformableSurfaceTracer::Scope trace(_Model->Tracer(), "Gradient", name.c_str());
+        const double t0 = WallClockTime();
+        double *gradient = _Output;
+        if (_Buffer) {
+          gradient = _Buffer[i];
+          memset(gradient, 0, _NumberOfDOFs * sizeof(double));
+        }
+        term->Gradient(gradient, _Step);
+        _Time[i] += WallClockTime() - t0;
+      }
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Sum gradients of energy terms in fixed order of the terms
+struct SumTermGradients
+{
+  double * const *_Buffer;
+  int             _NumberOfTerms;
+  double         *_Output;
+
+  void operator ()(const blocked_range<int> &re) const
+  {
+    for (int dof = re.begin(); dof != re.end(); ++dof) {
+      for (int i = 0; i < _NumberOfTerms; ++i) {
+        if (_Buffer[i]) _Output[dof] += _Buffer[i][dof];
+      }
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Count active nodes, i.e., nodes with non-zero status, of each block of nodes
+struct CountActivePoints
+{
+  vtkDataArray *_Status;
+  int          *_Offsets;
+  int           _BlockSize;
+  int           _NumberOfPoints;
+
+  void operator ()(const blocked_range<int> &blocks) const
+  {
+    for (int block = blocks.begin(); block != blocks.end(); ++block) {
+      const int end = min((block + 1) * _BlockSize, _NumberOfPoints);
+      int nactive = 0;
+      for (int ptId = block * _BlockSize; ptId < end; ++ptId) {
+        if (_Status->GetComponent(ptId, 0) != .0) ++nactive;
+      }
+      _Offsets[block + 1] = nactive;
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Copy indices of active nodes of each block of nodes in ascending order
+struct CollectActivePoints
+{
+  vtkDataArray *_Status;
+  const int    *_Offsets;
+  int          *_Output;
+  int           _BlockSize;
+  int           _NumberOfPoints;
+
+  void operator ()(const blocked_range<int> &blocks) const
+  {
+    for (int block = blocks.begin(); block != blocks.end(); ++block) {
+      const int end = min((block + 1) * _BlockSize, _NumberOfPoints);
+      int *out = _Output + _Offsets[block];
+      for (int ptId = block * _BlockSize; ptId < end; ++ptId) {
+        if (_Status->GetComponent(ptId, 0) != .0) *out++ = ptId;
+      }
+    }
+  }
+};
+
+
 } // namespace DeformableSurfaceModelUtils
 using namespace DeformableSurfaceModelUtils;
 
@@ -710,6 +1274,7 @@ DeformableSurfaceModel::DeformableSurfaceModel()
   _RemeshInterval(0),
   _RemeshCounter(0),
   _RemeshAdaptively(false),
+  _ParallelRemeshing(false),
   _LowPassInterval(0),
   _LowPassIterations(100),
   _LowPassBand(.75),
@@ -724,7 +1289,12 @@ DeformableSurfaceModel::DeformableSurfaceModel()
   _AllowContraction(true),
   _IsSurfaceMesh(false),
   _MinimizeExtrinsicEnergy(false),
-  _LowPassCounter(0)
+  _ConcurrentTerms(false),
+  _ActiveSet(false),
+  _Tracer(nullptr),
+  _LowPassCounter(0),
+  _SurfaceLocatorTime(0.),
+  _SerialUpdatePending(true)
 {
 }
 
@@ -760,10 +1330,11 @@ void DeformableSurfaceModel::Initialize()
   // Initialize input locator if needed
   if (_MaxInputDistance <= 0.) _MaxInputDistance = inf;
   if (_IsSurfaceMesh && !IsInf(_MaxInputDistance)) {
-    _InputCellLocator = vtkSmartPointer<vtkCellLocator>::New();
-    _InputCellLocator->SetDataSet(_Input);
-    _InputCellLocator->BuildLocator();
+    _InputLocator.Build(vtkPolyData::SafeDownCast(_Input));
+  } else {
+    _InputLocator.Clear();
   }
+  _InputCell.clear();
 
   // Gradient smoothing
   if (_Transformation && (_GradientAveraging > 0 || _LowPassInterval > 0)) {
@@ -780,6 +1351,10 @@ void DeformableSurfaceModel::Initialize()
   }
   _LowPassCounter = 0;
 
+  // Surface locator is built upon first collision query
+  _SurfaceLocator.Clear();
+  _SurfaceLocatorTime = 0.;
+
   // Local adaptive remeshing settings
   if (_IsSurfaceMesh && IsTriangularMesh(_Input) && _RemeshInterval > 0) {
     if (_MinEdgeLength < .0 || _MaxEdgeLength <= .0) {
@@ -801,16 +1376,22 @@ void DeformableSurfaceModel::Initialize()
   this->Changed(true);
 
   // Initialize energy terms
+  _InsideMask.Clear();
   for (size_t i = 0; i < _ExternalForce.size(); ++i) {
     _ExternalForce[i]->PointSet(&_PointSet);
     if (IsImplicitSurfaceForce(_ExternalForce[i])) {
       _ExternalForce[i]->Image(_ImplicitSurface);
     } else {
       _ExternalForce[i]->Image(_Image);
+      SurfaceForce *force = dynamic_cast<SurfaceForce *>(_ExternalForce[i]);
+      if (force) force->SharedInsideMask(&_InsideMask);
     }
   }
+  _CurvatureCache.Clear();
   for (size_t i = 0; i < _InternalForce.size(); ++i) {
     _InternalForce[i]->PointSet(&_PointSet);
+    SurfaceConstraint *constraint = dynamic_cast<SurfaceConstraint *>(_InternalForce[i]);
+    if (constraint) constraint->SharedCurvatureCache(&_CurvatureCache);
   }
   for (int i = 0; i < _NumberOfTerms; ++i) {
     EnergyTerm *term = Term(i);
@@ -819,6 +1400,8 @@ void DeformableSurfaceModel::Initialize()
       term->Initialize();
     }
   }
+  ResetTermTimes();
+  _SerialUpdatePending = true;
 }
 
 // -----------------------------------------------------------------------------
@@ -1045,6 +1628,9 @@ bool DeformableSurfaceModel::Set(const char *name, const char *value)
   if (strcmp(name, "Adatpive remeshing") == 0 || strcmp(name, "Remesh adaptively") == 0) {
     return FromString(value, _RemeshAdaptively);
   }
+  if (strcmp(name, "Parallel remeshing") == 0) {
+    return FromString(value, _ParallelRemeshing);
+  }
   if (strcmp(name, "Maximum distance from input surface") == 0) {
     return FromString(value, _MaxInputDistance);
   }
@@ -1072,6 +1658,12 @@ bool DeformableSurfaceModel::Set(const char *name, const char *value)
   if (strcmp(name, "Allow surface contraction") == 0) {
     return FromString(value, _AllowContraction);
   }
+  if (strcmp(name, "Concurrent evaluation of energy terms") == 0) {
+    return FromString(value, _ConcurrentTerms);
+  }
+  if (strcmp(name, "Active set evaluation") == 0) {
+    return FromString(value, _ActiveSet);
+  }
 
   bool known = false;
   for (int i = 0; i < _NumberOfTerms; ++i) {
@@ -1096,6 +1688,7 @@ ParameterList DeformableSurfaceModel::Parameter() const
   Insert(params, "Maximum feature angle", _MaxFeatureAngle);
   Insert(params, "Remesh interval", _RemeshInterval);
   Insert(params, "Adaptive remeshing", _RemeshAdaptively);
+  Insert(params, "Parallel remeshing", _ParallelRemeshing);
   Insert(params, "Maximum distance from input surface", _MaxInputDistance);
   Insert(params, "Hard non-self-intersection constraint", _HardNonSelfIntersection);
   Insert(params, "Minimum frontface distance", _MinFrontfaceDistance);
@@ -1105,6 +1698,8 @@ ParameterList DeformableSurfaceModel::Parameter() const
   Insert(params, "Allow triangle inversion", _AllowTriangleInversion);
   Insert(params, "Allow surface expansion", _AllowExpansion);
   Insert(params, "Allow surface contraction", _AllowContraction);
+  Insert(params, "Concurrent evaluation of energy terms", _ConcurrentTerms);
+  Insert(params, "Active set evaluation", _ActiveSet);
   return params;
 }
 
@@ -1130,6 +1725,10 @@ void DeformableSurfaceModel::Put(const double *x)
       points->SetPoint(i, x);
     }
     _PointSet.PointsChanged();
+    if (!_SurfaceLocator.Empty()) {
+      _SurfaceLocator.Refit();
+      _SurfaceLocatorTime += _SurfaceLocator.LastUpdateTime();
+    }
   }
   // Mark deformable surface model as changed
   this->Changed(true);
@@ -1163,7 +1762,9 @@ double DeformableSurfaceModel::Get(int dof) const
 // -----------------------------------------------------------------------------
 double DeformableSurfaceModel::Step(double *dx)
 {
+  DeformableSurfaceTracer::Scope trace(_Tracer, "Step", nullptr);
   double delta;
+  _SurfaceLocatorTime = 0.;
   if (_Transformation) {
 
     delta = _Transformation->Update(dx);
@@ -1171,47 +1772,14 @@ double DeformableSurfaceModel::Step(double *dx)
   } else {
 
     // Perform low-pass filtering
-    //
-    // The translation and scale "fix" is due to a bug in vtkWindowedSincPolyDataFilter:
-    // http://vtk.1045678.n5.nabble.com/Bug-in-vtkWindowedSincPolyDataFilter-td1234055.html
     if (_IsSurfaceMesh && _LowPassInterval > 0 && _LowPassIterations > 0) {
       ++_LowPassCounter;
       if (_LowPassCounter >= _LowPassInterval) {
         _LowPassCounter = 0;
 
         MIRTK_START_TIMING();
-        vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
-        points->SetNumberOfPoints(_PointSet.NumberOfPoints());
-        vtkSmartPointer<vtkPolyData> surface;
-        surface = vtkSmartPointer<vtkPolyData>::New();
-        surface->ShallowCopy(_PointSet.Surface());
-        surface->SetPoints(points);
-        MovePoints::Run(_PointSet.Points(), dx, surface->GetPoints());
-
-        double c1[3], s1[3];
-        GetCentroid(surface, c1);
-        GetScale(surface, c1, s1);
-
-        vtkNew<vtkWindowedSincPolyDataFilter> filter;
-        filter->SetPassBand(_LowPassBand);
-        filter->SetNumberOfIterations(_LowPassIterations);
-        filter->NormalizeCoordinatesOn();
-        filter->FeatureEdgeSmoothingOff();
-        SetVTKInput(filter, surface);
-        filter->Update();
-
-        double c2[3], s2[3];
-        GetCentroid(filter->GetOutput(), c2);
-        GetScale(filter->GetOutput(), c2, s2);
-
-        double p1[3], p2[3], *dp = dx;
-        for (vtkIdType ptId = 0; ptId < surface->GetNumberOfPoints(); ++ptId, dp += 3) {
-          surface->GetPoint(ptId, p1);
-          filter->GetOutput()->GetPoint(ptId, p2);
-          dp[0] += (c1[0] + s1[0] * (p2[0] - c2[0]) / s2[0]) - p1[0];
-          dp[1] += (c1[1] + s1[1] * (p2[1] - c2[1]) / s2[1]) - p1[1];
-          dp[2] += (c1[2] + s1[2] * (p2[2] - c2[2]) / s2[2]) - p1[2];
-        }
+        LowPassFilter(_PointSet.Points(), _PointSet.Surface(), _PointSet.SurfaceEdges(),
+                      dx, _LowPassIterations, _LowPassBand);
         MIRTK_DEBUG_TIMING(3, "low-pass filtering");
       }
     }
@@ -1225,6 +1793,11 @@ double DeformableSurfaceModel::Step(double *dx)
     if (delta != .0) {
       MovePoints::Run(_PointSet.Points(), dx);
       _PointSet.PointsChanged();
+      // Refit bounding volumes of collision locator to moved surface points
+      if (!_SurfaceLocator.Empty()) {
+        _SurfaceLocator.Refit();
+        _SurfaceLocatorTime += _SurfaceLocator.LastUpdateTime();
+      }
     }
   }
   // Mark deformable surface model as changed
@@ -1236,6 +1809,80 @@ double DeformableSurfaceModel::Step(double *dx)
   return delta;
 }
 
+// -----------------------------------------------------------------------------
+bool DeformableSurfaceModel::EvaluateTermsConcurrently() const
+{
+  return _ConcurrentTerms && !_Transformation && _NumberOfTerms > 1;
+}
+
+// -----------------------------------------------------------------------------
+void DeformableSurfaceModel::PrepareConcurrentEvaluation()
+{
+  _PointSet.Edges();
+  if (_IsSurfaceMesh) {
+    _PointSet.SurfaceEdges();
+    _PointSet.SurfaceNormals();
+    _PointSet.SurfaceFaceNormals();
+    _PointSet.SurfaceArea();
+    _PointSet.InputSurfaceArea();
+    vtkPolyData * const surface = _PointSet.Surface();
+    if (surface->NeedToBuildCells()) surface->BuildCells();
+  }
+  for (size_t i = 0; i < _ExternalForce.size(); ++i) {
+    if (_ExternalForce[i]->Weight() != .0) _ExternalForce[i]->PrepareConcurrentEvaluation();
+  }
+  for (size_t i = 0; i < _InternalForce.size(); ++i) {
+    if (_InternalForce[i]->Weight() != .0) _InternalForce[i]->PrepareConcurrentEvaluation();
+  }
+}
+
+// -----------------------------------------------------------------------------
+bool DeformableSurfaceModel::UpdateActivePoints()
+{
+  _ActivePoints.clear();
+  if (!_ActiveSet || _Transformation || !_IsSurfaceMesh) return false;
+  vtkDataArray * const status = _PointSet.SurfaceStatus();
+  if (!status) return false;
+
+  MIRTK_START_TIMING();
+  const int block_size = 1024;
+  const int npoints    = _PointSet.NumberOfSurfacePoints();
+  const int nblocks    = (npoints + block_size - 1) / block_size;
+
+  // Passive nodes adjacent to active nodes are not included, because the
+  // energy terms skip nodes with zero status also when evaluated at all nodes.
+  // The active nodes of each block are counted in a first pass and copied in
+  // a second pass, such that the indices are in ascending order.
+  _ActiveBlockOffsets.resize(nblocks + 1);
+  _ActiveBlockOffsets[0] = 0;
+  CountActivePoints count;
+  count._Status         = status;
+  count._Offsets        = _ActiveBlockOffsets.data();
+  count._BlockSize      = block_size;
+  count._NumberOfPoints = npoints;
+  parallel_for(blocked_range<int>(0, nblocks), count);
+  for (int block = 0; block < nblocks; ++block) {
+    _ActiveBlockOffsets[block + 1] += _ActiveBlockOffsets[block];
+  }
+  _ActivePoints.resize(_ActiveBlockOffsets[nblocks]);
+  CollectActivePoints collect;
+  collect._Status         = status;
+  collect._Offsets        = _ActiveBlockOffsets.data();
+  collect._Output         = _ActivePoints.data();
+  collect._BlockSize      = block_size;
+  collect._NumberOfPoints = npoints;
+  parallel_for(blocked_range<int>(0, nblocks), collect);
+  MIRTK_DEBUG_TIMING(5, "update of active nodes");
+  return true;
+}
+
+// -----------------------------------------------------------------------------
+void DeformableSurfaceModel::ResetTermTimes()
+{
+  _TermUpdateTime  .assign(_NumberOfTerms, 0.);
+  _TermGradientTime.assign(_NumberOfTerms, 0.);
+}
+
 // -----------------------------------------------------------------------------
 void DeformableSurfaceModel::Update(bool gradient)
 {
@@ -1245,27 +1892,21 @@ void DeformableSurfaceModel::Update(bool gradient)
     if (_Transformation) {
       _PointSet.Update(true);
     }
-    // 1. Update external forces
-    for (auto force : _ExternalForce) {
-      if (force->Weight() != 0.) {
-        force->Update(gradient);
-        force->ResetValue(); // in case energy term does not do this
-      }
-    }
-    // 2. Update internal forces
-    for (auto force : _InternalForce) {
-      if (force->Weight() != 0.) {
-        force->Update(gradient);
-        force->ResetValue(); // in case energy term does not do this
-      }
+    // Update external forces, internal forces, and transformation constraints
+    if (_TermUpdateTime.size() != static_cast<size_t>(_NumberOfTerms)) {
+      ResetTermTimes();
     }
-    // 3. Update transformation constraints
-    for (auto constraint : _Constraint) {
-      if (constraint->Weight() != 0.) {
-        constraint->Update(gradient);
-        constraint->ResetValue(); // in case energy term does not do this
-      }
+    UpdateTerms update;
+    update._Model    = this;
+    update._Gradient = gradient;
+    update._Time     = _TermUpdateTime.data();
+    if (EvaluateTermsConcurrently() && !_SerialUpdatePending) {
+      PrepareConcurrentEvaluation();
+      parallel_for(blocked_range<int>(0, _NumberOfTerms, 1), update);
+    } else {
+      update(blocked_range<int>(0, _NumberOfTerms));
     }
+    _SerialUpdatePending = false;
     // Mark deformable surface model as up-to-date
     this->Changed(false);
     MIRTK_DEBUG_TIMING(3, "update of energy function");
@@ -1289,6 +1930,7 @@ bool DeformableSurfaceModel::Remesh()
   if (_RemeshCounter < _RemeshInterval) return false;
   _RemeshCounter = 0;
 
+  DeformableSurfaceTracer::Scope trace(_Tracer, "Remesh", nullptr);
   MIRTK_START_TIMING();
 
   // Shallow copy of surface mesh
@@ -1312,47 +1954,62 @@ bool DeformableSurfaceModel::Remesh()
     }
   }
 
-  // Compute local edge length intervals
-  SurfaceRemeshing remesher;
-  if (_RemeshAdaptively) {
-    vtkSmartPointer<vtkDataArray> adaptive_edge_length;
-    if (false && _ImplicitSurface) {
-      // FIXME: Experimental code that is not ready for use
-      adaptive_edge_length = ComputeEdgeLengthRange(_PointSet.Surface(), _MinEdgeLength, _MaxEdgeLength, _ImplicitSurface);
-    } else {
-      SurfaceCurvature curv;
-      curv.Input(_PointSet.Surface());
-      curv.CurvatureType(SurfaceCurvature::Curvedness);
-      curv.Run();
-      adaptive_edge_length = curv.GetCurvedness();
-      _PointSet.Surface()->GetPointData()->AddArray(adaptive_edge_length);
-    }
-    if (adaptive_edge_length) {
-      remesher.AdaptiveEdgeLengthArray(adaptive_edge_length);
-    } else {
-      remesher.MinCellEdgeLengthArray(input->GetCellData()->GetArray("MinEdgeLength"));
-      remesher.MaxCellEdgeLengthArray(input->GetCellData()->GetArray("MaxEdgeLength"));
+  // Remesh surface
+  vtkSmartPointer<vtkPolyData> output;
+  if (_ParallelRemeshing && !_RemeshAdaptively && !_Transformation) {
+    ParallelSurfaceRemeshing remesher;
+    remesher.Input(input);
+    remesher.PointMask(_PointSet.InitialSurfaceStatus());
+    remesher.MinEdgeLength(_MinEdgeLength);
+    remesher.MaxEdgeLength(_MaxEdgeLength);
+    remesher.MinFeatureAngle(_MinFeatureAngle);
+    remesher.MaxFeatureAngle(_MaxFeatureAngle);
+    remesher.Run();
+    output = remesher.Output();
+  } else {
+    // Compute local edge length intervals
+    SurfaceRemeshing remesher;
+    if (_RemeshAdaptively) {
+      vtkSmartPointer<vtkDataArray> adaptive_edge_length;
+      if (false && _ImplicitSurface) {
+        // FIXME: Experimental code that is not ready for use
+        adaptive_edge_length = ComputeEdgeLengthRange(_PointSet.Surface(), _MinEdgeLength, _MaxEdgeLength, _ImplicitSurface);
+      } else {
+        SurfaceCurvature curv;
+        curv.Input(_PointSet.Surface());
+        curv.CurvatureType(SurfaceCurvature::Curvedness);
+        curv.Run();
+        adaptive_edge_length = curv.GetCurvedness();
+        _PointSet.Surface()->GetPointData()->AddArray(adaptive_edge_length);
+      }
+      if (adaptive_edge_length) {
+        remesher.AdaptiveEdgeLengthArray(adaptive_edge_length);
+      } else {
+        remesher.MinCellEdgeLengthArray(input->GetCellData()->GetArray("MinEdgeLength"));
+        remesher.MaxCellEdgeLengthArray(input->GetCellData()->GetArray("MaxEdgeLength"));
+      }
     }
-  }
 
-  // Remesh surface
-  remesher.Input(input);
-  remesher.PointMask(_PointSet.InitialSurfaceStatus());
-  remesher.MeltingOrder(SurfaceRemeshing::AREA);
-  remesher.MeltNodesOn();
-  remesher.MeltTrianglesOff();
-  remesher.InvertTrianglesSharingOneLongEdge(_AllowTriangleInversion);
-  remesher.InvertTrianglesToIncreaseMinHeight(_AllowTriangleInversion);
-  remesher.MinEdgeLength(_MinEdgeLength);
-  remesher.MaxEdgeLength(_MaxEdgeLength);
-  remesher.MinFeatureAngle(_MinFeatureAngle);
-  remesher.MaxFeatureAngle(_MaxFeatureAngle);
-  remesher.Transformation(_Transformation);
-  remesher.Run();
-
-  vtkSmartPointer<vtkPolyData> output = remesher.Output();
+    remesher.Input(input);
+    remesher.PointMask(_PointSet.InitialSurfaceStatus());
+    remesher.MeltingOrder(SurfaceRemeshing::AREA);
+    remesher.MeltNodesOn();
+    remesher.MeltTrianglesOff();
+    remesher.InvertTrianglesSharingOneLongEdge(_AllowTriangleInversion);
+    remesher.InvertTrianglesToIncreaseMinHeight(_AllowTriangleInversion);
+    remesher.MinEdgeLength(_MinEdgeLength);
+    remesher.MaxEdgeLength(_MaxEdgeLength);
+    remesher.MinFeatureAngle(_MinFeatureAngle);
+    remesher.MaxFeatureAngle(_MaxFeatureAngle);
+    remesher.Transformation(_Transformation);
+    remesher.Run();
+
+    output = remesher.Output();
+  }
 
   if (output != input) {
+    // Collision locator must be rebuilt for new surface mesh topology
+    _SurfaceLocator.Clear();
     // Update deformable surface mesh
     _PointSet.InputPointSet(output);
     if (_Transformation) {
@@ -1376,6 +2033,9 @@ bool DeformableSurfaceModel::Remesh()
       if (points) _PointSet.Points()->DeepCopy(points);
     }
 
+    // Input surface cells found last within maximum distance refer to old nodes
+    _InputCell.clear();
+
     // Reinitialize internal and external force terms
     for (size_t i = 0; i < _ExternalForce.size(); ++i) {
       if (_ExternalForce[i]->Weight() != .0) {
@@ -1390,12 +2050,71 @@ bool DeformableSurfaceModel::Remesh()
 
     // Mark deformable surface model as modified
     this->Changed(true);
+    _SerialUpdatePending = true;
   }
 
   MIRTK_DEBUG_TIMING(3, "local adaptive remeshing");
   return (input != output);
 }
 
+// -----------------------------------------------------------------------------
+void DeformableSurfaceModel::SaveState(vtkFieldData *data) const
+{
+  vtkSmartPointer<vtkIntArray> remesh_counter = vtkSmartPointer<vtkIntArray>::New();
+  remesh_counter->SetName("RemeshCounter");
+  remesh_counter->InsertNextValue(_RemeshCounter);
+  data->RemoveArray(remesh_counter->GetName());
+  data->AddArray(remesh_counter);
+
+  vtkSmartPointer<vtkIntArray> lowpass_counter = vtkSmartPointer<vtkIntArray>::New();
+  lowpass_counter->SetName("LowPassCounter");
+  lowpass_counter->InsertNextValue(_LowPassCounter);
+  data->RemoveArray(lowpass_counter->GetName());
+  data->AddArray(lowpass_counter);
+
+  // Initial values of terms normalized by these, NaN for all other terms
+  vtkSmartPointer<vtkDoubleArray> initial_values = vtkSmartPointer<vtkDoubleArray>::New();
+  initial_values->SetName("InitialValues");
+  initial_values->SetNumberOfTuples(_NumberOfTerms);
+  for (int i = 0; i < _NumberOfTerms; ++i) {
+    EnergyTerm * const term = const_cast<EnergyTerm *>(Term(i));
+    if (term->Weight() != .0 && term->DivideByInitialValue()) {
+      initial_values->SetValue(i, term->InitialValue());
+    } else {
+      initial_values->SetValue(i, NaN);
+    }
+  }
+  data->RemoveArray(initial_values->GetName());
+  data->AddArray(initial_values);
+}
+
+// -----------------------------------------------------------------------------
+void DeformableSurfaceModel::RestoreState(vtkFieldData *data)
+{
+  vtkDataArray *remesh_counter  = data->GetArray("RemeshCounter");
+  vtkDataArray *lowpass_counter = data->GetArray("LowPassCounter");
+  if (remesh_counter && remesh_counter->GetNumberOfTuples() > 0) {
+    _RemeshCounter = static_cast<int>(remesh_counter->GetComponent(0, 0));
+  }
+  if (lowpass_counter && lowpass_counter->GetNumberOfTuples() > 0) {
+    _LowPassCounter = static_cast<int>(lowpass_counter->GetComponent(0, 0));
+  }
+  vtkDataArray *initial_values = data->GetArray("InitialValues");
+  if (initial_values) {
+    if (initial_values->GetNumberOfTuples() != _NumberOfTerms) {
+      Throw(ERR_InvalidArgument, __FUNCTION__, "Checkpoint has initial values of ",
+            initial_values->GetNumberOfTuples(), " energy terms, but model has ", _NumberOfTerms);
+    }
+    double value;
+    for (int i = 0; i < _NumberOfTerms; ++i) {
+      value = initial_values->GetComponent(i, 0);
+      if (IsNaN(value)) continue;
+      PointSetForce * const force = dynamic_cast<PointSetForce *>(Term(i));
+      if (force) force->InitialValue(value);
+    }
+  }
+}
+
 // =============================================================================
 // Evaluation
 // =============================================================================
@@ -1444,7 +2163,13 @@ double DeformableSurfaceModel::Value()
   double value, sum = .0;
   for (int i = 0; i < _NumberOfTerms; ++i) {
     EnergyTerm *term = Term(i);
-    value = (term->Weight() != .0 ? term->Value() : .0);
+    if (term->Weight() != .0) {
+      const string &name = term->Name();
+      DeformableSurfaceTracer::Scope trace(_Tracer, "Value", name.c_str());
+      value = term->Value();
+    } else {
+      value = .0;
+    }
     if (IsNaN(value)) {
       string name = term->Name();
       if (name.empty()) name = ToString(i + 1);
@@ -1482,12 +2207,47 @@ void DeformableSurfaceModel::Gradient(double *gradient, double step, bool *sgn_c
     }
   }
 
+  // Restrict gradient evaluation to active nodes
+  const Array<int> *active = (UpdateActivePoints() ? &_ActivePoints : nullptr);
+  for (size_t i = 0; i < _ExternalForce.size(); ++i) {
+    _ExternalForce[i]->ActivePoints(active);
+  }
+  for (size_t i = 0; i < _InternalForce.size(); ++i) {
+    _InternalForce[i]->ActivePoints(active);
+  }
+
   // Sum (weighted) internal and external forces
-  for (int i = 0; i < _NumberOfTerms; ++i) {
-    EnergyTerm *term = Term(i);
-    if (term->Weight() != .0) {
-      term->Gradient(gradient, step);
+  if (_TermGradientTime.size() != static_cast<size_t>(_NumberOfTerms)) {
+    ResetTermTimes();
+  }
+  EvaluateTermGradients eval;
+  eval._Model        = this;
+  eval._Buffer       = nullptr;
+  eval._Output       = gradient;
+  eval._NumberOfDOFs = ndofs;
+  eval._Step         = step;
+  eval._Time         = _TermGradientTime.data();
+  if (EvaluateTermsConcurrently()) {
+    // Evaluate each term into its own buffer and sum these in fixed order
+    // afterwards such that the result is independent of the task scheduling
+    Array<double *> buffer(_NumberOfTerms, nullptr);
+    _TermGradient.resize(_NumberOfTerms);
+    for (int i = 0; i < _NumberOfTerms; ++i) {
+      if (Term(i)->Weight() != .0) {
+        _TermGradient[i].resize(ndofs);
+        buffer[i] = _TermGradient[i].data();
+      }
     }
+    PrepareConcurrentEvaluation();
+    eval._Buffer = buffer.data();
+    parallel_for(blocked_range<int>(0, _NumberOfTerms, 1), eval);
+    SumTermGradients sum;
+    sum._Buffer        = buffer.data();
+    sum._NumberOfTerms = _NumberOfTerms;
+    sum._Output        = gradient;
+    parallel_for(blocked_range<int>(0, ndofs), sum);
+  } else {
+    eval(blocked_range<int>(0, _NumberOfTerms));
   }
 
   // Smooth gradient
@@ -1539,6 +2299,8 @@ void DeformableSurfaceModel::SmoothGradient(double *dx) const
   // Only done when DoFs are the node positions themselves
   if (_Transformation) return;
 
+  DeformableSurfaceTracer::Scope trace(_Tracer, "SmoothGradient", nullptr);
+
   // Smooth vertex displacements such that adjacent nodes move coherently.
   // Can also be viewed as an averaging of the gradient vectors in a local
   // neighborhood. With decreasing smoothing iterations, a multi-resolution
@@ -1623,6 +2385,7 @@ void DeformableSurfaceModel::SmoothGradient(double *dx) const
 void DeformableSurfaceModel
 ::ResolveSurfaceCollisions(double *dx, bool nsi, double mind, double minw) const
 {
+  DeformableSurfaceTracer::Scope trace(_Tracer, "ResolveSurfaceCollisions", nullptr);
   MIRTK_START_TIMING();
 
   const int    fix_attempt      =  2; // No. of attempts displacement is halfed
@@ -1657,9 +2420,13 @@ void DeformableSurfaceModel
   surface->GetPointData()->AddArray(scale);
   surface->GetCellData ()->AddArray(mask);
 
-  vtkNew<vtkCellLocator> locator;
-  locator->SetDataSet(current);
-  locator->BuildLocator();
+  // Build locator upon first call or after remeshing, otherwise it has been
+  // refitted already after the surface points were last moved
+  if (_SurfaceLocator.Empty() || _SurfaceLocator.DataSet() != current ||
+      _SurfaceLocator.NumberOfCells() != current->GetNumberOfCells()) {
+    _SurfaceLocator.Build(current);
+    _SurfaceLocatorTime += _SurfaceLocator.LastUpdateTime();
+  }
 
   SurfaceCollisions check;
   check.AdjacentIntersectionTest(nsi);
@@ -1695,7 +2462,7 @@ void DeformableSurfaceModel
           bounds[0] = p[0] - r, bounds[1] = p[0] + r;
           bounds[2] = p[1] - r, bounds[3] = p[1] + r;
           bounds[4] = p[2] - r, bounds[5] = p[2] + r;
-          locator->FindCellsWithinBounds(bounds, cellIds.GetPointer());
+          _SurfaceLocator.FindCellsWithinBounds(bounds, cellIds.GetPointer());
           for (vtkIdType i = 0; i < cellIds->GetNumberOfIds(); ++i) {
             mask->SetComponent(cellIds->GetId(i), 0, 1.);
           }
@@ -1769,6 +2536,8 @@ void DeformableSurfaceModel::EnforceHardConstraints(double *dx) const
   // Hard constraints only apply to non-parametric deformable surface models
   if (_Transformation) return;
 
+  DeformableSurfaceTracer::Scope trace(_Tracer, "EnforceHardConstraints", nullptr);
+
   // Hard surface mesh constraints
   if (_IsSurfaceMesh) {
 
@@ -1798,17 +2567,19 @@ void DeformableSurfaceModel::EnforceHardConstraints(double *dx) const
 
     // Disallow points to travel further away from input surface than the given threshold
     if (!IsInf(_MaxInputDistance)) {
-      int subId;
-      vtkIdType cellId;
-      vtkNew<vtkGenericCell> cell;
-      double p[3], x[3], dist2, *d = dx;
-      const double max_dist2 = _MaxInputDistance * _MaxInputDistance;
-      for (int ptId = 0; ptId < _PointSet.NumberOfSurfacePoints(); ++ptId, d += 3) {
-        _PointSet.Surface()->GetPoint(ptId, p);
-        p[0] += d[0], p[1] += d[1], p[2] += d[2];
-        _InputCellLocator->FindClosestPoint(p, x, cell.GetPointer(), cellId, subId, dist2);
-        if (dist2 > max_dist2) d[0] = d[1] = d[2] = 0.;
+      MIRTK_START_TIMING();
+      const int npoints = _PointSet.NumberOfSurfacePoints();
+      if (_InputCell.size() != static_cast<size_t>(npoints)) {
+        _InputCell.assign(npoints, -1);
       }
+      EnforceMaxInputDistance eval;
+      eval._Points       = _PointSet.SurfacePoints();
+      eval._Locator      = &_InputLocator;
+      eval._Cell         = _InputCell.data();
+      eval._Displacement = dx;
+      eval._MaxDistance2 = _MaxInputDistance * _MaxInputDistance;
+      parallel_for(blocked_range<int>(0, npoints), eval);
+      MIRTK_DEBUG_TIMING(5, "enforcement of maximum input distance");
     }
 
     // Enforce non-self-intersection / minimum cell distance constraints
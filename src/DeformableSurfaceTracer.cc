@@ -0,0 +1,174 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright 2013-2017 Imperial College London
+ * Copyright 2013-2017 Andreas Schuh
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "mirtk/DeformableSurfaceTracer.h"
+
+#include "mirtk/LocalOptimizer.h"
+
+#include <fstream>
+
+
+namespace mirtk {
+
+
+// =============================================================================
+// Auxiliaries
+// =============================================================================
+
+namespace DeformableSurfaceTracerUtils {
+
+
+// -----------------------------------------------------------------------------
+/// Write string as quoted JSON string value
+void WriteJSONString(ostream &os, const string &str)
+{
+  os << '"';
+  for (auto c : str) {
+    switch (c) {
+      case '"':  os << "\\\""; break;
+      case '\\': os << "\\\\"; break;
+      case '\n': os << "\\n";  break;
+      case '\t': os << "\\t";  break;
+      default:   os << c;      break;
+    }
+  }
+  os << '"';
+}
+
+
+} // namespace DeformableSurfaceTracerUtils
+using namespace DeformableSurfaceTracerUtils;
+
+// =============================================================================
+// Construction/Destruction
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+DeformableSurfaceTracer::DeformableSurfaceTracer()
+:
+  _Iteration(0),
+  _Epoch(Clock::now()),
+  _IterationStart(0.),
+  _RunStart(0.)
+{
+}
+
+// -----------------------------------------------------------------------------
+DeformableSurfaceTracer::~DeformableSurfaceTracer()
+{
+}
+
+// -----------------------------------------------------------------------------
+void DeformableSurfaceTracer::Clear()
+{
+  std::lock_guard<std::mutex> lock(_Mutex);
+  _Events.clear();
+  _Threads.clear();
+  _Iteration = 0;
+  _Epoch     = Clock::now();
+}
+
+// =============================================================================
+// Recording
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+void DeformableSurfaceTracer::Record(const char *category, const char *name, double start, double end)
+{
+  std::lock_guard<std::mutex> lock(_Mutex);
+  TraceEvent event;
+  event.category  = (category ? category : "");
+  event.name      = event.category;
+  if (name && name[0] != '\0') {
+    if (!event.name.empty()) event.name += ' ';
+    event.name += name;
+  }
+  event.start     = start;
+  event.duration  = end - start;
+  event.iteration = _Iteration;
+  auto it = _Threads.find(std::this_thread::get_id());
+  if (it == _Threads.end()) {
+    const int idx = static_cast<int>(_Threads.size());
+    it = _Threads.insert(std::make_pair(std::this_thread::get_id(), idx)).first;
+  }
+  event.thread = it->second;
+  _Events.push_back(event);
+}
+
+// -----------------------------------------------------------------------------
+void DeformableSurfaceTracer::HandleEvent(Observable *obj, Event event, const void *data)
+{
+  const Iteration *iter = reinterpret_cast<const Iteration *>(data);
+  switch (event) {
+    case StartEvent: {
+      _RunStart = Now();
+    } break;
+    case IterationStartEvent: {
+      if (iter) _Iteration = iter->Iter();
+      else      ++_Iteration;
+      _IterationStart = Now();
+    } break;
+    case IterationEndEvent: {
+      Record("Iteration", nullptr, _IterationStart, Now());
+    } break;
+    case EndEvent: {
+      const LocalOptimizer *optimizer = dynamic_cast<const LocalOptimizer *>(obj);
+      Record("Run", optimizer ? optimizer->NameOfClass() : nullptr, _RunStart, Now());
+    } break;
+    default: break;
+  }
+}
+
+// =============================================================================
+// Output
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+bool DeformableSurfaceTracer::Write(const char *fname) const
+{
+  ofstream os(fname);
+  if (!os) return false;
+  os.precision(3);
+  os << fixed;
+  os << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+  bool first = true;
+  for (const auto &thread : _Threads) {
+    if (!first) os << ",";
+    os << "\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << thread.second
+       << ", \"args\": {\"name\": \"" << (thread.second == 0 ? "main" : "worker ")
+       << (thread.second == 0 ? "" : ToString(thread.second)) << "\"}}";
+    first = false;
+  }
+  for (const auto &event : _Events) {
+    if (!first) os << ",";
+    os << "\n{\"name\": ";
+    WriteJSONString(os, event.name);
+    os << ", \"cat\": ";
+    WriteJSONString(os, event.category);
+    os << ", \"ph\": \"X\", \"ts\": " << event.start << ", \"dur\": " << event.duration
+       << ", \"pid\": 1, \"tid\": " << event.thread
+       << ", \"args\": {\"iteration\": " << event.iteration << "}}";
+    first = false;
+  }
+  os << "\n]}\n";
+  return !os.fail();
+}
+
+
+} // namespace mirtk
@@ -29,6 +29,7 @@
 #include "vtkPointData.h"
 #include "vtkDataArray.h"
 #include "vtkDoubleArray.h"
+#include "vtkIntArray.h"
 #include "vtkUnsignedCharArray.h"
 
 
@@ -51,25 +52,23 @@ namespace EulerMethodUtils {
 class ComputeDisplacements
 {
   const double *_Gradient;
-  vtkDataArray *_Displacement;
+  double       *_Displacement;
   double        _StepLength;
 
 public:
 
-  ComputeDisplacements(vtkDataArray *dx, const double *gradient, double dt, double norm)
+  ComputeDisplacements(double *dx, const double *gradient, double dt, double norm)
   :
     _Gradient(gradient), _Displacement(dx), _StepLength(-dt / norm)
   {}
 
   void operator ()(const blocked_range<int> &ptIds) const
   {
-    double d[3];
-    const double *g = _Gradient + 3 * ptIds.begin();
-    for (int ptId = ptIds.begin(); ptId != ptIds.end(); ++ptId, g += 3) {
-      d[0] = _StepLength * g[0];
-      d[1] = _StepLength * g[1];
-      d[2] = _StepLength * g[2];
-      _Displacement->SetTuple(ptId, d);
+    const int     n = 3 * ptIds.end();
+    const double *g = _Gradient;
+    double       *d = _Displacement;
+    for (int i = 3 * ptIds.begin(); i < n; ++i) {
+      d[i] = _StepLength * g[i];
     }
   }
 };
@@ -78,31 +77,78 @@ public:
 /// Clamp magnitudes of node displacements to [0, max]
 class ClampDisplacements
 {
-  vtkDataArray *_Displacement;
-  double        _Maximum;
+  double *_Displacement;
+  double  _Maximum;
 
 public:
 
-  ClampDisplacements(vtkDataArray *dx, double max_dx)
+  ClampDisplacements(double *dx, double max_dx)
   :
     _Displacement(dx), _Maximum(max_dx * max_dx)
   {}
 
   void operator ()(const blocked_range<int> &ptIds) const
   {
-    double norm, d[3];
-    for (int ptId = ptIds.begin(); ptId != ptIds.end(); ++ptId) {
-      _Displacement->GetTuple(ptId, d);
+    double norm;
+    double *d = _Displacement + 3 * ptIds.begin();
+    for (int ptId = ptIds.begin(); ptId != ptIds.end(); ++ptId, d += 3) {
       norm = d[0]*d[0] + d[1]*d[1] + d[2]*d[2];
       if (norm > _Maximum) {
         norm = sqrt(_Maximum / norm);
         d[0] *= norm, d[1] *= norm, d[2] *= norm;
-        _Displacement->SetTuple(ptId, d);
       }
     }
   }
 };
 
+// -----------------------------------------------------------------------------
+/// Add scaled node displacements projected onto normals to tracked values
+template <class TNormal, class TValue>
+class AddNormalDisplacements
+{
+  const double  *_Displacement;
+  const TNormal *_Normals;
+  TValue        *_Values;
+  double         _Scale;
+
+public:
+
+  AddNormalDisplacements(TValue *values, const TNormal *normals, const double *dx, double scale)
+  :
+    _Displacement(dx), _Normals(normals), _Values(values), _Scale(scale)
+  {}
+
+  void operator ()(const blocked_range<int> &ptIds) const
+  {
+    const double  *d = _Displacement + 3 * ptIds.begin();
+    const TNormal *n = _Normals      + 3 * ptIds.begin();
+    for (int ptId = ptIds.begin(); ptId != ptIds.end(); ++ptId, d += 3, n += 3) {
+      _Values[ptId] += static_cast<TValue>(_Scale * (d[0]*n[0] + d[1]*n[1] + d[2]*n[2]));
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Add normal displacements using raw pointer of tracked values array
+template <class TNormal>
+bool AddNormalDisplacement(vtkDataArray *values, const TNormal *normals,
+                           const double *dx, double scale, int n)
+{
+  if (values->GetDataType() == VTK_FLOAT) {
+    float *v = static_cast<float *>(values->GetVoidPointer(0));
+    AddNormalDisplacements<TNormal, float> eval(v, normals, dx, scale);
+    parallel_for(blocked_range<int>(0, n), eval);
+    return true;
+  }
+  if (values->GetDataType() == VTK_DOUBLE) {
+    double *v = static_cast<double *>(values->GetVoidPointer(0));
+    AddNormalDisplacements<TNormal, double> eval(v, normals, dx, scale);
+    parallel_for(blocked_range<int>(0, n), eval);
+    return true;
+  }
+  return false;
+}
+
 
 } // namespace EulerMethodUtils
 using namespace EulerMethodUtils;
@@ -119,6 +165,7 @@ EulerMethod::EulerMethod(ObjectiveFunction *f)
   _NormalizeStepLength(true),
   _MaximumDisplacement(.0),
   _Gradient(nullptr),
+  _StepCount(0),
   _NumberOfDOFs(0)
 {
   _Epsilon = 1e-9;
@@ -132,6 +179,8 @@ void EulerMethod::CopyAttributes(const EulerMethod &other)
   _MaximumDisplacement = other._MaximumDisplacement;
   _Displacement        = other._Displacement;
   _NormalDisplacement  = other._NormalDisplacement;
+  _StepCount           = other._StepCount;
+  _Checkpoint          = other._Checkpoint;
   _NumberOfDOFs        = other._NumberOfDOFs;
 
   if (_NumberOfDOFs != other._NumberOfDOFs || other._NumberOfDOFs == 0) {
@@ -313,6 +362,11 @@ double EulerMethod::Run()
   // Initialize
   this->Initialize();
 
+  // Restore state of interrupted integration
+  const bool resume = (_Checkpoint != nullptr);
+  const int  iter0  = (resume ? this->RestoreCheckpoint() : 0);
+  _StepCount = iter0;
+
   // Initial update of deformable surface model before start event because
   // the update can trigger some lazy initialization which in turn may
   // broadcast some log events for verbose command output
@@ -323,12 +377,14 @@ double EulerMethod::Run()
 
   // Get initial energy value
   double value = _Model->Value();
-  _LastValues.clear();
-  _LastValues.push_back(value);
+  if (!resume) {
+    _LastValues.clear();
+    _LastValues.push_back(value);
+  }
 
   // Perform explicit integration steps
   _Converged = false;
-  Iteration step(0, _NumberOfSteps);
+  Iteration step(0, max(0, _NumberOfSteps - iter0));
   while (!_Converged && step.Next()) {
 
     // Notify observers about start of iteration
@@ -344,6 +400,7 @@ double EulerMethod::Run()
     // Perform time step
     _LastDelta = _Model->Step(dx);
     if (_LastDelta <= _Delta) break;
+    ++_StepCount;
 
     // Track node displacement in normal direction
     // (e.g., sulcal depth measure during cortical surface inflation)
@@ -364,7 +421,10 @@ double EulerMethod::Run()
     // internal and external forces, the energy values corresponding to the
     // external forces are infinite and hence the total energy value.
     if (!IsInf(value)) value = _Model->Value();
-    _Converged = Converged(step.Iter(), value, dx);
+    {
+      DeformableSurfaceTracer::Scope trace(_Model->Tracer(), "Converged", nullptr);
+      _Converged = Converged(iter0 + step.Iter(), value, dx);
+    }
 
     // Notify observers about end of iteration
     Broadcast(IterationEndEvent, &step);
@@ -417,7 +477,8 @@ double EulerMethod::GradientNorm() const
 // -----------------------------------------------------------------------------
 void EulerMethod::UpdateDisplacement()
 {
-  ComputeDisplacements eval(_Displacement, _Gradient, _StepLength, this->GradientNorm());
+  double *dx = static_cast<double *>(_Displacement->GetVoidPointer(0));
+  ComputeDisplacements eval(dx, _Gradient, _StepLength, this->GradientNorm());
   parallel_for(blocked_range<int>(0, _Model->NumberOfPoints()), eval);
   this->TruncateDisplacement();
 }
@@ -428,7 +489,8 @@ void EulerMethod::TruncateDisplacement(bool force)
   double max_dx = _MaximumDisplacement;
   if (max_dx <= .0) max_dx = _NormalizeStepLength ? _StepLength : 1.0;
   if (force || !_NormalizeStepLength || max_dx < _StepLength) {
-    ClampDisplacements clamp(_Displacement, max_dx);
+    double *dx = static_cast<double *>(_Displacement->GetVoidPointer(0));
+    ClampDisplacements clamp(dx, max_dx);
     parallel_for(blocked_range<int>(0, _Model->NumberOfPoints()), clamp);
   }
 }
@@ -437,16 +499,168 @@ void EulerMethod::TruncateDisplacement(bool force)
 void EulerMethod::UpdateNormalDisplacement()
 {
   if (_NormalDisplacement && IsSurfaceMesh(_Model->Output())) {
-    double m, n[3], dx[3];
-    vtkDataArray * const normals = _Model->PointSet().SurfaceNormals();
-    for (int ptId = 0; ptId < _Model->NumberOfPoints(); ++ptId) {
-      normals->GetTuple(ptId, n);
-      _Displacement->GetTuple(ptId, dx);
-      m  = _NormalDisplacement->GetComponent(ptId, 0);
-      m += dx[0]*n[0] + dx[1]*n[1] + dx[2]*n[2];
-      _NormalDisplacement->SetComponent(ptId, 0, m);
+    const double *dx = static_cast<const double *>(_Displacement->GetVoidPointer(0));
+    this->AddNormalDisplacement(dx, 1.0);
+  }
+}
+
+// -----------------------------------------------------------------------------
+void EulerMethod::AddNormalDisplacement(const double *dx, double scale)
+{
+  const int n = _Model->NumberOfPoints();
+  vtkDataArray * const normals = _Model->PointSet().SurfaceNormals();
+  if (normals->GetNumberOfComponents() == 3) {
+    if (normals->GetDataType() == VTK_FLOAT) {
+      const float *nptr = static_cast<const float *>(normals->GetVoidPointer(0));
+      if (EulerMethodUtils::AddNormalDisplacement(_NormalDisplacement, nptr, dx, scale, n)) return;
+    } else if (normals->GetDataType() == VTK_DOUBLE) {
+      const double *nptr = static_cast<const double *>(normals->GetVoidPointer(0));
+      if (EulerMethodUtils::AddNormalDisplacement(_NormalDisplacement, nptr, dx, scale, n)) return;
+    }
+  }
+  double m, nrm[3];
+  const double *d = dx;
+  for (int ptId = 0; ptId < n; ++ptId, d += 3) {
+    normals->GetTuple(ptId, nrm);
+    m  = _NormalDisplacement->GetComponent(ptId, 0);
+    m += scale * (d[0]*nrm[0] + d[1]*nrm[1] + d[2]*nrm[2]);
+    _NormalDisplacement->SetComponent(ptId, 0, m);
+  }
+}
+
+// =============================================================================
+// Checkpointing
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+vtkSmartPointer<vtkPointSet> EulerMethod::Checkpoint() const
+{
+  vtkSmartPointer<vtkPointSet> output = _Model->Output();
+  vtkSmartPointer<vtkPointSet> checkpoint;
+  checkpoint.TakeReference(output->NewInstance());
+  checkpoint->DeepCopy(output);
+
+  this->SaveState(checkpoint->GetFieldData());
+  return checkpoint;
+}
+
+// -----------------------------------------------------------------------------
+void EulerMethod::Resume(vtkPointSet *checkpoint)
+{
+  _Checkpoint = checkpoint;
+}
+
+// -----------------------------------------------------------------------------
+int EulerMethod::RestoreCheckpoint()
+{
+  vtkSmartPointer<vtkPointSet> checkpoint = _Checkpoint;
+  _Checkpoint = nullptr;
+
+  if (_Model->Transformation()) {
+    Throw(ERR_NotImplemented, __FUNCTION__, "Cannot resume integration of parametric deformable surface model");
+  }
+  if (checkpoint->GetNumberOfPoints() != static_cast<vtkIdType>(_Model->NumberOfPoints())) {
+    Throw(ERR_InvalidArgument, __FUNCTION__, "Checkpoint has ", checkpoint->GetNumberOfPoints(),
+          " points, but deformable surface model has ", _Model->NumberOfPoints(), " points");
+  }
+
+  // Copy point data of checkpoint, reusing existing arrays of the model such
+  // that the references to these arrays held by this optimizer remain valid
+  vtkPointData * const modelPD = _Model->Output()->GetPointData();
+  vtkPointData * const checkPD = checkpoint->GetPointData();
+  for (int i = 0; i < checkPD->GetNumberOfArrays(); ++i) {
+    vtkDataArray * const src = checkPD->GetArray(i);
+    if (src == nullptr || src->GetName() == nullptr) continue;
+    vtkDataArray * const dst = modelPD->GetArray(src->GetName());
+    if (dst && dst->GetNumberOfComponents() == src->GetNumberOfComponents()) {
+      dst->SetNumberOfTuples(src->GetNumberOfTuples());
+      for (int j = 0; j < src->GetNumberOfComponents(); ++j) {
+        dst->CopyComponent(j, src, j);
+      }
+      dst->Modified();
+    } else {
+      vtkSmartPointer<vtkDataArray> array;
+      array.TakeReference(src->NewInstance());
+      array->DeepCopy(src);
+      array->SetName(src->GetName());
+      modelPD->RemoveArray(src->GetName());
+      modelPD->AddArray(array);
+    }
+  }
+
+  // Set deformed surface points
+  Array<double> x(3 * checkpoint->GetNumberOfPoints());
+  for (vtkIdType ptId = 0; ptId < checkpoint->GetNumberOfPoints(); ++ptId) {
+    checkpoint->GetPoint(ptId, &x[3 * ptId]);
+  }
+  _Model->Put(x.data());
+
+  // Restore scalar state
+  _StepCount = 0;
+  this->RestoreState(checkpoint->GetFieldData());
+  return _StepCount;
+}
+
+// -----------------------------------------------------------------------------
+void EulerMethod::SaveState(vtkFieldData *data) const
+{
+  _Model->SaveState(data);
+
+  vtkSmartPointer<vtkIntArray> step_count = vtkSmartPointer<vtkIntArray>::New();
+  step_count->SetName("StepCount");
+  step_count->InsertNextValue(_StepCount);
+  data->RemoveArray(step_count->GetName());
+  data->AddArray(step_count);
+
+  vtkSmartPointer<vtkDoubleArray> last_values = vtkSmartPointer<vtkDoubleArray>::New();
+  last_values->SetName("LastValues");
+  for (auto value : _LastValues) last_values->InsertNextValue(value);
+  data->RemoveArray(last_values->GetName());
+  data->AddArray(last_values);
+}
+
+// -----------------------------------------------------------------------------
+void EulerMethod::RestoreState(vtkFieldData *data)
+{
+  _Model->RestoreState(data);
+
+  vtkDataArray * const last_values = data->GetArray("LastValues");
+  if (last_values) {
+    _LastValues.clear();
+    for (vtkIdType i = 0; i < last_values->GetNumberOfTuples(); ++i) {
+      _LastValues.push_back(last_values->GetComponent(i, 0));
     }
   }
+
+  RestoreValue(data, "StepCount", _StepCount);
+}
+
+// -----------------------------------------------------------------------------
+void EulerMethod::SaveValue(vtkFieldData *data, const char *name, double value)
+{
+  vtkSmartPointer<vtkDoubleArray> array = vtkSmartPointer<vtkDoubleArray>::New();
+  array->SetName(name);
+  array->InsertNextValue(value);
+  data->RemoveArray(name);
+  data->AddArray(array);
+}
+
+// -----------------------------------------------------------------------------
+bool EulerMethod::RestoreValue(vtkFieldData *data, const char *name, double &value)
+{
+  vtkDataArray * const array = data->GetArray(name);
+  if (array == nullptr || array->GetNumberOfTuples() == 0) return false;
+  value = array->GetComponent(0, 0);
+  return true;
+}
+
+// -----------------------------------------------------------------------------
+bool EulerMethod::RestoreValue(vtkFieldData *data, const char *name, int &value)
+{
+  double v;
+  if (!RestoreValue(data, name, v)) return false;
+  value = static_cast<int>(v);
+  return true;
 }
 
 // -----------------------------------------------------------------------------
@@ -24,7 +24,7 @@
 #include "mirtk/ObjectFactory.h"
 
 #include "vtkPointData.h"
-#include "vtkFloatArray.h"
+#include "vtkDoubleArray.h"
 
 
 namespace mirtk {
@@ -46,8 +46,8 @@ namespace EulerMethodWithDampingUtils {
 class ComputeDisplacements
 {
   const double *_Gradient;
-  vtkDataArray *_Velocity;
-  vtkDataArray *_Displacement;
+  double       *_Velocity;
+  double       *_Displacement;
   double        _DampingFactor;
   double        _BodyMass;
   double        _StepLength;
@@ -55,7 +55,7 @@ class ComputeDisplacements
 
 public:
 
-  ComputeDisplacements(vtkDataArray *dx, vtkDataArray *v, const double *gradient,
+  ComputeDisplacements(double *dx, double *v, const double *gradient,
                        double damping, double mass, double dt, double norm)
   :
     _Gradient(gradient),
@@ -69,20 +69,15 @@ public:
 
   void operator ()(const blocked_range<int> &ptIds) const
   {
-    double v[3], d[3];
     const double s1 = -_StepLength / (_BodyMass * _GradientNorm);
     const double s2 =  _StepLength * _DampingFactor / _BodyMass;
-    const double *g = _Gradient     + 3 * ptIds.begin();
-    for (int ptId = ptIds.begin(); ptId != ptIds.end(); ++ptId, g += 3) {
-      _Velocity->GetTuple(ptId, v);
-      v[0] += s1 * g[0] - s2 * v[0];
-      v[1] += s1 * g[1] - s2 * v[1];
-      v[2] += s1 * g[2] - s2 * v[2];
-      _Velocity->SetTuple(ptId, v);
-      d[0] = v[0] * _StepLength;
-      d[1] = v[1] * _StepLength;
-      d[2] = v[2] * _StepLength;
-      _Displacement->SetTuple(ptId, d);
+    const int     n = 3 * ptIds.end();
+    const double *g = _Gradient;
+    double       *v = _Velocity;
+    double       *d = _Displacement;
+    for (int i = 3 * ptIds.begin(); i < n; ++i) {
+      v[i] += s1 * g[i] - s2 * v[i];
+      d[i]  = v[i] * _StepLength;
     }
   }
 };
@@ -185,14 +180,27 @@ void EulerMethodWithDamping::Initialize()
   // (e.g., from a previous Euler integration with different parameters).
   vtkSmartPointer<vtkDataArray> velocity;
   velocity = modelPD->GetArray("Velocity");
-  if (!velocity) {
-    velocity = vtkSmartPointer<vtkFloatArray>::New();
+  if (!velocity || velocity->GetNumberOfComponents() != 3) {
+    velocity = vtkSmartPointer<vtkDoubleArray>::New();
     velocity->SetName("Velocity");
     velocity->SetNumberOfComponents(3);
     velocity->SetNumberOfTuples(_Model->NumberOfPoints());
     velocity->FillComponent(0, .0);
     velocity->FillComponent(1, .0);
     velocity->FillComponent(2, .0);
+    modelPD->RemoveArray("Velocity");
+    modelPD->AddArray(velocity);
+  } else if (velocity->GetDataType() != VTK_DOUBLE) {
+    // Convert to double such that velocities can be updated in-place
+    vtkSmartPointer<vtkDataArray> input = velocity;
+    velocity = vtkSmartPointer<vtkDoubleArray>::New();
+    velocity->SetName("Velocity");
+    velocity->SetNumberOfComponents(3);
+    velocity->SetNumberOfTuples(_Model->NumberOfPoints());
+    velocity->CopyComponent(0, input, 0);
+    velocity->CopyComponent(1, input, 1);
+    velocity->CopyComponent(2, input, 2);
+    modelPD->RemoveArray("Velocity");
     modelPD->AddArray(velocity);
   }
 
@@ -205,7 +213,9 @@ void EulerMethodWithDamping::UpdateDisplacement()
 {
   vtkPointData *modelPD  = _Model->Output()->GetPointData();
   vtkDataArray *velocity = modelPD->GetArray("Velocity");
-  ComputeDisplacements eval(_Displacement, velocity, _Gradient, _DampingFactor,
+  double *dx = static_cast<double *>(_Displacement->GetVoidPointer(0));
+  double *v  = static_cast<double *>(velocity     ->GetVoidPointer(0));
+  ComputeDisplacements eval(dx, v, _Gradient, _DampingFactor,
                             _BodyMass, _StepLength, this->GradientNorm());
   parallel_for(blocked_range<int>(0, _Model->NumberOfPoints()), eval);
   this->TruncateDisplacement();
@@ -48,14 +48,14 @@ namespace EulerMethodWithMomentumUtils {
 class ComputeDisplacements
 {
   const double *_Gradient;
-  vtkDataArray *_Displacement;
+  double       *_Displacement;
   double        _Momentum;
   double        _Maximum;
   double        _StepLength;
 
 public:
 
-  ComputeDisplacements(vtkDataArray *dx, const double *gradient,
+  ComputeDisplacements(double *dx, const double *gradient,
                        double momentum, double max_dx, double dt, double norm)
   :
     _Gradient(gradient),
@@ -67,10 +67,10 @@ public:
 
   void operator ()(const blocked_range<int> &ptIds) const
   {
-    double norm, d[3];
-    const double *g = _Gradient + 3 * ptIds.begin();
-    for (int ptId = ptIds.begin(); ptId != ptIds.end(); ++ptId, g += 3) {
-      _Displacement->GetTuple(ptId, d);
+    double norm;
+    const double *g = _Gradient     + 3 * ptIds.begin();
+    double       *d = _Displacement + 3 * ptIds.begin();
+    for (int ptId = ptIds.begin(); ptId != ptIds.end(); ++ptId, g += 3, d += 3) {
       d[0] = _StepLength * g[0] + _Momentum * d[0];
       d[1] = _StepLength * g[1] + _Momentum * d[1];
       d[2] = _StepLength * g[2] + _Momentum * d[2];
@@ -79,7 +79,6 @@ public:
         norm = sqrt(_Maximum / norm);
         d[0] *= norm, d[1] *= norm, d[2] *= norm;
       }
-      _Displacement->SetTuple(ptId, d);
     }
   }
 };
@@ -182,7 +181,8 @@ void EulerMethodWithMomentum::UpdateDisplacement()
   double norm   = this->GradientNorm();
   double max_dx = _MaximumDisplacement;
   if (max_dx <= .0) max_dx = _NormalizeStepLength ? _StepLength : 1.0;
-  ComputeDisplacements eval(_Displacement, _Gradient, _Momentum, max_dx, _StepLength, norm);
+  double *dx = static_cast<double *>(_Displacement->GetVoidPointer(0));
+  ComputeDisplacements eval(dx, _Gradient, _Momentum, max_dx, _StepLength, norm);
   parallel_for(blocked_range<int>(0, _Model->NumberOfPoints()), eval);
 }
 
@@ -196,16 +196,7 @@ void EulerMethodWithMomentum::UpdateNormalDisplacement()
     //       The FreeSurfer function MRISinflateBrain only sums up the current
     //       displacements (scaled forces) excluding the momentum.
     if (_NormalDisplacement && IsSurfaceMesh(_Model->Output())) {
-      double d, n[3];
-      const double dt = - _StepLength / this->GradientNorm();
-      const double *g = _Gradient;
-      vtkDataArray *normals = _Model->PointSet().SurfaceNormals();
-      for (int ptId = 0; ptId < _Model->NumberOfPoints(); ++ptId, g += 3) {
-        normals->GetTuple(ptId, n);
-        d  = _NormalDisplacement->GetComponent(ptId, 0);
-        d += dt*g[0]*n[0] + dt*g[1]*n[1] + dt*g[2]*n[2];
-        _NormalDisplacement->SetComponent(ptId, 0, d);
-      }
+      this->AddNormalDisplacement(_Gradient, - _StepLength / this->GradientNorm());
     }
   } else {
     EulerMethod::UpdateNormalDisplacement();
@@ -0,0 +1,372 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright 2013-2017 Imperial College London
+ * Copyright 2013-2017 Andreas Schuh
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "mirtk/FastInertialRelaxationEngine.h"
+
+#include "mirtk/Math.h"
+#include "mirtk/Parallel.h"
+#include "mirtk/DeformableSurfaceModel.h"
+
+#include "vtkPointData.h"
+#include "vtkDoubleArray.h"
+
+
+namespace mirtk {
+
+
+// =============================================================================
+// Auxiliary functors
+// =============================================================================
+
+namespace FastInertialRelaxationEngineUtils {
+
+
+// -----------------------------------------------------------------------------
+/// Compute power and squared norms of negated forces and velocities
+class ComputePower
+{
+  const double *_Gradient;
+  const double *_Velocity;
+
+public:
+
+  double _Power;        ///< Negated dot product of gradient and velocities
+  double _GradientNorm; ///< Squared norm of gradient
+  double _VelocityNorm; ///< Squared norm of velocities
+
+  ComputePower(const double *gradient, const double *v)
+  :
+    _Gradient(gradient), _Velocity(v),
+    _Power(0.), _GradientNorm(0.), _VelocityNorm(0.)
+  {}
+
+  ComputePower(const ComputePower &other, split)
+  :
+    _Gradient(other._Gradient), _Velocity(other._Velocity),
+    _Power(0.), _GradientNorm(0.), _VelocityNorm(0.)
+  {}
+
+  void join(const ComputePower &other)
+  {
+    _Power        += other._Power;
+    _GradientNorm += other._GradientNorm;
+    _VelocityNorm += other._VelocityNorm;
+  }
+
+  void operator ()(const blocked_range<int> &ptIds)
+  {
+    const int     n = 3 * ptIds.end();
+    const double *g = _Gradient;
+    const double *v = _Velocity;
+    for (int i = 3 * ptIds.begin(); i < n; ++i) {
+      _Power        -= g[i] * v[i];
+      _GradientNorm += g[i] * g[i];
+      _VelocityNorm += v[i] * v[i];
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Mix velocities with forces, perform semi-implicit Euler step of velocities,
+/// and compute node displacements given new velocities and time step
+class ComputeDisplacements
+{
+  const double *_Gradient;
+  double       *_Velocity;
+  double       *_Displacement;
+  double        _VelocityWeight;
+  double        _ForceWeight;
+  double        _TimeStep;
+
+public:
+
+  ComputeDisplacements(double *dx, double *v, const double *gradient,
+                       double v_weight, double f_weight, double dt)
+  :
+    _Gradient(gradient),
+    _Velocity(v),
+    _Displacement(dx),
+    _VelocityWeight(v_weight),
+    _ForceWeight(-f_weight),
+    _TimeStep(dt)
+  {}
+
+  void operator ()(const blocked_range<int> &ptIds) const
+  {
+    const int     n = 3 * ptIds.end();
+    const double *g = _Gradient;
+    double       *v = _Velocity;
+    double       *d = _Displacement;
+    for (int i = 3 * ptIds.begin(); i < n; ++i) {
+      v[i] = _VelocityWeight * v[i] + _ForceWeight * g[i];
+      d[i] = _TimeStep * v[i];
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Set velocities to node displacements divided by time step
+class ComputeVelocities
+{
+  const double *_Displacement;
+  double       *_Velocity;
+  double        _TimeStep;
+
+public:
+
+  ComputeVelocities(double *v, const double *dx, double dt)
+  :
+    _Displacement(dx), _Velocity(v), _TimeStep(dt)
+  {}
+
+  void operator ()(const blocked_range<int> &ptIds) const
+  {
+    const int     n = 3 * ptIds.end();
+    const double *d = _Displacement;
+    double       *v = _Velocity;
+    for (int i = 3 * ptIds.begin(); i < n; ++i) {
+      v[i] = d[i] / _TimeStep;
+    }
+  }
+};
+
+
+} // namespace FastInertialRelaxationEngineUtils
+using namespace FastInertialRelaxationEngineUtils;
+
+// =============================================================================
+// Construction/Destruction
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+FastInertialRelaxationEngine::FastInertialRelaxationEngine(ObjectiveFunction *f)
+:
+  EulerMethod(f),
+  _MaximumTimeStepFactor(10.),
+  _TimeStepIncrease(1.1),
+  _TimeStepDecrease(.5),
+  _InitialMixing(.1),
+  _MixingDecrease(.99),
+  _MinimumNumberOfPositiveSteps(5),
+  _TimeStep(0.),
+  _Mixing(0.),
+  _NumberOfPositiveSteps(0),
+  _NumberOfRestarts(0)
+{
+}
+
+// -----------------------------------------------------------------------------
+void FastInertialRelaxationEngine::CopyAttributes(const FastInertialRelaxationEngine &other)
+{
+  _MaximumTimeStepFactor        = other._MaximumTimeStepFactor;
+  _TimeStepIncrease             = other._TimeStepIncrease;
+  _TimeStepDecrease             = other._TimeStepDecrease;
+  _InitialMixing                = other._InitialMixing;
+  _MixingDecrease               = other._MixingDecrease;
+  _MinimumNumberOfPositiveSteps = other._MinimumNumberOfPositiveSteps;
+  _TimeStep                     = other._TimeStep;
+  _Mixing                       = other._Mixing;
+  _NumberOfPositiveSteps        = other._NumberOfPositiveSteps;
+  _NumberOfRestarts             = other._NumberOfRestarts;
+}
+
+// -----------------------------------------------------------------------------
+FastInertialRelaxationEngine::FastInertialRelaxationEngine(const FastInertialRelaxationEngine &other)
+:
+  EulerMethod(other)
+{
+  CopyAttributes(other);
+}
+
+// -----------------------------------------------------------------------------
+FastInertialRelaxationEngine &FastInertialRelaxationEngine::operator =(const FastInertialRelaxationEngine &other)
+{
+  if (this != &other) {
+    EulerMethod::operator =(other);
+    CopyAttributes(other);
+  }
+  return *this;
+}
+
+// -----------------------------------------------------------------------------
+FastInertialRelaxationEngine::~FastInertialRelaxationEngine()
+{
+}
+
+// =============================================================================
+// Parameters
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+bool FastInertialRelaxationEngine::Set(const char *name, const char *value)
+{
+  if (strcmp(name, "Maximum time step factor") == 0) {
+    return FromString(value, _MaximumTimeStepFactor) && _MaximumTimeStepFactor >= 1.;
+  }
+  if (strcmp(name, "Time step increase") == 0) {
+    return FromString(value, _TimeStepIncrease) && _TimeStepIncrease >= 1.;
+  }
+  if (strcmp(name, "Time step decrease") == 0) {
+    return FromString(value, _TimeStepDecrease) && _TimeStepDecrease > 0. && _TimeStepDecrease <= 1.;
+  }
+  if (strcmp(name, "Initial velocity mixing") == 0) {
+    return FromString(value, _InitialMixing) && _InitialMixing >= 0. && _InitialMixing <= 1.;
+  }
+  if (strcmp(name, "Velocity mixing decrease") == 0) {
+    return FromString(value, _MixingDecrease) && _MixingDecrease > 0. && _MixingDecrease <= 1.;
+  }
+  if (strcmp(name, "Minimum no. of steps with positive power") == 0) {
+    return FromString(value, _MinimumNumberOfPositiveSteps);
+  }
+  return EulerMethod::Set(name, value);
+}
+
+// -----------------------------------------------------------------------------
+ParameterList FastInertialRelaxationEngine::Parameter() const
+{
+  ParameterList params = EulerMethod::Parameter();
+  Insert(params, "Maximum time step factor",                 _MaximumTimeStepFactor);
+  Insert(params, "Time step increase",                       _TimeStepIncrease);
+  Insert(params, "Time step decrease",                       _TimeStepDecrease);
+  Insert(params, "Initial velocity mixing",                  _InitialMixing);
+  Insert(params, "Velocity mixing decrease",                 _MixingDecrease);
+  Insert(params, "Minimum no. of steps with positive power", _MinimumNumberOfPositiveSteps);
+  return params;
+}
+
+// =============================================================================
+// Execution
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+void FastInertialRelaxationEngine::Initialize()
+{
+  // Initialize base class
+  EulerMethod::Initialize();
+
+  // Get model point data
+  vtkPointData *modelPD = _Model->Output()->GetPointData();
+
+  // Add point data array with initial node velocities such that these
+  // are interpolated at new node positions during the remeshing
+  vtkSmartPointer<vtkDataArray> velocity;
+  velocity = modelPD->GetArray("Velocity");
+  if (!velocity || velocity->GetNumberOfComponents() != 3) {
+    velocity = vtkSmartPointer<vtkDoubleArray>::New();
+    velocity->SetName("Velocity");
+    velocity->SetNumberOfComponents(3);
+    velocity->SetNumberOfTuples(_Model->NumberOfPoints());
+    velocity->FillComponent(0, .0);
+    velocity->FillComponent(1, .0);
+    velocity->FillComponent(2, .0);
+    modelPD->RemoveArray("Velocity");
+    modelPD->AddArray(velocity);
+  } else if (velocity->GetDataType() != VTK_DOUBLE) {
+    // Convert to double such that velocities can be updated in-place
+    vtkSmartPointer<vtkDataArray> input = velocity;
+    velocity = vtkSmartPointer<vtkDoubleArray>::New();
+    velocity->SetName("Velocity");
+    velocity->SetNumberOfComponents(3);
+    velocity->SetNumberOfTuples(_Model->NumberOfPoints());
+    velocity->CopyComponent(0, input, 0);
+    velocity->CopyComponent(1, input, 1);
+    velocity->CopyComponent(2, input, 2);
+    modelPD->RemoveArray("Velocity");
+    modelPD->AddArray(velocity);
+  }
+
+  // Reset state of relaxation, which is replaced by RestoreState when resumed
+  _TimeStep              = _StepLength;
+  _Mixing                = _InitialMixing;
+  _NumberOfPositiveSteps = 0;
+  _NumberOfRestarts      = 0;
+}
+
+// -----------------------------------------------------------------------------
+void FastInertialRelaxationEngine::UpdateDisplacement()
+{
+  const int     n        = _Model->NumberOfPoints();
+  vtkPointData *modelPD  = _Model->Output()->GetPointData();
+  vtkDataArray *velocity = modelPD->GetArray("Velocity");
+  double *dx = static_cast<double *>(_Displacement->GetVoidPointer(0));
+  double *v  = static_cast<double *>(velocity     ->GetVoidPointer(0));
+
+  // Forces are the negated gradient divided by the normalization factor
+  const double norm = this->GradientNorm();
+  ComputePower power(_Gradient, v);
+  parallel_reduce(blocked_range<int>(0, n), power);
+
+  // Mix velocities with force directions while moving downhill, and
+  // restart from rest with smaller time step when moving uphill
+  double v_weight, f_weight;
+  if (power._VelocityNorm == 0.) {
+    v_weight = f_weight = 0.;
+  } else if (power._Power > 0.) {
+    v_weight = 1. - _Mixing;
+    f_weight = 0.;
+    if (power._GradientNorm > 0.) {
+      f_weight = _Mixing * sqrt(power._VelocityNorm / power._GradientNorm);
+    }
+    if (++_NumberOfPositiveSteps > _MinimumNumberOfPositiveSteps) {
+      _TimeStep = min(_TimeStep * _TimeStepIncrease, _MaximumTimeStepFactor * _StepLength);
+      _Mixing  *= _MixingDecrease;
+    }
+  } else {
+    v_weight = f_weight = 0.;
+    _NumberOfPositiveSteps = 0;
+    ++_NumberOfRestarts;
+    _TimeStep *= _TimeStepDecrease;
+    _Mixing    = _InitialMixing;
+  }
+
+  // Semi-implicit Euler step with unit mass
+  ComputeDisplacements eval(dx, v, _Gradient, v_weight, f_weight + _TimeStep / norm, _TimeStep);
+  parallel_for(blocked_range<int>(0, n), eval);
+
+  // Limit maximum node displacement also when time step was increased,
+  // and keep velocities consistent with truncated displacements
+  this->TruncateDisplacement(true);
+  ComputeVelocities sync(v, dx, _TimeStep);
+  parallel_for(blocked_range<int>(0, n), sync);
+}
+
+// =============================================================================
+// Checkpointing
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+void FastInertialRelaxationEngine::SaveState(vtkFieldData *data) const
+{
+  EulerMethod::SaveState(data);
+  SaveValue(data, "TimeStep",              _TimeStep);
+  SaveValue(data, "Mixing",                _Mixing);
+  SaveValue(data, "NumberOfPositiveSteps", _NumberOfPositiveSteps);
+}
+
+// -----------------------------------------------------------------------------
+void FastInertialRelaxationEngine::RestoreState(vtkFieldData *data)
+{
+  EulerMethod::RestoreState(data);
+  RestoreValue(data, "TimeStep",              _TimeStep);
+  RestoreValue(data, "Mixing",                _Mixing);
+  RestoreValue(data, "NumberOfPositiveSteps", _NumberOfPositiveSteps);
+}
+
+
+} // namespace mirtk
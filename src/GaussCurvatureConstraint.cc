@@ -22,7 +22,6 @@
 #include "mirtk/Math.h"
 #include "mirtk/Memory.h"
 #include "mirtk/Parallel.h"
-#include "mirtk/MeshSmoothing.h"
 #include "mirtk/SurfaceCurvature.h"
 
 #include "mirtk/VtkMath.h"
@@ -86,6 +85,7 @@ struct EvaluateGradient
 
   vtkPoints       *_Points;
   vtkDataArray    *_Status;
+  const int       *_PointIds;
   const EdgeTable *_EdgeTable;
   vtkDataArray    *_Normals;
   vtkDataArray    *_GaussCurvature;
@@ -103,7 +103,8 @@ struct EvaluateGradient
     int        numAdjPts;
     const int *adjPtIds;
 
-    for (int ptId = ptIds.begin(); ptId != ptIds.end(); ++ptId) {
+    for (int idx = ptIds.begin(), ptId; idx != ptIds.end(); ++idx) {
+      ptId = (_PointIds ? _PointIds[idx] : idx);
       if (_Status && _Status->GetComponent(ptId, 0) == .0) continue;
       _EdgeTable->GetAdjacentPoints(ptId, numAdjPts, adjPtIds);
       if (numAdjPts > 0) {
@@ -303,6 +304,11 @@ void GaussCurvatureConstraint::Initialize()
   if (_UseMeanCurvature) {
     AddPointData(SurfaceCurvature::MEAN,  1, VTK_FLOAT, global);
   }
+
+  // Register curvature types with (shared) curvature cache
+  int curv_types = SurfaceCurvature::Gauss;
+  if (_UseMeanCurvature) curv_types |= SurfaceCurvature::Mean;
+  CurvatureCache().AddCurvatureTypes(curv_types);
 }
 
 // -----------------------------------------------------------------------------
@@ -318,42 +324,18 @@ void GaussCurvatureConstraint::Update(bool gradient)
   vtkDataArray * const gauss_curvature = PointData(SurfaceCurvature::GAUSS);
   vtkDataArray * const mean_curvature  = (_UseMeanCurvature ? PointData(SurfaceCurvature::MEAN) : nullptr);
 
-  int curv_types = 0;
+  SurfaceCurvatureCache &cache = CurvatureCache();
   if (gauss_curvature->GetMTime() < surface->GetMTime()) {
-    curv_types |= SurfaceCurvature::Gauss;
+    vtkSmartPointer<vtkDataArray> curvature;
+    curvature = cache.Curvature(surface, SurfaceCurvature::Gauss, SharedEdgeTable());
+    gauss_curvature->CopyComponent(0, curvature, 0);
+    gauss_curvature->Modified();
   }
   if (mean_curvature && mean_curvature->GetMTime() < surface->GetMTime()) {
-    curv_types |= SurfaceCurvature::Mean;
-  }
-  if (curv_types != 0) {
-    SurfaceCurvature curv(curv_types);
-    curv.Input(surface);
-    curv.EdgeTable(SharedEdgeTable());
-    curv.VtkCurvaturesOn();
-    curv.Run();
-
-    MeshSmoothing smoother;
-    smoother.Input(curv.Output());
-    smoother.EdgeTable(SharedEdgeTable());
-    smoother.SmoothPointsOff();
-    if ((curv_types & SurfaceCurvature::Gauss) != 0) {
-      smoother.SmoothArray(SurfaceCurvature::GAUSS);
-    }
-    if ((curv_types & SurfaceCurvature::Mean) != 0) {
-      smoother.SmoothArray(SurfaceCurvature::MEAN);
-    }
-    smoother.NumberOfIterations(2);
-    smoother.Run();
-
-    vtkPointData * const outputPD = smoother.Output()->GetPointData();
-    if ((curv_types & SurfaceCurvature::Gauss) != 0) {
-      gauss_curvature->CopyComponent(0, outputPD->GetArray(SurfaceCurvature::GAUSS), 0);
-      gauss_curvature->Modified();
-    }
-    if ((curv_types & SurfaceCurvature::Mean) != 0) {
-      mean_curvature->CopyComponent(0, outputPD->GetArray(SurfaceCurvature::MEAN), 0);
-      mean_curvature->Modified();
-    }
+    vtkSmartPointer<vtkDataArray> curvature;
+    curvature = cache.Curvature(surface, SurfaceCurvature::Mean, SharedEdgeTable());
+    mean_curvature->CopyComponent(0, curvature, 0);
+    mean_curvature->Modified();
   }
 }
 
@@ -378,6 +360,7 @@ void GaussCurvatureConstraint
   GaussCurvatureConstraintUtils::EvaluateGradient eval;
   eval._Points            = Points();
   eval._Status            = Status();
+  eval._PointIds          = ActivePointIds();
   eval._EdgeTable         = Edges();
   eval._Normals           = Normals();
   eval._GaussCurvature    = PointData(SurfaceCurvature::GAUSS);
@@ -388,7 +371,7 @@ void GaussCurvatureConstraint
   eval._MaxGaussCurvature = _MaxGaussCurvature;
   eval._NegativeGaussCurvatureAction = _NegativeGaussCurvatureAction;
   eval._PositiveGaussCurvatureAction = _PositiveGaussCurvatureAction;
-  parallel_for(blocked_range<int>(0, _NumberOfPoints), eval);
+  parallel_for(blocked_range<int>(0, NumberOfActivePoints()), eval);
 
   SurfaceConstraint::EvaluateGradient(gradient, step, weight / _NumberOfPoints);
 }
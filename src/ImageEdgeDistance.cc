@@ -25,19 +25,16 @@
 #include "mirtk/Math.h"
 #include "mirtk/Parallel.h"
 #include "mirtk/Profiling.h"
-#include "mirtk/DataStatistics.h"
-#include "mirtk/MeshSmoothing.h"
-#include "mirtk/MedianPointData.h"
+#include "mirtk/LocalBoxStatistics.h"
 
 #include "mirtk/PointSetIO.h"
 #include "mirtk/PointSetUtils.h"
 
 #include "vtkPointData.h"
-#include "vtkImageData.h"
-#include "vtkImageStencilData.h"
-#include "vtkImageStencilIterator.h"
+#include "vtkMath.h"
 
-#include <iterator> // distance, next, prev
+#include <algorithm> // nth_element, min_element, max_element
+#include <iterator>  // distance, next, prev
 
 
 namespace mirtk {
@@ -289,10 +286,10 @@ public:
 };
 
 // -----------------------------------------------------------------------------
-/// Compute local intensity statistics
+/// Compute local intensity statistics from precomputed box window sums
 class ComputeLocalStatistics : public VoxelFunction
 {
-  int    _Radius;
+  const LocalBoxStatistics *_Sums;
   double _GlobalMean;
   double _GlobalVariance;
   double _MaxMeanValue;
@@ -300,13 +297,14 @@ class ComputeLocalStatistics : public VoxelFunction
 
 public:
 
-  ComputeLocalStatistics(const ImageAttributes &attr, int width, double global_mean = 0., double global_variance = 0.)
+  ComputeLocalStatistics(const LocalBoxStatistics *sums, int width, double global_mean = 0., double global_variance = 0.)
   :
-    _Radius(width / 2),
+    _Sums(sums),
     _GlobalMean(global_mean),
     _GlobalVariance(global_variance),
     _MaxMeanValue(global_mean + 3. * sqrt(global_variance))
   {
+    const ImageAttributes &attr = sums->Domain();
     int max_nsamples = 1;
     if (attr._x > 1) max_nsamples *= width;
     if (attr._y > 1) max_nsamples *= width;
@@ -314,36 +312,14 @@ public:
     _MinNumberOfSamples = max(1, 5 * max_nsamples / 100);
   }
 
-  template <class TIn, class TMask, class TOut>
-  void operator ()(int ci, int cj, int ck, int cl, const TIn *in, const TMask *mask, TOut *mean, TOut *var)
+  template <class TOut>
+  void operator ()(int ci, int cj, int ck, int, TOut *mean, TOut *var)
   {
-    int    num = 0;
-    double sum = 0., sum2 = 0., v;
-
-    const int nx = _Domain->_x;
-    const int ny = _Domain->_y;
-    const int nz = _Domain->_z;
-
-    const int i1 = max(0, ci - _Radius), i2 = min(ci + _Radius, nx - 1);
-    const int j1 = max(0, cj - _Radius), j2 = min(cj + _Radius, ny - 1);
-    const int k1 = max(0, ck - _Radius), k2 = min(ck + _Radius, nz - 1);
-
-    const int xstride = 1;
-    const int ystride =  nx - (i2 - i1 + 1);
-    const int zstride = (ny - (j2 - j1 + 1)) * nx;
-    const int offset  = _Domain->LatticeToIndex(i1, j1, k1) - _Domain->LatticeToIndex(ci, cj, ck);
-
-    in += offset, mask += offset;
-    for (int k = k1; k <= k2; ++k, in += zstride, mask += zstride)
-    for (int j = j1; j <= j2; ++j, in += ystride, mask += ystride)
-    for (int i = i1; i <= i2; ++i, in += xstride, mask += xstride) {
-      if (*mask != 0) {
-        v = static_cast<double>(*in);
-        sum += v, sum2 += v * v, ++num;
-      }
-    }
+    const int idx = _Domain->LatticeToIndex(ci, cj, ck);
+    const int num = _Sums->Count(idx);
     if (num >= _MinNumberOfSamples) {
-      sum /= num, sum2 /= num;
+      const double sum  = _Sums->Sum(idx) / num;
+      const double sum2 = _Sums->SumOfSquares(idx) / num;
       *mean = sum;
       *var  = sum2 - sum * sum;
       // Upper limit of variance is the global intensity variance such
@@ -364,6 +340,18 @@ public:
       *var  = _GlobalVariance;
     }
   }
+
+  /// Compute local statistics of masked intensities within box window
+  template <class TOut>
+  static void Run(const ImageAttributes &attr, const BaseImage *in, const BinaryImage *mask,
+                  int width, double global_mean, double global_variance,
+                  TOut *mean, TOut *var)
+  {
+    LocalBoxStatistics sums(width / 2);
+    sums.Compute(in, mask);
+    ComputeLocalStatistics local(&sums, width, global_mean, global_variance);
+    ParallelForEachVoxel(attr, mean, var, local);
+  }
 };
 
 // -----------------------------------------------------------------------------
@@ -456,6 +444,164 @@ Array<int> ComputeCorticalDeepGreyMatterBoundingBox(const ImageAttributes &attr,
   return bounds;
 }
 
+// -----------------------------------------------------------------------------
+/// Cubic B-spline weights and their derivatives at offset t in [0, 1)
+inline void CubicBSplineWeights(double t, double w[4], double dw[4])
+{
+  const double t2 = t * t, t3 = t2 * t, u = 1. - t;
+  w[0] = u * u * u / 6.;
+  w[1] = (3. * t3 - 6. * t2 + 4.) / 6.;
+  w[2] = (-3. * t3 + 3. * t2 + 3. * t + 1.) / 6.;
+  w[3] = t3 / 6.;
+  dw[0] = -.5 * u * u;
+  dw[1] = 1.5 * t2 - 2. * t;
+  dw[2] = -1.5 * t2 + t + .5;
+  dw[3] = .5 * t2;
+}
+
+// -----------------------------------------------------------------------------
+/// Evaluate interpolated image and its directional derivative along a ray
+///
+/// Evaluates the cubic B-spline interpolated image values and/or directional
+/// derivatives at the equidistant ray points q_i = p + i * dp, with i in
+/// [begin, end), in a single pass. The B-spline weights of a sample are used
+/// for both the value and the derivative, and the 4x4x4 coefficients are
+/// only fetched again when the ray enters another voxel. Since the step
+/// length is usually a fraction of the voxel size, consecutive samples share
+/// the same coefficients. Samples whose support is not entirely inside the
+/// coefficient image are evaluated by the interpolator with boundary handling.
+///
+/// \param[out] f     Image values at ray points. Not evaluated if \c nullptr.
+/// \param[out] g     Directional derivatives along normalized dp at ray points.
+///                   Not evaluated if \c nullptr.
+/// \param[in]  func  Cubic B-spline interpolated image.
+/// \param[in]  p     Ray point with index 0 in image coordinates.
+/// \param[in]  dp    Ray step in image coordinates.
+/// \param[in]  begin Index of first ray point.
+/// \param[in]  end   Index one past the last ray point.
+/// \param[in]  jac   Pre-allocated 1x3 matrix used for boundary samples.
+void EvaluateRayProfile(double *f, double *g, const ContinuousImage *func,
+                        const Point &p, const Vector3 &dp, int begin, int end,
+                        Matrix &jac)
+{
+  const auto &coeff = func->Coefficient();
+  const int nx = coeff.X(), ny = coeff.Y(), nz = coeff.Z();
+
+  Vector3 n = dp;
+  n.Normalize();
+
+  double c[64], wx[4], wy[4], wz[4], dx[4], dy[4], dz[4];
+  double rx[16], rdx[16], sy[4], sdx[4], sdy[4];
+  double x, y, z, v, gx, gy, gz;
+  int    i, j, k, ci = -1, cj = -1, ck = -1;
+
+  for (int s = begin; s < end; ++s) {
+    x = p._x + s * dp._x;
+    y = p._y + s * dp._y;
+    z = p._z + s * dp._z;
+    i = ifloor(x), j = ifloor(y), k = ifloor(z);
+    if (i < 1 || j < 1 || k < 1 || i + 2 >= nx || j + 2 >= ny || k + 2 >= nz) {
+      if (f) f[s] = func->Evaluate(x, y, z);
+      if (g) {
+        func->Jacobian3D(jac, x, y, z);
+        g[s] = n._x * jac(0, 0) + n._y * jac(0, 1) + n._z * jac(0, 2);
+      }
+      continue;
+    }
+    // Fetch coefficients of 4x4x4 support region if ray entered another voxel
+    if (i != ci || j != cj || k != ck) {
+      for (int c3 = 0, r = 0; c3 < 4; ++c3)
+      for (int c2 = 0; c2 < 4; ++c2, ++r) {
+        const auto *row = coeff.Data(i - 1, j - 1 + c2, k - 1 + c3);
+        for (int c1 = 0; c1 < 4; ++c1) {
+          c[4 * r + c1] = static_cast<double>(row[c1]);
+        }
+      }
+      ci = i, cj = j, ck = k;
+    }
+    CubicBSplineWeights(x - i, wx, dx);
+    CubicBSplineWeights(y - j, wy, dy);
+    CubicBSplineWeights(z - k, wz, dz);
+    // Separable contraction along x, y, and z
+    for (int r = 0; r < 16; ++r) {
+      const double *cr = c + 4 * r;
+      rx [r] = cr[0] * wx[0] + cr[1] * wx[1] + cr[2] * wx[2] + cr[3] * wx[3];
+      rdx[r] = cr[0] * dx[0] + cr[1] * dx[1] + cr[2] * dx[2] + cr[3] * dx[3];
+    }
+    for (int c3 = 0; c3 < 4; ++c3) {
+      const double *r = rx  + 4 * c3;
+      const double *d = rdx + 4 * c3;
+      sy [c3] = r[0] * wy[0] + r[1] * wy[1] + r[2] * wy[2] + r[3] * wy[3];
+      sdy[c3] = r[0] * dy[0] + r[1] * dy[1] + r[2] * dy[2] + r[3] * dy[3];
+      sdx[c3] = d[0] * wy[0] + d[1] * wy[1] + d[2] * wy[2] + d[3] * wy[3];
+    }
+    if (f) {
+      v = sy[0] * wz[0] + sy[1] * wz[1] + sy[2] * wz[2] + sy[3] * wz[3];
+      f[s] = v;
+    }
+    if (g) {
+      gx = sdx[0] * wz[0] + sdx[1] * wz[1] + sdx[2] * wz[2] + sdx[3] * wz[3];
+      gy = sdy[0] * wz[0] + sdy[1] * wz[1] + sdy[2] * wz[2] + sdy[3] * wz[3];
+      gz = sy [0] * dz[0] + sy [1] * dz[1] + sy [2] * dz[2] + sy [3] * dz[3];
+      g[s] = n._x * gx + n._y * gy + n._z * gz;
+    }
+  }
+}
+
+// -----------------------------------------------------------------------------
+/// Structure used to store information of an extremum of the intensity profile
+struct Extremum
+{
+  int    idx;  ///< Index of normal ray sample corresponding to this extremum
+  bool   min;  ///< Whether this extremum is a minimum (GM) or maximum (WM)
+  double mean; ///< Local intensity mean
+  double std;  ///< Local intensity standard deviation
+  double var;  ///< Local intensity variance
+  double prb;  ///< Probability that this minimum/maximum belongs to GM/WM
+
+  Extremum(int i = -1, bool is_min = false)
+  :
+    idx(i), min(is_min), mean(NaN), std(NaN), var(NaN), prb(0.)
+  {}
+
+  inline operator bool() const { return idx >= 0; }
+  inline operator int() const { return idx; }
+  inline operator size_t() const { return static_cast<size_t>(idx); }
+};
+
+/// Sequence of function minima/maxima
+typedef Array<Extremum, cache_aligned_allocator<Extremum> > Extrema;
+
+
+} // namespace ImageEdgeDistanceUtils
+
+// -----------------------------------------------------------------------------
+/// Buffers of a fixed block of points reused by subsequent updates
+///
+/// The points are divided into at most ImageEdgeDistance::MaxNumberOfBlocks
+/// blocks of equal size, and each block is processed by one task at a time.
+struct ImageEdgeDistance::BlockWorkspace
+{
+  Matrix                          _Jacobian; ///< Jacobian of image function
+  ImageEdgeDistanceUtils::Extrema _Extrema;  ///< Extrema of intensity profile
+
+  BlockWorkspace() : _Jacobian(1, 3) {}
+};
+
+namespace ImageEdgeDistanceUtils {
+
+
+// Type of workspace of a block of points
+typedef ImageEdgeDistance::BlockWorkspace BlockWorkspace;
+
+// -----------------------------------------------------------------------------
+/// Range of point IDs of the n-th fixed block of points
+inline blocked_range<int> BlockRange(int n, int block_size, int npoints)
+{
+  const int begin = n * block_size;
+  return blocked_range<int>(begin, min(begin + block_size, npoints));
+}
+
 // ------------------------------------------------------------------------------
 /// Evaluate image gradient/intensity at normal ray sample points
 struct SampleIntensityProfile
@@ -475,6 +621,10 @@ struct SampleIntensityProfile
   double                *_T2Intensity;
   double                *_T2Gradient;
 
+  const SharedPtr<BlockWorkspace> *_Workspaces;
+  int                              _BlockSize;
+  int                              _NumberOfPoints;
+
   // ---------------------------------------------------------------------------
   /// Check if point is inside the surface
   ///
@@ -500,34 +650,38 @@ struct SampleIntensityProfile
   }
 
   // ---------------------------------------------------------------------------
-  /// Evaluate directional image derivative along ray in dp centered at p
-  inline void SampleT2Gradient(double *g, int k, const Point &p, const Vector3 &dp) const
+  /// Evaluate image function and directional derivative along ray in dp centered at p
+  ///
+  /// The ray is clipped at the first point outside the image foreground in
+  /// either direction, and the samples outside this range are set to NaN.
+  /// The image values are sampled by the same pass when f is not \c nullptr,
+  /// and subsequently masked by SampleT2Intensity.
+  inline void SampleT2Profile(double *f, double *g, int k, const Point &p, const Vector3 &dp, Matrix &jac) const
   {
+    const BaseImage * const image = _T2WeightedImage->Input();
     const int i0 = k/2;
-    int i, x, y, z;
-
+    int begin, end;
     Point q;
-    Matrix jac(1, 3);
-    Vector3 n = dp;
-    n.Normalize();
 
     q = p;
-    for (i = i0; i <= k; ++i, q += dp) {
-      x = iround(q._x), y = iround(q._y), z = iround(q._z);
-      if (!_T2WeightedImage->Input()->IsInsideForeground(x, y, z)) break;
-      _T2WeightedImage->Jacobian3D(jac, q._x, q._y, q._z);
-      g[i] = n._x * jac(0, 0) + n._y * jac(0, 1) + n._z * jac(0, 2);
+    for (end = i0; end <= k; ++end, q += dp) {
+      if (!image->IsInsideForeground(iround(q._x), iround(q._y), iround(q._z))) break;
     }
-    while (i <= k) g[i++] = NaN;
-
     q = p, q -= dp;
-    for (i = i0 - 1; i >= 0; --i, q -= dp) {
-      x = iround(q._x), y = iround(q._y), z = iround(q._z);
-      if (!_T2WeightedImage->Input()->IsInsideForeground(x, y, z)) break;
-      _T2WeightedImage->Jacobian3D(jac, q._x, q._y, q._z);
-      g[i] = n._x * jac(0, 0) + n._y * jac(0, 1) + n._z * jac(0, 2);
+    for (begin = i0; begin > 0; --begin, q -= dp) {
+      if (!image->IsInsideForeground(iround(q._x), iround(q._y), iround(q._z))) break;
+    }
+
+    EvaluateRayProfile(f, g, _T2WeightedImage, p - double(i0) * dp, dp, begin, end, jac);
+
+    for (int i = 0; i < begin; ++i) {
+      g[i] = NaN;
+      if (f) f[i] = NaN;
+    }
+    for (int i = end; i <= k; ++i) {
+      g[i] = NaN;
+      if (f) f[i] = NaN;
     }
-    while (i >= 0) g[i--] = NaN;
   }
 
   // ---------------------------------------------------------------------------
@@ -540,9 +694,10 @@ struct SampleIntensityProfile
   /// the surface mask. The latter is used to prevent the force of causing
   /// self-intersections by finding the wrong image edges.
   ///
-  /// \param[in] g Directional derivative values which are previously set to NaN
-  ///              once the ray left the image foreground region. Used to avoid
-  ///              re-evaluation of whether a point is in foreground or not.
+  /// \param[in,out] f Image function values sampled by SampleT2Profile.
+  /// \param[in]     g Directional derivative values which are previously set to NaN
+  ///                  once the ray left the image foreground region. Used to avoid
+  ///                  re-evaluation of whether a point is in foreground or not.
   inline void SampleT2Intensity(double *f, const double *g, int k, const Point &p, const Vector3 &dp) const
   {
     const int i0 = k/2;
@@ -551,7 +706,6 @@ struct SampleIntensityProfile
 
     i = i0, q = p;
     while (i <= k && !IsNaN(g[i])) {
-      f[i] = _T2WeightedImage->Evaluate(q._x, q._y, q._z);
       if (IsOutsideSurface(q)) {
         ++i, q += dp;
         break;
@@ -560,16 +714,12 @@ struct SampleIntensityProfile
     }
     while (i <= k && !IsNaN(g[i])) {
       if (IsInsideSurface(q)) break;
-      f[i] = _T2WeightedImage->Evaluate(q._x, q._y, q._z);
       ++i, q += dp;
     }
     while (i <= k) f[i++] = NaN;
 
     i = i0, q = p;
     while (i >= 0 && !IsNaN(g[i])) {
-      if (i != i0) {
-        f[i] = _T2WeightedImage->Evaluate(q._x, q._y, q._z);
-      }
       if (IsInsideSurface(q)) {
         --i, q -= dp;
         break;
@@ -578,7 +728,6 @@ struct SampleIntensityProfile
     }
     while (i >= 0 && !IsNaN(g[i])) {
       if (IsOutsideSurface(q)) break;
-      f[i] = _T2WeightedImage->Evaluate(q._x, q._y, q._z);
       if (_VentriclesDistance) {
         x = iround(q._x), y = iround(q._y), z = iround(q._z);
         const double d = _VentriclesDistance->Get(x, y, z);
@@ -596,37 +745,35 @@ struct SampleIntensityProfile
   }
 
   // ---------------------------------------------------------------------------
-  inline void SampleT1Intensity(double* f1, const double *f2, int k, const Point &p, const Vector3 &dp) const
+  /// Evaluate T1-weighted image function and directional derivative along ray
+  ///
+  /// The T1-weighted image values and derivatives are only sampled where the
+  /// respective T2-weighted image values and derivatives are not NaN.
+  inline void SampleT1Profile(double *f1, double *g1, const double *f2, const double *g2,
+                              int k, const Point &p, const Vector3 &dp, Matrix &jac) const
   {
-    Point q = p - double(k/2) * dp;
-    for (int i = 0; i <= k; ++i, q += dp) {
-      if (IsNaN(f2[i])) {
-        f1[i] = NaN;
-      } else {
-        f1[i] = _T1WeightedImage->Evaluate(q._x, q._y, q._z);
-      }
+    int begin = 0, end = k + 1;
+    while (begin < end && IsNaN(g2[begin])) ++begin;
+    while (end > begin && IsNaN(g2[end - 1])) --end;
+    EvaluateRayProfile(f1, g1, _T1WeightedImage, p - double(k/2) * dp, dp, begin, end, jac);
+    for (int i = 0; i <= k; ++i) {
+      if (IsNaN(g2[i])) g1[i] = NaN;
+      if (f1 && IsNaN(f2[i])) f1[i] = NaN;
     }
   }
 
   // ---------------------------------------------------------------------------
-  inline void SampleT1Gradient(double *g1, const double *g2, int k, const Point &p, const Vector3 &dp) const
+  /// Sample rays of the given fixed blocks of points
+  void operator ()(const blocked_range<int> &blocks) const
   {
-    Matrix jac(1, 3);
-    Vector3 n = dp;
-    n.Normalize();
-    Point q = p - double(k/2) * dp;
-    for (int i = 0; i <= k; ++i, q += dp) {
-      if (IsNaN(g2[i])) {
-        g1[i] = NaN;
-      } else {
-        _T1WeightedImage->Jacobian3D(jac, q._x, q._y, q._z);
-        g1[i] = n._x * jac(0, 0) + n._y * jac(0, 1) + n._z * jac(0, 2);
-      }
+    for (int n = blocks.begin(); n != blocks.end(); ++n) {
+      (*this)(BlockRange(n, _BlockSize, _NumberOfPoints), _Workspaces[n]->_Jacobian);
     }
   }
 
   // ---------------------------------------------------------------------------
-  void operator ()(const blocked_range<int> &ptIds) const
+  /// Sample rays of the given points
+  void operator ()(const blocked_range<int> &ptIds, Matrix &jac) const
   {
     Point   p;
     Vector3 n;
@@ -639,15 +786,13 @@ struct SampleIntensityProfile
         _T2WeightedImage->WorldToImage(p);
         _T2WeightedImage->WorldToImage(n);
         const size_t offset = static_cast<size_t>(ptId) * _NumberOfSamples;
-        SampleT2Gradient(_T2Gradient + offset, k, p, n);
+        double * const f2 = (_T2Intensity ? _T2Intensity + offset : nullptr);
+        double * const g2 = _T2Gradient + offset;
+        SampleT2Profile(f2, g2, k, p, n, jac);
+        if (f2) SampleT2Intensity(f2, g2, k, p, n);
         if (_T1Gradient) {
-          SampleT1Gradient(_T1Gradient + offset, _T2Gradient + offset, k, p, n);
-        }
-        if (_T2Intensity) {
-          SampleT2Intensity(_T2Intensity + offset, _T2Gradient + offset, k, p, n);
-          if (_T1Intensity) {
-            SampleT1Intensity(_T1Intensity + offset, _T2Intensity + offset, k, p, n);
-          }
+          double * const f1 = (f2 && _T1Intensity ? _T1Intensity + offset : nullptr);
+          SampleT1Profile(f1, _T1Gradient + offset, f2, g2, k, p, n, jac);
         }
       }
     }
@@ -699,36 +844,16 @@ struct ComputeDistances
   double _GlobalWhiteMatterThreshold;
   const int *_CorticalDeepGreyMatterBoundingBox;
 
+  const SharedPtr<BlockWorkspace> *_Workspaces;
+  int                              _BlockSize;
+  int                              _NumberOfPoints;
+
   /// Enumeration of different image edge forces
   enum ImageEdgeDistance::EdgeType _EdgeType;
 
-  // ---------------------------------------------------------------------------
-  /// Structure used to store information of an extremum of the intensity profile
-  struct Extremum
-  {
-    int    idx;  ///< Index of normal ray sample corresponding to this extremum
-    bool   min;  ///< Whether this extremum is a minimum (GM) or maximum (WM)
-    double mean; ///< Local intensity mean
-    double std;  ///< Local intensity standard deviation
-    double var;  ///< Local intensity variance
-    double prb;  ///< Probability that this minimum/maximum belongs to GM/WM
-
-    Extremum(int i = -1, bool is_min = false)
-    :
-      idx(i), min(is_min), mean(NaN), std(NaN), var(NaN), prb(0.)
-    {}
-
-    inline operator bool() const { return idx >= 0; }
-    inline operator int() const { return idx; }
-    inline operator size_t() const { return static_cast<size_t>(idx); }
-  };
-
   /// Type of 3D voxel index
   typedef Vector3D<int> Voxel;
 
-  /// Sequence of function minima/maxima
-  typedef Array<Extremum, cache_aligned_allocator<Extremum> > Extrema;
-
   #if BUILD_WITH_DEBUG_CODE
   void WriteRayPoints(const char *fname, Point p, const Vector3 &dp, int k) const
   {
@@ -2155,7 +2280,17 @@ struct ComputeDistances
   }
 
   // ---------------------------------------------------------------------------
-  void operator ()(const blocked_range<int> &ptIds) const
+  /// Compute edge distances of the given fixed blocks of points
+  void operator ()(const blocked_range<int> &blocks) const
+  {
+    for (int n = blocks.begin(); n != blocks.end(); ++n) {
+      (*this)(BlockRange(n, _BlockSize, _NumberOfPoints), _Workspaces[n]->_Extrema);
+    }
+  }
+
+  // ---------------------------------------------------------------------------
+  /// Compute edge distances of the given points
+  void operator ()(const blocked_range<int> &ptIds, Extrema &extrema) const
   {
     const int k = _NumberOfSamples - 1;
     const int r = k / 2;
@@ -2166,10 +2301,10 @@ struct ComputeDistances
     Vector3 n;
 
     bool dbg = false;
-    Extrema extrema;
     Extrema::iterator a, b;
     if (_EdgeType == ImageEdgeDistance::NeonatalWhiteSurface ||
         _EdgeType == ImageEdgeDistance::NeonatalPialSurface) {
+      extrema.clear();
       extrema.reserve(max(_NumberOfSamples / 4, 10));
     }
 
@@ -2319,6 +2454,104 @@ struct ComputeDistances
   }
 };
 
+// -----------------------------------------------------------------------------
+/// Median filter edge distances within n-ring neighborhood of each node
+struct MedianFilterDistances
+{
+  typedef RegisteredPointSet::NodeNeighbors NodeNeighbors;
+
+  const NodeNeighbors *_Neighbors;
+  int                  _Radius;
+  const int           *_Offsets;
+  const double        *_Input;
+  double              *_Values;
+  vtkDataArray        *_Distances;
+
+  void operator ()(const blocked_range<int> &ptIds) const
+  {
+    int        numNbrPts;
+    const int *nbrPtIds;
+    double    *values, *median;
+
+    for (int ptId = ptIds.begin(); ptId != ptIds.end(); ++ptId) {
+      _Neighbors->GetConnectedPoints(ptId, numNbrPts, nbrPtIds, _Radius);
+      values = _Values + _Offsets[ptId];
+      values[0] = _Input[ptId];
+      for (int i = 0; i < numNbrPts; ++i) {
+        values[i + 1] = _Input[nbrPtIds[i]];
+      }
+      median = values + (numNbrPts + 1) / 2;
+      nth_element(values, median, values + numNbrPts + 1);
+      _Distances->SetComponent(ptId, 0, *median);
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Smooth edge distances by Gaussian weighted average of adjacent node values
+///
+/// The standard deviation of the Gaussian kernel is the RMS length of the
+/// edges adjacent to each node, and the node itself has unit weight.
+struct SmoothDistances
+{
+  typedef RegisteredPointSet::EdgeTable EdgeTable;
+
+  vtkPoints       *_Points;
+  const EdgeTable *_EdgeTable;
+  const double    *_Input;
+  double          *_Output;
+
+  void operator ()(const blocked_range<int> &ptIds) const
+  {
+    int        numAdjPts;
+    const int *adjPtIds;
+    double     c[3], p[3], sigma2, w, wsum, value;
+
+    for (int ptId = ptIds.begin(); ptId != ptIds.end(); ++ptId) {
+      _EdgeTable->GetAdjacentPoints(ptId, numAdjPts, adjPtIds);
+      value = _Input[ptId];
+      if (numAdjPts > 0) {
+        _Points->GetPoint(ptId, c);
+        sigma2 = 0.;
+        for (int i = 0; i < numAdjPts; ++i) {
+          _Points->GetPoint(adjPtIds[i], p);
+          sigma2 += vtkMath::Distance2BetweenPoints(c, p);
+        }
+        sigma2 /= numAdjPts;
+        if (sigma2 > 0.) {
+          wsum = 1.;
+          for (int i = 0; i < numAdjPts; ++i) {
+            _Points->GetPoint(adjPtIds[i], p);
+            w = exp(-.5 * vtkMath::Distance2BetweenPoints(c, p) / sigma2);
+            value += w * _Input[adjPtIds[i]];
+            wsum  += w;
+          }
+          value /= wsum;
+        }
+      }
+      _Output[ptId] = value;
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Compute percentile of values using the NIST definition of rank
+///
+/// Unlike data::statistic::AbsPercentile, the values are partially reordered
+/// in place such that no temporary copy needs to be allocated.
+inline double PercentileInPlace(int p, double *values, int n)
+{
+  if (n <= 0) return NaN;
+  const double rank = static_cast<double>(p) / 100. * static_cast<double>(n + 1);
+  const int    k    = ifloor(rank);
+  if (k <= 0) return *min_element(values, values + n);
+  if (k >= n) return *max_element(values, values + n);
+  nth_element(values, values + k - 1, values + n);
+  const double a = values[k - 1];
+  const double b = *min_element(values + k, values + n);
+  return a + (rank - static_cast<double>(k)) * (b - a);
+}
+
 // -----------------------------------------------------------------------------
 /// Compute magnitude of image edge force
 struct ComputeMagnitude
@@ -2496,6 +2729,7 @@ void ImageEdgeDistance::CopyAttributes(const ImageEdgeDistance &other)
   _CorticalDeepGreyMatterBoundingBox = other._CorticalDeepGreyMatterBoundingBox;
   _T1WeightedImageFunction           = other._T1WeightedImageFunction;
   _T2WeightedImageFunction           = other._T2WeightedImageFunction;
+  _SharedImageStatistics             = other._SharedImageStatistics;
 }
 
 // -----------------------------------------------------------------------------
@@ -2528,7 +2762,8 @@ ImageEdgeDistance::ImageEdgeDistance(const char *name, double weight)
   _GlobalWhiteMatterVariance(NaN),
   _GlobalWhiteMatterThreshold(NaN),
   _GlobalGreyMatterMean(NaN),
-  _GlobalGreyMatterVariance(NaN)
+  _GlobalGreyMatterVariance(NaN),
+  _SharedImageStatistics(nullptr)
 {
   _ParameterPrefix.push_back("Image edge distance ");
   _ParameterPrefix.push_back("Intensity edge distance ");
@@ -2676,6 +2911,39 @@ void ImageEdgeDistance::Initialize()
   AddPointData("Distance");
   AddPointData("Magnitude");
 
+  // Calculate image intensity statistics and initialize image interpolators
+  if (_SharedImageStatistics) {
+    typedef ImageStatisticsCache::Entry CacheEntry;
+    SharedPtr<CacheEntry> entry;
+    {
+      std::lock_guard<std::mutex> lock(_SharedImageStatistics->_Mutex);
+      for (const auto &cached : _SharedImageStatistics->_Entries) {
+        if (HasImageStatisticsInput(cached->_Statistics)) {
+          entry = cached;
+          break;
+        }
+      }
+      if (!entry) {
+        entry = NewShared<CacheEntry>();
+        GetImageStatisticsInput(entry->_Statistics);
+        _SharedImageStatistics->_Entries.push_back(entry);
+      }
+    }
+    bool computed = false;
+    std::call_once(entry->_Computed, [this, &entry, &computed]() {
+      InitializeImageStatistics();
+      SaveImageStatistics(entry->_Statistics);
+      computed = true;
+    });
+    if (!computed) LoadImageStatistics(entry->_Statistics);
+  } else {
+    InitializeImageStatistics();
+  }
+}
+
+// -----------------------------------------------------------------------------
+void ImageEdgeDistance::InitializeImageStatistics()
+{
   // Calculate image intensity statistics
   _LocalWhiteMatterMean.Clear();
   _LocalWhiteMatterVariance.Clear();
@@ -2708,8 +2976,9 @@ void ImageEdgeDistance::Initialize()
       if (wm_window > 0) {
         _LocalWhiteMatterMean.Initialize(attr);
         _LocalWhiteMatterVariance.Initialize(attr);
-        ComputeLocalStatistics local(attr, wm_window, _GlobalWhiteMatterMean, _GlobalWhiteMatterVariance);
-        ParallelForEachVoxel(attr, t2w_image, wm_mask, &_LocalWhiteMatterMean, &_LocalWhiteMatterVariance, local);
+        ComputeLocalStatistics::Run(attr, t2w_image, wm_mask, wm_window,
+                                    _GlobalWhiteMatterMean, _GlobalWhiteMatterVariance,
+                                    &_LocalWhiteMatterMean, &_LocalWhiteMatterVariance);
       }
       if (IsNaN(_MinGradient)) {
         ComputeMeanAbsoluteDifference mad(_GlobalWhiteMatterMean);
@@ -2728,8 +2997,9 @@ void ImageEdgeDistance::Initialize()
       if (gm_window > 0) {
         _LocalGreyMatterMean.Initialize(attr);
         _LocalGreyMatterVariance.Initialize(attr);
-        ComputeLocalStatistics local(attr, gm_window, _GlobalGreyMatterMean, _GlobalGreyMatterVariance);
-        ParallelForEachVoxel(attr, t2w_image, gm_mask, &_LocalGreyMatterMean, &_LocalGreyMatterVariance, local);
+        ComputeLocalStatistics::Run(attr, t2w_image, gm_mask, gm_window,
+                                    _GlobalGreyMatterMean, _GlobalGreyMatterVariance,
+                                    &_LocalGreyMatterMean, &_LocalGreyMatterVariance);
       }
     }
     if (t1w_image) {
@@ -2744,8 +3014,9 @@ void ImageEdgeDistance::Initialize()
       if (_T1GreyMatterWindowWidth > 0) {
         _LocalGreyMatterT1Mean.Initialize(attr);
         _LocalGreyMatterT1Variance.Initialize(attr);
-        ComputeLocalStatistics local(attr, _T1GreyMatterWindowWidth, gm_mean, gm_var);
-        ParallelForEachVoxel(attr, t1w_image, gm_mask, &_LocalGreyMatterT1Mean, &_LocalGreyMatterT1Variance, local);
+        ComputeLocalStatistics::Run(attr, t1w_image, gm_mask, _T1GreyMatterWindowWidth,
+                                    gm_mean, gm_var,
+                                    &_LocalGreyMatterT1Mean, &_LocalGreyMatterT1Variance);
       }
       if (IsNaN(_MinT1Gradient)) {
         const BinaryImage *mask = wm_mask;
@@ -2832,17 +3103,124 @@ void ImageEdgeDistance::Initialize()
   }
 }
 
+// -----------------------------------------------------------------------------
+void ImageEdgeDistance::GetImageStatisticsInput(ImageStatistics &stats) const
+{
+  stats._Image              = _Image;
+  stats._T1WeightedImage    = _T1WeightedImage;
+  stats._WhiteMatterMask    = _WhiteMatterMask;
+  stats._GreyMatterMask     = _GreyMatterMask;
+  stats._VentriclesDistance = _VentriclesDistance;
+  stats._EdgeType           = _EdgeType;
+  stats._WindowWidth[0]     = _WhiteMatterWindowWidth;
+  stats._WindowWidth[1]     = _GreyMatterWindowWidth;
+  stats._WindowWidth[2]     = _T1GreyMatterWindowWidth;
+  stats._Thresholds[0]      = _MinIntensity;
+  stats._Thresholds[1]      = _MaxIntensity;
+  stats._Thresholds[2]      = _MinGradient;
+  stats._Thresholds[3]      = _MaxGradient;
+  stats._Thresholds[4]      = _MinT1Gradient;
+  stats._Thresholds[5]      = _MaxT1Gradient;
+}
+
+// -----------------------------------------------------------------------------
+bool ImageEdgeDistance::HasImageStatisticsInput(const ImageStatistics &stats) const
+{
+  ImageStatistics input;
+  GetImageStatisticsInput(input);
+  if (input._Image              != stats._Image              ||
+      input._T1WeightedImage    != stats._T1WeightedImage    ||
+      input._WhiteMatterMask    != stats._WhiteMatterMask    ||
+      input._GreyMatterMask     != stats._GreyMatterMask     ||
+      input._VentriclesDistance != stats._VentriclesDistance ||
+      input._EdgeType           != stats._EdgeType) {
+    return false;
+  }
+  for (int i = 0; i < 3; ++i) {
+    if (input._WindowWidth[i] != stats._WindowWidth[i]) return false;
+  }
+  for (int i = 0; i < 6; ++i) {
+    const double a = input._Thresholds[i], b = stats._Thresholds[i];
+    if (a != b && !(IsNaN(a) && IsNaN(b))) return false;
+  }
+  return true;
+}
+
+// -----------------------------------------------------------------------------
+void ImageEdgeDistance::SaveImageStatistics(ImageStatistics &stats) const
+{
+  stats._GlobalWhiteMatterMean             = _GlobalWhiteMatterMean;
+  stats._GlobalWhiteMatterVariance         = _GlobalWhiteMatterVariance;
+  stats._GlobalWhiteMatterThreshold        = _GlobalWhiteMatterThreshold;
+  stats._GlobalGreyMatterMean              = _GlobalGreyMatterMean;
+  stats._GlobalGreyMatterVariance          = _GlobalGreyMatterVariance;
+  stats._LocalWhiteMatterMean              = _LocalWhiteMatterMean;
+  stats._LocalWhiteMatterVariance          = _LocalWhiteMatterVariance;
+  stats._LocalGreyMatterMean               = _LocalGreyMatterMean;
+  stats._LocalGreyMatterVariance           = _LocalGreyMatterVariance;
+  stats._LocalGreyMatterT1Mean             = _LocalGreyMatterT1Mean;
+  stats._LocalGreyMatterT1Variance         = _LocalGreyMatterT1Variance;
+  stats._CorticalDeepGreyMatterBoundingBox = _CorticalDeepGreyMatterBoundingBox;
+  stats._T1WeightedImageFunction           = _T1WeightedImageFunction;
+  stats._T2WeightedImageFunction           = _T2WeightedImageFunction;
+  stats._InitializedThresholds[0]          = _MinIntensity;
+  stats._InitializedThresholds[1]          = _MaxIntensity;
+  stats._InitializedThresholds[2]          = _MinGradient;
+  stats._InitializedThresholds[3]          = _MaxGradient;
+  stats._InitializedThresholds[4]          = _MinT1Gradient;
+  stats._InitializedThresholds[5]          = _MaxT1Gradient;
+}
+
+// -----------------------------------------------------------------------------
+void ImageEdgeDistance::LoadImageStatistics(const ImageStatistics &stats)
+{
+  _GlobalWhiteMatterMean             = stats._GlobalWhiteMatterMean;
+  _GlobalWhiteMatterVariance         = stats._GlobalWhiteMatterVariance;
+  _GlobalWhiteMatterThreshold        = stats._GlobalWhiteMatterThreshold;
+  _GlobalGreyMatterMean              = stats._GlobalGreyMatterMean;
+  _GlobalGreyMatterVariance          = stats._GlobalGreyMatterVariance;
+  _LocalWhiteMatterMean              = stats._LocalWhiteMatterMean;
+  _LocalWhiteMatterVariance          = stats._LocalWhiteMatterVariance;
+  _LocalGreyMatterMean               = stats._LocalGreyMatterMean;
+  _LocalGreyMatterVariance           = stats._LocalGreyMatterVariance;
+  _LocalGreyMatterT1Mean             = stats._LocalGreyMatterT1Mean;
+  _LocalGreyMatterT1Variance         = stats._LocalGreyMatterT1Variance;
+  _CorticalDeepGreyMatterBoundingBox = stats._CorticalDeepGreyMatterBoundingBox;
+  _T1WeightedImageFunction           = stats._T1WeightedImageFunction;
+  _T2WeightedImageFunction           = stats._T2WeightedImageFunction;
+  _MinIntensity                      = stats._InitializedThresholds[0];
+  _MaxIntensity                      = stats._InitializedThresholds[1];
+  _MinGradient                       = stats._InitializedThresholds[2];
+  _MaxGradient                       = stats._InitializedThresholds[3];
+  _MinT1Gradient                     = stats._InitializedThresholds[4];
+  _MaxT1Gradient                     = stats._InitializedThresholds[5];
+}
+
 // =============================================================================
 // Evaluation
 // =============================================================================
 
+// -----------------------------------------------------------------------------
+void ImageEdgeDistance::PrepareConcurrentEvaluation() const
+{
+  if (_MedianFilterRadius > 0) Neighbors(_MedianFilterRadius);
+}
+
+// -----------------------------------------------------------------------------
+void ImageEdgeDistance::EvaluateRayProfile(double *f, double *g, const ContinuousImage *func,
+                                           const Point &p, const Vector3 &dp, int begin, int end,
+                                           Matrix &jac)
+{
+  ImageEdgeDistanceUtils::EvaluateRayProfile(f, g, func, p, dp, begin, end, jac);
+}
+
 // -----------------------------------------------------------------------------
 void ImageEdgeDistance::Update(bool gradient)
 {
   // Update base class
   SurfaceForce::Update(gradient);
+  if (_NumberOfPoints == 0) return;
 
-  vtkPolyData  * const surface        = DeformedSurface();
   vtkDataArray * const distances      = PointData("Distance");
   vtkDataArray * const magnitude      = PointData("Magnitude");
   vtkDataArray * const status         = Status();
@@ -2850,12 +3228,16 @@ void ImageEdgeDistance::Update(bool gradient)
 
   // Sample intensity along normal ray points and estimate distance to image feature edge
   {
-    const int radius          = ifloor(_MaxDistance / _StepLength);
-    const int nsamples        = 2 * radius + 1;
-    const int max_num_threads = 32;
-    const int grainsize       = (_NumberOfPoints + max_num_threads - 1) / max_num_threads;
+    const int radius     = ifloor(_MaxDistance / _StepLength);
+    const int nsamples   = 2 * radius + 1;
+    const int block_size = (_NumberOfPoints + MaxNumberOfBlocks - 1) / MaxNumberOfBlocks;
+    const int nblocks    = (_NumberOfPoints + block_size - 1) / block_size;
 
-    const blocked_range<int> ptIdRange(0, _NumberOfPoints, grainsize);
+    // Workspaces of blocks are reused by subsequent updates
+    while (static_cast<int>(_BlockWorkspaces.size()) < nblocks) {
+      _BlockWorkspaces.push_back(NewShared<BlockWorkspace>());
+    }
+    const blocked_range<int> blocks(0, nblocks, 1);
 
     // Sample image gradient along ray normal and image intensities
     SampleIntensityProfile sample;
@@ -2873,37 +3255,31 @@ void ImageEdgeDistance::Update(bool gradient)
     sample._T2Gradient            = nullptr;
     sample._T2Intensity           = nullptr;
     sample._SurfaceMask           = nullptr;
+    sample._Workspaces            = _BlockWorkspaces.data();
+    sample._BlockSize             = block_size;
+    sample._NumberOfPoints        = _NumberOfPoints;
 
-    BinaryImage surface_mask;
     if (_EdgeType == NeonatalWhiteSurface) {
       MIRTK_START_TIMING();
-      surface_mask.Initialize(_Image->Attributes(), 1);
-      vtkSmartPointer<vtkPointSet> pointset = WorldToImage(surface, &surface_mask);
-      vtkPolyData * const polydata = vtkPolyData::SafeDownCast(pointset);
-      vtkSmartPointer<vtkImageData> vtkmask = NewVtkMask(_Image->X(), _Image->Y(), _Image->Z());
-      vtkSmartPointer<vtkImageStencilData> stencil = ImageStencil(vtkmask, polydata);
-      ImageStencilToMask(stencil, vtkmask);
-      surface_mask.CopyFrom(reinterpret_cast<BinaryPixel *>(vtkmask->GetScalarPointer()));
-      sample._SurfaceMask = &surface_mask;
+      sample._SurfaceMask = &InsideMask();
       MIRTK_DEBUG_TIMING(5, "computing inside mask");
     }
 
     MIRTK_START_TIMING();
     const size_t n = static_cast<size_t>(nsamples) * static_cast<size_t>(_NumberOfPoints);
-    Array<double, cache_aligned_allocator<double> > f1, g1, f2, g2;
-    g2.resize(n);
-    sample._T2Gradient = g2.data();
+    _T2GradientSamples.resize(n);
+    sample._T2Gradient = _T2GradientSamples.data();
     if (_EdgeType == NeonatalWhiteSurface || _EdgeType == NeonatalPialSurface) {
-      f2.resize(n);
-      sample._T2Intensity = f2.data();
+      _T2IntensitySamples.resize(n);
+      sample._T2Intensity = _T2IntensitySamples.data();
       if (sample._T1WeightedImage) {
-        g1.resize(n);
-        sample._T1Gradient = g1.data();
-        f1.resize(n);
-        sample._T1Intensity = f1.data();
+        _T1GradientSamples.resize(n);
+        sample._T1Gradient = _T1GradientSamples.data();
+        _T1IntensitySamples.resize(n);
+        sample._T1Intensity = _T1IntensitySamples.data();
       }
     }
-    parallel_for(ptIdRange, sample);
+    parallel_for(blocks, sample);
     MIRTK_DEBUG_TIMING(5, "sampling image gradient/intensity");
 
     // Compute distance to closest image edge
@@ -2924,6 +3300,9 @@ void ImageEdgeDistance::Update(bool gradient)
     eval._StepLength      = _StepLength;
     eval._NumberOfSamples = nsamples;
     eval._EdgeType        = _EdgeType;
+    eval._Workspaces      = _BlockWorkspaces.data();
+    eval._BlockSize       = block_size;
+    eval._NumberOfPoints  = _NumberOfPoints;
 
     eval._T1WeightedImage      = sample._T1WeightedImage;
     eval._T2WeightedImage      = sample._T2WeightedImage;
@@ -2958,50 +3337,66 @@ void ImageEdgeDistance::Update(bool gradient)
 
     #if BUILD_WITH_DEBUG_CODE
     if (dbg_dist >= 0.) {
-      eval(ptIdRange);
+      eval(blocks);
     } else
     #else
     {
-      parallel_for(ptIdRange, eval);
+      parallel_for(blocks, eval);
     }
     #endif
     MIRTK_DEBUG_TIMING(5, "computing edge distances");
   }
 
   // Smooth measurements
+  //
+  // The filter buffers are reused by subsequent updates and only reallocated
+  // when their size increases, i.e., after the surface was remeshed.
+  const blocked_range<int> ptIds(0, _NumberOfPoints);
+  if (_MedianFilterRadius > 0 || _DistanceSmoothing > 0) {
+    _InputDistances.resize(_NumberOfPoints);
+  }
   if (_MedianFilterRadius > 0) {
     MIRTK_START_TIMING();
-    MedianPointData median;
-    median.Input(surface);
-    median.InputData(distances);
-    median.EdgeTable(SharedEdgeTable());
-    median.Connectivity(_MedianFilterRadius);
-    median.Run();
-    mirtkAssert(median.OutputData()->GetNumberOfTuples() == distances->GetNumberOfTuples(),
-                "Median filtered data array has same number of tuples as input");
-    mirtkAssert(median.OutputData()->GetNumberOfComponents() == 1,
-                "Median filtered data array has same number of components as input");
-    distances->CopyComponent(0, median.OutputData(), 0);
+    const NodeNeighbors * const neighbors = Neighbors(_MedianFilterRadius);
+    int        numNbrPts;
+    const int *nbrPtIds;
+    _NeighborOffsets.resize(_NumberOfPoints + 1);
+    _NeighborOffsets[0] = 0;
+    for (int ptId = 0; ptId < _NumberOfPoints; ++ptId) {
+      neighbors->GetConnectedPoints(ptId, numNbrPts, nbrPtIds, _MedianFilterRadius);
+      _NeighborOffsets[ptId + 1] = _NeighborOffsets[ptId] + numNbrPts + 1;
+      _InputDistances[ptId] = distances->GetComponent(ptId, 0);
+    }
+    _NeighborDistances.resize(_NeighborOffsets[_NumberOfPoints]);
+    MedianFilterDistances median;
+    median._Neighbors = neighbors;
+    median._Radius    = _MedianFilterRadius;
+    median._Offsets   = _NeighborOffsets.data();
+    median._Input     = _InputDistances.data();
+    median._Values    = _NeighborDistances.data();
+    median._Distances = distances;
+    parallel_for(ptIds, median);
     MIRTK_DEBUG_TIMING(5, "edge distance median filtering");
   }
   if (_DistanceSmoothing > 0) {
     MIRTK_START_TIMING();
-    MeshSmoothing smoother;
-    smoother.Input(surface);
-    smoother.EdgeTable(SharedEdgeTable());
-    smoother.SmoothPointsOff();
-    smoother.SmoothArray(distances->GetName());
-    smoother.Weighting(MeshSmoothing::Gaussian);
-    smoother.NumberOfIterations(_DistanceSmoothing);
-    smoother.Run();
-    vtkPointData * const pd = smoother.Output()->GetPointData();
-    vtkDataArray * const smoothed_distances = pd->GetArray(distances->GetName());
-    mirtkAssert(smoothed_distances != nullptr, "Smoothed output data array exists");
-    mirtkAssert(smoothed_distances->GetNumberOfTuples() == distances->GetNumberOfTuples(),
-                "Smoothed data array has same number of tuples as input");
-    mirtkAssert(smoothed_distances->GetNumberOfComponents() == 1,
-                "Smoothed data array has same number of components as input");
-    distances->CopyComponent(0, smoothed_distances, 0);
+    _SmoothedDistances.resize(_NumberOfPoints);
+    for (int ptId = 0; ptId < _NumberOfPoints; ++ptId) {
+      _SmoothedDistances[ptId] = distances->GetComponent(ptId, 0);
+    }
+    const SharedPtr<const EdgeTable> edgeTable = SharedEdgeTable();
+    SmoothDistances smoother;
+    smoother._Points    = Points();
+    smoother._EdgeTable = edgeTable.get();
+    for (int iter = 0; iter < _DistanceSmoothing; ++iter) {
+      _InputDistances.swap(_SmoothedDistances);
+      smoother._Input  = _InputDistances.data();
+      smoother._Output = _SmoothedDistances.data();
+      parallel_for(ptIds, smoother);
+    }
+    for (int ptId = 0; ptId < _NumberOfPoints; ++ptId) {
+      distances->SetComponent(ptId, 0, _SmoothedDistances[ptId]);
+    }
     MIRTK_DEBUG_TIMING(5, "edge distance smoothing");
   }
 
@@ -3014,15 +3409,16 @@ void ImageEdgeDistance::Update(bool gradient)
     calcmag._MaxDistance = _DistanceThreshold;
     calcmag._Magnitude   = magnitude;
     if (!(calcmag._MaxDistance > 0.)) { // including NaN
-      bool * const mask = new bool[_NumberOfPoints];
+      _AbsDistances.resize(_NumberOfPoints);
+      int n = 0;
       for (int ptId = 0; ptId < _NumberOfPoints; ++ptId) {
-        mask[ptId] = (initial_status->GetComponent(ptId, 0) != 0.);
+        if (initial_status->GetComponent(ptId, 0) != 0.) {
+          _AbsDistances[n++] = abs(distances->GetComponent(ptId, 0));
+        }
       }
-      using mirtk::data::statistic::AbsPercentile;
-      calcmag._MaxDistance = max(.1 * _MaxDistance, AbsPercentile::Calculate(95, distances, mask));
-      delete[] mask;
+      calcmag._MaxDistance = max(.1 * _MaxDistance, PercentileInPlace(95, _AbsDistances.data(), n));
     }
-    parallel_for(blocked_range<int>(0, _NumberOfPoints), calcmag);
+    parallel_for(ptIds, calcmag);
     MIRTK_DEBUG_TIMING(5, "computing edge force magnitude");
   }
 
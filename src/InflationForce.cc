@@ -100,6 +100,7 @@ struct EvaluateGradient
 
   vtkPoints       *_Points;
   vtkDataArray    *_Status;
+  const int       *_PointIds;
   const EdgeTable *_EdgeTable;
   GradientType    *_Gradient;
 
@@ -110,7 +111,8 @@ struct EvaluateGradient
     double       p1[3], p2[3], e[3];
     GradientType gradient;
 
-    for (int ptId = ptIds.begin(); ptId != ptIds.end(); ++ptId) {
+    for (int idx = ptIds.begin(), ptId; idx != ptIds.end(); ++idx) {
+      ptId = (_PointIds ? _PointIds[idx] : idx);
       if (_Status && _Status->GetComponent(ptId, 0) == .0) continue;
       _EdgeTable->GetAdjacentPoints(ptId, numAdjPts, adjPtIds);
       if (numAdjPts > 0) {
@@ -252,9 +254,10 @@ void InflationForce::EvaluateGradient(double *gradient, double step, double weig
   InflationForceUtils::EvaluateGradient eval;
   eval._Points    = _PointSet->SurfacePoints();
   eval._Status    = _PointSet->SurfaceStatus();
+  eval._PointIds  = ActivePointIds();
   eval._EdgeTable = _PointSet->SurfaceEdges();
   eval._Gradient  = _Gradient;
-  parallel_for(blocked_range<int>(0, _NumberOfPoints), eval);
+  parallel_for(blocked_range<int>(0, NumberOfActivePoints()), eval);
 
   InflationForceUtils::SumMagnitudeOfNormalComponents mag;
   mag._Gradient = _Gradient;
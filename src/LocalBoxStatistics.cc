@@ -0,0 +1,306 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright 2013-2017 Imperial College London
+ * Copyright 2013-2017 Andreas Schuh
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "mirtk/LocalBoxStatistics.h"
+
+#include "mirtk/Math.h"
+#include "mirtk/Parallel.h"
+#include "mirtk/Profiling.h"
+
+
+namespace mirtk {
+
+
+// =============================================================================
+// Auxiliary functors
+// =============================================================================
+
+namespace LocalBoxStatisticsUtils {
+
+
+// -----------------------------------------------------------------------------
+/// Initialize window sums with masked voxel values
+struct InitializeSums
+{
+  const BaseImage   *_Image;
+  const BinaryImage *_Mask;
+  int               *_Count;
+  double            *_Sum;
+  double            *_Sum2;
+
+  void operator ()(const blocked_range<int> &re) const
+  {
+    double v;
+    for (int idx = re.begin(); idx != re.end(); ++idx) {
+      if (_Mask == nullptr || _Mask->Get(idx) != 0) {
+        v = _Image->GetAsDouble(idx);
+        _Count[idx] = 1;
+        _Sum  [idx] = v;
+        _Sum2 [idx] = v * v;
+      } else {
+        _Count[idx] = 0;
+        _Sum  [idx] = _Sum2[idx] = 0.;
+      }
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Replace values of image line by sum of values within clipped 1D window
+template <class T>
+void RunningSum(T *data, int n, int stride, int r, Array<T> &buf)
+{
+  for (int i = 0; i < n; ++i) buf[i] = data[i * stride];
+  T sum = T(0);
+  for (int i = 0, m = min(r, n - 1); i <= m; ++i) sum += buf[i];
+  for (int i = 0; i < n; ++i) {
+    data[i * stride] = sum;
+    if (i + r + 1 <  n) sum += buf[i + r + 1];
+    if (i - r     >= 0) sum -= buf[i - r];
+  }
+}
+
+// -----------------------------------------------------------------------------
+/// Sum values within 1D window along image lines parallel to one axis
+struct SumAlongLines
+{
+  int    *_Count;
+  double *_Sum;
+  double *_Sum2;
+  int     _Length;  ///< Number of voxels along line
+  int     _Stride;  ///< Offset between consecutive voxels of a line
+  int     _Lines;   ///< Number of lines along first orthogonal axis
+  int     _Stride1; ///< Offset between lines along first orthogonal axis
+  int     _Stride2; ///< Offset between lines along second orthogonal axis
+  int     _Radius;  ///< Radius of 1D window
+
+  void operator ()(const blocked_range<int> &re) const
+  {
+    Array<int>    cbuf(_Length);
+    Array<double> sbuf(_Length);
+    int offset;
+    for (int l = re.begin(); l != re.end(); ++l) {
+      offset = (l % _Lines) * _Stride1 + (l / _Lines) * _Stride2;
+      RunningSum(_Count + offset, _Length, _Stride, _Radius, cbuf);
+      RunningSum(_Sum   + offset, _Length, _Stride, _Radius, sbuf);
+      RunningSum(_Sum2  + offset, _Length, _Stride, _Radius, sbuf);
+    }
+  }
+};
+
+
+// -----------------------------------------------------------------------------
+/// Sum masked voxel values within clipped box window at each voxel
+struct BruteForceSums
+{
+  const ImageAttributes *_Domain;
+  const BaseImage       *_Image;
+  const BinaryImage     *_Mask;
+  int                   *_Count;
+  double                *_Sum;
+  double                *_Sum2;
+  int                    _Radius;
+
+  void operator ()(const blocked_range<int> &re) const
+  {
+    int    ci, cj, ck, idx, num;
+    double sum, sum2, v;
+
+    const int nx = _Domain->_x;
+    const int ny = _Domain->_y;
+    const int nz = _Domain->_z;
+
+    for (int cidx = re.begin(); cidx != re.end(); ++cidx) {
+      ci = cidx % nx;
+      cj = (cidx / nx) % ny;
+      ck = cidx / (nx * ny);
+      const int i1 = max(0, ci - _Radius), i2 = min(ci + _Radius, nx - 1);
+      const int j1 = max(0, cj - _Radius), j2 = min(cj + _Radius, ny - 1);
+      const int k1 = max(0, ck - _Radius), k2 = min(ck + _Radius, nz - 1);
+      num = 0, sum = sum2 = 0.;
+      for (int k = k1; k <= k2; ++k)
+      for (int j = j1; j <= j2; ++j)
+      for (int i = i1; i <= i2; ++i) {
+        idx = _Domain->LatticeToIndex(i, j, k);
+        if (_Mask == nullptr || _Mask->Get(idx) != 0) {
+          v = _Image->GetAsDouble(idx);
+          sum += v, sum2 += v * v, ++num;
+        }
+      }
+      _Count[cidx] = num;
+      _Sum  [cidx] = sum;
+      _Sum2 [cidx] = sum2;
+    }
+  }
+};
+
+
+} // namespace LocalBoxStatisticsUtils
+using namespace LocalBoxStatisticsUtils;
+
+// =============================================================================
+// Construction/Destruction
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+LocalBoxStatistics::LocalBoxStatistics(int radius)
+:
+  _Radius(radius)
+{
+}
+
+// -----------------------------------------------------------------------------
+void LocalBoxStatistics::CopyAttributes(const LocalBoxStatistics &other)
+{
+  _Radius = other._Radius;
+  _Domain = other._Domain;
+  _Count  = other._Count;
+  _Sum    = other._Sum;
+  _Sum2   = other._Sum2;
+}
+
+// -----------------------------------------------------------------------------
+LocalBoxStatistics::LocalBoxStatistics(const LocalBoxStatistics &other)
+:
+  Object(other)
+{
+  CopyAttributes(other);
+}
+
+// -----------------------------------------------------------------------------
+LocalBoxStatistics &LocalBoxStatistics::operator =(const LocalBoxStatistics &other)
+{
+  if (this != &other) {
+    Object::operator =(other);
+    CopyAttributes(other);
+  }
+  return *this;
+}
+
+// -----------------------------------------------------------------------------
+LocalBoxStatistics::~LocalBoxStatistics()
+{
+}
+
+// -----------------------------------------------------------------------------
+void LocalBoxStatistics::Clear()
+{
+  _Domain = ImageAttributes();
+  Array<int   >().swap(_Count);
+  Array<double>().swap(_Sum);
+  Array<double>().swap(_Sum2);
+}
+
+// =============================================================================
+// Execution
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+void LocalBoxStatistics::Compute(const BaseImage *image, const BinaryImage *mask)
+{
+  MIRTK_START_TIMING();
+
+  if (mask && !mask->HasSpatialAttributesOf(image)) {
+    Throw(ERR_RuntimeError, __FUNCTION__, "Attributes of mask differ from those of the intensity image!");
+  }
+
+  _Domain = image->Attributes();
+  const int nx = _Domain._x;
+  const int ny = _Domain._y;
+  const int nz = _Domain._z;
+  const int n  = nx * ny * nz;
+
+  _Count.resize(n);
+  _Sum  .resize(n);
+  _Sum2 .resize(n);
+
+  InitializeSums init;
+  init._Image = image;
+  init._Mask  = mask;
+  init._Count = _Count.data();
+  init._Sum   = _Sum  .data();
+  init._Sum2  = _Sum2 .data();
+  parallel_for(blocked_range<int>(0, n), init);
+
+  if (_Radius > 0) {
+    SumAlongLines sum;
+    sum._Count  = _Count.data();
+    sum._Sum    = _Sum  .data();
+    sum._Sum2   = _Sum2 .data();
+    sum._Radius = _Radius;
+
+    // Sum along x axis
+    sum._Length  = nx;
+    sum._Stride  = 1;
+    sum._Lines   = ny;
+    sum._Stride1 = nx;
+    sum._Stride2 = nx * ny;
+    if (nx > 1) parallel_for(blocked_range<int>(0, ny * nz), sum);
+
+    // Sum along y axis
+    sum._Length  = ny;
+    sum._Stride  = nx;
+    sum._Lines   = nx;
+    sum._Stride1 = 1;
+    sum._Stride2 = nx * ny;
+    if (ny > 1) parallel_for(blocked_range<int>(0, nx * nz), sum);
+
+    // Sum along z axis
+    sum._Length  = nz;
+    sum._Stride  = nx * ny;
+    sum._Lines   = nx;
+    sum._Stride1 = 1;
+    sum._Stride2 = nx;
+    if (nz > 1) parallel_for(blocked_range<int>(0, nx * ny), sum);
+  }
+
+  MIRTK_DEBUG_TIMING(3, "computing local box window sums");
+}
+
+// -----------------------------------------------------------------------------
+void LocalBoxStatistics::ComputeBruteForce(const BaseImage *image, const BinaryImage *mask)
+{
+  MIRTK_START_TIMING();
+
+  if (mask && !mask->HasSpatialAttributesOf(image)) {
+    Throw(ERR_RuntimeError, __FUNCTION__, "Attributes of mask differ from those of the intensity image!");
+  }
+
+  _Domain = image->Attributes();
+  const int n = _Domain._x * _Domain._y * _Domain._z;
+
+  _Count.resize(n);
+  _Sum  .resize(n);
+  _Sum2 .resize(n);
+
+  BruteForceSums sum;
+  sum._Domain = &_Domain;
+  sum._Image  = image;
+  sum._Mask   = mask;
+  sum._Count  = _Count.data();
+  sum._Sum    = _Sum  .data();
+  sum._Sum2   = _Sum2 .data();
+  sum._Radius = max(0, _Radius);
+  parallel_for(blocked_range<int>(0, n), sum);
+
+  MIRTK_DEBUG_TIMING(3, "computing local box window sums (brute-force)");
+}
+
+
+} // namespace mirtk
@@ -20,7 +20,6 @@
 #include "mirtk/MaximumCurvatureConstraint.h"
 
 #include "mirtk/Math.h"
-#include "mirtk/MeshSmoothing.h"
 #include "mirtk/SurfaceCurvature.h"
 
 #include "vtkPointData.h"
@@ -83,6 +82,7 @@ struct EvaluateForce
 
   vtkPoints       *_Points;
   vtkDataArray    *_Status;
+  const int       *_PointIds;
   const EdgeTable *_EdgeTable;
   vtkDataArray    *_Curvature;
   double           _Threshold;
@@ -96,7 +96,8 @@ struct EvaluateForce
     Point      p, q;
     Vector3    f;
 
-    for (int ptId = ptIds.begin(); ptId != ptIds.end(); ++ptId) {
+    for (int idx = ptIds.begin(), ptId; idx != ptIds.end(); ++idx) {
+      ptId = (_PointIds ? _PointIds[idx] : idx);
       if (_Status && _Status->GetComponent(ptId, 0) == .0) continue;
       _EdgeTable->GetAdjacentPoints(ptId, numAdjPts, adjPtIds);
       if (numAdjPts > 0) {
@@ -177,6 +178,9 @@ void MaximumCurvatureConstraint::Initialize()
   // Add global (i.e., shared) point data array of computed surface curvatures
   const bool global = true;
   AddPointData(SurfaceCurvature::MAXIMUM, 1, VTK_FLOAT, global);
+
+  // Register curvature type with (shared) curvature cache
+  CurvatureCache().AddCurvatureTypes(SurfaceCurvature::Maximum);
 }
 
 // -----------------------------------------------------------------------------
@@ -191,21 +195,7 @@ void MaximumCurvatureConstraint::Update(bool gradient)
   vtkPolyData  * const surface   = DeformedSurface();
   vtkDataArray * const curvature = PointData(SurfaceCurvature::MAXIMUM);
   if (curvature->GetMTime() < surface->GetMTime()) {
-
-    SurfaceCurvature curv(SurfaceCurvature::Maximum);
-    curv.Input(surface);
-    curv.VtkCurvaturesOn();
-    curv.Run();
-
-    MeshSmoothing smoother;
-    smoother.Input(curv.Output());
-    smoother.SmoothPointsOff();
-    smoother.SmoothArray(SurfaceCurvature::MAXIMUM);
-    smoother.NumberOfIterations(2);
-    smoother.Run();
-
-    vtkPointData * const smoothPD = smoother.Output()->GetPointData();
-    curvature->DeepCopy(smoothPD->GetArray(SurfaceCurvature::MAXIMUM));
+    curvature->DeepCopy(CurvatureCache().Curvature(surface, SurfaceCurvature::Maximum, SharedEdgeTable()));
     curvature->Modified();
   }
 }
@@ -231,11 +221,12 @@ void MaximumCurvatureConstraint
   MaximumCurvatureConstraintUtils::EvaluateForce eval;
   eval._Points    = Points();
   eval._Status    = Status();
+  eval._PointIds  = ActivePointIds();
   eval._EdgeTable = Edges();
   eval._Curvature = PointData(SurfaceCurvature::MAXIMUM);
   eval._Threshold = _Threshold;
   eval._Gradient  = _Gradient;
-  parallel_for(blocked_range<int>(0, _NumberOfPoints), eval);
+  parallel_for(blocked_range<int>(0, NumberOfActivePoints()), eval);
 
   SurfaceConstraint::EvaluateGradient(gradient, step, weight / _NumberOfPoints);
 }
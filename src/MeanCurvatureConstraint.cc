@@ -23,7 +23,6 @@
 #include "mirtk/Matrix3x3.h"
 #include "mirtk/Triangle.h"
 
-#include "mirtk/MeshSmoothing.h"
 #include "mirtk/SurfaceCurvature.h"
 
 #include "mirtk/VtkMath.h"
@@ -278,15 +277,20 @@ struct Evaluate
 ///
 /// The following computes the actual gradient of the mean curvature as computed
 /// by the vtkCurvatures::GetMeanCurvature function.
+///
+/// The contributions of each pair of adjacent triangles to the gradient at
+/// its four points are stored separately and summed up per point afterwards
+/// by AccumulateGradient. This avoids concurrent updates of the gradient of
+/// shared points, and the summation order is independent of the number of
+/// threads.
 struct EvaluateGradient
 {
   typedef MeanCurvatureConstraint::GradientType GradientType;
 
-  vtkPolyData     *_Surface;
-  vtkDataArray    *_Status;
-  const EdgeTable *_EdgeTable;
-  GradientType    *_Gradient;
-  int             *_Count;
+  vtkPolyData  *_Surface;
+  const int    *_EdgeQuads;
+  GradientType *_QuadGradient;
+  char         *_QuadContributes;
 
   /// Partial derivatives of cross product w.r.t. coordinates of a
   ///
@@ -305,218 +309,194 @@ struct EvaluateGradient
   }
 
   /// Compute gradient of vtkCurvatures::GetMeanCurvature
-  void operator ()(const blocked_range<vtkIdType> &cellIds) const
+  void operator ()(const blocked_range<int> &quads) const
   {
-    vtkIdType i, j, k, l;
-    vtkIdType numCellPts, *cellPts, cellPtIdx;
-    vtkIdType numNborPts, *nborPts, nborPtIdx;
+    int       i, j, k, l;
     double    v_i[3], v_j[3], v_k[3], v_l[3], cs2_plus_sn2, dangle_dsn, dangle_dcs;
     double    length, length2, A_ijk, A_ikl, A_sum, cs, sn, angle, H;
     Matrix3x3 dnJ_ijk, dnJ_ikl, dn_cross1, dn_cross2, dn_ijk, dn_ikl, T;
     Vector3   p_i, e_ij, e_ik, e_il, n_ijk, n_ikl, n_cross;
     Vector3   dA_sum, dlength, dcs, dsn, dangle, dH;
 
-    vtkSmartPointer<vtkIdList> nborCellIds;
-    nborCellIds = vtkSmartPointer<vtkIdList>::New();
+    for (int quad = quads.begin(); quad != quads.end(); ++quad) {
+      const int    *pts  = _EdgeQuads    + 4 * quad;
+      GradientType *grad = _QuadGradient + 4 * quad;
+      _QuadContributes[quad] = false;
+
+      // Get indices of points of adjacent triangles (i, j, k) and (i, k, l)
+      i = pts[0], j = pts[1], k = pts[2], l = pts[3];
+
+      // Get vertex points
+      _Surface->GetPoint(i, v_i);
+      _Surface->GetPoint(j, v_j);
+      _Surface->GetPoint(k, v_k);
+      _Surface->GetPoint(l, v_l);
+
+      // Compute required vector quantities from vertex points
+      p_i   = Vector3(v_i);
+      e_ij  = Vector3(v_j) - p_i;
+      e_ik  = Vector3(v_k) - p_i;
+      e_il  = Vector3(v_l) - p_i;
+      n_ijk = e_ij.Cross(e_ik);
+      n_ikl = e_ik.Cross(e_il);
+
+      // Note: The area factor 1/2 is cancelled by the factor 2 of atan2
+      A_ijk = n_ijk.Normalize();
+      A_ikl = n_ikl.Normalize();
+      A_sum = A_ijk + A_ikl;
+
+      // Compute cross product of normal vectors (i.e., *after* Normalize)
+      n_cross = n_ikl.Cross(n_ijk);
+
+      // Compute cosine and sine of angle made up by the face normals
+      cs = n_ijk.Dot(n_ikl);
+      sn = n_cross.Dot(e_ik); // divided by l_ik inside if block
+      if (sn != 0. || cs != 0.) {
+
+        // Compute length of shared edge and its derivative
+        length2 = e_ik.SquaredLength();
+        length  = sqrt(length2);
+
+        // Compute double angle using atan2 and the partial derivatives of atan2
+        sn /= length;
+        angle = atan2(sn, cs);
+
+        cs2_plus_sn2 = cs * cs + sn * sn;
+        dangle_dsn   =  cs / cs2_plus_sn2;
+        dangle_dcs   = -sn / cs2_plus_sn2;
+
+        //double z_norm     = sqrt(cs2_plus_sn2);
+        //double inv_z_norm = 1. / z_norm;
+        //double t          = (z_norm - cs) / sn;
+        //double dt         = 2. / (1. + t * t);
+        //dangle_dcs = - dt * (inv_z_norm + 1.) / sn;
+        //dangle_dsn =   dt * (cs - inv_z_norm * sn - z_norm) / (sn * sn);
+
+        // Compute other common terms
+        dlength   = angle * e_ik / length; // w.r.t. v_k
+        dn_cross1 =  CrossJacobian(n_ijk, n_ikl);
+        dn_cross2 = -CrossJacobian(n_ikl, n_ijk);
+
+        // Compute mean curvature (excl. factor 3)
+        H = length * angle / A_sum;
+
+        // Tensor product needed for partial derivatives of sine of angle
+        T[0][0]           = e_ik[0] * e_ik[0] / length2 + 1.;
+        T[0][1] = T[1][0] = e_ik[0] * e_ik[1] / length2;
+        T[0][2] = T[2][0] = e_ik[0] * e_ik[2] / length2;
+        T[1][1]           = e_ik[1] * e_ik[1] / length2 + 1.;
+        T[1][2] = T[2][1] = e_ik[1] * e_ik[2] / length2;
+        T[2][2]           = e_ik[2] * e_ik[2] / length2 + 1.;
+
+        // Derivative of mean curvature w.r.t. v_i
+        dnJ_ijk = Triangle::NormalDirectionJacobian(v_i, v_j, v_k);
+        dnJ_ikl = Triangle::NormalDirectionJacobian(v_i, v_k, v_l);
+        dn_ijk  = Triangle::NormalJacobian(n_ijk, dnJ_ijk);
+        dn_ikl  = Triangle::NormalJacobian(n_ikl, dnJ_ikl);
+
+        dA_sum  = n_ijk * dnJ_ijk;
+        dA_sum += n_ikl * dnJ_ikl;
+        dA_sum *= H;
+
+        dsn  = e_ik * (dn_cross1 * dn_ijk + dn_cross2 * dn_ikl);
+        dsn -= n_cross * T;
+        dsn /= length;
+        dsn *= dangle_dsn;
+
+        dcs  = n_ikl * dn_ijk;
+        dcs += n_ijk * dn_ikl;
+        dcs *= dangle_dcs;
+
+        dangle  = dsn;
+        dangle += dcs;
+        dangle *= length;
+
+        dH  = -dlength;
+        dH += dA_sum;
+        dH += dangle;
+        dH /= A_sum;
+
+        grad[0] = H * GradientType(dH);
+
+        // Derivative of mean curvature w.r.t. v_j
+        dnJ_ijk = Triangle::NormalDirectionJacobian(v_j, v_k, v_i);
+        dn_ijk  = Triangle::NormalJacobian(n_ijk, dnJ_ijk);
+
+        dA_sum  = n_ijk * dnJ_ijk;
+        dA_sum *= H;
+
+        dsn  = e_ik * dn_cross1 * dn_ijk;
+        dsn /= length;
+        dsn *= dangle_dsn;
+
+        dcs  = n_ikl * dn_ijk;
+        dcs *= dangle_dcs;
+
+        dangle  = dsn;
+        dangle += dcs;
+        dangle *= length;
+
+        dH  = dA_sum;
+        dH += dangle;
+        dH /= A_sum;
 
-    for (vtkIdType cellId = cellIds.begin(); cellId != cellIds.end(); ++cellId) {
-      _Surface->GetCellPoints(cellId, numCellPts, cellPts);
-      for (cellPtIdx = 0; cellPtIdx < numCellPts; ++cellPtIdx) {
-
-        // Get start and end point indices of current cell edge
-        i = cellPts[cellPtIdx];
-        k = cellPts[(cellPtIdx + 1) % numCellPts];
+        grad[1] = H * GradientType(dH);
+
+        // Derivative of mean curvature w.r.t. v_k
+        dnJ_ijk = Triangle::NormalDirectionJacobian(v_k, v_i, v_j);
+        dnJ_ikl = Triangle::NormalDirectionJacobian(v_k, v_l, v_i);
+        dn_ijk  = Triangle::NormalJacobian(n_ijk, dnJ_ijk);
+        dn_ikl  = Triangle::NormalJacobian(n_ikl, dnJ_ikl);
 
-        // Get neighboring face sharing this edge
-        _Surface->GetCellEdgeNeighbors(cellId, i, k, nborCellIds);
-        if (nborCellIds->GetNumberOfIds() == 1 && nborCellIds->GetId(0) > cellId) {
-
-          // Get indices of two other points of this and the neighboring cell,
-          // while preserving the order, i.e., orientation for both cells
-          l = cellPts[(cellPtIdx + 2) % numCellPts];
-          _Surface->GetCellPoints(nborCellIds->GetId(0), numNborPts, nborPts);
-          if (numNborPts > 2) {
-            nborPtIdx = 0;
-            while (nborPts[nborPtIdx] != i) ++nborPtIdx;
-            j = nborPts[(nborPtIdx + 1) % numNborPts];
-            if (j == k) j = nborPts[(nborPtIdx + numNborPts - 1) % numNborPts];
+        dA_sum  = n_ijk * dnJ_ijk;
+        dA_sum += n_ikl * dnJ_ikl;
+        dA_sum *= H;
 
-            // Get vertex points
-            _Surface->GetPoint(i, v_i);
-            _Surface->GetPoint(j, v_j);
-            _Surface->GetPoint(k, v_k);
-            _Surface->GetPoint(l, v_l);
+        dsn  = e_ik * (dn_cross1 * dn_ijk + dn_cross2 * dn_ikl);
+        dsn += n_cross * T;
+        dsn /= length;
+        dsn *= dangle_dsn;
 
-            // Compute required vector quantities from vertex points
-            p_i   = Vector3(v_i);
-            e_ij  = Vector3(v_j) - p_i;
-            e_ik  = Vector3(v_k) - p_i;
-            e_il  = Vector3(v_l) - p_i;
-            n_ijk = e_ij.Cross(e_ik);
-            n_ikl = e_ik.Cross(e_il);
+        dcs  = n_ikl * dn_ijk;
+        dcs += n_ijk * dn_ikl;
+        dcs *= dangle_dcs;
 
-            // Note: The area factor 1/2 is cancelled by the factor 2 of atan2
-            A_ijk = n_ijk.Normalize();
-            A_ikl = n_ikl.Normalize();
-            A_sum = A_ijk + A_ikl;
+        dangle  = dsn;
+        dangle += dcs;
+        dangle *= length;
 
-            // Compute cross product of normal vectors (i.e., *after* Normalize)
-            n_cross = n_ikl.Cross(n_ijk);
+        dH  = dlength;
+        dH += dA_sum;
+        dH += dangle;
+        dH /= A_sum;
 
-            // Compute cosine and sine of angle made up by the face normals
-            cs = n_ijk.Dot(n_ikl);
-            sn = n_cross.Dot(e_ik); // divided by l_ik inside if block
-            if (sn != 0. || cs != 0.) {
+        grad[2] = H * GradientType(dH);
 
-              // Compute length of shared edge and its derivative
-              length2 = e_ik.SquaredLength();
-              length  = sqrt(length2);
+        // Derivative of mean curvature w.r.t. v_l
+        dnJ_ikl = Triangle::NormalDirectionJacobian(v_l, v_i, v_k);
+        dn_ikl  = Triangle::NormalJacobian(n_ikl, dnJ_ikl);
 
-              // Compute double angle using atan2 and the partial derivatives of atan2
-              sn /= length;
-              angle = atan2(sn, cs);
+        dA_sum  = n_ikl * dnJ_ikl;
+        dA_sum *= H;
 
-              cs2_plus_sn2 = cs * cs + sn * sn;
-              dangle_dsn   =  cs / cs2_plus_sn2;
-              dangle_dcs   = -sn / cs2_plus_sn2;
+        dsn  = e_ik * dn_cross2 * dn_ikl;
+        dsn /= length;
+        dsn *= dangle_dsn;
 
-              //double z_norm     = sqrt(cs2_plus_sn2);
-              //double inv_z_norm = 1. / z_norm;
-              //double t          = (z_norm - cs) / sn;
-              //double dt         = 2. / (1. + t * t);
-              //dangle_dcs = - dt * (inv_z_norm + 1.) / sn;
-              //dangle_dsn =   dt * (cs - inv_z_norm * sn - z_norm) / (sn * sn);
+        dcs  = n_ijk * dn_ikl;
+        dcs *= dangle_dcs;
 
-              // Compute other common terms
-              dlength   = angle * e_ik / length; // w.r.t. v_k
-              dn_cross1 =  CrossJacobian(n_ijk, n_ikl);
-              dn_cross2 = -CrossJacobian(n_ikl, n_ijk);
+        dangle  = dsn;
+        dangle += dcs;
+        dangle *= length;
 
-              // Compute mean curvature (excl. factor 3)
-              H = length * angle / A_sum;
+        dH  = dA_sum;
+        dH += dangle;
+        dH /= A_sum;
 
-              // Tensor product needed for partial derivatives of sine of angle
-              T[0][0]           = e_ik[0] * e_ik[0] / length2 + 1.;
-              T[0][1] = T[1][0] = e_ik[0] * e_ik[1] / length2;
-              T[0][2] = T[2][0] = e_ik[0] * e_ik[2] / length2;
-              T[1][1]           = e_ik[1] * e_ik[1] / length2 + 1.;
-              T[1][2] = T[2][1] = e_ik[1] * e_ik[2] / length2;
-              T[2][2]           = e_ik[2] * e_ik[2] / length2 + 1.;
-
-              // Derivative of mean curvature w.r.t. v_i
-              dnJ_ijk = Triangle::NormalDirectionJacobian(v_i, v_j, v_k);
-              dnJ_ikl = Triangle::NormalDirectionJacobian(v_i, v_k, v_l);
-              dn_ijk  = Triangle::NormalJacobian(n_ijk, dnJ_ijk);
-              dn_ikl  = Triangle::NormalJacobian(n_ikl, dnJ_ikl);
+        grad[3] = H * GradientType(dH);
 
-              dA_sum  = n_ijk * dnJ_ijk;
-              dA_sum += n_ikl * dnJ_ikl;
-              dA_sum *= H;
-
-              dsn  = e_ik * (dn_cross1 * dn_ijk + dn_cross2 * dn_ikl);
-              dsn -= n_cross * T;
-              dsn /= length;
-              dsn *= dangle_dsn;
-
-              dcs  = n_ikl * dn_ijk;
-              dcs += n_ijk * dn_ikl;
-              dcs *= dangle_dcs;
-
-              dangle  = dsn;
-              dangle += dcs;
-              dangle *= length;
-
-              dH  = -dlength;
-              dH += dA_sum;
-              dH += dangle;
-              dH /= A_sum;
-
-              _Gradient[i] += H * GradientType(dH);
-              _Count   [i] += 1;
-
-              // Derivative of mean curvature w.r.t. v_j
-              dnJ_ijk = Triangle::NormalDirectionJacobian(v_j, v_k, v_i);
-              dn_ijk  = Triangle::NormalJacobian(n_ijk, dnJ_ijk);
-
-              dA_sum  = n_ijk * dnJ_ijk;
-              dA_sum *= H;
-
-              dsn  = e_ik * dn_cross1 * dn_ijk;
-              dsn /= length;
-              dsn *= dangle_dsn;
-
-              dcs  = n_ikl * dn_ijk;
-              dcs *= dangle_dcs;
-
-              dangle  = dsn;
-              dangle += dcs;
-              dangle *= length;
-
-              dH  = dA_sum;
-              dH += dangle;
-              dH /= A_sum;
-
-              _Gradient[j] += H * GradientType(dH);
-              _Count   [j] += 1;
-
-              // Derivative of mean curvature w.r.t. v_k
-              dnJ_ijk = Triangle::NormalDirectionJacobian(v_k, v_i, v_j);
-              dnJ_ikl = Triangle::NormalDirectionJacobian(v_k, v_l, v_i);
-              dn_ijk  = Triangle::NormalJacobian(n_ijk, dnJ_ijk);
-              dn_ikl  = Triangle::NormalJacobian(n_ikl, dnJ_ikl);
-
-              dA_sum  = n_ijk * dnJ_ijk;
-              dA_sum += n_ikl * dnJ_ikl;
-              dA_sum *= H;
-
-              dsn  = e_ik * (dn_cross1 * dn_ijk + dn_cross2 * dn_ikl);
-              dsn += n_cross * T;
-              dsn /= length;
-              dsn *= dangle_dsn;
-
-              dcs  = n_ikl * dn_ijk;
-              dcs += n_ijk * dn_ikl;
-              dcs *= dangle_dcs;
-
-              dangle  = dsn;
-              dangle += dcs;
-              dangle *= length;
-
-              dH  = dlength;
-              dH += dA_sum;
-              dH += dangle;
-              dH /= A_sum;
-
-              _Gradient[k] += H * GradientType(dH);
-              _Count   [k] += 1;
-
-              // Derivative of mean curvature w.r.t. v_l
-              dnJ_ikl = Triangle::NormalDirectionJacobian(v_l, v_i, v_k);
-              dn_ikl  = Triangle::NormalJacobian(n_ikl, dnJ_ikl);
-
-              dA_sum  = n_ikl * dnJ_ikl;
-              dA_sum *= H;
-
-              dsn  = e_ik * dn_cross2 * dn_ikl;
-              dsn /= length;
-              dsn *= dangle_dsn;
-
-              dcs  = n_ijk * dn_ikl;
-              dcs *= dangle_dcs;
-
-              dangle  = dsn;
-              dangle += dcs;
-              dangle *= length;
-
-              dH  = dA_sum;
-              dH += dangle;
-              dH /= A_sum;
-
-              _Gradient[l] += H * GradientType(dH);
-              _Count   [l] += 1;
-            }
-          }
-        }
+        _QuadContributes[quad] = true;
       }
     }
   }
@@ -713,6 +693,37 @@ struct EvaluateGradient
 //  }
 };
 
+// -----------------------------------------------------------------------------
+/// Sum gradient contributions of adjacent edge quads at each point
+struct AccumulateGradient
+{
+  typedef MeanCurvatureConstraint::GradientType GradientType;
+
+  const int          *_PointQuadOffsets;
+  const int          *_PointQuadSlots;
+  const GradientType *_QuadGradient;
+  const char         *_QuadContributes;
+  GradientType       *_Gradient;
+  int                *_Count;
+
+  void operator ()(const blocked_range<int> &ptIds) const
+  {
+    int slot;
+    for (int ptId = ptIds.begin(); ptId != ptIds.end(); ++ptId) {
+      GradientType &gradient = _Gradient[ptId];
+      int          &count    = _Count[ptId];
+      gradient = 0., count = 0;
+      for (int idx = _PointQuadOffsets[ptId]; idx < _PointQuadOffsets[ptId + 1]; ++idx) {
+        slot = _PointQuadSlots[idx];
+        if (_QuadContributes[slot / 4]) {
+          gradient += _QuadGradient[slot];
+          ++count;
+        }
+      }
+    }
+  }
+};
+
 
 #if USE_CURVATURE_WEIGHTED_SPRING_FORCE
 // -----------------------------------------------------------------------------
@@ -823,9 +834,90 @@ void MeanCurvatureConstraint::Initialize()
   #if USE_CURVATURE_WEIGHTED_SPRING_FORCE
     const bool global = true;
     AddPointData(SurfaceCurvature::MEAN, 1, VTK_FLOAT, global);
+    CurvatureCache().AddCurvatureTypes(SurfaceCurvature::Mean);
   #else // USE_CURVATURE_WEIGHTED_SPRING_FORCE
     AllocateCount(_NumberOfPoints);
   #endif // USE_CURVATURE_WEIGHTED_SPRING_FORCE
+
+  // Initialize this class
+  MeanCurvatureConstraint::Init();
+}
+
+// -----------------------------------------------------------------------------
+void MeanCurvatureConstraint::Reinitialize()
+{
+  // Reinitialize base class
+  SurfaceConstraint::Reinitialize();
+
+  // Reinitialize this class
+  MeanCurvatureConstraint::Init();
+}
+
+// -----------------------------------------------------------------------------
+void MeanCurvatureConstraint::Init()
+{
+  _EdgeQuads.clear();
+  _PointQuadOffsets.clear();
+  _PointQuadSlots.clear();
+  _QuadGradient.clear();
+  _QuadContributes.clear();
+
+  #if !USE_CURVATURE_WEIGHTED_SPRING_FORCE
+  if (_NumberOfPoints == 0) return;
+
+  // Find pairs of adjacent triangles (i, j, k) and (i, k, l) sharing an edge,
+  // where the cell with the smaller ID determines the order of the points
+  vtkPolyData * const surface = DeformedSurface();
+  if (surface->NeedToBuildCells()) surface->BuildCells();
+  surface->BuildLinks();
+
+  vtkIdType i, j, k, l;
+  vtkIdType numCellPts, *cellPts, cellPtIdx;
+  vtkIdType numNborPts, *nborPts, nborPtIdx;
+  vtkSmartPointer<vtkIdList> nborCellIds = vtkSmartPointer<vtkIdList>::New();
+
+  _EdgeQuads.reserve(6 * static_cast<size_t>(surface->GetNumberOfCells()));
+  for (vtkIdType cellId = 0; cellId < surface->GetNumberOfCells(); ++cellId) {
+    surface->GetCellPoints(cellId, numCellPts, cellPts);
+    for (cellPtIdx = 0; cellPtIdx < numCellPts; ++cellPtIdx) {
+      i = cellPts[cellPtIdx];
+      k = cellPts[(cellPtIdx + 1) % numCellPts];
+      surface->GetCellEdgeNeighbors(cellId, i, k, nborCellIds);
+      if (nborCellIds->GetNumberOfIds() == 1 && nborCellIds->GetId(0) > cellId) {
+        l = cellPts[(cellPtIdx + 2) % numCellPts];
+        surface->GetCellPoints(nborCellIds->GetId(0), numNborPts, nborPts);
+        if (numNborPts > 2) {
+          nborPtIdx = 0;
+          while (nborPts[nborPtIdx] != i) ++nborPtIdx;
+          j = nborPts[(nborPtIdx + 1) % numNborPts];
+          if (j == k) j = nborPts[(nborPtIdx + numNborPts - 1) % numNborPts];
+          _EdgeQuads.push_back(static_cast<int>(i));
+          _EdgeQuads.push_back(static_cast<int>(j));
+          _EdgeQuads.push_back(static_cast<int>(k));
+          _EdgeQuads.push_back(static_cast<int>(l));
+        }
+      }
+    }
+  }
+
+  // Point to quad vertex adjacency in compressed row format
+  const int nslots = static_cast<int>(_EdgeQuads.size());
+  _PointQuadOffsets.resize(_NumberOfPoints + 1, 0);
+  for (int slot = 0; slot < nslots; ++slot) {
+    ++_PointQuadOffsets[_EdgeQuads[slot] + 1];
+  }
+  for (int ptId = 0; ptId < _NumberOfPoints; ++ptId) {
+    _PointQuadOffsets[ptId + 1] += _PointQuadOffsets[ptId];
+  }
+  Array<int> pos(_PointQuadOffsets.begin(), _PointQuadOffsets.end() - 1);
+  _PointQuadSlots.resize(nslots);
+  for (int slot = 0; slot < nslots; ++slot) {
+    _PointQuadSlots[pos[_EdgeQuads[slot]]++] = slot;
+  }
+
+  _QuadGradient   .resize(nslots);
+  _QuadContributes.resize(nslots / 4);
+  #endif // USE_CURVATURE_WEIGHTED_SPRING_FORCE
 }
 
 // -----------------------------------------------------------------------------
@@ -841,23 +933,7 @@ void MeanCurvatureConstraint::Update(bool gradient)
   vtkPolyData  * const surface        = DeformedSurface();
   vtkDataArray * const mean_curvature = PointData(SurfaceCurvature::MEAN);
   if (mean_curvature->GetMTime() < surface->GetMTime()) {
-
-    SurfaceCurvature curv(SurfaceCurvature::Mean);
-    curv.Input(surface);
-    curv.EdgeTable(SharedEdgeTable());
-    curv.VtkCurvaturesOn();
-    curv.Run();
-
-    MeshSmoothing smoother;
-    smoother.Input(curv.Output());
-    smoother.EdgeTable(SharedEdgeTable());
-    smoother.SmoothPointsOff();
-    smoother.SmoothArray(SurfaceCurvature::MEAN);
-    smoother.NumberOfIterations(2);
-    smoother.Run();
-
-    vtkPointData * const smoothPD = smoother.Output()->GetPointData();
-    mean_curvature->DeepCopy(smoothPD->GetArray(SurfaceCurvature::MEAN));
+    mean_curvature->DeepCopy(CurvatureCache().Curvature(surface, SurfaceCurvature::Mean, SharedEdgeTable()));
     mean_curvature->Modified();
   }
   #endif // USE_CURVATURE_WEIGHTED_SPRING_FORCE
@@ -909,16 +985,24 @@ void MeanCurvatureConstraint
 
   #else // USE_CURVATURE_WEIGHTED_SPRING_FORCE
 
-    vtkPolyData * const surface = DeformedSurface();
-    memset(_Count, 0, _NumberOfPoints * sizeof(int));
+    const int nquads = static_cast<int>(_QuadContributes.size());
+
     MeanCurvatureConstraintUtils::EvaluateGradient eval;
-    eval._Surface   = surface;
-    eval._Status    = Status();
-    eval._EdgeTable = Edges();
-    eval._Gradient  = _Gradient;
-    eval._Count     = _Count;
-    eval(blocked_range<vtkIdType>(0, surface->GetNumberOfCells()));
-    //parallel_for(blocked_range<int>(0, _NumberOfPoints), eval);
+    eval._Surface         = DeformedSurface();
+    eval._EdgeQuads       = _EdgeQuads.data();
+    eval._QuadGradient    = _QuadGradient.data();
+    eval._QuadContributes = _QuadContributes.data();
+    parallel_for(blocked_range<int>(0, nquads), eval);
+
+    MeanCurvatureConstraintUtils::AccumulateGradient accum;
+    accum._PointQuadOffsets = _PointQuadOffsets.data();
+    accum._PointQuadSlots   = _PointQuadSlots.data();
+    accum._QuadGradient     = _QuadGradient.data();
+    accum._QuadContributes  = _QuadContributes.data();
+    accum._Gradient         = _Gradient;
+    accum._Count            = _Count;
+    parallel_for(blocked_range<int>(0, _NumberOfPoints), accum);
+
     for (int i = 0; i < _NumberOfPoints; ++i) {
       // - Factor 2 is from the derivative of the square function.
       // - Factor 3 is from the area divisor of the mean curvature.
@@ -49,16 +49,38 @@ namespace MetricDistortionUtils {
 
 // -----------------------------------------------------------------------------
 typedef RegisteredPointSet::NodeNeighbors NodeNeighbors;
-typedef MetricDistortion::DistancesArray  DistancesArray;
+typedef MetricDistortion::NodeDistances   NodeDistances;
 
 // -----------------------------------------------------------------------------
-/// Compute initial distances between neighboring nodes
+/// Count neighbors of each node
+struct CountNeighbors
+{
+  const NodeNeighbors *_Neighbors;
+  int                 *_Offsets;
+  int                  _Radius;
+
+  void operator ()(const blocked_range<int> &ptIds) const
+  {
+    int        numNbrPts;
+    const int *nbrPtIds;
+
+    for (int ptId = ptIds.begin(); ptId != ptIds.end(); ++ptId) {
+      _Neighbors->GetConnectedPoints(ptId, numNbrPts, nbrPtIds, _Radius);
+      _Offsets[ptId + 1] = numNbrPts;
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Copy neighbor indices and compute initial distances between neighboring nodes
 struct ComputeInitialDistances
 {
-  vtkPoints             *_InitialPoints;
-  const NodeNeighbors   *_Neighbors;
-  Array<DistancesArray> *_Distances;
-  int                    _Radius;
+  vtkPoints           *_InitialPoints;
+  const NodeNeighbors *_Neighbors;
+  const int           *_Offsets;
+  int                 *_NeighborIds;
+  NodeDistances       *_Distances;
+  int                  _Radius;
 
   void operator ()(const blocked_range<int> &ptIds) const
   {
@@ -69,11 +91,13 @@ struct ComputeInitialDistances
     for (int ptId = ptIds.begin(); ptId != ptIds.end(); ++ptId) {
       _InitialPoints->GetPoint(ptId, c);
       _Neighbors->GetConnectedPoints(ptId, numNbrPts, nbrPtIds, _Radius);
-      DistancesArray &dists = (*_Distances)[ptId];
-      dists.resize(numNbrPts);
+      int           * const ids   = _NeighborIds + _Offsets[ptId];
+      NodeDistances * const dists = _Distances   + _Offsets[ptId];
       for (int i = 0; i < numNbrPts; ++i) {
         _InitialPoints->GetPoint(nbrPtIds[i], p);
+        ids[i] = nbrPtIds[i];
         dists[i]._Distance0 = sqrt(vtkMath::Distance2BetweenPoints(c, p));
+        dists[i]._Distance  = dists[i]._Distance0;
       }
     }
   }
@@ -83,24 +107,20 @@ struct ComputeInitialDistances
 /// Compute current distances between neighboring nodes
 struct ComputeDistances
 {
-  vtkPoints             *_Points;
-  const NodeNeighbors   *_Neighbors;
-  Array<DistancesArray> *_Distances;
-  int                    _Radius;
+  vtkPoints     *_Points;
+  const int     *_Offsets;
+  const int     *_NeighborIds;
+  NodeDistances *_Distances;
 
   void operator ()(const blocked_range<int> &ptIds) const
   {
-    int        numNbrPts;
-    const int *nbrPtIds;
-    double     c[3], p[3];
+    double c[3], p[3];
 
     for (int ptId = ptIds.begin(); ptId != ptIds.end(); ++ptId) {
       _Points->GetPoint(ptId, c);
-      _Neighbors->GetConnectedPoints(ptId, numNbrPts, nbrPtIds, _Radius);
-      DistancesArray &dists = (*_Distances)[ptId];
-      for (int i = 0; i < numNbrPts; ++i) {
-        _Points->GetPoint(nbrPtIds[i], p);
-        dists[i]._Distance = sqrt(vtkMath::Distance2BetweenPoints(c, p));
+      for (int i = _Offsets[ptId]; i < _Offsets[ptId + 1]; ++i) {
+        _Points->GetPoint(_NeighborIds[i], p);
+        _Distances[i]._Distance = sqrt(vtkMath::Distance2BetweenPoints(c, p));
       }
     }
   }
@@ -110,21 +130,17 @@ struct ComputeDistances
 /// Evaluate metric distortion
 struct Evaluate
 {
-  vtkPoints                   *_Points;
-  const NodeNeighbors         *_Neighbors;
-  const Array<DistancesArray> *_Distances;
-  int                          _Radius;
-  double                       _Scale;
-  double                       _Sum;
+  const int           *_Offsets;
+  const NodeDistances *_Distances;
+  double               _Scale;
+  double               _Sum;
 
   Evaluate() : _Sum(.0) {}
 
   Evaluate(const Evaluate &other, split)
   :
-    _Points   (other._Points),
-    _Neighbors(other._Neighbors),
+    _Offsets  (other._Offsets),
     _Distances(other._Distances),
-    _Radius   (other._Radius),
     _Scale    (other._Scale),
     _Sum(.0)
   {}
@@ -138,17 +154,15 @@ struct Evaluate
   //       to the force computed by EvaluateGradient
   void operator ()(const blocked_range<int> &ptIds)
   {
-    int        numNbrPts;
-    const int *nbrPtIds;
-    double     delta, sum;
+    int    numNbrPts;
+    double delta, sum;
 
     for (int ptId = ptIds.begin(); ptId != ptIds.end(); ++ptId) {
-      const DistancesArray &dists = (*_Distances)[ptId];
-      _Neighbors->GetConnectedPoints(ptId, numNbrPts, nbrPtIds, _Radius);
+      numNbrPts = _Offsets[ptId + 1] - _Offsets[ptId];
       if (numNbrPts > 0) {
         sum = .0;
-        for (int i = 0; i < numNbrPts; ++i) {
-          delta = dists[i]._Distance - _Scale * dists[i]._Distance0;
+        for (int i = _Offsets[ptId]; i < _Offsets[ptId + 1]; ++i) {
+          delta = _Distances[i]._Distance - _Scale * _Distances[i]._Distance0;
           sum += delta * delta;
         }
         _Sum += (sum / numNbrPts);
@@ -163,31 +177,31 @@ struct EvaluateGradient
 {
   typedef MetricDistortion::GradientType GradientType;
 
-  vtkPoints                   *_Points;
-  vtkDataArray                *_Normals;
-  vtkDataArray                *_Status;
-  const NodeNeighbors         *_Neighbors;
-  const Array<DistancesArray> *_Distances;
-  GradientType                *_Gradient;
-  int                          _Radius;
-  double                       _Scale;
+  vtkPoints           *_Points;
+  vtkDataArray        *_Normals;
+  vtkDataArray        *_Status;
+  const int           *_PointIds;
+  const int           *_Offsets;
+  const int           *_NeighborIds;
+  const NodeDistances *_Distances;
+  GradientType        *_Gradient;
+  double               _Scale;
 
   void operator ()(const blocked_range<int> &ptIds) const
   {
-    int        numNbrPts;
-    const int *nbrPtIds;
-    double     p1[3], p2[3], n[3], e[3], f[3], s;
+    int    numNbrPts;
+    double p1[3], p2[3], n[3], e[3], f[3], s;
 
-    for (int ptId = ptIds.begin(); ptId != ptIds.end(); ++ptId) {
+    for (int idx = ptIds.begin(), ptId; idx != ptIds.end(); ++idx) {
+      ptId = (_PointIds ? _PointIds[idx] : idx);
       if (_Status && _Status->GetComponent(ptId, 0) == .0) continue;
-      _Points->GetPoint(ptId, p1);
-      const DistancesArray &dists = (*_Distances)[ptId];
-      _Neighbors->GetConnectedPoints(ptId, numNbrPts, nbrPtIds, _Radius);
+      numNbrPts = _Offsets[ptId + 1] - _Offsets[ptId];
       if (numNbrPts == 0) continue;
+      _Points->GetPoint(ptId, p1);
       f[0] = f[1] = f[2] = .0;
-      for (int i = 0; i < numNbrPts; ++i) {
-        _Points->GetPoint(nbrPtIds[i], p2);
-        s = (dists[i]._Distance - _Scale * dists[i]._Distance0) / dists[i]._Distance;
+      for (int i = _Offsets[ptId]; i < _Offsets[ptId + 1]; ++i) {
+        _Points->GetPoint(_NeighborIds[i], p2);
+        s = (_Distances[i]._Distance - _Scale * _Distances[i]._Distance0) / _Distances[i]._Distance;
         vtkMath::Subtract(p2, p1, e);
         vtkMath::MultiplyScalar(e, s);
         vtkMath::Add(f, e, f);
@@ -227,9 +241,11 @@ MetricDistortion::MetricDistortion(const char *name, double weight)
 // -----------------------------------------------------------------------------
 void MetricDistortion::CopyAttributes(const MetricDistortion &other)
 {
-  _Radius      = other._Radius;
-  _InitialArea = other._InitialArea;
-  _Distances   = other._Distances;
+  _Radius          = other._Radius;
+  _InitialArea     = other._InitialArea;
+  _NeighborOffsets = other._NeighborOffsets;
+  _NeighborIds     = other._NeighborIds;
+  _Distances       = other._Distances;
 }
 
 // -----------------------------------------------------------------------------
@@ -304,19 +320,42 @@ void MetricDistortion::Reinitialize()
 void MetricDistortion::Init()
 {
   if (_NumberOfPoints > 0) {
-    _Distances.resize(_NumberOfPoints);
+    MIRTK_START_TIMING();
+    const RegisteredPointSet::NodeNeighbors *neighbors = _PointSet->SurfaceNeighbors(_Radius);
+
+    // Count neighbors of each node and compute offsets of first neighbor
+    _NeighborOffsets.resize(_NumberOfPoints + 1);
+    _NeighborOffsets[0] = 0;
+    MetricDistortionUtils::CountNeighbors count;
+    count._Neighbors = neighbors;
+    count._Offsets   = _NeighborOffsets.data();
+    count._Radius    = _Radius;
+    parallel_for(blocked_range<int>(0, _NumberOfPoints), count);
+    for (int ptId = 0; ptId < _NumberOfPoints; ++ptId) {
+      _NeighborOffsets[ptId + 1] += _NeighborOffsets[ptId];
+    }
+
+    // Copy neighbor indices and compute initial distances
+    const int nentries = _NeighborOffsets[_NumberOfPoints];
+    _NeighborIds.resize(nentries);
+    _Distances  .resize(nentries);
     MetricDistortionUtils::ComputeInitialDistances eval;
     vtkSmartPointer<vtkPoints> points = GetInitialPoints();
     eval._InitialPoints = points;
-    eval._Neighbors     = _PointSet->SurfaceNeighbors(_Radius);
-    eval._Distances     = &_Distances;
+    eval._Neighbors     = neighbors;
+    eval._Offsets       = _NeighborOffsets.data();
+    eval._NeighborIds   = _NeighborIds.data();
+    eval._Distances     = _Distances.data();
     eval._Radius        = _Radius;
     parallel_for(blocked_range<int>(0, _NumberOfPoints), eval);
     vtkSmartPointer<vtkPolyData> surface = vtkSmartPointer<vtkPolyData>::New();
     surface->ShallowCopy(_PointSet->InputSurface());
     surface->SetPoints(points);
     _InitialArea = Area(surface);
+    MIRTK_DEBUG_TIMING(3, "initialization of metric distortion");
   } else {
+    _NeighborOffsets.clear();
+    _NeighborIds.clear();
     _Distances.clear();
     _InitialArea = .0;
   }
@@ -327,10 +366,10 @@ void MetricDistortion::Update(bool gradient)
 {
   SurfaceConstraint::Update(gradient);
   MetricDistortionUtils::ComputeDistances eval;
-  eval._Points    = _PointSet->SurfacePoints();
-  eval._Neighbors = _PointSet->SurfaceNeighbors(_Radius);
-  eval._Distances = &_Distances;
-  eval._Radius    = _Radius;
+  eval._Points      = _PointSet->SurfacePoints();
+  eval._Offsets     = _NeighborOffsets.data();
+  eval._NeighborIds = _NeighborIds.data();
+  eval._Distances   = _Distances.data();
   parallel_for(blocked_range<int>(0, _NumberOfPoints), eval);
 }
 
@@ -340,10 +379,8 @@ double MetricDistortion::Evaluate()
   if (_NumberOfPoints == 0) return .0;
   MIRTK_START_TIMING();
   MetricDistortionUtils::Evaluate eval;
-  eval._Points    = _PointSet->SurfacePoints();
-  eval._Neighbors = _PointSet->SurfaceNeighbors(_Radius);
-  eval._Distances =  &_Distances;
-  eval._Radius    = _Radius;
+  eval._Offsets   = _NeighborOffsets.data();
+  eval._Distances = _Distances.data();
   eval._Scale     = 1.0 / sqrt(_InitialArea / _PointSet->SurfaceArea());
   parallel_reduce(blocked_range<int>(0, _NumberOfPoints), eval);
   MIRTK_DEBUG_TIMING(3, "evaluation of metric distortion");
@@ -359,15 +396,16 @@ void MetricDistortion::EvaluateGradient(double *gradient, double step, double we
   memset(_Gradient, 0, _NumberOfPoints * sizeof(GradientType));
 
   MetricDistortionUtils::EvaluateGradient eval;
-  eval._Points    = _PointSet->SurfacePoints();
-  eval._Normals   = _PointSet->SurfaceNormals();
-  eval._Status    = _PointSet->SurfaceStatus();
-  eval._Neighbors = _PointSet->SurfaceNeighbors(_Radius);
-  eval._Distances = &_Distances;
-  eval._Gradient  = _Gradient;
-  eval._Radius    = _Radius;
-  eval._Scale     = 1.0 / sqrt(_InitialArea / _PointSet->SurfaceArea());
-  parallel_for(blocked_range<int>(0, _NumberOfPoints), eval);
+  eval._Points      = _PointSet->SurfacePoints();
+  eval._Normals     = _PointSet->SurfaceNormals();
+  eval._Status      = _PointSet->SurfaceStatus();
+  eval._PointIds    = ActivePointIds();
+  eval._Offsets     = _NeighborOffsets.data();
+  eval._NeighborIds = _NeighborIds.data();
+  eval._Distances   = _Distances.data();
+  eval._Gradient    = _Gradient;
+  eval._Scale       = 1.0 / sqrt(_InitialArea / _PointSet->SurfaceArea());
+  parallel_for(blocked_range<int>(0, NumberOfActivePoints()), eval);
 
   InternalForce::EvaluateGradient(gradient, step, 2.0 * weight / _NumberOfPoints);
   MIRTK_DEBUG_TIMING(3, "evaluation of metric distortion force");
@@ -28,10 +28,11 @@
 #include "mirtk/VtkMath.h"
 
 #include "vtkUnsignedCharArray.h"
-#include "vtkGenericCell.h"
 #include "vtkCellData.h"
 #include "vtkPoints.h"
 
+#include <algorithm> // sort
+
 
 namespace mirtk {
 
@@ -123,89 +124,86 @@ struct Evaluate
 };
 
 // -----------------------------------------------------------------------------
-// Evaluate non-self-intersection force
-struct EvaluateGradient
+/// Evaluate non-self-intersection force of each colliding cell
+///
+/// The force of a cell is the sum of the forces of its collisions, which is
+/// added to each point of the cell by AccumulatePointForces.
+struct EvaluateCellForces
 {
   typedef NonSelfIntersectionConstraint::GradientType Force;
 
-  vtkSmartPointer<vtkPolyData> _DataSet;
-  const CollisionsArray       *_Collisions;
-  double                       _MinDistance;
-  Force                       *_Gradient;
-  int                         *_Count;
-
-  EvaluateGradient() : _Gradient(NULL), _Count(NULL) {}
+  const CollisionsArray  *_Collisions;
+  const Array<vtkIdType> *_Cells;
+  double                  _MinDistance;
+  Force                  *_Force;
+  int                    *_Count;
 
-  EvaluateGradient(const EvaluateGradient &other, split)
-  :
-    _DataSet    (other._DataSet),
-    _Collisions (other._Collisions),
-    _MinDistance(other._MinDistance)
+  void operator ()(const blocked_range<size_t> &re) const
   {
-    _Gradient = CAllocate<Force>(_DataSet->GetNumberOfPoints());
-    _Count    = CAllocate<int>  (_DataSet->GetNumberOfPoints());
+    double w;
+    for (size_t i = re.begin(); i != re.end(); ++i) {
+      const CollisionsSet &colls = (*_Collisions)[(*_Cells)[i]];
+      Force &force = _Force[i];
+      int   &count = _Count[i];
+      force = Force(0., 0., 0.);
+      count = 0;
+      for (CollisionsIterator it = colls.begin(); it != colls.end(); ++it) {
+        const CollisionInfo &coll = *it;
+        if (coll._Distance > .0) {
+          w = abs(_MinDistance - coll._Distance) / (_MinDistance * coll._Distance);
+          force -= Force(w * (coll._Point1[0] - coll._Point2[0]),
+                         w * (coll._Point1[1] - coll._Point2[1]),
+                         w * (coll._Point1[2] - coll._Point2[2]));
+          ++count;
+        }
+      }
+    }
   }
+};
+
+// -----------------------------------------------------------------------------
+/// Point of colliding cell
+struct CellPoint
+{
+  vtkIdType _PointId; ///< Point ID
+  int       _Index;   ///< Index of colliding cell
 
-  void join(EvaluateGradient &other)
+  bool operator <(const CellPoint &other) const
   {
-    for (vtkIdType i = 0; i < _DataSet->GetNumberOfPoints(); ++i) {
-      _Gradient[i] += other._Gradient[i];
-      _Count   [i] += other._Count   [i];
-    }
-    Deallocate(other._Gradient);
-    Deallocate(other._Count);
+    return _PointId < other._PointId || (_PointId == other._PointId && _Index < other._Index);
   }
+};
 
-  void operator ()(const blocked_range<size_t> &re)
-  {
-    vtkSmartPointer<vtkGenericCell> cell = vtkSmartPointer<vtkGenericCell>::New();
-    double    w, f[3];
-    vtkIdType ptId;
+// -----------------------------------------------------------------------------
+/// Sum forces of colliding cells at their points
+///
+/// Each range element is a run of CellPoint entries with the same point ID,
+/// such that each point is updated by exactly one thread.
+struct AccumulatePointForces
+{
+  typedef NonSelfIntersectionConstraint::GradientType Force;
 
-#if 0
-    int    subId;
-    double dist2, pcoords[3], *weights;
-    weights = new double[_DataSet->GetMaxCellSize()];
-#endif
+  const Array<CellPoint> *_CellPoints;
+  const Array<int>       *_Runs;
+  const Force            *_CellForce;
+  const int              *_CellCount;
+  Force                  *_Gradient;
+  int                    *_Count;
 
-    for (size_t cellId = re.begin(); cellId != re.end(); ++cellId) {
-      const CollisionsSet &colls = (*_Collisions)[cellId];
-      for (CollisionsIterator it = colls.begin(); it != colls.end(); ++it) {
-        const CollisionInfo &coll = *it;
-        if (coll._Distance > .0) {
-          _DataSet->GetCell(cellId, cell);
-          w = abs(_MinDistance - coll._Distance) / (_MinDistance * coll._Distance);
-          f[0] = w * (coll._Point1[0] - coll._Point2[0]);
-          f[1] = w * (coll._Point1[1] - coll._Point2[1]);
-          f[2] = w * (coll._Point1[2] - coll._Point2[2]);
-#if 0 // does not work well for coplanar triangles as long as
-      // SurfaceCollisions does not return the center points of the
-      // projected overlaps
-          if (cell->EvaluatePosition(const_cast<double *>(coll._Point1), NULL,
-                                     subId, pcoords, dist2, weights) == 1) {
-            for (vtkIdType i = 0; i < cell->GetNumberOfPoints(); ++i) {
-              ptId = cell->GetPointId(i);
-              _Gradient[ptId]._x -= weights[i] * f[0];
-              _Gradient[ptId]._y -= weights[i] * f[1];
-              _Gradient[ptId]._z -= weights[i] * f[2];
-              ++_Count[ptId];
-            }
-          } else
-#endif
-          {
-            for (vtkIdType i = 0; i < cell->GetNumberOfPoints(); ++i) {
-              ptId = cell->GetPointId(i);
-              _Gradient[ptId] -= Force(f[0], f[1], f[2]);
-              ++_Count[ptId];
-            }
-          }
-        }
+  void operator ()(const blocked_range<int> &re) const
+  {
+    for (int r = re.begin(); r != re.end(); ++r) {
+      const int begin = (*_Runs)[r];
+      const int end   = (*_Runs)[r + 1];
+      const vtkIdType ptId = (*_CellPoints)[begin]._PointId;
+      Force &gradient = _Gradient[ptId];
+      int   &count    = _Count[ptId];
+      for (int i = begin; i < end; ++i) {
+        const int idx = (*_CellPoints)[i]._Index;
+        gradient += _CellForce[idx];
+        count    += _CellCount[idx];
       }
     }
-
-#if 0
-    delete[] weights;
-#endif
   }
 };
 
@@ -424,13 +422,57 @@ void NonSelfIntersectionConstraint::EvaluateGradient(double *gradient, double st
 
   if (_NumberOfCollisions == 0) return;
 
-  NonSelfIntersectionConstraintUtils::EvaluateGradient eval;
-  eval._DataSet     = _PointSet->Surface();
+  // Sparse accumulation of forces of colliding cells at their points, which
+  // requires memory proportional to the number of collisions only
+  vtkPolyData * const surface = _PointSet->Surface();
+
+  Array<vtkIdType> cells;
+  for (size_t cellId = 0; cellId < _Collisions.size(); ++cellId) {
+    if (!_Collisions[cellId].empty()) cells.push_back(static_cast<vtkIdType>(cellId));
+  }
+  const int ncells = static_cast<int>(cells.size());
+
+  Array<GradientType> cell_force(ncells);
+  Array<int>          cell_count(ncells);
+  NonSelfIntersectionConstraintUtils::EvaluateCellForces eval;
   eval._Collisions  = &_Collisions;
+  eval._Cells       = &cells;
   eval._MinDistance = _MinDistance;
-  eval._Gradient    = _Gradient;
-  eval._Count       = _Count;
-  parallel_reduce(blocked_range<size_t>(0, _Collisions.size()), eval);
+  eval._Force       = cell_force.data();
+  eval._Count       = cell_count.data();
+  parallel_for(blocked_range<size_t>(0, cells.size()), eval);
+
+  if (surface->NeedToBuildCells()) surface->BuildCells();
+  Array<CellPoint> cell_points;
+  cell_points.reserve(3 * cells.size());
+  vtkIdType npts, *pts;
+  CellPoint cell_point;
+  for (int i = 0; i < ncells; ++i) {
+    if (cell_count[i] == 0) continue;
+    surface->GetCellPoints(cells[i], npts, pts);
+    cell_point._Index = i;
+    for (vtkIdType j = 0; j < npts; ++j) {
+      cell_point._PointId = pts[j];
+      cell_points.push_back(cell_point);
+    }
+  }
+  std::sort(cell_points.begin(), cell_points.end());
+
+  Array<int> runs;
+  for (int i = 0; i < static_cast<int>(cell_points.size()); ++i) {
+    if (i == 0 || cell_points[i]._PointId != cell_points[i-1]._PointId) runs.push_back(i);
+  }
+  const int nruns = static_cast<int>(runs.size());
+  runs.push_back(static_cast<int>(cell_points.size()));
+
+  NonSelfIntersectionConstraintUtils::AccumulatePointForces accum;
+  accum._CellPoints = &cell_points;
+  accum._Runs       = &runs;
+  accum._CellForce  = cell_force.data();
+  accum._CellCount  = cell_count.data();
+  accum._Gradient   = _Gradient;
+  accum._Count      = _Count;
+  parallel_for(blocked_range<int>(0, nruns), accum);
 
   for (int i = 0; i < _NumberOfPoints; ++i) {
     if (_Count[i] > 0) _Gradient[i] /= _Count[i];
@@ -0,0 +1,1154 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright 2013-2017 Imperial College London
+ * Copyright 2013-2017 Andreas Schuh
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "mirtk/ParallelSurfaceRemeshing.h"
+
+#include "mirtk/Math.h"
+#include "mirtk/Memory.h"
+#include "mirtk/Parallel.h"
+#include "mirtk/Profiling.h"
+#include "mirtk/PointSetUtils.h"
+
+#include "vtkPoints.h"
+#include "vtkCellArray.h"
+#include "vtkPointData.h"
+#include "vtkCellData.h"
+#include "vtkIdTypeArray.h"
+
+#include <algorithm>
+#include <atomic>
+
+
+namespace mirtk {
+
+
+// =============================================================================
+// Auxiliaries
+// =============================================================================
+
+namespace ParallelSurfaceRemeshingUtils {
+
+
+// -----------------------------------------------------------------------------
+/// Maximum number of triangles adjacent to a node whose edges are collapsed
+const int MaxValence = 32;
+
+// -----------------------------------------------------------------------------
+/// Edge to be modified and its priority
+struct EdgeKey
+{
+  double _Length2; ///< Squared edge length
+  int    _PtId1;   ///< Smaller index of edge end points, -1 if invalid
+  int    _PtId2;   ///< Larger index of edge end points
+
+  EdgeKey() : _Length2(inf), _PtId1(-1), _PtId2(-1) {}
+
+  EdgeKey(double l2, int a, int b)
+  :
+    _Length2(l2), _PtId1(a < b ? a : b), _PtId2(a < b ? b : a)
+  {}
+
+  bool IsValid() const { return _PtId1 >= 0; }
+
+  bool operator ==(const EdgeKey &other) const
+  {
+    return _PtId1 == other._PtId1 && _PtId2 == other._PtId2;
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Whether edge a is collapsed before edge b, i.e., shorter edges first
+inline bool CollapseBefore(const EdgeKey &a, const EdgeKey &b)
+{
+  if (!b.IsValid()) return a.IsValid();
+  if (!a.IsValid()) return false;
+  if (a._Length2 != b._Length2) return a._Length2 < b._Length2;
+  if (a._PtId1   != b._PtId1)   return a._PtId1   < b._PtId1;
+  return a._PtId2 < b._PtId2;
+}
+
+// -----------------------------------------------------------------------------
+/// Whether edge a is split before edge b, i.e., longer edges first
+inline bool SplitBefore(const EdgeKey &a, const EdgeKey &b)
+{
+  if (!b.IsValid()) return a.IsValid();
+  if (!a.IsValid()) return false;
+  if (a._Length2 != b._Length2) return a._Length2 > b._Length2;
+  if (a._PtId1   != b._PtId1)   return a._PtId1   < b._PtId1;
+  return a._PtId2 < b._PtId2;
+}
+
+// -----------------------------------------------------------------------------
+/// Squared distance between two points, which is symmetric also in floating point
+inline double Distance2(const double *p, const double *q)
+{
+  const double dx = q[0] - p[0], dy = q[1] - p[1], dz = q[2] - p[2];
+  return dx * dx + dy * dy + dz * dz;
+}
+
+// -----------------------------------------------------------------------------
+/// Compute normal of triangle scaled by twice its area
+inline void TriangleNormal(const double *a, const double *b, const double *c, double *n)
+{
+  const double u[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+  const double v[3] = {c[0] - a[0], c[1] - a[1], c[2] - a[2]};
+  n[0] = u[1] * v[2] - u[2] * v[1];
+  n[1] = u[2] * v[0] - u[0] * v[2];
+  n[2] = u[0] * v[1] - u[1] * v[0];
+}
+
+// -----------------------------------------------------------------------------
+/// Pointers to the mesh data of the remeshing filter
+struct Mesh
+{
+  double    *_Points;
+  double    *_Normals;       ///< Node normals or \c nullptr
+  char      *_Fixed;
+  char      *_Deleted;
+  double    *_PointData;
+  int        _PointDataSize;
+  int       *_Triangles;
+  double    *_CellData;
+  int        _CellDataSize;
+  const int *_LinkOffsets;
+  const int *_Links;
+  const int *_Valence;
+  double     _MinLength2;    ///< Squared minimum edge length
+  double     _MaxLength2;    ///< Squared maximum edge length
+  double     _MinFeatureCos; ///< Cosine of minimum feature angle
+  double     _MaxFeatureCos; ///< Cosine of maximum feature angle
+
+  const double *Point(int ptId) const
+  {
+    return _Points + 3 * ptId;
+  }
+
+  const int *Triangle(int cellId) const
+  {
+    return _Triangles + 3 * cellId;
+  }
+
+  /// Whether angle between node normals of edge end points exceeds the given angle
+  bool IsFeatureEdge(int a, int b, double cos_angle) const
+  {
+    if (_Normals == nullptr) return false;
+    const double *na = _Normals + 3 * a;
+    const double *nb = _Normals + 3 * b;
+    return na[0] * nb[0] + na[1] * nb[1] + na[2] * nb[2] <= cos_angle;
+  }
+
+  /// Get indices of nodes adjacent to a node
+  ///
+  /// \returns Number of adjacent nodes, or -1 if it exceeds the buffer size.
+  int GetAdjacentPoints(int ptId, int *adjPtIds, int maxAdjPts) const
+  {
+    int n = 0, j;
+    for (int i = _LinkOffsets[ptId]; i < _LinkOffsets[ptId + 1]; ++i) {
+      const int *tri = Triangle(_Links[i]);
+      for (int k = 0; k < 3; ++k) {
+        if (tri[k] == ptId) continue;
+        for (j = 0; j < n; ++j) {
+          if (adjPtIds[j] == tri[k]) break;
+        }
+        if (j == n) {
+          if (n == maxAdjPts) return -1;
+          adjPtIds[n++] = tri[k];
+        }
+      }
+    }
+    return n;
+  }
+
+  /// Set point data of a node to the average of two nodes
+  void AveragePointData(int ptId, int a, int b) const
+  {
+    double       *v  = _PointData + _PointDataSize * ptId;
+    const double *va = _PointData + _PointDataSize * a;
+    const double *vb = _PointData + _PointDataSize * b;
+    for (int j = 0; j < _PointDataSize; ++j) {
+      v[j] = .5 * (va[j] + vb[j]);
+    }
+  }
+
+  /// Set node normal to the normalized average of two node normals
+  void AverageNormal(int ptId, int a, int b) const
+  {
+    if (_Normals == nullptr) return;
+    double *n = _Normals + 3 * ptId;
+    const double *na = _Normals + 3 * a;
+    const double *nb = _Normals + 3 * b;
+    n[0] = na[0] + nb[0], n[1] = na[1] + nb[1], n[2] = na[2] + nb[2];
+    const double norm = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+    if (norm > 0.) n[0] /= norm, n[1] /= norm, n[2] /= norm;
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Count triangles adjacent to each node
+struct CountTriangleLinks
+{
+  const int        *_Triangles;
+  std::atomic<int> *_Counts;
+
+  void operator ()(const blocked_range<int> &cellIds) const
+  {
+    for (int cellId = cellIds.begin(); cellId != cellIds.end(); ++cellId) {
+      const int *tri = _Triangles + 3 * cellId;
+      if (tri[0] >= 0) {
+        _Counts[tri[0]].fetch_add(1, std::memory_order_relaxed);
+        _Counts[tri[1]].fetch_add(1, std::memory_order_relaxed);
+        _Counts[tri[2]].fetch_add(1, std::memory_order_relaxed);
+      }
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Copy triangle indices to the next free link position of their nodes
+struct ScatterTriangleLinks
+{
+  const int        *_Triangles;
+  std::atomic<int> *_Next;
+  int              *_Links;
+
+  void operator ()(const blocked_range<int> &cellIds) const
+  {
+    for (int cellId = cellIds.begin(); cellId != cellIds.end(); ++cellId) {
+      const int *tri = _Triangles + 3 * cellId;
+      if (tri[0] >= 0) {
+        for (int i = 0; i < 3; ++i) {
+          _Links[_Next[tri[i]].fetch_add(1, std::memory_order_relaxed)] = cellId;
+        }
+      }
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Sort triangle indices adjacent to each node in ascending order
+struct SortTriangleLinks
+{
+  const int *_LinkOffsets;
+  int       *_Links;
+
+  void operator ()(const blocked_range<int> &ptIds) const
+  {
+    for (int ptId = ptIds.begin(); ptId != ptIds.end(); ++ptId) {
+      std::sort(_Links + _LinkOffsets[ptId], _Links + _LinkOffsets[ptId + 1]);
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Compute node normals as area weighted average of adjacent triangle normals
+struct ComputeNodeNormals
+{
+  const Mesh *_Mesh;
+
+  void operator ()(const blocked_range<int> &ptIds) const
+  {
+    double n[3], *normal;
+    for (int ptId = ptIds.begin(); ptId != ptIds.end(); ++ptId) {
+      normal = _Mesh->_Normals + 3 * ptId;
+      normal[0] = normal[1] = normal[2] = 0.;
+      for (int i = _Mesh->_LinkOffsets[ptId]; i < _Mesh->_LinkOffsets[ptId + 1]; ++i) {
+        const int *tri = _Mesh->Triangle(_Mesh->_Links[i]);
+        TriangleNormal(_Mesh->Point(tri[0]), _Mesh->Point(tri[1]), _Mesh->Point(tri[2]), n);
+        normal[0] += n[0], normal[1] += n[1], normal[2] += n[2];
+      }
+      const double norm = sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+      if (norm > 0.) normal[0] /= norm, normal[1] /= norm, normal[2] /= norm;
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Determine valence of nodes with closed manifold neighborhood
+struct ComputeValence
+{
+  const Mesh *_Mesh;
+  int        *_Valence;
+
+  void operator ()(const blocked_range<int> &ptIds) const
+  {
+    int adjPtIds[MaxValence], count[MaxValence], n, j;
+    for (int ptId = ptIds.begin(); ptId != ptIds.end(); ++ptId) {
+      n = 0;
+      for (int i = _Mesh->_LinkOffsets[ptId]; n >= 0 && i < _Mesh->_LinkOffsets[ptId + 1]; ++i) {
+        const int *tri = _Mesh->Triangle(_Mesh->_Links[i]);
+        for (int k = 0; n >= 0 && k < 3; ++k) {
+          if (tri[k] == ptId) continue;
+          for (j = 0; j < n; ++j) {
+            if (adjPtIds[j] == tri[k]) break;
+          }
+          if (j < n) {
+            ++count[j];
+          } else if (n < MaxValence) {
+            adjPtIds[n] = tri[k];
+            count[n++] = 1;
+          } else {
+            n = -1;
+          }
+        }
+      }
+      // Each edge of a closed manifold neighborhood has two adjacent triangles
+      for (j = 0; j < n; ++j) {
+        if (count[j] != 2) break;
+      }
+      _Valence[ptId] = (n > 0 && j == n ? n : -1);
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Propose shortest edge of each node to be collapsed which is valid
+struct ProposeCollapses
+{
+  const Mesh *_Mesh;
+  EdgeKey    *_Proposal;
+
+  /// Whether edge can be collapsed without violating the manifold topology,
+  /// flipping an adjacent triangle, or creating an edge above maximum length
+  bool CanCollapse(int a, int b) const
+  {
+    const int *valence = _Mesh->_Valence;
+    if (_Mesh->_Fixed[a] || _Mesh->_Fixed[b]) return false;
+    if (valence[a] < 0 || valence[b] < 0) return false;
+    if (valence[a] + valence[b] - 4 < 3) return false;
+    if (_Mesh->IsFeatureEdge(a, b, _Mesh->_MinFeatureCos)) return false;
+
+    // Opposite nodes of the two triangles sharing the edge
+    int c[2], n = 0;
+    for (int i = _Mesh->_LinkOffsets[a]; i < _Mesh->_LinkOffsets[a + 1]; ++i) {
+      const int *tri = _Mesh->Triangle(_Mesh->_Links[i]);
+      if (tri[0] == b || tri[1] == b || tri[2] == b) {
+        if (n == 2) return false;
+        c[n++] = tri[0] + tri[1] + tri[2] - a - b;
+      }
+    }
+    if (n != 2) return false;
+    if (valence[c[0]] < 4 || valence[c[1]] < 4) return false;
+
+    // Link condition, i.e., end points have no other common adjacent node
+    int adjPtIdsA[MaxValence], adjPtIdsB[MaxValence];
+    const int na = _Mesh->GetAdjacentPoints(a, adjPtIdsA, MaxValence);
+    const int nb = _Mesh->GetAdjacentPoints(b, adjPtIdsB, MaxValence);
+    if (na < 0 || nb < 0) return false;
+    int ncommon = 0;
+    for (int i = 0; i < na; ++i)
+    for (int j = 0; j < nb; ++j) {
+      if (adjPtIdsA[i] == adjPtIdsB[j]) ++ncommon;
+    }
+    if (ncommon != 2) return false;
+
+    // Check triangles which are modified by the collapse
+    double p[3], n0[3], n1[3];
+    const double *pa = _Mesh->Point(a);
+    const double *pb = _Mesh->Point(b);
+    p[0] = .5 * (pa[0] + pb[0]);
+    p[1] = .5 * (pa[1] + pb[1]);
+    p[2] = .5 * (pa[2] + pb[2]);
+    for (int e = 0; e < 2; ++e) {
+      const int ptId = (e == 0 ? a : b);
+      for (int i = _Mesh->_LinkOffsets[ptId]; i < _Mesh->_LinkOffsets[ptId + 1]; ++i) {
+        const int *tri = _Mesh->Triangle(_Mesh->_Links[i]);
+        const double *v[3];
+        int k = -1;
+        for (int j = 0; j < 3; ++j) {
+          if (tri[j] == a || tri[j] == b) k = (k == -1 ? j : -2);
+          v[j] = _Mesh->Point(tri[j]);
+        }
+        if (k < 0) continue; // triangle removed by collapse
+        TriangleNormal(v[0], v[1], v[2], n0);
+        v[k] = p;
+        TriangleNormal(v[0], v[1], v[2], n1);
+        if (n0[0] * n1[0] + n0[1] * n1[1] + n0[2] * n1[2] <= 0.) return false;
+        if (Distance2(p, v[(k + 1) % 3]) > _Mesh->_MaxLength2) return false;
+        if (Distance2(p, v[(k + 2) % 3]) > _Mesh->_MaxLength2) return false;
+      }
+    }
+    return true;
+  }
+
+  void operator ()(const blocked_range<int> &ptIds) const
+  {
+    int adjPtIds[MaxValence], n;
+    double l2;
+    for (int a = ptIds.begin(); a != ptIds.end(); ++a) {
+      EdgeKey best;
+      if (!_Mesh->_Fixed[a] && _Mesh->_Valence[a] > 0) {
+        n = _Mesh->GetAdjacentPoints(a, adjPtIds, MaxValence);
+        for (int i = 0; i < n; ++i) {
+          const int b = adjPtIds[i];
+          if (b < a) continue;
+          l2 = Distance2(_Mesh->Point(a), _Mesh->Point(b));
+          if (l2 < _Mesh->_MinLength2) {
+            EdgeKey key(l2, a, b);
+            if (CollapseBefore(key, best) && CanCollapse(a, b)) best = key;
+          }
+        }
+      }
+      _Proposal[a] = best;
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Determine for each node the first proposed collapse of an adjacent edge,
+/// or the first proposed collapse of a nearby edge, respectively
+struct FirstProposedCollapse
+{
+  const Mesh    *_Mesh;
+  const EdgeKey *_Input;
+  EdgeKey       *_Output;
+  bool           _AdjacentEdges; ///< Only consider edges adjacent to node
+
+  void operator ()(const blocked_range<int> &ptIds) const
+  {
+    for (int ptId = ptIds.begin(); ptId != ptIds.end(); ++ptId) {
+      EdgeKey first = _Input[ptId];
+      for (int i = _Mesh->_LinkOffsets[ptId]; i < _Mesh->_LinkOffsets[ptId + 1]; ++i) {
+        const int *tri = _Mesh->Triangle(_Mesh->_Links[i]);
+        for (int k = 0; k < 3; ++k) {
+          const EdgeKey &key = _Input[tri[k]];
+          if (_AdjacentEdges && key._PtId2 != ptId) continue;
+          if (CollapseBefore(key, first)) first = key;
+        }
+      }
+      _Output[ptId] = first;
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Select proposed collapses which are first in the neighborhoods of all
+/// nodes they modify, such that the selected collapses are independent
+struct SelectCollapses
+{
+  const Mesh    *_Mesh;
+  const EdgeKey *_Proposal;
+  const EdgeKey *_First;
+  char          *_Selected;
+
+  bool IsFirst(int ptId, const EdgeKey &key) const
+  {
+    if (!(_First[ptId] == key)) return false;
+    for (int i = _Mesh->_LinkOffsets[ptId]; i < _Mesh->_LinkOffsets[ptId + 1]; ++i) {
+      const int *tri = _Mesh->Triangle(_Mesh->_Links[i]);
+      for (int k = 0; k < 3; ++k) {
+        if (!(_First[tri[k]] == key)) return false;
+      }
+    }
+    return true;
+  }
+
+  void operator ()(const blocked_range<int> &ptIds) const
+  {
+    for (int ptId = ptIds.begin(); ptId != ptIds.end(); ++ptId) {
+      const EdgeKey &key = _Proposal[ptId];
+      _Selected[ptId] = (key.IsValid() && IsFirst(key._PtId1, key) && IsFirst(key._PtId2, key));
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Collapse selected edges into their midpoints
+struct CollapseSelectedEdges
+{
+  const Mesh    *_Mesh;
+  const EdgeKey *_Edges;
+
+  void operator ()(const blocked_range<int> &re) const
+  {
+    for (int idx = re.begin(); idx != re.end(); ++idx) {
+      const int a = _Edges[idx]._PtId1;
+      const int b = _Edges[idx]._PtId2;
+      double *pa = _Mesh->_Points + 3 * a;
+      const double *pb = _Mesh->Point(b);
+      pa[0] = .5 * (pa[0] + pb[0]);
+      pa[1] = .5 * (pa[1] + pb[1]);
+      pa[2] = .5 * (pa[2] + pb[2]);
+      _Mesh->AveragePointData(a, a, b);
+      _Mesh->AverageNormal(a, a, b);
+      for (int i = _Mesh->_LinkOffsets[b]; i < _Mesh->_LinkOffsets[b + 1]; ++i) {
+        int *tri = _Mesh->_Triangles + 3 * _Mesh->_Links[i];
+        if (tri[0] == a || tri[1] == a || tri[2] == a) {
+          tri[0] = tri[1] = tri[2] = -1;
+        } else {
+          for (int k = 0; k < 3; ++k) {
+            if (tri[k] == b) tri[k] = a;
+          }
+        }
+      }
+      _Mesh->_Deleted[b] = 1;
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Propose longest edge of each triangle to be split
+struct ProposeSplits
+{
+  const Mesh *_Mesh;
+  EdgeKey    *_Proposal;
+
+  void operator ()(const blocked_range<int> &cellIds) const
+  {
+    double l2;
+    int    a, b;
+    for (int cellId = cellIds.begin(); cellId != cellIds.end(); ++cellId) {
+      EdgeKey best;
+      const int *tri = _Mesh->Triangle(cellId);
+      if (tri[0] >= 0) {
+        for (int k = 0; k < 3; ++k) {
+          a = tri[k], b = tri[(k + 1) % 3];
+          if (_Mesh->_Fixed[a] || _Mesh->_Fixed[b]) continue;
+          l2 = Distance2(_Mesh->Point(a), _Mesh->Point(b));
+          if (l2 > _Mesh->_MaxLength2) {
+            EdgeKey key(l2, a, b);
+            if (SplitBefore(key, best) && !_Mesh->IsFeatureEdge(a, b, _Mesh->_MaxFeatureCos)) {
+              best = key;
+            }
+          }
+        }
+      }
+      _Proposal[cellId] = best;
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Select proposed splits which are first in both adjacent triangles, such
+/// that the selected splits are independent, where the triangle with the
+/// smaller index performs the split of an edge shared by two triangles
+///
+/// The output is the index of the other triangle or -1 for a boundary edge,
+/// and -2 if the triangle does not perform a split.
+struct SelectSplits
+{
+  const Mesh    *_Mesh;
+  const EdgeKey *_Proposal;
+  int           *_Selected;
+
+  void operator ()(const blocked_range<int> &cellIds) const
+  {
+    for (int cellId = cellIds.begin(); cellId != cellIds.end(); ++cellId) {
+      const EdgeKey &key = _Proposal[cellId];
+      int nbrId = -2;
+      if (key.IsValid()) {
+        const int a = key._PtId1, b = key._PtId2;
+        int n = 0;
+        nbrId = -1;
+        for (int i = _Mesh->_LinkOffsets[a]; i < _Mesh->_LinkOffsets[a + 1]; ++i) {
+          const int otherId = _Mesh->_Links[i];
+          if (otherId == cellId) continue;
+          const int *tri = _Mesh->Triangle(otherId);
+          if (tri[0] == b || tri[1] == b || tri[2] == b) nbrId = otherId, ++n;
+        }
+        if (n > 1 || (n == 1 && (nbrId < cellId || !(_Proposal[nbrId] == key)))) {
+          nbrId = -2;
+        }
+      }
+      _Selected[cellId] = nbrId;
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Split of an edge
+struct EdgeSplit
+{
+  int _CellId;   ///< Triangle which performs the split
+  int _NbrId;    ///< Other triangle sharing the edge or -1
+  int _PtId;     ///< Index of new node
+  int _NewId;    ///< Index of first new triangle
+};
+
+// -----------------------------------------------------------------------------
+/// Split selected edges at their midpoints
+struct SplitSelectedEdges
+{
+  const Mesh      *_Mesh;
+  const EdgeSplit *_Splits;
+  const EdgeKey   *_Proposal;
+
+  /// Replace triangle (a, b, c) by (a, m, c) and add triangle (m, b, c),
+  /// where b follows a in the order of the triangle nodes
+  void Split(int cellId, int a, int b, int m, int newId) const
+  {
+    int *tri = _Mesh->_Triangles + 3 * cellId;
+    int k = 0;
+    while (tri[k] != a) ++k;
+    if (tri[(k + 1) % 3] != b) {
+      swap(a, b);
+      while (tri[k] != a) k = (k + 1) % 3;
+    }
+    const int c = tri[(k + 2) % 3];
+    tri[(k + 1) % 3] = m;
+    int *other = _Mesh->_Triangles + 3 * newId;
+    other[0] = m, other[1] = b, other[2] = c;
+    double       *v = _Mesh->_CellData + _Mesh->_CellDataSize * newId;
+    const double *w = _Mesh->_CellData + _Mesh->_CellDataSize * cellId;
+    for (int j = 0; j < _Mesh->_CellDataSize; ++j) v[j] = w[j];
+  }
+
+  void operator ()(const blocked_range<int> &re) const
+  {
+    for (int idx = re.begin(); idx != re.end(); ++idx) {
+      const EdgeSplit &split = _Splits[idx];
+      const EdgeKey   &edge  = _Proposal[split._CellId];
+      const int a = edge._PtId1, b = edge._PtId2, m = split._PtId;
+      const double *pa = _Mesh->Point(a);
+      const double *pb = _Mesh->Point(b);
+      double *pm = _Mesh->_Points + 3 * m;
+      pm[0] = .5 * (pa[0] + pb[0]);
+      pm[1] = .5 * (pa[1] + pb[1]);
+      pm[2] = .5 * (pa[2] + pb[2]);
+      _Mesh->AveragePointData(m, a, b);
+      _Mesh->AverageNormal(m, a, b);
+      _Mesh->_Fixed  [m] = 0;
+      _Mesh->_Deleted[m] = 0;
+      Split(split._CellId, a, b, m, split._NewId);
+      if (split._NbrId >= 0) {
+        Split(split._NbrId, a, b, m, split._NewId + 1);
+      }
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Copy positions of remaining nodes to output points
+struct CopyRemainingPoints
+{
+  const double *_Points;
+  const int    *_PtIds;
+  vtkPoints    *_Output;
+
+  void operator ()(const blocked_range<int> &re) const
+  {
+    for (int i = re.begin(); i != re.end(); ++i) {
+      _Output->SetPoint(i, _Points + 3 * _PtIds[i]);
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Copy remaining triangles with new node indices to output cell array
+struct CopyRemainingTriangles
+{
+  const int *_Triangles;
+  const int *_CellIds;
+  const int *_NewPtId;
+  vtkIdType *_Cells;
+
+  void operator ()(const blocked_range<int> &re) const
+  {
+    for (int i = re.begin(); i != re.end(); ++i) {
+      const int *tri   = _Triangles + 3 * _CellIds[i];
+      vtkIdType *cell  = _Cells + 4 * i;
+      cell[0] = 3;
+      cell[1] = _NewPtId[tri[0]];
+      cell[2] = _NewPtId[tri[1]];
+      cell[3] = _NewPtId[tri[2]];
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Copy data array to attributes matrix
+struct GetAttributeValues
+{
+  vtkDataArray *_Array;
+  double       *_Values;
+  int           _Offset;
+  int           _Size;
+
+  void operator ()(const blocked_range<int> &re) const
+  {
+    const int ncomps = _Array->GetNumberOfComponents();
+    for (int id = re.begin(); id != re.end(); ++id) {
+      double *v = _Values + _Size * id + _Offset;
+      for (int j = 0; j < ncomps; ++j) {
+        v[j] = _Array->GetComponent(id, j);
+      }
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Copy attributes matrix to data array
+struct SetAttributeValues
+{
+  const double *_Values;
+  const int    *_Ids;
+  int           _Offset;
+  int           _Size;
+  vtkDataArray *_Array;
+
+  void operator ()(const blocked_range<int> &re) const
+  {
+    const int  ncomps  = _Array->GetNumberOfComponents();
+    const int  type    = _Array->GetDataType();
+    const bool integer = (type != VTK_FLOAT && type != VTK_DOUBLE);
+    double value;
+    for (int id = re.begin(); id != re.end(); ++id) {
+      const double *v = _Values + _Size * _Ids[id] + _Offset;
+      for (int j = 0; j < ncomps; ++j) {
+        value = v[j];
+        if (integer) value = round(value);
+        _Array->SetComponent(id, j, value);
+      }
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Copy data arrays to attributes matrix
+///
+/// \returns Number of components of all data arrays.
+int GetAttributes(vtkDataSetAttributes *data, int n, Array<double> &values)
+{
+  int size = 0;
+  for (int i = 0; i < data->GetNumberOfArrays(); ++i) {
+    vtkDataArray *array = data->GetArray(i);
+    if (array) size += array->GetNumberOfComponents();
+  }
+  values.resize(static_cast<size_t>(n) * size);
+  GetAttributeValues eval;
+  eval._Values = values.data();
+  eval._Offset = 0;
+  eval._Size   = size;
+  for (int i = 0; i < data->GetNumberOfArrays(); ++i) {
+    eval._Array = data->GetArray(i);
+    if (eval._Array) {
+      parallel_for(blocked_range<int>(0, n), eval);
+      eval._Offset += eval._Array->GetNumberOfComponents();
+    }
+  }
+  return size;
+}
+
+// -----------------------------------------------------------------------------
+/// Create data arrays from attributes matrix
+void SetAttributes(vtkDataSetAttributes *input, const Array<double> &values, int size,
+                   const Array<int> &ids, vtkDataSetAttributes *output)
+{
+  const int n = static_cast<int>(ids.size());
+  SetAttributeValues eval;
+  eval._Values = values.data();
+  eval._Ids    = ids.data();
+  eval._Offset = 0;
+  eval._Size   = size;
+  for (int i = 0; i < input->GetNumberOfArrays(); ++i) {
+    vtkDataArray *array = input->GetArray(i);
+    if (array == nullptr) continue;
+    vtkSmartPointer<vtkDataArray> copy;
+    copy.TakeReference(array->NewInstance());
+    copy->SetName(array->GetName());
+    copy->SetNumberOfComponents(array->GetNumberOfComponents());
+    copy->SetNumberOfTuples(n);
+    eval._Array = copy;
+    parallel_for(blocked_range<int>(0, n), eval);
+    eval._Offset += array->GetNumberOfComponents();
+    const int attr = input->IsArrayAnAttribute(i);
+    if (attr >= 0) output->SetAttribute(copy, attr);
+    else           output->AddArray(copy);
+  }
+}
+
+
+} // namespace ParallelSurfaceRemeshingUtils
+using namespace ParallelSurfaceRemeshingUtils;
+
+// =============================================================================
+// Construction/Destruction
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+ParallelSurfaceRemeshing::ParallelSurfaceRemeshing()
+:
+  _MinEdgeLength(.0),
+  _MaxEdgeLength(inf),
+  _MinFeatureAngle(180.0),
+  _MaxFeatureAngle(180.0),
+  _MaxNumberOfRounds(100),
+  _NumberOfCollapses(0),
+  _NumberOfSplits(0),
+  _NumberOfRounds(0),
+  _PointDataSize(0),
+  _CellDataSize(0)
+{
+}
+
+// -----------------------------------------------------------------------------
+ParallelSurfaceRemeshing::~ParallelSurfaceRemeshing()
+{
+}
+
+// =============================================================================
+// Execution
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+void ParallelSurfaceRemeshing::Initialize()
+{
+  if (!_Input) {
+    Throw(ERR_InvalidArgument, __FUNCTION__, "Input surface mesh not set");
+  }
+  if (!IsTriangularMesh(_Input)) {
+    Throw(ERR_InvalidArgument, __FUNCTION__, "Input must be a triangulated surface mesh");
+  }
+
+  const int npoints = static_cast<int>(_Input->GetNumberOfPoints());
+  const int ncells  = static_cast<int>(_Input->GetNumberOfCells());
+
+  _Points.resize(3 * npoints);
+  for (int ptId = 0; ptId < npoints; ++ptId) {
+    _Input->GetPoint(ptId, _Points.data() + 3 * ptId);
+  }
+  _Fixed.resize(npoints);
+  for (int ptId = 0; ptId < npoints; ++ptId) {
+    _Fixed[ptId] = (_PointMask && _PointMask->GetComponent(ptId, 0) == 0.);
+  }
+  _Deleted.assign(npoints, 0);
+
+  vtkIdType npts, *pts;
+  _Triangles.resize(3 * ncells);
+  for (int cellId = 0; cellId < ncells; ++cellId) {
+    _Input->GetCellPoints(cellId, npts, pts);
+    for (int k = 0; k < 3; ++k) {
+      _Triangles[3 * cellId + k] = static_cast<int>(pts[k]);
+    }
+  }
+
+  _PointDataSize = GetAttributes(_Input->GetPointData(), npoints, _PointData);
+  _CellDataSize  = GetAttributes(_Input->GetCellData(),  ncells,  _CellData);
+
+  _Normals.clear();
+  if (_MinFeatureAngle < 180. || _MaxFeatureAngle < 180.) {
+    BuildLinks();
+    ComputeNormals();
+  }
+
+  _NumberOfCollapses = 0;
+  _NumberOfSplits    = 0;
+  _NumberOfRounds    = 0;
+}
+
+// -----------------------------------------------------------------------------
+void ParallelSurfaceRemeshing::BuildLinks()
+{
+  const int npoints = static_cast<int>(_Deleted.size());
+  const int ncells  = static_cast<int>(_Triangles.size() / 3);
+
+  // Count adjacent triangles of each node
+  UniquePtr<std::atomic<int>[]> counts(new std::atomic<int>[npoints]);
+  for (int ptId = 0; ptId < npoints; ++ptId) {
+    counts[ptId].store(0, std::memory_order_relaxed);
+  }
+  CountTriangleLinks count;
+  count._Triangles = _Triangles.data();
+  count._Counts    = counts.get();
+  parallel_for(blocked_range<int>(0, ncells), count);
+
+  // Offsets of links, where the counters are reused as next free positions
+  _LinkOffsets.resize(npoints + 1);
+  _LinkOffsets[0] = 0;
+  for (int ptId = 0; ptId < npoints; ++ptId) {
+    _LinkOffsets[ptId + 1] = _LinkOffsets[ptId] + counts[ptId].load(std::memory_order_relaxed);
+    counts[ptId].store(_LinkOffsets[ptId], std::memory_order_relaxed);
+  }
+
+  // Insert triangles and sort them in ascending order of their indices
+  _Links.resize(_LinkOffsets[npoints]);
+  ScatterTriangleLinks scatter;
+  scatter._Triangles = _Triangles.data();
+  scatter._Next      = counts.get();
+  scatter._Links     = _Links.data();
+  parallel_for(blocked_range<int>(0, ncells), scatter);
+
+  SortTriangleLinks sort;
+  sort._LinkOffsets = _LinkOffsets.data();
+  sort._Links       = _Links.data();
+  parallel_for(blocked_range<int>(0, npoints), sort);
+}
+
+// -----------------------------------------------------------------------------
+void ParallelSurfaceRemeshing::ComputeNormals()
+{
+  const int npoints = static_cast<int>(_Deleted.size());
+  _Normals.resize(3 * npoints);
+  Mesh mesh;
+  mesh._Points      = _Points.data();
+  mesh._Normals     = _Normals.data();
+  mesh._Triangles   = _Triangles.data();
+  mesh._LinkOffsets = _LinkOffsets.data();
+  mesh._Links       = _Links.data();
+  ComputeNodeNormals eval;
+  eval._Mesh = &mesh;
+  parallel_for(blocked_range<int>(0, npoints), eval);
+}
+
+// -----------------------------------------------------------------------------
+int ParallelSurfaceRemeshing::CollapseEdges()
+{
+  const int npoints = static_cast<int>(_Deleted.size());
+  BuildLinks();
+
+  Mesh mesh;
+  mesh._Points        = _Points.data();
+  mesh._Normals       = (_Normals.empty() ? nullptr : _Normals.data());
+  mesh._Fixed         = _Fixed.data();
+  mesh._Deleted       = _Deleted.data();
+  mesh._PointData     = _PointData.data();
+  mesh._PointDataSize = _PointDataSize;
+  mesh._Triangles     = _Triangles.data();
+  mesh._LinkOffsets   = _LinkOffsets.data();
+  mesh._Links         = _Links.data();
+  mesh._MinLength2    = _MinEdgeLength * _MinEdgeLength;
+  mesh._MaxLength2    = (_MaxEdgeLength > 0. && !IsInf(_MaxEdgeLength) ? _MaxEdgeLength * _MaxEdgeLength : inf);
+  mesh._MinFeatureCos = (_MinFeatureAngle < 180. ? cos(_MinFeatureAngle * pi / 180.) : -2.);
+
+  _Valence.resize(npoints);
+  ComputeValence valence;
+  valence._Mesh    = &mesh;
+  valence._Valence = _Valence.data();
+  parallel_for(blocked_range<int>(0, npoints), valence);
+  mesh._Valence = _Valence.data();
+
+  // Each node proposes the collapse of its shortest edge to nodes with
+  // greater index, and the proposals first in order within the neighborhood
+  // of all nodes whose adjacent triangles they modify are selected
+  Array<EdgeKey> proposal(npoints), adjacent(npoints), nearby(npoints);
+  ProposeCollapses propose;
+  propose._Mesh     = &mesh;
+  propose._Proposal = proposal.data();
+  parallel_for(blocked_range<int>(0, npoints), propose);
+
+  FirstProposedCollapse first;
+  first._Mesh          = &mesh;
+  first._Input         = proposal.data();
+  first._Output        = adjacent.data();
+  first._AdjacentEdges = true;
+  parallel_for(blocked_range<int>(0, npoints), first);
+  first._Input         = adjacent.data();
+  first._Output        = nearby.data();
+  first._AdjacentEdges = false;
+  parallel_for(blocked_range<int>(0, npoints), first);
+
+  Array<char> selected(npoints);
+  SelectCollapses select;
+  select._Mesh     = &mesh;
+  select._Proposal = proposal.data();
+  select._First    = nearby.data();
+  select._Selected = selected.data();
+  parallel_for(blocked_range<int>(0, npoints), select);
+
+  Array<EdgeKey> edges;
+  for (int ptId = 0; ptId < npoints; ++ptId) {
+    if (selected[ptId]) edges.push_back(proposal[ptId]);
+  }
+  const int ncollapses = static_cast<int>(edges.size());
+
+  CollapseSelectedEdges collapse;
+  collapse._Mesh  = &mesh;
+  collapse._Edges = edges.data();
+  parallel_for(blocked_range<int>(0, ncollapses), collapse);
+
+  return ncollapses;
+}
+
+// -----------------------------------------------------------------------------
+int ParallelSurfaceRemeshing::SplitEdges()
+{
+  const int npoints = static_cast<int>(_Deleted.size());
+  const int ncells  = static_cast<int>(_Triangles.size() / 3);
+  BuildLinks();
+
+  Mesh mesh;
+  mesh._Points        = _Points.data();
+  mesh._Normals       = (_Normals.empty() ? nullptr : _Normals.data());
+  mesh._Fixed         = _Fixed.data();
+  mesh._Triangles     = _Triangles.data();
+  mesh._LinkOffsets   = _LinkOffsets.data();
+  mesh._Links         = _Links.data();
+  mesh._MaxLength2    = _MaxEdgeLength * _MaxEdgeLength;
+  mesh._MaxFeatureCos = (_MaxFeatureAngle < 180. ? cos(_MaxFeatureAngle * pi / 180.) : -2.);
+
+  // Each triangle proposes the split of its longest edge, and the proposals
+  // which are also first in the other triangle sharing the edge are selected
+  Array<EdgeKey> proposal(ncells);
+  ProposeSplits propose;
+  propose._Mesh     = &mesh;
+  propose._Proposal = proposal.data();
+  parallel_for(blocked_range<int>(0, ncells), propose);
+
+  Array<int> selected(ncells);
+  SelectSplits select;
+  select._Mesh     = &mesh;
+  select._Proposal = proposal.data();
+  select._Selected = selected.data();
+  parallel_for(blocked_range<int>(0, ncells), select);
+
+  // Assign indices of new nodes and triangles in order of the splits
+  Array<EdgeSplit> splits;
+  EdgeSplit split;
+  split._PtId  = npoints;
+  split._NewId = ncells;
+  for (int cellId = 0; cellId < ncells; ++cellId) {
+    if (selected[cellId] >= -1) {
+      split._CellId = cellId;
+      split._NbrId  = selected[cellId];
+      splits.push_back(split);
+      split._PtId  += 1;
+      split._NewId += (split._NbrId >= 0 ? 2 : 1);
+    }
+  }
+  const int nsplits = static_cast<int>(splits.size());
+  if (nsplits == 0) return 0;
+
+  _Points   .resize(3 * split._PtId);
+  _Fixed    .resize(split._PtId);
+  _Deleted  .resize(split._PtId);
+  _PointData.resize(static_cast<size_t>(_PointDataSize) * split._PtId);
+  if (!_Normals.empty()) _Normals.resize(3 * split._PtId);
+  _Triangles.resize(3 * split._NewId);
+  _CellData .resize(static_cast<size_t>(_CellDataSize) * split._NewId);
+
+  mesh._Points        = _Points.data();
+  mesh._Normals       = (_Normals.empty() ? nullptr : _Normals.data());
+  mesh._Fixed         = _Fixed.data();
+  mesh._Deleted       = _Deleted.data();
+  mesh._PointData     = _PointData.data();
+  mesh._PointDataSize = _PointDataSize;
+  mesh._Triangles     = _Triangles.data();
+  mesh._CellData      = _CellData.data();
+  mesh._CellDataSize  = _CellDataSize;
+
+  SplitSelectedEdges eval;
+  eval._Mesh     = &mesh;
+  eval._Splits   = splits.data();
+  eval._Proposal = proposal.data();
+  parallel_for(blocked_range<int>(0, nsplits), eval);
+
+  return nsplits;
+}
+
+// -----------------------------------------------------------------------------
+void ParallelSurfaceRemeshing::Finalize()
+{
+  if (_NumberOfCollapses == 0 && _NumberOfSplits == 0) {
+    _Output = _Input;
+    return;
+  }
+
+  const int npoints = static_cast<int>(_Deleted.size());
+  const int ncells  = static_cast<int>(_Triangles.size() / 3);
+
+  // Remaining nodes and triangles in order of their indices, where only this
+  // compaction is a serial scan and the mesh data is copied in parallel
+  Array<int> ptIds, cellIds, newPtId(npoints, -1);
+  ptIds.reserve(npoints);
+  for (int ptId = 0; ptId < npoints; ++ptId) {
+    if (!_Deleted[ptId]) {
+      newPtId[ptId] = static_cast<int>(ptIds.size());
+      ptIds.push_back(ptId);
+    }
+  }
+  cellIds.reserve(ncells);
+  for (int cellId = 0; cellId < ncells; ++cellId) {
+    if (_Triangles[3 * cellId] >= 0) cellIds.push_back(cellId);
+  }
+
+  const int nremaining_points = static_cast<int>(ptIds.size());
+  const int nremaining_cells  = static_cast<int>(cellIds.size());
+
+  vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
+  points->SetDataType(_Input->GetPoints()->GetDataType());
+  points->SetNumberOfPoints(nremaining_points);
+  CopyRemainingPoints copy_points;
+  copy_points._Points = _Points.data();
+  copy_points._PtIds  = ptIds.data();
+  copy_points._Output = points;
+  parallel_for(blocked_range<int>(0, nremaining_points), copy_points);
+
+  vtkSmartPointer<vtkIdTypeArray> cells = vtkSmartPointer<vtkIdTypeArray>::New();
+  cells->SetNumberOfTuples(4 * static_cast<vtkIdType>(nremaining_cells));
+  CopyRemainingTriangles copy_cells;
+  copy_cells._Triangles = _Triangles.data();
+  copy_cells._CellIds   = cellIds.data();
+  copy_cells._NewPtId   = newPtId.data();
+  copy_cells._Cells     = cells->GetPointer(0);
+  parallel_for(blocked_range<int>(0, nremaining_cells), copy_cells);
+  vtkSmartPointer<vtkCellArray> polys = vtkSmartPointer<vtkCellArray>::New();
+  polys->SetCells(nremaining_cells, cells);
+
+  _Output = vtkSmartPointer<vtkPolyData>::New();
+  _Output->SetPoints(points);
+  _Output->SetPolys(polys);
+  _Output->GetFieldData()->ShallowCopy(_Input->GetFieldData());
+  SetAttributes(_Input->GetPointData(), _PointData, _PointDataSize, ptIds,   _Output->GetPointData());
+  SetAttributes(_Input->GetCellData(),  _CellData,  _CellDataSize,  cellIds, _Output->GetCellData());
+  _Output->BuildLinks();
+}
+
+// -----------------------------------------------------------------------------
+void ParallelSurfaceRemeshing::Run()
+{
+  MIRTK_START_TIMING();
+  Initialize();
+
+  // Collapse short edges first such that these are not split
+  int n;
+  if (_MinEdgeLength > 0.) {
+    for (int round = 0; round < _MaxNumberOfRounds; ++round) {
+      n = CollapseEdges();
+      if (n == 0) break;
+      _NumberOfCollapses += n;
+      ++_NumberOfRounds;
+    }
+  }
+  if (_MaxEdgeLength > 0. && !IsInf(_MaxEdgeLength)) {
+    for (int round = 0; round < _MaxNumberOfRounds; ++round) {
+      n = SplitEdges();
+      if (n == 0) break;
+      _NumberOfSplits += n;
+      ++_NumberOfRounds;
+    }
+  }
+
+  Finalize();
+
+  _Points   .clear();
+  _Normals  .clear();
+  _Fixed    .clear();
+  _Deleted  .clear();
+  _PointData.clear();
+  _Triangles.clear();
+  _CellData .clear();
+  _Links    .clear();
+  _LinkOffsets.clear();
+  _Valence  .clear();
+
+  MIRTK_DEBUG_TIMING(3, "parallel surface remeshing (#collapses=" << _NumberOfCollapses
+                        << ", #splits=" << _NumberOfSplits << ", #rounds=" << _NumberOfRounds << ")");
+}
+
+
+} // namespace mirtk
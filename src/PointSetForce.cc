@@ -242,6 +242,7 @@ PointSetForce::PointSetForce(const char *name, double weight)
   _AverageSignedGradients(false),
   _AverageGradientMagnitude(false),
   _SurfaceForce(false),
+  _ActivePoints(nullptr),
   _Gradient(nullptr),
   _GradientSize(0),
   _Count(nullptr),
@@ -258,6 +259,7 @@ void PointSetForce::CopyAttributes(const PointSetForce &other)
   _AverageSignedGradients   = other._AverageSignedGradients;
   _AverageGradientMagnitude = other._AverageGradientMagnitude;
   _SurfaceForce             = other._SurfaceForce;
+  _ActivePoints             = other._ActivePoints;
   _InitialUpdate            = other._InitialUpdate;
   AllocateGradient(other._GradientSize);
   AllocateCount(other._CountSize);
@@ -502,6 +504,12 @@ void PointSetForce::Reinitialize()
   PointSetForce::Init();
 }
 
+// -----------------------------------------------------------------------------
+void PointSetForce::InitialValue(double value)
+{
+  _InitialValue = value;
+}
+
 // =============================================================================
 // Evaluation
 // =============================================================================
@@ -515,6 +523,11 @@ void PointSetForce::Update(bool)
   _InitialUpdate = false;
 }
 
+// -----------------------------------------------------------------------------
+void PointSetForce::PrepareConcurrentEvaluation() const
+{
+}
+
 // -----------------------------------------------------------------------------
 void PointSetForce::EvaluateGradient(double *gradient, double, double weight)
 {
@@ -21,8 +21,6 @@
 
 #include "mirtk/Array.h"
 #include "mirtk/Memory.h"
-#include "mirtk/Vector.h"
-#include "mirtk/Matrix.h"
 #include "mirtk/Parallel.h"
 #include "mirtk/Profiling.h"
 #include "mirtk/VtkMath.h"
@@ -47,6 +45,20 @@ namespace QuadraticCurvatureConstraintUtils {
 
 // -----------------------------------------------------------------------------
 /// Evaluate error of quadratic fit in normal direction
+///
+/// The distances h_i of the neighbors to the tangent plane are fit by the
+/// quadratic function h = a * r + b of the squared radial distances r_i
+/// to the central node, and the residual is the offset b of the fit. Instead
+/// of computing the pseudo-inverse of the N x 2 matrix [r_i, 1] by SVD, the
+/// offset is obtained from the closed-form solution of the normal equations,
+///
+///   b = sum_i c_i h_i, with c_i = 1/N - r_mean (r_i - r_mean) / S_rr,
+///
+/// where the sums are accumulated relative to the first r_i to reduce the
+/// loss of precision of S_rr = sum_i (r_i - r_mean)^2. When all r_i are equal,
+/// the matrix has rank one and its pseudo-inverse yields c_i = 1 / (N (r^2 + 1)).
+/// When the neighbors are weighted by the similarity of the external force
+/// magnitude, the weighted sum of c_i h_i is normalized by the sum of weights.
 struct ComputeErrorOfQuadraticFit
 {
   typedef RegisteredPointSet::NodeNeighbors NodeNeighbors;
@@ -63,40 +75,47 @@ struct ComputeErrorOfQuadraticFit
 
     int       numNbrPts;
     const int *nbrPtIds;
-    double     c[3], p[3], n[3], e[3], b, m, delta, w, wsum;
-
-    Vector h; // Distances of neighbors to tangent plane
-    Matrix r; // Squared radial distances of neighbors to central node
+    double     c[3], p[3], n[3], e[3], b, m, delta, w, wsum, h, r, r0, d;
+    double     sum_d, sum_dd, sum_wh, sum_wdh, N, d_mean, r_mean, s_rr;
 
     for (int ptId = ptIds.begin(); ptId != ptIds.end(); ++ptId) {
       b = 0.;
       _Neighbors->GetConnectedPoints(ptId, numNbrPts, nbrPtIds);
       if (numNbrPts > 0) {
-        _Points   ->GetPoint(ptId, c);
-        _Normals  ->GetTuple(ptId, n);
-        h.Initialize(numNbrPts);
-        r.Initialize(numNbrPts, 2);
+        _Points ->GetPoint(ptId, c);
+        _Normals->GetTuple(ptId, n);
+        m = (_ExternalMagnitude ? abs(_ExternalMagnitude->GetComponent(ptId, 0)) : 0.);
+        r0 = sum_d = sum_dd = sum_wh = sum_wdh = wsum = 0.;
         for (int i = 0; i < numNbrPts; ++i) {
           _Points->GetPoint(nbrPtIds[i], p);
           vtkMath::Subtract(p, c, e);
-          h(i)    = vtkMath::Dot(e, n);
-          r(i, 0) = vtkMath::Dot(e, e) - h(i) * h(i);
-          r(i, 1) = 1.;
-        }
-        r.PseudoInvert();
-        if (_ExternalMagnitude) {
-          wsum = 0.;
-          m = abs(_ExternalMagnitude->GetComponent(ptId, 0));
-          for (int i = 0; i < numNbrPts; ++i) {
+          h = vtkMath::Dot(e, n);
+          r = vtkMath::Dot(e, e) - h * h;
+          if (i == 0) r0 = r;
+          d = r - r0;
+          if (_ExternalMagnitude) {
             delta = (abs(_ExternalMagnitude->GetComponent(nbrPtIds[i], 0)) - m) / (m + 1e-6);
-            wsum += (w = exp(-.5 * delta * delta / delta_sigma2));
-            b += w * r(1, i) * h(i);
+            w = exp(-.5 * delta * delta / delta_sigma2);
+          } else {
+            w = 1.;
           }
-          if (wsum > 0.) b /= wsum;
+          sum_d   += d;
+          sum_dd  += d * d;
+          sum_wh  += w * h;
+          sum_wdh += w * d * h;
+          wsum    += w;
+        }
+        N      = static_cast<double>(numNbrPts);
+        d_mean = sum_d / N;
+        r_mean = r0 + d_mean;
+        s_rr   = sum_dd - d_mean * sum_d;
+        if (s_rr > 1e-12 * N * (r_mean * r_mean + 1.)) {
+          b = sum_wh / N - r_mean * (sum_wdh - d_mean * sum_wh) / s_rr;
         } else {
-          for (int i = 0; i < numNbrPts; ++i) {
-            b += r(1, i) * h(i);
-          }
+          b = sum_wh / (N * (r_mean * r_mean + 1.));
+        }
+        if (_ExternalMagnitude) {
+          if (wsum > 0.) b /= wsum;
         }
       }
       _Residuals->SetComponent(ptId, 0, b);
@@ -141,6 +160,7 @@ struct EvaluateGradient
   typedef QuadraticCurvatureConstraint::GradientType GradientType;
 
   vtkDataArray *_Status;
+  const int    *_PointIds;
   vtkDataArray *_Normals;
   vtkDataArray *_Residuals;
   GradientType *_Gradient;
@@ -148,7 +168,8 @@ struct EvaluateGradient
   void operator ()(const blocked_range<int> &ptIds) const
   {
     double b, n[3];
-    for (int ptId = ptIds.begin(); ptId != ptIds.end(); ++ptId) {
+    for (int idx = ptIds.begin(), ptId; idx != ptIds.end(); ++idx) {
+      ptId = (_PointIds ? _PointIds[idx] : idx);
       if (_Status && _Status->GetComponent(ptId, 0) == .0) continue;
       _Normals->GetTuple(ptId, n);
       b = _Residuals->GetComponent(ptId, 0);
@@ -229,6 +250,12 @@ void QuadraticCurvatureConstraint::Initialize()
   AddPointData("Residuals", 1, VTK_FLOAT);
 }
 
+// -----------------------------------------------------------------------------
+void QuadraticCurvatureConstraint::PrepareConcurrentEvaluation() const
+{
+  Neighbors();
+}
+
 // -----------------------------------------------------------------------------
 void QuadraticCurvatureConstraint::Update(bool gradient)
 {
@@ -272,10 +299,11 @@ void QuadraticCurvatureConstraint
 
   QuadraticCurvatureConstraintUtils::EvaluateGradient eval;
   eval._Status    = Status();
+  eval._PointIds  = ActivePointIds();
   eval._Normals   = Normals();
   eval._Residuals = PointData("Residuals");
   eval._Gradient  = _Gradient;
-  parallel_for(blocked_range<int>(0, _NumberOfPoints), eval);
+  parallel_for(blocked_range<int>(0, NumberOfActivePoints()), eval);
 
   SurfaceConstraint::EvaluateGradient(gradient, step, 2. * weight / _NumberOfPoints);
   MIRTK_DEBUG_TIMING(3, "evaluation of quadratic curvature force");
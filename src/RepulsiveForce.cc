@@ -24,9 +24,11 @@
 #include "mirtk/Vector3.h"
 #include "mirtk/Memory.h"
 #include "mirtk/Parallel.h"
+#include "mirtk/Profiling.h"
 #include "mirtk/PointSetUtils.h"
 
 #include "vtkSmartPointer.h"
+#include "vtkMath.h"
 #include "vtkIdList.h"
 #include "vtkPoints.h"
 #include "vtkPolyData.h"
@@ -35,6 +37,9 @@
 #include "vtkAbstractPointLocator.h"
 #include "vtkOctreePointLocator.h"
 
+#include <algorithm>
+#include <atomic>
+
 
 namespace mirtk {
 
@@ -68,16 +73,200 @@ inline double RepulsionDerivative(double d, double r)
   return 3. * (d * d) / (r * r);
 }
 
+// -----------------------------------------------------------------------------
+/// Compute index of grid cell containing each node
+struct ComputeGridCells
+{
+  vtkPoints                 *_Points;
+  RepulsiveForce::PointGrid *_Grid;
+
+  void operator ()(const blocked_range<int> &ptIds) const
+  {
+    int    i, j, k;
+    double p[3];
+    const double s = 1. / _Grid->_CellSize;
+    for (int ptId = ptIds.begin(); ptId != ptIds.end(); ++ptId) {
+      _Points->GetPoint(ptId, p);
+      i = static_cast<int>((p[0] - _Grid->_Origin[0]) * s);
+      j = static_cast<int>((p[1] - _Grid->_Origin[1]) * s);
+      k = static_cast<int>((p[2] - _Grid->_Origin[2]) * s);
+      i = max(0, min(i, _Grid->_Size[0] - 1));
+      j = max(0, min(j, _Grid->_Size[1] - 1));
+      k = max(0, min(k, _Grid->_Size[2] - 1));
+      _Grid->_CellIds[ptId] = i + _Grid->_Size[0] * (j + _Grid->_Size[1] * k);
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Count nodes in each grid cell
+struct CountGridPoints
+{
+  const int        *_CellIds;
+  std::atomic<int> *_Counts;
+
+  void operator ()(const blocked_range<int> &ptIds) const
+  {
+    for (int ptId = ptIds.begin(); ptId != ptIds.end(); ++ptId) {
+      _Counts[_CellIds[ptId]].fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Copy node indices to the next free position of their grid cell
+struct ScatterGridPoints
+{
+  const int        *_CellIds;
+  std::atomic<int> *_Next;
+  int              *_PointIds;
+
+  void operator ()(const blocked_range<int> &ptIds) const
+  {
+    for (int ptId = ptIds.begin(); ptId != ptIds.end(); ++ptId) {
+      _PointIds[_Next[_CellIds[ptId]].fetch_add(1, std::memory_order_relaxed)] = ptId;
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Sort node indices of each grid cell in ascending order
+struct SortGridPoints
+{
+  const int *_Offsets;
+  int       *_PointIds;
+
+  void operator ()(const blocked_range<int> &cellIds) const
+  {
+    for (int cellId = cellIds.begin(); cellId != cellIds.end(); ++cellId) {
+      std::sort(_PointIds + _Offsets[cellId], _PointIds + _Offsets[cellId + 1]);
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Sort nodes into uniform grid with given cell size
+///
+/// The cell index of each node is computed in parallel, followed by a counting
+/// sort of the node indices by cell index. The nodes are counted and scattered
+/// in parallel using atomic counters per cell instead of per-thread histograms,
+/// which would require memory proportional to the number of threads times the
+/// number of cells. Only the prefix sum over the cells is serial. The order
+/// in which concurrent threads scatter the nodes of a cell is arbitrary. The
+/// nodes of each cell are therefore sorted afterwards, such that they are
+/// stored in ascending order, independent of the number of threads.
+void BuildPointGrid(RepulsiveForce::PointGrid &grid, vtkPoints *points, double cell_size)
+{
+  const int npoints = static_cast<int>(points->GetNumberOfPoints());
+
+  double bounds[6];
+  points->GetBounds(bounds);
+
+  // Enlarge cells when the surface is large compared to the force radius
+  // such that the number of (mostly empty) cells is bounded by the number of nodes
+  double extent[3];
+  for (int d = 0; d < 3; ++d) {
+    extent[d] = bounds[2*d+1] - bounds[2*d];
+  }
+  const double max_cells = max(1., 8. * npoints);
+  grid._CellSize = max(cell_size, 1e-6);
+  while ((floor(extent[0] / grid._CellSize) + 1.) *
+         (floor(extent[1] / grid._CellSize) + 1.) *
+         (floor(extent[2] / grid._CellSize) + 1.) > max_cells) {
+    grid._CellSize *= 2.;
+  }
+  for (int d = 0; d < 3; ++d) {
+    grid._Origin[d] = bounds[2*d];
+    grid._Size  [d] = static_cast<int>(floor(extent[d] / grid._CellSize)) + 1;
+  }
+  const int ncells = grid._Size[0] * grid._Size[1] * grid._Size[2];
+
+  grid._CellIds.resize(npoints);
+  ComputeGridCells cells;
+  cells._Points = points;
+  cells._Grid   = &grid;
+  parallel_for(blocked_range<int>(0, npoints), cells);
+
+  UniquePtr<std::atomic<int>[]> counts(new std::atomic<int>[ncells]());
+  CountGridPoints count;
+  count._CellIds = grid._CellIds.data();
+  count._Counts  = counts.get();
+  parallel_for(blocked_range<int>(0, npoints), count);
+
+  // Offsets of cells, where the counters are reused as next free positions
+  grid._Offsets.resize(ncells + 1);
+  grid._Offsets[0] = 0;
+  for (int cellId = 0; cellId < ncells; ++cellId) {
+    grid._Offsets[cellId + 1] = grid._Offsets[cellId] + counts[cellId].load(std::memory_order_relaxed);
+    counts[cellId].store(grid._Offsets[cellId], std::memory_order_relaxed);
+  }
+
+  grid._PointIds.resize(npoints);
+  ScatterGridPoints scatter;
+  scatter._CellIds  = grid._CellIds.data();
+  scatter._Next     = counts.get();
+  scatter._PointIds = grid._PointIds.data();
+  parallel_for(blocked_range<int>(0, npoints), scatter);
+
+  SortGridPoints sort;
+  sort._Offsets  = grid._Offsets.data();
+  sort._PointIds = grid._PointIds.data();
+  parallel_for(blocked_range<int>(0, ncells), sort);
+}
+
+// -----------------------------------------------------------------------------
+/// Find nodes within given radius using uniform grid with cell size >= radius
+void FindPointsWithinRadius(const RepulsiveForce::PointGrid &grid, vtkPoints *points,
+                            double r, const double p[3], vtkIdList *ids)
+{
+  double q[3];
+  int    cell[3], lo[3], hi[3], cellId, end;
+
+  const double s  = 1. / grid._CellSize;
+  const double r2 = r * r;
+
+  for (int d = 0; d < 3; ++d) {
+    cell[d] = static_cast<int>(floor((p[d] - grid._Origin[d]) * s));
+    lo  [d] = max(0, cell[d] - 1);
+    hi  [d] = min(grid._Size[d] - 1, cell[d] + 1);
+  }
+  ids->Reset();
+  for (int k = lo[2]; k <= hi[2]; ++k)
+  for (int j = lo[1]; j <= hi[1]; ++j)
+  for (int i = lo[0]; i <= hi[0]; ++i) {
+    cellId = i + grid._Size[0] * (j + grid._Size[1] * k);
+    end    = grid._Offsets[cellId + 1];
+    for (int n = grid._Offsets[cellId]; n < end; ++n) {
+      points->GetPoint(grid._PointIds[n], q);
+      if (vtkMath::Distance2BetweenPoints(p, q) <= r2) {
+        ids->InsertNextId(grid._PointIds[n]);
+      }
+    }
+  }
+}
+
+// -----------------------------------------------------------------------------
+/// Find nodes within given radius using either point locator or uniform grid
+inline void FindPointsWithinRadius(vtkAbstractPointLocator         *locator,
+                                   const RepulsiveForce::PointGrid *grid,
+                                   vtkPoints *points, double r, const double p[3],
+                                   vtkIdList *ids)
+{
+  if (locator) locator->FindPointsWithinRadius(r, p, ids);
+  else         FindPointsWithinRadius(*grid, points, r, p, ids);
+}
+
 // -----------------------------------------------------------------------------
 /// Evaluate energy of repulsive force term
 struct Evaluate
 {
-  vtkPoints               *_Points;
-  vtkDataArray            *_Normals;
-  vtkAbstractPointLocator *_Locator;
-  double                   _FrontfaceDistance;
-  double                   _BackfaceDistance;
-  double                   _Penalty;
+  vtkPoints                       *_Points;
+  vtkDataArray                    *_Normals;
+  vtkAbstractPointLocator         *_Locator;
+  const RepulsiveForce::PointGrid *_Grid;
+  double                           _FrontfaceDistance;
+  double                           _BackfaceDistance;
+  double                           _Penalty;
 
   Evaluate() : _Penalty(0.) {}
 
@@ -86,6 +275,7 @@ struct Evaluate
     _Points(other._Points),
     _Normals(other._Normals),
     _Locator(other._Locator),
+    _Grid(other._Grid),
     _FrontfaceDistance(other._FrontfaceDistance),
     _BackfaceDistance(other._BackfaceDistance),
     _Penalty(0.)
@@ -109,7 +299,7 @@ struct Evaluate
     for (int ptId = ptIds.begin(), id; ptId != ptIds.end(); ++ptId) {
       _Points ->GetPoint(ptId, p);
       _Normals->GetTuple(ptId, np);
-      _Locator->FindPointsWithinRadius(r, p, ids);
+      FindPointsWithinRadius(_Locator, _Grid, _Points, r, p, ids);
       if (ids->GetNumberOfIds() > 0) {
         penalty = 0., num = 0;
         for (vtkIdType i = 0; i < ids->GetNumberOfIds(); ++i) {
@@ -143,15 +333,17 @@ struct EvaluateGradient
 {
   typedef RepulsiveForce::GradientType GradientType;
 
-  vtkPoints               *_Points;
-  vtkDataArray            *_Status;
-  vtkDataArray            *_Normals;
-  vtkAbstractPointLocator *_Locator;
-  double                   _FrontfaceDistance;
-  double                   _BackfaceDistance;
-  GradientType            *_Gradient;
-  vtkDataArray            *_Magnitude;
-  double                   _Weight;
+  vtkPoints                       *_Points;
+  vtkDataArray                    *_Status;
+  const int                       *_PointIds;
+  vtkDataArray                    *_Normals;
+  vtkAbstractPointLocator         *_Locator;
+  const RepulsiveForce::PointGrid *_Grid;
+  double                           _FrontfaceDistance;
+  double                           _BackfaceDistance;
+  GradientType                    *_Gradient;
+  vtkDataArray                    *_Magnitude;
+  double                           _Weight;
 
   void operator ()(const blocked_range<int> &ptIds) const
   {
@@ -163,11 +355,12 @@ struct EvaluateGradient
     const double r = max(_FrontfaceDistance, _BackfaceDistance);
 
     vtkSmartPointer<vtkIdList> ids = vtkSmartPointer<vtkIdList>::New();
-    for (int ptId = ptIds.begin(), id; ptId != ptIds.end(); ++ptId) {
+    for (int idx = ptIds.begin(), ptId, id; idx != ptIds.end(); ++idx) {
+      ptId = (_PointIds ? _PointIds[idx] : idx);
       if (_Status && _Status->GetComponent(ptId, 0) == .0) continue;
       _Points ->GetPoint(ptId, p);
       _Normals->GetTuple(ptId, np);
-      _Locator->FindPointsWithinRadius(r, p, ids);
+      FindPointsWithinRadius(_Locator, _Grid, _Points, r, p, ids);
       if (ids->GetNumberOfIds() > 0) {
         gradient = 0., num = 0, mag = 0.;
         for (vtkIdType i = 0; i < ids->GetNumberOfIds(); ++i) {
@@ -205,6 +398,38 @@ struct EvaluateGradient
 
 } // namespace RepulsiveForceUtils
 
+// =============================================================================
+// Enum <-> string conversion
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+template <>
+bool FromString(const char *str, enum RepulsiveForce::NeighborSearchMethod &value)
+{
+  const string lstr = ToLower(str);
+  if (lstr == "octree") {
+    value = RepulsiveForce::OctreeSearch;
+  } else if (lstr == "grid" || lstr == "uniform grid") {
+    value = RepulsiveForce::GridSearch;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+// -----------------------------------------------------------------------------
+template <>
+string ToString(const enum RepulsiveForce::NeighborSearchMethod &value, int w, char c, bool left)
+{
+  const char *str;
+  switch (value) {
+    case RepulsiveForce::OctreeSearch: str = "Octree"; break;
+    case RepulsiveForce::GridSearch:   str = "Grid";   break;
+    default:                           str = "Unknown"; break;
+  }
+  return ToString(str, w, c, left);
+}
+
 // =============================================================================
 // Construction/Destruction
 // =============================================================================
@@ -214,7 +439,8 @@ RepulsiveForce::RepulsiveForce(const char *name, double weight)
 :
   SurfaceConstraint(name, weight),
   _FrontfaceRadius(-1.),
-  _BackfaceRadius(-1.)
+  _BackfaceRadius(-1.),
+  _NeighborSearch(OctreeSearch)
 {
   _ParameterPrefix.push_back("Repulsive force ");
   _ParameterPrefix.push_back("Node repulsion ");
@@ -225,6 +451,8 @@ void RepulsiveForce::CopyAttributes(const RepulsiveForce &other)
 {
   _FrontfaceRadius = other._FrontfaceRadius;
   _BackfaceRadius  = other._BackfaceRadius;
+  _NeighborSearch  = other._NeighborSearch;
+  _Grid            = other._Grid;
 
   if (other._Locator) _Locator.TakeReference(other._Locator->NewInstance());
   else                _Locator = nullptr;
@@ -270,7 +498,11 @@ void RepulsiveForce::Initialize()
     }
   }
 
-  _Locator = vtkSmartPointer<vtkOctreePointLocator>::New();
+  if (_NeighborSearch == OctreeSearch) {
+    _Locator = vtkSmartPointer<vtkOctreePointLocator>::New();
+  } else {
+    _Locator = nullptr;
+  }
 
   if (debug) AddPointData("Magnitude")->FillComponent(0, 0.);
 }
@@ -281,6 +513,7 @@ void RepulsiveForce::Reinitialize()
   if (_FrontfaceRadius == .0 && _BackfaceRadius == 0.) {
     _NumberOfPoints = 0;
     _Locator        = nullptr;
+    _Grid           = PointGrid();
   } else {
     SurfaceConstraint::Reinitialize();
   }
@@ -305,6 +538,9 @@ bool RepulsiveForce::SetWithoutPrefix(const char *name, const char *value)
   if (strcmp(name, "Backface radius") == 0) {
     return FromString(value, _BackfaceRadius);
   }
+  if (strcmp(name, "Neighbor search") == 0) {
+    return FromString(value, _NeighborSearch);
+  }
   return PointSetForce::SetWithoutPrefix(name, value);
 }
 
@@ -318,6 +554,7 @@ ParameterList RepulsiveForce::Parameter() const
     InsertWithPrefix(params, "Frontface radius", _FrontfaceRadius);
     InsertWithPrefix(params, "Backface radius",  _BackfaceRadius);
   }
+  InsertWithPrefix(params, "Neighbor search", _NeighborSearch);
   return params;
 }
 
@@ -333,14 +570,22 @@ void RepulsiveForce::Update(bool gradient)
   // Update base class
   SurfaceConstraint::Update(gradient);
 
-  // Make shallow copy without data arrays such that modified time of data set
-  // does not depend on unused attributes that may be modified by other terms
-  vtkSmartPointer<vtkPolyData> surface = vtkSmartPointer<vtkPolyData>::New();
-  surface->ShallowCopy(DeformedSurface());
-  surface->GetPointData()->Initialize();
-  surface->GetCellData ()->Initialize();
-  _Locator->SetDataSet(surface);
-  _Locator->BuildLocator();
+  MIRTK_START_TIMING();
+  if (_Locator) {
+    // Make shallow copy without data arrays such that modified time of data set
+    // does not depend on unused attributes that may be modified by other terms
+    vtkSmartPointer<vtkPolyData> surface = vtkSmartPointer<vtkPolyData>::New();
+    surface->ShallowCopy(DeformedSurface());
+    surface->GetPointData()->Initialize();
+    surface->GetCellData ()->Initialize();
+    _Locator->SetDataSet(surface);
+    _Locator->BuildLocator();
+    MIRTK_DEBUG_TIMING(5, "update of repulsive force octree");
+  } else {
+    const double r = max(_FrontfaceRadius, _BackfaceRadius);
+    RepulsiveForceUtils::BuildPointGrid(_Grid, Points(), r);
+    MIRTK_DEBUG_TIMING(5, "update of repulsive force uniform grid");
+  }
 }
 
 // -----------------------------------------------------------------------------
@@ -352,6 +597,7 @@ double RepulsiveForce::Evaluate()
   eval._Points            = Points();
   eval._Normals           = Normals();
   eval._Locator           = _Locator;
+  eval._Grid              = &_Grid;
   eval._FrontfaceDistance = _FrontfaceRadius;
   eval._BackfaceDistance  = _BackfaceRadius;
   parallel_reduce(blocked_range<int>(0, _NumberOfPoints), eval);
@@ -369,14 +615,16 @@ void RepulsiveForce::EvaluateGradient(double *gradient, double step, double weig
   RepulsiveForceUtils::EvaluateGradient eval;
   eval._Points            = Points();
   eval._Status            = Status();
+  eval._PointIds          = ActivePointIds();
   eval._Normals           = Normals();
   eval._Locator           = _Locator;
+  eval._Grid              = &_Grid;
   eval._FrontfaceDistance = _FrontfaceRadius;
   eval._BackfaceDistance  = _BackfaceRadius;
   eval._Gradient          = _Gradient;
   eval._Magnitude         = PointData("Magnitude", true);
   eval._Weight            = weight;
-  parallel_for(blocked_range<int>(0, _NumberOfPoints), eval);
+  parallel_for(blocked_range<int>(0, NumberOfActivePoints()), eval);
 
   SurfaceConstraint::EvaluateGradient(gradient, step, weight / _NumberOfPoints);
 }
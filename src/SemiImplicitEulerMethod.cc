@@ -0,0 +1,417 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright 2013-2017 Imperial College London
+ * Copyright 2013-2017 Andreas Schuh
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "mirtk/SemiImplicitEulerMethod.h"
+
+#include "mirtk/Math.h"
+#include "mirtk/Array.h"
+#include "mirtk/Parallel.h"
+#include "mirtk/Profiling.h"
+#include "mirtk/EdgeTable.h"
+#include "mirtk/DeformableSurfaceModel.h"
+#include "mirtk/PointSetUtils.h"
+
+#include "vtkDataArray.h"
+
+
+namespace mirtk {
+
+
+// =============================================================================
+// Auxiliary functors
+// =============================================================================
+
+namespace SemiImplicitEulerMethodUtils {
+
+
+// -----------------------------------------------------------------------------
+/// Multiply node vectors by the matrix \f$I + \lambda L\f$
+///
+/// The rows and columns of passive nodes are those of the identity matrix,
+/// such that the matrix remains symmetric positive definite.
+struct MultiplyMatrix
+{
+  const EdgeTable *_EdgeTable;
+  const char      *_Passive;
+  const double    *_Diagonal;
+  double           _Lambda;
+  const double    *_Input;
+  double          *_Output;
+
+  void operator ()(const blocked_range<int> &ptIds) const
+  {
+    const int *adjPtIds;
+    int        numAdjPts;
+    double     s[3];
+
+    for (int ptId = ptIds.begin(); ptId != ptIds.end(); ++ptId) {
+      const double *x = _Input  + 3 * ptId;
+      double       *y = _Output + 3 * ptId;
+      if (_Passive[ptId]) {
+        y[0] = x[0], y[1] = x[1], y[2] = x[2];
+        continue;
+      }
+      s[0] = s[1] = s[2] = 0.;
+      _EdgeTable->GetAdjacentPoints(ptId, numAdjPts, adjPtIds);
+      for (int i = 0; i < numAdjPts; ++i) {
+        if (_Passive[adjPtIds[i]]) continue;
+        const double *v = _Input + 3 * adjPtIds[i];
+        s[0] += v[0], s[1] += v[1], s[2] += v[2];
+      }
+      y[0] = _Diagonal[ptId] * x[0] - _Lambda * s[0];
+      y[1] = _Diagonal[ptId] * x[1] - _Lambda * s[1];
+      y[2] = _Diagonal[ptId] * x[2] - _Lambda * s[2];
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Initialize diagonal of the system matrix and zero displacements of passive nodes
+struct InitializeSystem
+{
+  const EdgeTable *_EdgeTable;
+  vtkDataArray    *_Status;
+  double           _Lambda;
+  char            *_Passive;
+  double          *_Diagonal;
+  double          *_Displacement;
+
+  void operator ()(const blocked_range<int> &ptIds) const
+  {
+    for (int ptId = ptIds.begin(); ptId != ptIds.end(); ++ptId) {
+      if (_Status && _Status->GetComponent(ptId, 0) == 0.) {
+        _Passive [ptId] = 1;
+        _Diagonal[ptId] = 1.;
+        double *d = _Displacement + 3 * ptId;
+        d[0] = d[1] = d[2] = 0.;
+      } else {
+        _Passive [ptId] = 0;
+        _Diagonal[ptId] = 1. + _Lambda * _EdgeTable->NumberOfAdjacentPoints(ptId);
+      }
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Initialize residual, preconditioned residual, and search direction
+struct InitializeResidual
+{
+  const double *_Diagonal;
+  const double *_RightHandSide;
+  const double *_MatrixTimesSolution;
+  double       *_Residual;
+  double       *_Preconditioned;
+  double       *_Direction;
+
+  void operator ()(const blocked_range<int> &ptIds) const
+  {
+    for (int ptId = ptIds.begin(); ptId != ptIds.end(); ++ptId) {
+      for (int j = 3 * ptId; j < 3 * ptId + 3; ++j) {
+        _Residual[j]       = _RightHandSide[j] - _MatrixTimesSolution[j];
+        _Preconditioned[j] = _Residual[j] / _Diagonal[ptId];
+        _Direction[j]      = _Preconditioned[j];
+      }
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Compute dot products of the x, y, and z components of two node vectors
+class DotProduct
+{
+  const double *_A;
+  const double *_B;
+
+public:
+
+  double _Sum[3];
+
+  DotProduct(const double *a, const double *b)
+  :
+    _A(a), _B(b)
+  {
+    _Sum[0] = _Sum[1] = _Sum[2] = 0.;
+  }
+
+  DotProduct(const DotProduct &other, split)
+  :
+    _A(other._A), _B(other._B)
+  {
+    _Sum[0] = _Sum[1] = _Sum[2] = 0.;
+  }
+
+  void join(const DotProduct &other)
+  {
+    _Sum[0] += other._Sum[0];
+    _Sum[1] += other._Sum[1];
+    _Sum[2] += other._Sum[2];
+  }
+
+  void operator ()(const blocked_range<int> &ptIds)
+  {
+    const double *a = _A + 3 * ptIds.begin();
+    const double *b = _B + 3 * ptIds.begin();
+    for (int ptId = ptIds.begin(); ptId != ptIds.end(); ++ptId, a += 3, b += 3) {
+      _Sum[0] += a[0] * b[0];
+      _Sum[1] += a[1] * b[1];
+      _Sum[2] += a[2] * b[2];
+    }
+  }
+
+  static void Run(int n, const double *a, const double *b, double sum[3])
+  {
+    DotProduct eval(a, b);
+    parallel_reduce(blocked_range<int>(0, n), eval);
+    sum[0] = eval._Sum[0];
+    sum[1] = eval._Sum[1];
+    sum[2] = eval._Sum[2];
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Update solution and residual, and apply Jacobi preconditioner to residual
+struct UpdateSolution
+{
+  const double *_Diagonal;
+  const double *_Direction;
+  const double *_MatrixTimesDirection;
+  double       *_Solution;
+  double       *_Residual;
+  double       *_Preconditioned;
+  double        _Alpha[3];
+
+  void operator ()(const blocked_range<int> &ptIds) const
+  {
+    for (int ptId = ptIds.begin(); ptId != ptIds.end(); ++ptId) {
+      for (int j = 3 * ptId; j < 3 * ptId + 3; ++j) {
+        _Solution[j] += _Alpha[j % 3] * _Direction[j];
+        _Residual[j] -= _Alpha[j % 3] * _MatrixTimesDirection[j];
+        _Preconditioned[j] = _Residual[j] / _Diagonal[ptId];
+      }
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Update conjugate search direction
+struct UpdateDirection
+{
+  const double *_Preconditioned;
+  double       *_Direction;
+  double        _Beta[3];
+
+  void operator ()(const blocked_range<int> &ptIds) const
+  {
+    for (int j = 3 * ptIds.begin(); j < 3 * ptIds.end(); ++j) {
+      _Direction[j] = _Preconditioned[j] + _Beta[j % 3] * _Direction[j];
+    }
+  }
+};
+
+
+} // namespace SemiImplicitEulerMethodUtils
+using namespace SemiImplicitEulerMethodUtils;
+
+// =============================================================================
+// Construction/Destruction
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+SemiImplicitEulerMethod::SemiImplicitEulerMethod(ObjectiveFunction *f)
+:
+  EulerMethod(f),
+  _ImplicitSmoothing(1.0),
+  _MaximumNumberOfCGIterations(50),
+  _CGTolerance(1e-3),
+  _LastNumberOfCGIterations(0)
+{
+}
+
+// -----------------------------------------------------------------------------
+void SemiImplicitEulerMethod::CopyAttributes(const SemiImplicitEulerMethod &other)
+{
+  _ImplicitSmoothing           = other._ImplicitSmoothing;
+  _MaximumNumberOfCGIterations = other._MaximumNumberOfCGIterations;
+  _CGTolerance                 = other._CGTolerance;
+  _LastNumberOfCGIterations    = other._LastNumberOfCGIterations;
+}
+
+// -----------------------------------------------------------------------------
+SemiImplicitEulerMethod::SemiImplicitEulerMethod(const SemiImplicitEulerMethod &other)
+:
+  EulerMethod(other)
+{
+  CopyAttributes(other);
+}
+
+// -----------------------------------------------------------------------------
+SemiImplicitEulerMethod &SemiImplicitEulerMethod::operator =(const SemiImplicitEulerMethod &other)
+{
+  if (this != &other) {
+    EulerMethod::operator =(other);
+    CopyAttributes(other);
+  }
+  return *this;
+}
+
+// -----------------------------------------------------------------------------
+SemiImplicitEulerMethod::~SemiImplicitEulerMethod()
+{
+}
+
+// =============================================================================
+// Parameters
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+bool SemiImplicitEulerMethod::Set(const char *name, const char *value)
+{
+  if (strcmp(name, "Implicit smoothing") == 0 ||
+      strcmp(name, "Implicit smoothing weight") == 0) {
+    return FromString(value, _ImplicitSmoothing) && _ImplicitSmoothing >= 0.;
+  }
+  if (strcmp(name, "Maximum no. of CG iterations") == 0) {
+    return FromString(value, _MaximumNumberOfCGIterations);
+  }
+  if (strcmp(name, "CG tolerance") == 0) {
+    return FromString(value, _CGTolerance);
+  }
+  return EulerMethod::Set(name, value);
+}
+
+// -----------------------------------------------------------------------------
+ParameterList SemiImplicitEulerMethod::Parameter() const
+{
+  ParameterList params = EulerMethod::Parameter();
+  Insert(params, "Implicit smoothing",           _ImplicitSmoothing);
+  Insert(params, "Maximum no. of CG iterations", _MaximumNumberOfCGIterations);
+  Insert(params, "CG tolerance",                 _CGTolerance);
+  return params;
+}
+
+// =============================================================================
+// Execution
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+void SemiImplicitEulerMethod::UpdateDisplacement()
+{
+  EulerMethod::UpdateDisplacement();
+  _LastNumberOfCGIterations = 0;
+  if (_ImplicitSmoothing > 0. && _MaximumNumberOfCGIterations > 0 &&
+      IsSurfaceMesh(_Model->Output())) {
+    MIRTK_START_TIMING();
+    _LastNumberOfCGIterations = this->PreconditionDisplacement();
+    MIRTK_DEBUG_TIMING(3, "smoothing of displacements"
+                          " (" << _LastNumberOfCGIterations << " CG iterations)");
+  }
+}
+
+// -----------------------------------------------------------------------------
+int SemiImplicitEulerMethod::PreconditionDisplacement()
+{
+  const int        npoints   = _Model->NumberOfPoints();
+  const EdgeTable *edgeTable = _Model->PointSet().SurfaceEdges();
+  double          *dx        = static_cast<double *>(_Displacement->GetVoidPointer(0));
+  const blocked_range<int> ptIds(0, npoints);
+
+  // Resize workspace, which keeps its capacity across steps and remeshing
+  _Passive             .resize(npoints);
+  _Diagonal            .resize(npoints);
+  _Residual            .resize(3 * npoints);
+  _Preconditioned      .resize(3 * npoints);
+  _Direction           .resize(3 * npoints);
+  _MatrixTimesDirection.resize(3 * npoints);
+
+  // Diagonal of the system matrix, which is also the Jacobi preconditioner
+  InitializeSystem init;
+  init._EdgeTable    = edgeTable;
+  init._Status       = _Model->PointSet().SurfaceStatus();
+  init._Lambda       = _ImplicitSmoothing;
+  init._Passive      = _Passive.data();
+  init._Diagonal     = _Diagonal.data();
+  init._Displacement = dx;
+  parallel_for(ptIds, init);
+
+  MultiplyMatrix A;
+  A._EdgeTable = edgeTable;
+  A._Passive   = _Passive.data();
+  A._Diagonal  = _Diagonal.data();
+  A._Lambda    = _ImplicitSmoothing;
+
+  // Explicit displacements are both right-hand side and initial guess, where
+  // the right-hand side is only needed for the initial residual and its norm
+  double b2[3], r2[3], rz[3], pq[3], rz_next[3];
+  DotProduct::Run(npoints, dx, dx, b2);
+
+  A._Input  = dx;
+  A._Output = _MatrixTimesDirection.data();
+  parallel_for(ptIds, A);
+
+  InitializeResidual residual;
+  residual._Diagonal            = _Diagonal.data();
+  residual._RightHandSide       = dx;
+  residual._MatrixTimesSolution = _MatrixTimesDirection.data();
+  residual._Residual            = _Residual.data();
+  residual._Preconditioned      = _Preconditioned.data();
+  residual._Direction           = _Direction.data();
+  parallel_for(ptIds, residual);
+
+  DotProduct::Run(npoints, _Residual.data(), _Preconditioned.data(), rz);
+
+  const double tol2 = _CGTolerance * _CGTolerance;
+
+  UpdateSolution update;
+  update._Diagonal             = _Diagonal.data();
+  update._Direction            = _Direction.data();
+  update._MatrixTimesDirection = _MatrixTimesDirection.data();
+  update._Solution             = dx;
+  update._Residual             = _Residual.data();
+  update._Preconditioned       = _Preconditioned.data();
+
+  UpdateDirection next;
+  next._Preconditioned = _Preconditioned.data();
+  next._Direction      = _Direction.data();
+
+  A._Input  = _Direction.data();
+  A._Output = _MatrixTimesDirection.data();
+
+  int iter = 0;
+  while (iter < _MaximumNumberOfCGIterations) {
+    DotProduct::Run(npoints, _Residual.data(), _Residual.data(), r2);
+    if (r2[0] <= tol2 * b2[0] && r2[1] <= tol2 * b2[1] && r2[2] <= tol2 * b2[2]) break;
+    parallel_for(ptIds, A);
+    DotProduct::Run(npoints, _Direction.data(), _MatrixTimesDirection.data(), pq);
+    for (int j = 0; j < 3; ++j) {
+      update._Alpha[j] = (pq[j] > 0. ? rz[j] / pq[j] : 0.);
+    }
+    parallel_for(ptIds, update);
+    DotProduct::Run(npoints, _Residual.data(), _Preconditioned.data(), rz_next);
+    for (int j = 0; j < 3; ++j) {
+      next._Beta[j] = (rz[j] > 0. ? rz_next[j] / rz[j] : 0.);
+      rz[j] = rz_next[j];
+    }
+    parallel_for(ptIds, next);
+    ++iter;
+  }
+  return iter;
+}
+
+
+} // namespace mirtk
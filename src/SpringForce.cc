@@ -169,6 +169,7 @@ struct EvaluateGradient
 
   vtkPoints       *_Points;
   vtkDataArray    *_Status;
+  const int       *_PointIds;
   const EdgeTable *_EdgeTable;
   GradientType    *_Gradient;
 
@@ -177,10 +178,12 @@ struct EvaluateGradient
     int        numAdjPts;
     const int *adjPtIds;
     double     p[3], c[3];
+    GradientType *g;
 
-    GradientType *g = _Gradient + ptIds.begin();
-    for (int ptId = ptIds.begin(); ptId != ptIds.end(); ++ptId, ++g) {
+    for (int idx = ptIds.begin(), ptId; idx != ptIds.end(); ++idx) {
+      ptId = (_PointIds ? _PointIds[idx] : idx);
       if (_Status && _Status->GetComponent(ptId, 0) == .0) continue;
+      g = _Gradient + ptId;
       _EdgeTable->GetAdjacentPoints(ptId, numAdjPts, adjPtIds);
       if (numAdjPts > 0) {
         _Points->GetPoint(ptId, c);
@@ -347,9 +350,10 @@ void SpringForce::EvaluateGradient(double *gradient, double step, double weight)
   SpringForceUtils::EvaluateGradient eval;
   eval._Points    = Points();
   eval._Status    = Status();
+  eval._PointIds  = ActivePointIds();
   eval._EdgeTable = Edges();
   eval._Gradient  = _Gradient;
-  parallel_for(blocked_range<int>(0, _NumberOfPoints), eval);
+  parallel_for(blocked_range<int>(0, NumberOfActivePoints()), eval);
 
   if (fequal(_InwardNormalWeight,  _TangentialWeight) &&
       fequal(_OutwardNormalWeight, _TangentialWeight)) {
@@ -103,6 +103,7 @@ struct EvaluateGradient
 
   vtkPoints       *_Points;
   vtkDataArray    *_Status;
+  const int       *_PointIds;
   const EdgeTable *_EdgeTable;
   double           _RestLength;
   Force           *_Gradient;
@@ -113,7 +114,8 @@ struct EvaluateGradient
     const int *adjPts;
     int        numAdjPts;
 
-    for (vtkIdType ptId = re.begin(); ptId != re.end(); ++ptId) {
+    for (int idx = re.begin(), ptId; idx != re.end(); ++idx) {
+      ptId = (_PointIds ? _PointIds[idx] : idx);
       if (_Status && _Status->GetComponent(ptId, 0) == .0) continue;
       _Points->GetPoint(ptId, p1);
       _EdgeTable->GetAdjacentPoints(ptId, numAdjPts, adjPts);
@@ -292,10 +294,11 @@ void StretchingForce::EvaluateGradient(double *gradient, double step, double wei
   StretchingForceUtils::EvaluateGradient eval;
   eval._Points     = _PointSet->Points();
   eval._Status     = _PointSet->Status();
+  eval._PointIds   = ActivePointIds();
   eval._EdgeTable  = _PointSet->Edges();
   eval._RestLength = _AverageLength;
   eval._Gradient   = _Gradient;
-  parallel_for(blocked_range<int>(0, _NumberOfPoints), eval);
+  parallel_for(blocked_range<int>(0, NumberOfActivePoints()), eval);
 
   for (int i = 0; i < _NumberOfPoints; ++i) {
     if (_PointSet->Edges()->NumberOfAdjacentPoints(i) > 0) {
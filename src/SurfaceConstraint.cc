@@ -27,10 +27,18 @@ namespace mirtk {
 // Construction/Destruction
 // =============================================================================
 
+// -----------------------------------------------------------------------------
+void SurfaceConstraint::CopyAttributes(const SurfaceConstraint &other)
+{
+  _SharedCurvatureCache = other._SharedCurvatureCache;
+  _LocalCurvatureCache  = other._LocalCurvatureCache;
+}
+
 // -----------------------------------------------------------------------------
 SurfaceConstraint::SurfaceConstraint(const char *name, double weight)
 :
-  InternalForce(name, weight)
+  InternalForce(name, weight),
+  _SharedCurvatureCache(nullptr)
 {
   _SurfaceForce = true;
 }
@@ -40,12 +48,16 @@ SurfaceConstraint::SurfaceConstraint(const SurfaceConstraint &other)
 :
   InternalForce(other)
 {
+  CopyAttributes(other);
 }
 
 // -----------------------------------------------------------------------------
 SurfaceConstraint &SurfaceConstraint::operator =(const SurfaceConstraint &other)
 {
-  InternalForce::operator =(other);
+  if (this != &other) {
+    InternalForce::operator =(other);
+    CopyAttributes(other);
+  }
   return *this;
 }
 
@@ -54,5 +66,11 @@ SurfaceConstraint::~SurfaceConstraint()
 {
 }
 
+// -----------------------------------------------------------------------------
+SurfaceCurvatureCache &SurfaceConstraint::CurvatureCache()
+{
+  return (_SharedCurvatureCache ? *_SharedCurvatureCache : _LocalCurvatureCache);
+}
+
 
 } // namespace mirtk
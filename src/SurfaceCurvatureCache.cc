@@ -0,0 +1,253 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright 2013-2017 Imperial College London
+ * Copyright 2013-2017 Andreas Schuh
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "mirtk/SurfaceCurvatureCache.h"
+
+#include "mirtk/Parallel.h"
+#include "mirtk/Profiling.h"
+#include "mirtk/MeshSmoothing.h"
+#include "mirtk/SurfaceCurvature.h"
+
+
+namespace mirtk {
+
+
+// =============================================================================
+// Auxiliaries
+// =============================================================================
+
+namespace SurfaceCurvatureCacheUtils {
+
+
+// -----------------------------------------------------------------------------
+/// Curvature types which are cached and names of their point data arrays
+const int   NumberOfCachedTypes = 4;
+const int   CachedTypes[NumberOfCachedTypes] = {
+  SurfaceCurvature::Mean,
+  SurfaceCurvature::Gauss,
+  SurfaceCurvature::Maximum,
+  SurfaceCurvature::Minimum
+};
+const char *CachedNames[NumberOfCachedTypes] = {
+  SurfaceCurvature::MEAN,
+  SurfaceCurvature::GAUSS,
+  SurfaceCurvature::MAXIMUM,
+  SurfaceCurvature::MINIMUM
+};
+
+// -----------------------------------------------------------------------------
+/// Compute centroids of adjacent nodes
+struct ComputeCentroids
+{
+  vtkPoints       *_Points;
+  const EdgeTable *_EdgeTable;
+  vtkPoints       *_Centroids;
+
+  void operator ()(const blocked_range<int> &re) const
+  {
+    double     c[3], p[3];
+    const int *adjPtIds;
+    int        numAdjPts;
+
+    for (int ptId = re.begin(); ptId != re.end(); ++ptId) {
+      _EdgeTable->GetAdjacentPoints(ptId, numAdjPts, adjPtIds);
+      if (numAdjPts > 0) {
+        c[0] = c[1] = c[2] = .0;
+        for (int i = 0; i < numAdjPts; ++i) {
+          _Points->GetPoint(adjPtIds[i], p);
+          c[0] += p[0], c[1] += p[1], c[2] += p[2];
+        }
+        c[0] /= numAdjPts, c[1] /= numAdjPts, c[2] /= numAdjPts;
+      } else {
+        _Points->GetPoint(ptId, c);
+      }
+      _Centroids->SetPoint(ptId, c);
+    }
+  }
+};
+
+
+} // namespace SurfaceCurvatureCacheUtils
+using namespace SurfaceCurvatureCacheUtils;
+
+// =============================================================================
+// Construction/Destruction
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+SurfaceCurvatureCache::SurfaceCurvatureCache()
+:
+  _CurvatureTypes(0),
+  _NumberOfSmoothingIterations(2),
+  _NumberOfUpdates(0),
+  _PointsMTime(0),
+  _ComputedTypes(0),
+  _Curvatures(vtkSmartPointer<vtkPointData>::New())
+{
+}
+
+// -----------------------------------------------------------------------------
+void SurfaceCurvatureCache::CopyAttributes(const SurfaceCurvatureCache &other)
+{
+  _CurvatureTypes              = other._CurvatureTypes;
+  _NumberOfSmoothingIterations = other._NumberOfSmoothingIterations;
+  _NumberOfUpdates             = other._NumberOfUpdates;
+  _Surface                     = other._Surface;
+  _PointsMTime                 = other._PointsMTime;
+  _ComputedTypes               = other._ComputedTypes;
+  _Centroids                   = other._Centroids;
+  _Curvatures = vtkSmartPointer<vtkPointData>::New();
+  _Curvatures->ShallowCopy(other._Curvatures);
+}
+
+// -----------------------------------------------------------------------------
+SurfaceCurvatureCache::SurfaceCurvatureCache(const SurfaceCurvatureCache &other)
+:
+  Object(other)
+{
+  CopyAttributes(other);
+}
+
+// -----------------------------------------------------------------------------
+SurfaceCurvatureCache &SurfaceCurvatureCache::operator =(const SurfaceCurvatureCache &other)
+{
+  if (this != &other) {
+    Object::operator =(other);
+    CopyAttributes(other);
+  }
+  return *this;
+}
+
+// -----------------------------------------------------------------------------
+SurfaceCurvatureCache::~SurfaceCurvatureCache()
+{
+}
+
+// -----------------------------------------------------------------------------
+void SurfaceCurvatureCache::Clear()
+{
+  _CurvatureTypes = 0;
+  _Surface        = nullptr;
+  _PointsMTime    = 0;
+  _ComputedTypes  = 0;
+  _Centroids      = nullptr;
+  _Curvatures->Initialize();
+}
+
+// -----------------------------------------------------------------------------
+void SurfaceCurvatureCache::AddCurvatureTypes(int types)
+{
+  std::lock_guard<std::mutex> lock(_Mutex);
+  _CurvatureTypes |= types;
+}
+
+// =============================================================================
+// Update
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+void SurfaceCurvatureCache::Invalidate(vtkPolyData *surface)
+{
+  const vtkMTimeType mtime = surface->GetPoints()->GetMTime();
+  if (_Surface != surface || _PointsMTime != mtime) {
+    _Surface       = surface;
+    _PointsMTime   = mtime;
+    _ComputedTypes = 0;
+    _Centroids     = nullptr;
+    _Curvatures->Initialize();
+  }
+}
+
+// -----------------------------------------------------------------------------
+vtkSmartPointer<vtkDataArray>
+SurfaceCurvatureCache::Curvature(vtkPolyData *surface, int type, SharedPtr<const EdgeTable> edgeTable)
+{
+  const char *name = nullptr;
+  for (int i = 0; i < NumberOfCachedTypes; ++i) {
+    if (CachedTypes[i] == type) name = CachedNames[i];
+  }
+  if (name == nullptr) return nullptr;
+
+  std::lock_guard<std::mutex> lock(_Mutex);
+  Invalidate(surface);
+
+  if ((_ComputedTypes & type) == 0) {
+    MIRTK_START_TIMING();
+
+    // Compute all registered curvatures which were not computed before
+    int types = 0;
+    for (int i = 0; i < NumberOfCachedTypes; ++i) {
+      if ((CachedTypes[i] & (_CurvatureTypes | type)) != 0) types |= CachedTypes[i];
+    }
+    types &= ~_ComputedTypes;
+
+    SurfaceCurvature curv(types);
+    curv.Input(surface);
+    if (edgeTable) curv.EdgeTable(edgeTable);
+    curv.VtkCurvaturesOn();
+    curv.Run();
+
+    MeshSmoothing smoother;
+    smoother.Input(curv.Output());
+    if (edgeTable) smoother.EdgeTable(edgeTable);
+    smoother.SmoothPointsOff();
+    for (int i = 0; i < NumberOfCachedTypes; ++i) {
+      if ((types & CachedTypes[i]) != 0) smoother.SmoothArray(CachedNames[i]);
+    }
+    smoother.NumberOfIterations(_NumberOfSmoothingIterations);
+    smoother.Run();
+
+    vtkPointData * const smoothPD = smoother.Output()->GetPointData();
+    for (int i = 0; i < NumberOfCachedTypes; ++i) {
+      if ((types & CachedTypes[i]) != 0) {
+        _Curvatures->AddArray(smoothPD->GetArray(CachedNames[i]));
+      }
+    }
+    _ComputedTypes |= types;
+    ++_NumberOfUpdates;
+
+    MIRTK_DEBUG_TIMING(5, "update of surface curvature cache");
+  }
+
+  return _Curvatures->GetArray(name);
+}
+
+// -----------------------------------------------------------------------------
+vtkSmartPointer<vtkPoints>
+SurfaceCurvatureCache::Centroids(vtkPolyData *surface, const EdgeTable *edgeTable)
+{
+  std::lock_guard<std::mutex> lock(_Mutex);
+  Invalidate(surface);
+
+  if (!_Centroids) {
+    const int npoints = static_cast<int>(surface->GetNumberOfPoints());
+    _Centroids = vtkSmartPointer<vtkPoints>::New();
+    _Centroids->SetNumberOfPoints(npoints);
+    ComputeCentroids eval;
+    eval._Points    = surface->GetPoints();
+    eval._EdgeTable = edgeTable;
+    eval._Centroids = _Centroids;
+    parallel_for(blocked_range<int>(0, npoints), eval);
+  }
+
+  return _Centroids;
+}
+
+
+} // namespace mirtk
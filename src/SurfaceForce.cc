@@ -34,12 +34,15 @@ namespace mirtk {
 // -----------------------------------------------------------------------------
 void SurfaceForce::CopyAttributes(const SurfaceForce &other)
 {
+  _SharedInsideMask = other._SharedInsideMask;
+  _LocalInsideMask  = other._LocalInsideMask;
 }
 
 // -----------------------------------------------------------------------------
 SurfaceForce::SurfaceForce(const char *name, double weight)
 :
-  ExternalForce(name, weight)
+  ExternalForce(name, weight),
+  _SharedInsideMask(nullptr)
 {
   _SurfaceForce = true;
 }
@@ -105,5 +108,12 @@ double SurfaceForce::SelfDistance(const double p[3], const double n[3], double m
   return min(IntersectWithRay(p, n, +maxd), IntersectWithRay(p, n, -maxd));
 }
 
+// -----------------------------------------------------------------------------
+const BinaryImage &SurfaceForce::InsideMask()
+{
+  SurfaceInsideMask &cache = (_SharedInsideMask ? *_SharedInsideMask : _LocalInsideMask);
+  return cache.Update(DeformedSurface(), _Image->Attributes());
+}
+
 
 } // namespace mirtk
@@ -0,0 +1,504 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright 2013-2017 Imperial College London
+ * Copyright 2013-2017 Andreas Schuh
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "mirtk/SurfaceInsideMask.h"
+
+#include "mirtk/Math.h"
+#include "mirtk/Array.h"
+#include "mirtk/Memory.h"
+#include "mirtk/Matrix.h"
+#include "mirtk/Parallel.h"
+#include "mirtk/Profiling.h"
+#include "mirtk/Vtk.h"
+#include "mirtk/PointSetUtils.h"
+
+#include "vtkNew.h"
+#include "vtkIdList.h"
+#include "vtkCellArray.h"
+#include "vtkPolyDataToImageStencil.h"
+#include "vtkImageStencilData.h"
+
+
+namespace mirtk {
+
+
+// =============================================================================
+// Auxiliary functors
+// =============================================================================
+
+namespace SurfaceInsideMaskUtils {
+
+
+// -----------------------------------------------------------------------------
+/// Flag points which moved since the last update
+struct FindMovedPoints
+{
+  vtkPoints *_Points;
+  vtkPoints *_PreviousPoints;
+  char      *_Moved;
+
+  void operator ()(const blocked_range<vtkIdType> &re) const
+  {
+    double p[3], q[3];
+    for (vtkIdType ptId = re.begin(); ptId != re.end(); ++ptId) {
+      _Points        ->GetPoint(ptId, p);
+      _PreviousPoints->GetPoint(ptId, q);
+      _Moved[ptId] = (p[0] != q[0] || p[1] != q[1] || p[2] != q[2]);
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Mark bricks of the mask lattice overlapped by cells with moved points
+///
+/// For each cell with at least one moved point, the voxel bounding box of the
+/// cell at its previous and current position is computed, and all bricks
+/// overlapping this box are marked as dirty. Each thread marks the bricks in
+/// its own array, which are joined afterwards, because the number of bricks
+/// is small compared to the number of cells.
+struct MarkSweptBricks
+{
+  vtkPolyData           *_Surface;
+  vtkPoints             *_PreviousPoints;
+  const char            *_Moved;
+  const ImageAttributes *_Domain;
+  int                    _BrickSize;
+  int                    _NumberOfBricks[3];
+  Array<char>            _Dirty;
+  vtkIdType              _NumberOfCells;
+
+  MarkSweptBricks(vtkPolyData *surface, vtkPoints *prev_points, const char *moved,
+                  const ImageAttributes *domain, int brick_size)
+  :
+    _Surface(surface),
+    _PreviousPoints(prev_points),
+    _Moved(moved),
+    _Domain(domain),
+    _BrickSize(brick_size),
+    _NumberOfCells(0)
+  {
+    _NumberOfBricks[0] = (domain->_x + brick_size - 1) / brick_size;
+    _NumberOfBricks[1] = (domain->_y + brick_size - 1) / brick_size;
+    _NumberOfBricks[2] = (domain->_z + brick_size - 1) / brick_size;
+    _Dirty.resize(_NumberOfBricks[0] * _NumberOfBricks[1] * _NumberOfBricks[2], 0);
+  }
+
+  MarkSweptBricks(const MarkSweptBricks &other, split)
+  :
+    _Surface(other._Surface),
+    _PreviousPoints(other._PreviousPoints),
+    _Moved(other._Moved),
+    _Domain(other._Domain),
+    _BrickSize(other._BrickSize),
+    _Dirty(other._Dirty.size(), 0),
+    _NumberOfCells(0)
+  {
+    memcpy(_NumberOfBricks, other._NumberOfBricks, 3 * sizeof(int));
+  }
+
+  void join(const MarkSweptBricks &other)
+  {
+    for (size_t i = 0; i < _Dirty.size(); ++i) {
+      if (other._Dirty[i]) _Dirty[i] = 1;
+    }
+    _NumberOfCells += other._NumberOfCells;
+  }
+
+  void Add(double p[3], double lb[6]) const
+  {
+    _Domain->WorldToLattice(p[0], p[1], p[2]);
+    lb[0] = min(lb[0], p[0]), lb[1] = max(lb[1], p[0]);
+    lb[2] = min(lb[2], p[1]), lb[3] = max(lb[3], p[1]);
+    lb[4] = min(lb[4], p[2]), lb[5] = max(lb[5], p[2]);
+  }
+
+  void operator ()(const blocked_range<vtkIdType> &re)
+  {
+    vtkIdType npts, *pts, i;
+    double    p[3], lb[6];
+    int       b1[3], b2[3], n[3] = {_Domain->_x, _Domain->_y, _Domain->_z};
+    for (vtkIdType cellId = re.begin(); cellId != re.end(); ++cellId) {
+      _Surface->GetCellPoints(cellId, npts, pts);
+      for (i = 0; i < npts; ++i) {
+        if (_Moved[pts[i]]) break;
+      }
+      if (i == npts) continue;
+      lb[0] = lb[2] = lb[4] = +inf;
+      lb[1] = lb[3] = lb[5] = -inf;
+      for (i = 0; i < npts; ++i) {
+        _Surface->GetPoint(pts[i], p);
+        Add(p, lb);
+        _PreviousPoints->GetPoint(pts[i], p);
+        Add(p, lb);
+      }
+      for (int d = 0; d < 3; ++d) {
+        b1[d] = max(0,        ifloor(lb[2*d  ]) - 1) / _BrickSize;
+        b2[d] = min(n[d] - 1, iceil (lb[2*d+1]) + 1) / _BrickSize;
+      }
+      if (b1[0] > b2[0] || b1[1] > b2[1] || b1[2] > b2[2]) continue;
+      for (int bk = b1[2]; bk <= b2[2]; ++bk)
+      for (int bj = b1[1]; bj <= b2[1]; ++bj)
+      for (int bi = b1[0]; bi <= b2[0]; ++bi) {
+        _Dirty[(bk * _NumberOfBricks[1] + bj) * _NumberOfBricks[0] + bi] = 1;
+      }
+      ++_NumberOfCells;
+    }
+  }
+};
+
+
+// -----------------------------------------------------------------------------
+/// Select cells which intersect the z slabs of the mask regions to rasterize
+///
+/// The stencil of a region is computed from the contours of the surface at the
+/// z slices of the region, which are only closed when all cells crossing these
+/// slices are included. Only the voxel z coordinate of the cell points is needed
+/// to select these cells, i.e., the dot product of the world coordinates with
+/// the respective row of the world to image transformation.
+struct SelectCellsInSlabs
+{
+  vtkPolyData *_Surface;
+  double       _WorldToVoxelZ[4];
+  const int   *_Slabs;
+  int          _NumberOfSlabs;
+  char        *_Selected;
+
+  void operator ()(const blocked_range<vtkIdType> &re) const
+  {
+    vtkIdType npts, *pts;
+    double    p[3], z, z1, z2;
+    for (vtkIdType cellId = re.begin(); cellId != re.end(); ++cellId) {
+      _Surface->GetCellPoints(cellId, npts, pts);
+      z1 = +inf, z2 = -inf;
+      for (vtkIdType i = 0; i < npts; ++i) {
+        _Surface->GetPoint(pts[i], p);
+        z  = _WorldToVoxelZ[0] * p[0] + _WorldToVoxelZ[1] * p[1]
+           + _WorldToVoxelZ[2] * p[2] + _WorldToVoxelZ[3];
+        z1 = min(z1, z);
+        z2 = max(z2, z);
+      }
+      _Selected[cellId] = 0;
+      for (int s = 0; s < _NumberOfSlabs; ++s) {
+        if (z2 >= _Slabs[2*s] - 1 && z1 <= _Slabs[2*s+1] + 1) {
+          _Selected[cellId] = 1;
+          break;
+        }
+      }
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Copy current position of points which moved since the last update
+struct CopyMovedPoints
+{
+  vtkPoints  *_Points;
+  vtkPoints  *_PreviousPoints;
+  const char *_Moved;
+
+  void operator ()(const blocked_range<vtkIdType> &re) const
+  {
+    double p[3];
+    for (vtkIdType ptId = re.begin(); ptId != re.end(); ++ptId) {
+      if (_Moved[ptId]) {
+        _Points->GetPoint(ptId, p);
+        _PreviousPoints->SetPoint(ptId, p);
+      }
+    }
+  }
+};
+
+
+} // namespace SurfaceInsideMaskUtils
+using namespace SurfaceInsideMaskUtils;
+
+// =============================================================================
+// Construction/Destruction
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+SurfaceInsideMask::SurfaceInsideMask()
+:
+  _BrickSize(16),
+  _MaxPartialUpdateRatio(.5),
+  _NumberOfFullUpdates(0),
+  _NumberOfPartialUpdates(0),
+  _NumberOfCells(0)
+{
+}
+
+// -----------------------------------------------------------------------------
+void SurfaceInsideMask::CopyAttributes(const SurfaceInsideMask &other)
+{
+  _BrickSize              = other._BrickSize;
+  _MaxPartialUpdateRatio  = other._MaxPartialUpdateRatio;
+  _Mask                   = other._Mask;
+  _NumberOfFullUpdates    = other._NumberOfFullUpdates;
+  _NumberOfPartialUpdates = other._NumberOfPartialUpdates;
+  _Surface                = other._Surface;
+  _NumberOfCells          = other._NumberOfCells;
+  if (other._Points) {
+    _Points = vtkSmartPointer<vtkPoints>::New();
+    _Points->DeepCopy(other._Points);
+  } else {
+    _Points = nullptr;
+  }
+}
+
+// -----------------------------------------------------------------------------
+SurfaceInsideMask::SurfaceInsideMask(const SurfaceInsideMask &other)
+:
+  Object(other)
+{
+  CopyAttributes(other);
+}
+
+// -----------------------------------------------------------------------------
+SurfaceInsideMask &SurfaceInsideMask::operator =(const SurfaceInsideMask &other)
+{
+  if (this != &other) {
+    Object::operator =(other);
+    CopyAttributes(other);
+  }
+  return *this;
+}
+
+// -----------------------------------------------------------------------------
+SurfaceInsideMask::~SurfaceInsideMask()
+{
+}
+
+// -----------------------------------------------------------------------------
+void SurfaceInsideMask::Clear()
+{
+  _Mask.Clear();
+  _Surface       = nullptr;
+  _Points        = nullptr;
+  _NumberOfCells = 0;
+}
+
+// =============================================================================
+// Update
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+void SurfaceInsideMask::Rasterize(vtkPointSet *pointset, const int extent[6])
+{
+  int region[6];
+  memcpy(region, extent, 6 * sizeof(int));
+
+  vtkNew<vtkPolyDataToImageStencil> filter;
+  SetVTKInput(filter, pointset);
+  filter->SetOutputOrigin(0., 0., 0.);
+  filter->SetOutputSpacing(1., 1., 1.);
+  filter->SetOutputWholeExtent(region);
+  filter->Update();
+
+  vtkImageStencilData * const stencil = filter->GetOutput();
+
+  int i, i1, i2, iter;
+  for (int k = region[4]; k <= region[5]; ++k)
+  for (int j = region[2]; j <= region[3]; ++j) {
+    for (i = region[0]; i <= region[1]; ++i) {
+      _Mask(i, j, k) = false;
+    }
+    iter = 0;
+    while (stencil->GetNextExtent(i1, i2, region[0], region[1], j, k, iter)) {
+      for (i = i1; i <= i2; ++i) {
+        _Mask(i, j, k) = true;
+      }
+    }
+  }
+}
+
+// -----------------------------------------------------------------------------
+vtkSmartPointer<vtkPolyData>
+SurfaceInsideMask::ExtractSlabs(vtkPolyData *surface, const Array<int> &slabs)
+{
+  const vtkIdType npoints = surface->GetNumberOfPoints();
+  const vtkIdType ncells  = surface->GetNumberOfCells();
+
+  const Matrix w2i = _Mask.GetWorldToImageMatrix();
+  SelectCellsInSlabs select;
+  select._Surface          = surface;
+  select._WorldToVoxelZ[0] = w2i(2, 0);
+  select._WorldToVoxelZ[1] = w2i(2, 1);
+  select._WorldToVoxelZ[2] = w2i(2, 2);
+  select._WorldToVoxelZ[3] = w2i(2, 3);
+  select._Slabs            = slabs.data();
+  select._NumberOfSlabs    = static_cast<int>(slabs.size() / 2);
+  _SelectedCells.resize(ncells);
+  select._Selected         = _SelectedCells.data();
+  parallel_for(blocked_range<vtkIdType>(0, ncells), select);
+
+  // Copy and transform points of selected cells
+  if (static_cast<vtkIdType>(_PointIds.size()) != npoints) {
+    _PointIds.assign(npoints, -1);
+  }
+  vtkSmartPointer<vtkPoints>    points = vtkSmartPointer<vtkPoints>::New();
+  vtkSmartPointer<vtkCellArray> polys  = vtkSmartPointer<vtkCellArray>::New();
+  vtkNew<vtkIdList> ids;
+  vtkIdType npts, *pts;
+  double    p[3];
+  for (vtkIdType cellId = 0; cellId < ncells; ++cellId) {
+    if (!_SelectedCells[cellId]) continue;
+    surface->GetCellPoints(cellId, npts, pts);
+    ids->SetNumberOfIds(npts);
+    for (vtkIdType i = 0; i < npts; ++i) {
+      vtkIdType &ptId = _PointIds[pts[i]];
+      if (ptId < 0) {
+        surface->GetPoint(pts[i], p);
+        _Mask.WorldToImage(p[0], p[1], p[2]);
+        ptId = points->InsertNextPoint(p);
+      }
+      ids->SetId(i, ptId);
+    }
+    polys->InsertNextCell(ids.GetPointer());
+  }
+
+  // Reset point index map for next update
+  for (vtkIdType cellId = 0; cellId < ncells; ++cellId) {
+    if (!_SelectedCells[cellId]) continue;
+    surface->GetCellPoints(cellId, npts, pts);
+    for (vtkIdType i = 0; i < npts; ++i) {
+      _PointIds[pts[i]] = -1;
+    }
+  }
+
+  vtkSmartPointer<vtkPolyData> output = vtkSmartPointer<vtkPolyData>::New();
+  output->SetPoints(points);
+  output->SetPolys(polys);
+  return output;
+}
+
+// -----------------------------------------------------------------------------
+const BinaryImage &SurfaceInsideMask::Update(vtkPolyData *surface, const ImageAttributes &attr)
+{
+  std::lock_guard<std::mutex> lock(_Mutex);
+  MIRTK_START_TIMING();
+
+  const vtkIdType npoints = surface->GetNumberOfPoints();
+  const vtkIdType ncells  = surface->GetNumberOfCells();
+
+  bool full = (_Surface != surface || !_Points || _Points->GetNumberOfPoints() != npoints ||
+               _NumberOfCells != ncells || !_Mask.Attributes().EqualInSpace(attr));
+
+  Array<int> regions; // Voxel extents of boxes of dirty bricks
+
+  if (!full) {
+
+    // Mark bricks swept by cells whose points moved since last update
+    _Moved.resize(npoints);
+    FindMovedPoints find_moved;
+    find_moved._Points         = surface->GetPoints();
+    find_moved._PreviousPoints = _Points;
+    find_moved._Moved          = _Moved.data();
+    parallel_for(blocked_range<vtkIdType>(0, npoints), find_moved);
+
+    if (surface->NeedToBuildCells()) surface->BuildCells();
+    const int bs = max(1, _BrickSize);
+    MarkSweptBricks swept(surface, _Points, _Moved.data(), &attr, bs);
+    parallel_reduce(blocked_range<vtkIdType>(0, ncells), swept);
+    if (swept._NumberOfCells == 0) return _Mask;
+
+    // Greedily decompose set of dirty bricks into disjoint boxes
+    const int nx = swept._NumberOfBricks[0];
+    const int ny = swept._NumberOfBricks[1];
+    const int nz = swept._NumberOfBricks[2];
+    Array<char> &dirty = swept._Dirty;
+    auto is_dirty = [&](int i, int j, int k) { return dirty[(k * ny + j) * nx + i] != 0; };
+    auto is_dirty_row = [&](int i1, int i2, int j, int k) {
+      for (int i = i1; i <= i2; ++i) if (!is_dirty(i, j, k)) return false;
+      return true;
+    };
+    int i2, j2, k2, nvox = 0;
+    for (int k = 0; k < nz; ++k)
+    for (int j = 0; j < ny; ++j)
+    for (int i = 0; i < nx; ++i) {
+      if (!is_dirty(i, j, k)) continue;
+      for (i2 = i; i2 + 1 < nx && is_dirty(i2 + 1, j, k); ++i2);
+      for (j2 = j; j2 + 1 < ny && is_dirty_row(i, i2, j2 + 1, k); ++j2);
+      for (k2 = k; k2 + 1 < nz; ++k2) {
+        int jj = j;
+        while (jj <= j2 && is_dirty_row(i, i2, jj, k2 + 1)) ++jj;
+        if (jj <= j2) break;
+      }
+      for (int kk = k; kk <= k2; ++kk)
+      for (int jj = j; jj <= j2; ++jj)
+      for (int ii = i; ii <= i2; ++ii) {
+        dirty[(kk * ny + jj) * nx + ii] = 0;
+      }
+      const int extent[6] = {i * bs, min(attr._x - 1, (i2 + 1) * bs - 1),
+                             j * bs, min(attr._y - 1, (j2 + 1) * bs - 1),
+                             k * bs, min(attr._z - 1, (k2 + 1) * bs - 1)};
+      regions.insert(regions.end(), extent, extent + 6);
+      nvox += (extent[1] - extent[0] + 1) * (extent[3] - extent[2] + 1) * (extent[5] - extent[4] + 1);
+    }
+
+    // Rasterize entire surface when swept region covers much of the volume
+    if (nvox > _MaxPartialUpdateRatio * attr.NumberOfSpatialPoints()) {
+      full = true;
+    }
+  }
+
+  if (full) {
+
+    // Rasterize entire surface
+    if (!_Mask.Attributes().EqualInSpace(attr)) _Mask.Initialize(attr, 1);
+    int extent[6] = {0, attr._x - 1, 0, attr._y - 1, 0, attr._z - 1};
+    Rasterize(WorldToImage(surface, &_Mask), extent);
+    ++_NumberOfFullUpdates;
+
+    _Surface       = surface;
+    _NumberOfCells = ncells;
+    _Points        = vtkSmartPointer<vtkPoints>::New();
+    _Points->DeepCopy(surface->GetPoints());
+
+    MIRTK_DEBUG_TIMING(5, "rasterizing inside mask");
+
+  } else {
+
+    // Rasterize surface within boxes of dirty bricks only, where only the
+    // cells crossing the z slices of these boxes are mapped to voxel space
+    Array<int> slabs;
+    slabs.reserve(regions.size() / 3);
+    for (size_t r = 0; r < regions.size(); r += 6) {
+      slabs.push_back(regions[r + 4]);
+      slabs.push_back(regions[r + 5]);
+    }
+    vtkSmartPointer<vtkPointSet> pointset = ExtractSlabs(surface, slabs);
+    for (size_t r = 0; r < regions.size(); r += 6) {
+      Rasterize(pointset, &regions[r]);
+    }
+    ++_NumberOfPartialUpdates;
+
+    CopyMovedPoints copy_moved;
+    copy_moved._Points         = surface->GetPoints();
+    copy_moved._PreviousPoints = _Points;
+    copy_moved._Moved          = _Moved.data();
+    parallel_for(blocked_range<vtkIdType>(0, npoints), copy_moved);
+
+    MIRTK_DEBUG_TIMING(5, "updating inside mask");
+  }
+
+  return _Mask;
+}
+
+
+} // namespace mirtk
@@ -0,0 +1,448 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright 2013-2017 Imperial College London
+ * Copyright 2013-2017 Andreas Schuh
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MIRTK_Deformable_SyntheticInputs_H
+#define MIRTK_Deformable_SyntheticInputs_H
+
+#include "mirtk/Common.h"
+#include "mirtk/Array.h"
+#include "mirtk/Parallel.h"
+#include "mirtk/GenericImage.h"
+#include "mirtk/RegisteredImage.h"
+#include "mirtk/Vtk.h"
+
+#include "vtkSmartPointer.h"
+#include "vtkPolyData.h"
+#include "vtkPoints.h"
+#include "vtkCellArray.h"
+#include "vtkPointData.h"
+#include "vtkUnsignedCharArray.h"
+#include "vtkMath.h"
+#include "vtkWindowedSincPolyDataFilter.h"
+
+#include <map>
+#include <algorithm>
+
+
+namespace mirtk {
+
+
+// =============================================================================
+// Synthetic inputs
+// =============================================================================
+
+// Procedurally generated input surfaces and images used by the tests and the
+// benchmark suite of the Deformable module. No external data is required.
+
+// -----------------------------------------------------------------------------
+/// Type of synthetic input shape
+enum SyntheticShape
+{
+  SS_Sphere,
+  SS_Ellipsoid,
+  SS_Gyrified
+};
+
+// -----------------------------------------------------------------------------
+inline const char *ToString(SyntheticShape shape)
+{
+  switch (shape) {
+    case SS_Sphere:    return "sphere";
+    case SS_Ellipsoid: return "ellipsoid";
+    case SS_Gyrified:  return "gyrified";
+  }
+  return "unknown";
+}
+
+// -----------------------------------------------------------------------------
+inline bool FromString(const char *str, SyntheticShape &shape)
+{
+  const string lstr = ToLower(str);
+  if      (lstr == "sphere")    shape = SS_Sphere;
+  else if (lstr == "ellipsoid") shape = SS_Ellipsoid;
+  else if (lstr == "gyrified")  shape = SS_Gyrified;
+  else return false;
+  return true;
+}
+
+// -----------------------------------------------------------------------------
+/// Implicit function of synthetic shape which is negative inside
+///
+/// The shapes are star-shaped w.r.t. the origin, i.e., each shape is defined
+/// by its radius as function of the unit direction vector u.
+struct ImplicitShape
+{
+  SyntheticShape _Shape;
+  double         _Radius;
+
+  /// Radius of shape in direction of unit vector u
+  double Radius(const double u[3]) const
+  {
+    switch (_Shape) {
+      case SS_Sphere: {
+        return _Radius;
+      }
+      case SS_Ellipsoid: {
+        const double a = _Radius, b = .8 * _Radius, c = .65 * _Radius;
+        return 1.0 / sqrt(pow(u[0] / a, 2) + pow(u[1] / b, 2) + pow(u[2] / c, 2));
+      }
+      case SS_Gyrified: {
+        const double f = 8.0, A = .1;
+        return _Radius * (1.0 + A * sin(f * u[0]) * sin(f * u[1]) * sin(f * u[2]));
+      }
+    }
+    return _Radius;
+  }
+
+  /// Evaluate implicit function at point p
+  double Evaluate(const double p[3]) const
+  {
+    const double r = sqrt(p[0]*p[0] + p[1]*p[1] + p[2]*p[2]);
+    if (r < 1e-9) return -_Radius;
+    const double u[3] = {p[0] / r, p[1] / r, p[2] / r};
+    return r - Radius(u);
+  }
+
+  /// First order approximation of signed distance of point p from shape boundary
+  double Distance(const double p[3]) const
+  {
+    const double h = 1e-3 * _Radius;
+    double q[3] = {p[0], p[1], p[2]}, g[3];
+    for (int i = 0; i < 3; ++i) {
+      q[i] = p[i] + h;
+      g[i] = Evaluate(q);
+      q[i] = p[i] - h;
+      g[i] = (g[i] - Evaluate(q)) / (2.0 * h);
+      q[i] = p[i];
+    }
+    const double norm = sqrt(g[0]*g[0] + g[1]*g[1] + g[2]*g[2]);
+    return Evaluate(p) / (norm > 1e-9 ? norm : 1.0);
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Generate geodesic icosphere with 10 n^2 + 2 vertices on the unit sphere
+///
+/// Each face of the icosahedron is subdivided into n^2 triangles and the
+/// vertices are projected onto the unit sphere.
+inline vtkSmartPointer<vtkPolyData> Icosphere(int n)
+{
+  const double t = .5 * (1.0 + sqrt(5.0));
+  const double corners[12][3] = {
+    {-1,  t,  0}, { 1,  t,  0}, {-1, -t,  0}, { 1, -t,  0},
+    { 0, -1,  t}, { 0,  1,  t}, { 0, -1, -t}, { 0,  1, -t},
+    { t,  0, -1}, { t,  0,  1}, {-t,  0, -1}, {-t,  0,  1}
+  };
+  const int faces[20][3] = {
+    {0, 11,  5}, {0,  5,  1}, { 0,  1,  7}, { 0,  7, 10}, {0, 10, 11},
+    {1,  5,  9}, {5, 11,  4}, {11, 10,  2}, {10,  7,  6}, {7,  1,  8},
+    {3,  9,  4}, {3,  4,  2}, { 3,  2,  6}, { 3,  6,  8}, {3,  8,  9},
+    {4,  9,  5}, {2,  4, 11}, { 6,  2, 10}, { 8,  6,  7}, {9,  8,  1}
+  };
+
+  vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
+  points->SetDataTypeToDouble();
+  points->Allocate(10 * n * n + 2);
+
+  auto add_point = [&points](double x, double y, double z) {
+    const double norm = sqrt(x*x + y*y + z*z);
+    return points->InsertNextPoint(x / norm, y / norm, z / norm);
+  };
+  for (int i = 0; i < 12; ++i) {
+    add_point(corners[i][0], corners[i][1], corners[i][2]);
+  }
+
+  // Points along icosahedron edges are shared by adjacent faces
+  std::map<std::pair<int, int>, vtkIdType> edge_points;
+  auto edge_point = [&](int a, int b, int i) -> vtkIdType {
+    const int u = min(a, b), v = max(a, b);
+    auto it = edge_points.find(std::make_pair(u, v));
+    if (it == edge_points.end()) {
+      vtkIdType first = points->GetNumberOfPoints();
+      for (int k = 1; k < n; ++k) {
+        const double s = double(k) / n;
+        add_point((1. - s) * corners[u][0] + s * corners[v][0],
+                  (1. - s) * corners[u][1] + s * corners[v][1],
+                  (1. - s) * corners[u][2] + s * corners[v][2]);
+      }
+      it = edge_points.insert(std::make_pair(std::make_pair(u, v), first)).first;
+    }
+    return it->second + (a == u ? i : n - i) - 1;
+  };
+
+  vtkSmartPointer<vtkCellArray> polys = vtkSmartPointer<vtkCellArray>::New();
+  polys->Allocate(polys->EstimateSize(20 * n * n, 3));
+
+  Array<vtkIdType> ids((n + 1) * (n + 2) / 2);
+  for (int f = 0; f < 20; ++f) {
+    const int a = faces[f][0], b = faces[f][1], c = faces[f][2];
+    // Barycentric grid point with weights (n - i - j, i, j) of corners (a, b, c)
+    auto index = [n](int i, int j) { return j * (n + 1) - j * (j - 1) / 2 + i; };
+    for (int j = 0; j <= n; ++j)
+    for (int i = 0; i <= n - j; ++i) {
+      const int k = n - i - j;
+      vtkIdType &id = ids[index(i, j)];
+      if      (i == 0 && j == 0) id = a;
+      else if (i == n)           id = b;
+      else if (j == n)           id = c;
+      else if (j == 0)           id = edge_point(a, b, i);
+      else if (i == 0)           id = edge_point(a, c, j);
+      else if (k == 0)           id = edge_point(b, c, j);
+      else {
+        double x[3];
+        for (int d = 0; d < 3; ++d) {
+          x[d] = (k * corners[a][d] + i * corners[b][d] + j * corners[c][d]) / n;
+        }
+        id = add_point(x[0], x[1], x[2]);
+      }
+    }
+    vtkIdType tri[3];
+    for (int j = 0; j < n; ++j)
+    for (int i = 0; i < n - j; ++i) {
+      tri[0] = ids[index(i,     j    )];
+      tri[1] = ids[index(i + 1, j    )];
+      tri[2] = ids[index(i,     j + 1)];
+      polys->InsertNextCell(3, tri);
+      if (i + j < n - 1) {
+        tri[0] = ids[index(i + 1, j    )];
+        tri[1] = ids[index(i + 1, j + 1)];
+        tri[2] = ids[index(i,     j + 1)];
+        polys->InsertNextCell(3, tri);
+      }
+    }
+  }
+
+  vtkSmartPointer<vtkPolyData> surface = vtkSmartPointer<vtkPolyData>::New();
+  surface->SetPoints(points);
+  surface->SetPolys(polys);
+  return surface;
+}
+
+// -----------------------------------------------------------------------------
+/// Generate synthetic surface mesh with approximately the given number of vertices
+inline vtkSmartPointer<vtkPolyData> SyntheticSurface(const ImplicitShape &shape, int npoints)
+{
+  const int n = max(1, iround(sqrt(max(0, npoints - 2) / 10.0)));
+  vtkSmartPointer<vtkPolyData> surface = Icosphere(n);
+  vtkPoints * const points = surface->GetPoints();
+  double u[3], r;
+  for (vtkIdType ptId = 0; ptId < points->GetNumberOfPoints(); ++ptId) {
+    points->GetPoint(ptId, u);
+    r = shape.Radius(u);
+    points->SetPoint(ptId, r * u[0], r * u[1], r * u[2]);
+  }
+  return surface;
+}
+
+// -----------------------------------------------------------------------------
+/// Generate signed distance map and intensity image of synthetic shape
+///
+/// The intensity image has a bright foreground inside the shape and a smooth
+/// transition to the dark background across the shape boundary.
+inline void SyntheticImages(const ImplicitShape &shape, double spacing,
+                            RealImage &dmap, RealImage &image)
+{
+  const int    margin = 10;
+  const int    n      = 2 * (iceil(1.2 * shape._Radius / spacing) + margin) + 1;
+  const double width  = spacing;
+
+  ImageAttributes attr(n, n, n, spacing, spacing, spacing);
+  dmap .Initialize(attr, 1);
+  image.Initialize(attr, 1);
+
+  parallel_for(blocked_range<int>(0, n), [&](const blocked_range<int> &re) {
+    double p[3], d;
+    for (int k = re.begin(); k != re.end(); ++k)
+    for (int j = 0; j < n; ++j)
+    for (int i = 0; i < n; ++i) {
+      p[0] = i, p[1] = j, p[2] = k;
+      attr.LatticeToWorld(p[0], p[1], p[2]);
+      d = shape.Distance(p);
+      dmap (i, j, k) = static_cast<RealPixel>(d);
+      image(i, j, k) = static_cast<RealPixel>(20.0 + 80.0 / (1.0 + exp(d / width)));
+    }
+  });
+}
+
+// -----------------------------------------------------------------------------
+/// Average edge length of surface mesh
+inline double AverageEdgeLength(vtkPolyData *surface)
+{
+  vtkIdType npts, *pts;
+  double    p[3], q[3], sum = 0.;
+  int       n = 0;
+  vtkCellArray * const polys = surface->GetPolys();
+  polys->InitTraversal();
+  while (polys->GetNextCell(npts, pts)) {
+    for (vtkIdType i = 0; i < npts; ++i) {
+      surface->GetPoint(pts[i], p);
+      surface->GetPoint(pts[(i + 1) % npts], q);
+      sum += sqrt(vtkMath::Distance2BetweenPoints(p, q));
+      ++n;
+    }
+  }
+  return (n > 0 ? sum / n : 0.);
+}
+
+// -----------------------------------------------------------------------------
+/// Deep copy of surface mesh
+inline vtkSmartPointer<vtkPolyData> Copy(vtkPolyData *surface)
+{
+  vtkSmartPointer<vtkPolyData> copy = vtkSmartPointer<vtkPolyData>::New();
+  copy->DeepCopy(surface);
+  return copy;
+}
+
+
+// -----------------------------------------------------------------------------
+/// Open surface mesh with the cells whose points all have a z coordinate less
+/// than or equal to the given value, where unused points are removed
+inline vtkSmartPointer<vtkPolyData> CutSurface(vtkPolyData *surface, double z)
+{
+  const vtkIdType npoints = surface->GetNumberOfPoints();
+  vtkSmartPointer<vtkPoints>    points = vtkSmartPointer<vtkPoints>::New();
+  vtkSmartPointer<vtkCellArray> polys  = vtkSmartPointer<vtkCellArray>::New();
+  Array<vtkIdType> ids(npoints, -1);
+  vtkIdType npts, *pts, cell[3];
+  double    p[3];
+  vtkCellArray * const input_polys = surface->GetPolys();
+  input_polys->InitTraversal();
+  while (input_polys->GetNextCell(npts, pts)) {
+    if (npts != 3) continue;
+    bool keep = true;
+    for (vtkIdType i = 0; keep && i < npts; ++i) {
+      surface->GetPoint(pts[i], p);
+      keep = (p[2] <= z);
+    }
+    if (!keep) continue;
+    for (vtkIdType i = 0; i < npts; ++i) {
+      if (ids[pts[i]] < 0) {
+        surface->GetPoint(pts[i], p);
+        ids[pts[i]] = points->InsertNextPoint(p);
+      }
+      cell[i] = ids[pts[i]];
+    }
+    polys->InsertNextCell(3, cell);
+  }
+  vtkSmartPointer<vtkPolyData> output = vtkSmartPointer<vtkPolyData>::New();
+  output->SetPoints(points);
+  output->SetPolys(polys);
+  return output;
+}
+
+// -----------------------------------------------------------------------------
+/// Low-pass filter moved surface mesh nodes using vtkWindowedSincPolyDataFilter
+///
+/// Reference of the low-pass filtering done by DeformableSurfaceModel::Step
+/// before it was replaced by a native implementation, including the fix of
+/// the centroid and scale of the filtered points. The displacements are
+/// modified such that the moved points are low-pass filtered.
+inline void WindowedSincLowPass(vtkPolyData *surface, double *dx, int niter, double passband)
+{
+  const vtkIdType npoints = surface->GetNumberOfPoints();
+  if (npoints == 0) return;
+
+  vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
+  points->SetDataTypeToDouble();
+  points->SetNumberOfPoints(npoints);
+  double p[3];
+  for (vtkIdType ptId = 0; ptId < npoints; ++ptId) {
+    surface->GetPoint(ptId, p);
+    for (int k = 0; k < 3; ++k) p[k] += dx[3 * ptId + k];
+    points->SetPoint(ptId, p);
+  }
+  vtkSmartPointer<vtkPolyData> moved = vtkSmartPointer<vtkPolyData>::New();
+  moved->ShallowCopy(surface);
+  moved->SetPoints(points);
+
+  vtkSmartPointer<vtkWindowedSincPolyDataFilter> filter;
+  filter = vtkSmartPointer<vtkWindowedSincPolyDataFilter>::New();
+  filter->SetPassBand(passband);
+  filter->SetNumberOfIterations(niter);
+  filter->NormalizeCoordinatesOn();
+  filter->FeatureEdgeSmoothingOff();
+  SetVTKInput(filter, moved);
+  filter->Update();
+  vtkPoints * const filtered = filter->GetOutput()->GetPoints();
+
+  // Centroid and mean absolute deviation of moved and filtered points
+  double c1[3] = {0., 0., 0.}, s1[3] = {0., 0., 0.};
+  double c2[3] = {0., 0., 0.}, s2[3] = {0., 0., 0.};
+  double q[3];
+  for (vtkIdType ptId = 0; ptId < npoints; ++ptId) {
+    points  ->GetPoint(ptId, p);
+    filtered->GetPoint(ptId, q);
+    for (int k = 0; k < 3; ++k) c1[k] += p[k], c2[k] += q[k];
+  }
+  for (int k = 0; k < 3; ++k) c1[k] /= npoints, c2[k] /= npoints;
+  for (vtkIdType ptId = 0; ptId < npoints; ++ptId) {
+    points  ->GetPoint(ptId, p);
+    filtered->GetPoint(ptId, q);
+    for (int k = 0; k < 3; ++k) s1[k] += abs(p[k] - c1[k]), s2[k] += abs(q[k] - c2[k]);
+  }
+  for (int k = 0; k < 3; ++k) s1[k] /= npoints, s2[k] /= npoints;
+
+  for (vtkIdType ptId = 0; ptId < npoints; ++ptId) {
+    points  ->GetPoint(ptId, p);
+    filtered->GetPoint(ptId, q);
+    for (int k = 0; k < 3; ++k) {
+      dx[3 * ptId + k] += (c1[k] + s1[k] * (q[k] - c2[k]) / s2[k]) - p[k];
+    }
+  }
+}
+
+// -----------------------------------------------------------------------------
+/// Wrap synthetic image for use by deformable surface model
+inline void InitializeRegisteredImage(RegisteredImage &image, RealImage &input)
+{
+  image.InputImage(&input);
+  image.Initialize(input.Attributes());
+  image.Update(true, false, false, true);
+  image.SelfUpdate(false);
+}
+
+// -----------------------------------------------------------------------------
+/// Add "Status" point data array which marks the nodes with the largest z
+/// coordinate, i.e., a cap of the given fraction of nodes, as active
+inline void MarkActiveCap(vtkPointSet *output, double ratio)
+{
+  const int npoints = static_cast<int>(output->GetNumberOfPoints());
+  Array<double> z(npoints);
+  double p[3];
+  for (int ptId = 0; ptId < npoints; ++ptId) {
+    output->GetPoint(ptId, p);
+    z[ptId] = p[2];
+  }
+  Array<double> sorted(z);
+  const int k = max(0, min(npoints - 1, static_cast<int>((1. - ratio) * npoints)));
+  std::nth_element(sorted.begin(), sorted.begin() + k, sorted.end());
+  vtkSmartPointer<vtkDataArray> status = vtkSmartPointer<vtkUnsignedCharArray>::New();
+  status->SetName("Status");
+  status->SetNumberOfComponents(1);
+  status->SetNumberOfTuples(npoints);
+  for (int ptId = 0; ptId < npoints; ++ptId) {
+    status->SetComponent(ptId, 0, z[ptId] >= sorted[k] ? 1. : 0.);
+  }
+  output->GetPointData()->AddArray(status);
+}
+
+
+} // namespace mirtk
+
+#endif // MIRTK_Deformable_SyntheticInputs_H
@@ -0,0 +1,107 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright 2013-2017 Imperial College London
+ * Copyright 2013-2017 Andreas Schuh
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "mirtk/Common.h"
+#include "mirtk/NumericsConfig.h"
+#include "mirtk/DeformableConfig.h"
+
+#include "mirtk/DeformableSurfaceModel.h"
+#include "mirtk/ImplicitSurfaceDistance.h"
+#include "mirtk/CurvatureConstraint.h"
+#include "mirtk/SpringForce.h"
+#include "mirtk/MetricDistortion.h"
+#include "mirtk/RepulsiveForce.h"
+
+#include "SyntheticInputs.h"
+
+using namespace mirtk;
+
+
+// -----------------------------------------------------------------------------
+/// Check that the model gradient evaluated with an active set of nodes is
+/// identical to the gradient evaluated at all nodes
+int main(int, char *[])
+{
+  InitializeNumericsLibrary();
+  InitializeDeformableLibrary();
+
+  const double ratio = .05;
+
+  ImplicitShape shape;
+  shape._Shape  = SS_Gyrified;
+  shape._Radius = 30.;
+
+  RealImage input_image, input_dmap;
+  SyntheticImages(shape, 1., input_dmap, input_image);
+  RegisteredImage dmap;
+  InitializeRegisteredImage(dmap, input_dmap);
+
+  vtkSmartPointer<vtkPolyData> surface = SyntheticSurface(shape, 10000);
+  const double h = AverageEdgeLength(surface);
+
+  ImplicitSurfaceDistance distance  ("Distance",  1.0);
+  CurvatureConstraint     curvature ("Curvature", .5);
+  SpringForce             spring    ("Bending",   .5);
+  MetricDistortion        distortion("Metric distortion", .1);
+  RepulsiveForce          repulsion ("Repulsion", .1);
+  DeformableSurfaceModel  model;
+
+  repulsion.FrontfaceRadius(h);
+
+  model.Input(surface);
+  model.ImplicitSurface(&dmap);
+  model.Add(&distance,   false);
+  model.Add(&curvature,  false);
+  model.Add(&spring,     false);
+  model.Add(&distortion, false);
+  model.Add(&repulsion,  false);
+  model.Initialize();
+  MarkActiveCap(model.Output(), ratio);
+  model.Update(true);
+
+  Array<double> full(model.NumberOfDOFs());
+  Array<double> part(model.NumberOfDOFs());
+  model.ActiveSet(false);
+  model.Gradient(full.data());
+  model.ActiveSet(true);
+  model.Gradient(part.data());
+
+  double max_diff = 0.;
+  for (size_t i = 0; i < full.size(); ++i) {
+    max_diff = max(max_diff, abs(full[i] - part[i]));
+  }
+  bool ok = true;
+  if (max_diff > 1e-12) {
+    cerr << "Error: Gradient evaluated at active nodes differs from full evaluation: " << max_diff << endl;
+    ok = false;
+  }
+
+  // Active set must consist of exactly the nodes with non-zero status in ascending order
+  Array<int> expected;
+  vtkDataArray * const status = model.Output()->GetPointData()->GetArray("Status");
+  for (vtkIdType ptId = 0; ptId < status->GetNumberOfTuples(); ++ptId) {
+    if (status->GetComponent(ptId, 0) != 0.) expected.push_back(static_cast<int>(ptId));
+  }
+  if (model.ActivePoints() != expected) {
+    cerr << "Error: Active set has " << model.ActivePoints().size() << " nodes, expected "
+         << expected.size() << " nodes with non-zero status in ascending order" << endl;
+    ok = false;
+  }
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,196 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright 2013-2017 Imperial College London
+ * Copyright 2013-2017 Andreas Schuh
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "mirtk/Common.h"
+#include "mirtk/Memory.h"
+#include "mirtk/Observer.h"
+#include "mirtk/NumericsConfig.h"
+#include "mirtk/DeformableConfig.h"
+
+#include "mirtk/DeformableSurfaceModel.h"
+#include "mirtk/ImplicitSurfaceDistance.h"
+#include "mirtk/CurvatureConstraint.h"
+#include "mirtk/EulerMethod.h"
+#include "mirtk/EulerMethodWithMomentum.h"
+#include "mirtk/EulerMethodWithDamping.h"
+#include "mirtk/AdaptiveRungeKuttaMethod.h"
+#include "mirtk/FastInertialRelaxationEngine.h"
+
+#include "SyntheticInputs.h"
+
+using namespace mirtk;
+
+
+// -----------------------------------------------------------------------------
+/// Keeps checkpoint of Euler integration created at the end of a given step
+class CheckpointRecorder : public Observer
+{
+  mirtkObjectMacro(CheckpointRecorder);
+
+  /// Number of integration steps after which checkpoint is created
+  mirtkPublicAttributeMacro(int, Step);
+
+  /// Recorded checkpoint
+  mirtkReadOnlyAttributeMacro(vtkSmartPointer<vtkPointSet>, Checkpoint);
+
+public:
+
+  CheckpointRecorder(int step) : _Step(step) {}
+
+  void HandleEvent(Observable *obj, Event event, const void * = nullptr)
+  {
+    if (event != IterationEndEvent) return;
+    const EulerMethod *euler = dynamic_cast<const EulerMethod *>(obj);
+    if (euler && euler->StepCount() == _Step) _Checkpoint = euler->Checkpoint();
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Instantiate Euler method of named type
+EulerMethod *NewEulerMethod(const string &name)
+{
+  if (name == "EulerMethod")                  return new EulerMethod();
+  if (name == "EulerMethodWithMomentum")      return new EulerMethodWithMomentum();
+  if (name == "EulerMethodWithDamping")       return new EulerMethodWithDamping();
+  if (name == "AdaptiveRungeKuttaMethod")     return new AdaptiveRungeKuttaMethod();
+  if (name == "FastInertialRelaxationEngine") return new FastInertialRelaxationEngine();
+  return nullptr;
+}
+
+// -----------------------------------------------------------------------------
+/// Integrate deformable surface model, optionally resumed from a checkpoint
+///
+/// When the surface was remeshed before the checkpoint was created, the input
+/// mesh is replaced by the remeshed surface with initial point positions as
+/// done by the deform-mesh command.
+vtkSmartPointer<vtkPolyData> Integrate(const string &name, vtkPolyData *surface,
+                                       RegisteredImage &dmap, int nsteps,
+                                       vtkPointSet *checkpoint = nullptr,
+                                       Observer *observer = nullptr)
+{
+  const double h = AverageEdgeLength(surface);
+
+  vtkSmartPointer<vtkPolyData> input = Copy(surface);
+  if (checkpoint) {
+    vtkDataArray * const initial_points = checkpoint->GetPointData()->GetArray("InitialPoints");
+    if (initial_points) {
+      vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
+      points->SetNumberOfPoints(checkpoint->GetNumberOfPoints());
+      for (vtkIdType ptId = 0; ptId < checkpoint->GetNumberOfPoints(); ++ptId) {
+        points->SetPoint(ptId, initial_points->GetTuple(ptId));
+      }
+      input->DeepCopy(checkpoint);
+      input->SetPoints(points);
+      input->GetFieldData()->Initialize();
+    }
+  }
+
+  ImplicitSurfaceDistance distance ("Distance",  1.0);
+  CurvatureConstraint     curvature("Curvature", .5);
+  DeformableSurfaceModel  model;
+
+  distance.DivideByInitialValue(true);
+
+  model.Input(input);
+  model.ImplicitSurface(&dmap);
+  model.Add(&distance,  false);
+  model.Add(&curvature, false);
+  model.MinEdgeLength(.5 * h);
+  model.MaxEdgeLength(2. * h);
+  model.RemeshInterval(4);
+
+  UniquePtr<EulerMethod> optimizer(NewEulerMethod(name));
+  optimizer->Function(&model);
+  optimizer->NumberOfSteps(nsteps);
+  optimizer->StepLength(.5 * h);
+  optimizer->Delta(0.);
+  optimizer->Set("Epsilon", "0");
+  if (observer) optimizer->AddObserver(*observer);
+  if (checkpoint) optimizer->Resume(checkpoint);
+  optimizer->Run();
+  if (observer) optimizer->DeleteObserver(*observer);
+
+  return Copy(vtkPolyData::SafeDownCast(model.Output()));
+}
+
+// -----------------------------------------------------------------------------
+/// Maximum distance of corresponding points or infinity if the meshes differ
+double MaxPointDistance(vtkPolyData *a, vtkPolyData *b)
+{
+  if (a->GetNumberOfPoints() != b->GetNumberOfPoints()) return inf;
+  if (a->GetNumberOfCells()  != b->GetNumberOfCells())  return inf;
+  double p[3], q[3], max_dist = 0.;
+  for (vtkIdType ptId = 0; ptId < a->GetNumberOfPoints(); ++ptId) {
+    a->GetPoint(ptId, p);
+    b->GetPoint(ptId, q);
+    max_dist = max(max_dist, sqrt(vtkMath::Distance2BetweenPoints(p, q)));
+  }
+  return max_dist;
+}
+
+// -----------------------------------------------------------------------------
+/// Check that an integration resumed from a checkpoint created after a local
+/// remeshing yields the same result as the uninterrupted integration
+int main(int, char *[])
+{
+  InitializeNumericsLibrary();
+  InitializeDeformableLibrary();
+
+  const int nsteps     = 12;
+  const int checkpoint = 6;
+
+  ImplicitShape shape;
+  shape._Shape  = SS_Gyrified;
+  shape._Radius = 30.;
+
+  RealImage input_image, input_dmap;
+  SyntheticImages(shape, 1., input_dmap, input_image);
+  RegisteredImage dmap;
+  InitializeRegisteredImage(dmap, input_dmap);
+
+  vtkSmartPointer<vtkPolyData> surface = SyntheticSurface(shape, 5000);
+  const double h = AverageEdgeLength(surface);
+
+  const char * const names[] = {
+    "EulerMethod",
+    "EulerMethodWithMomentum",
+    "EulerMethodWithDamping",
+    "AdaptiveRungeKuttaMethod",
+    "FastInertialRelaxationEngine"
+  };
+
+  bool ok = true;
+  for (const char *name : names) {
+    vtkSmartPointer<vtkPolyData> expected = Integrate(name, surface, dmap, nsteps);
+    CheckpointRecorder recorder(checkpoint);
+    Integrate(name, surface, dmap, nsteps, nullptr, &recorder);
+    if (recorder.Checkpoint() == nullptr) {
+      cerr << "Error: " << name << " did not create checkpoint after step " << checkpoint << endl;
+      ok = false;
+      continue;
+    }
+    vtkSmartPointer<vtkPolyData> resumed = Integrate(name, surface, dmap, nsteps, recorder.Checkpoint());
+    const double dist = MaxPointDistance(expected, resumed);
+    if (dist > 1e-6 * h) {
+      cerr << "Error: " << name << " resumed from checkpoint differs from uninterrupted integration: " << dist << endl;
+      ok = false;
+    }
+  }
+  return ok ? 0 : 1;
+}
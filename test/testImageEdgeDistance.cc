@@ -0,0 +1,243 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright 2013-2017 Imperial College London
+ * Copyright 2013-2017 Andreas Schuh
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "mirtk/Common.h"
+#include "mirtk/NumericsConfig.h"
+#include "mirtk/DeformableConfig.h"
+
+#include "mirtk/DeformableSurfaceModel.h"
+#include "mirtk/ImageEdgeDistance.h"
+#include "mirtk/MedianPointData.h"
+#include "mirtk/MeshSmoothing.h"
+
+#include "SyntheticInputs.h"
+
+#include <new>
+#include <atomic>
+#include <cstdlib>
+
+using namespace mirtk;
+
+
+// =============================================================================
+// Memory allocations
+// =============================================================================
+
+/// Whether calls of the global operator new are counted
+std::atomic<bool> count_allocations(false);
+
+/// Number of global operator new calls while counting was enabled
+std::atomic<long> allocation_count(0);
+
+// -----------------------------------------------------------------------------
+void *operator new(size_t size)
+{
+  if (count_allocations.load(std::memory_order_relaxed)) ++allocation_count;
+  void * const ptr = std::malloc(size > 0 ? size : 1);
+  if (ptr == nullptr) throw std::bad_alloc();
+  return ptr;
+}
+
+// -----------------------------------------------------------------------------
+void *operator new[](size_t size)
+{
+  return operator new(size);
+}
+
+// -----------------------------------------------------------------------------
+void operator delete(void *ptr) noexcept
+{
+  std::free(ptr);
+}
+
+// -----------------------------------------------------------------------------
+void operator delete[](void *ptr) noexcept
+{
+  std::free(ptr);
+}
+
+// -----------------------------------------------------------------------------
+void operator delete(void *ptr, size_t) noexcept
+{
+  std::free(ptr);
+}
+
+// -----------------------------------------------------------------------------
+void operator delete[](void *ptr, size_t) noexcept
+{
+  std::free(ptr);
+}
+
+// =============================================================================
+// Auxiliaries
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+/// Edge distance force with public access to its point data arrays
+class TestImageEdgeDistance : public ImageEdgeDistance
+{
+public:
+  TestImageEdgeDistance(const char *name) : ImageEdgeDistance(name) {}
+  using ImageEdgeDistance::PointData;
+};
+
+// -----------------------------------------------------------------------------
+/// Maximum absolute difference of the values of two single component arrays
+double MaxAbsDifference(vtkDataArray *a, vtkDataArray *b)
+{
+  if (a->GetNumberOfTuples() != b->GetNumberOfTuples()) return inf;
+  double max_diff = 0.;
+  for (vtkIdType i = 0; i < a->GetNumberOfTuples(); ++i) {
+    max_diff = max(max_diff, abs(a->GetComponent(i, 0) - b->GetComponent(i, 0)));
+  }
+  return max_diff;
+}
+
+// =============================================================================
+// Tests
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+/// Check that the median filtering and smoothing of the edge distances are
+/// equivalent to the MedianPointData and MeshSmoothing filters used previously
+bool TestFilterEquivalence(vtkPolyData *surface, RegisteredImage &image)
+{
+  const int radius = 2;
+  const int niters = 3;
+
+  TestImageEdgeDistance  raw     ("Raw");
+  TestImageEdgeDistance  median  ("Median");
+  TestImageEdgeDistance  smoothed("Smoothed");
+  DeformableSurfaceModel model;
+
+  median  .MedianFilterRadius(radius);
+  smoothed.DistanceSmoothing(niters);
+
+  model.Input(Copy(surface));
+  model.Image(&image);
+  model.Add(&raw,      false);
+  model.Add(&median,   false);
+  model.Add(&smoothed, false);
+  model.Initialize();
+  model.Update(true);
+
+  vtkPolyData * const output = vtkPolyData::SafeDownCast(model.Output());
+  vtkSmartPointer<vtkDataArray> distances;
+  distances.TakeReference(raw.PointData("Distance")->NewInstance());
+  distances->DeepCopy(raw.PointData("Distance"));
+  distances->SetName("Distances");
+
+  MedianPointData filter;
+  filter.Input(output);
+  filter.InputData(distances);
+  filter.Connectivity(radius);
+  filter.Run();
+
+  vtkSmartPointer<vtkPolyData> input = Copy(output);
+  input->GetPointData()->Initialize();
+  input->GetPointData()->AddArray(distances);
+  MeshSmoothing smoother;
+  smoother.Input(input);
+  smoother.SmoothPointsOff();
+  smoother.SmoothArray(distances->GetName());
+  smoother.Weighting(MeshSmoothing::Gaussian);
+  smoother.NumberOfIterations(niters);
+  smoother.Run();
+
+  bool ok = true;
+  const double tol = 1e-6;
+  const double median_diff = MaxAbsDifference(median.PointData("Distance"), filter.OutputData());
+  if (median_diff > tol) {
+    cerr << "Error: Median filtered edge distances differ from MedianPointData output: " << median_diff << endl;
+    ok = false;
+  }
+  vtkDataArray * const expected = smoother.Output()->GetPointData()->GetArray(distances->GetName());
+  const double smooth_diff = MaxAbsDifference(smoothed.PointData("Distance"), expected);
+  if (smooth_diff > tol) {
+    cerr << "Error: Smoothed edge distances differ from MeshSmoothing output: " << smooth_diff << endl;
+    ok = false;
+  }
+  return ok;
+}
+
+// -----------------------------------------------------------------------------
+/// Check that updates of the edge distance force with median filtering and
+/// smoothing do not allocate memory once the buffers were allocated
+bool TestUpdateWithoutAllocations(vtkPolyData *surface, RegisteredImage &image)
+{
+  const int nwarmup = 5;
+  const int ncheck  = 3;
+
+  ImageEdgeDistance      dedges("Edge distance");
+  DeformableSurfaceModel model;
+
+  dedges.MedianFilterRadius(1);
+  dedges.DistanceSmoothing(2);
+
+  model.Input(Copy(surface));
+  model.Image(&image);
+  model.Add(&dedges, false);
+  model.Initialize();
+  model.Update(true);
+
+  for (int i = 0; i < nwarmup; ++i) {
+    dedges.Update(true);
+  }
+  allocation_count = 0;
+  count_allocations = true;
+  for (int i = 0; i < ncheck; ++i) {
+    dedges.Update(true);
+  }
+  count_allocations = false;
+  const long nallocs = allocation_count;
+
+  if (nallocs > 0) {
+    cerr << "Error: ImageEdgeDistance::Update allocated memory " << nallocs << " times in "
+         << ncheck << " updates following " << nwarmup << " initial updates" << endl;
+    return false;
+  }
+  return true;
+}
+
+// =============================================================================
+// Main
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+int main(int, char *[])
+{
+  InitializeNumericsLibrary();
+  InitializeDeformableLibrary();
+
+  ImplicitShape shape;
+  shape._Shape  = SS_Gyrified;
+  shape._Radius = 30.;
+
+  RealImage input_image, input_dmap;
+  SyntheticImages(shape, 1., input_dmap, input_image);
+  RegisteredImage image;
+  InitializeRegisteredImage(image, input_image);
+
+  vtkSmartPointer<vtkPolyData> surface = SyntheticSurface(shape, 10000);
+
+  bool ok = true;
+  ok = TestFilterEquivalence(surface, image) && ok;
+  ok = TestUpdateWithoutAllocations(surface, image) && ok;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,82 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright 2013-2017 Imperial College London
+ * Copyright 2013-2017 Andreas Schuh
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "mirtk/Common.h"
+#include "mirtk/GenericImage.h"
+#include "mirtk/LocalBoxStatistics.h"
+
+using namespace mirtk;
+
+
+// -----------------------------------------------------------------------------
+/// Compare window sums computed with running sums to brute-force window sums
+///
+/// \returns Maximum relative difference of window means and variances,
+///          or infinity when the number of samples of a window differs.
+double CompareLocalStatistics(const BaseImage *image, const BinaryImage *mask, int width)
+{
+  LocalBoxStatistics fast(width / 2), slow(width / 2);
+  fast.Compute(image, mask);
+  slow.ComputeBruteForce(image, mask);
+  const int n = image->NumberOfSpatialVoxels();
+  double max_diff = 0.;
+  for (int idx = 0; idx < n; ++idx) {
+    if (fast.Count(idx) != slow.Count(idx)) {
+      cerr << "Error: Local window sample count differs from brute-force count at voxel " << idx
+           << " for window width " << width << ": " << fast.Count(idx) << " != " << slow.Count(idx) << endl;
+      return inf;
+    }
+    const double mean = slow.Mean(idx), var = slow.Variance(idx);
+    max_diff = max(max_diff, abs(fast.Mean    (idx) - mean) / max(1., abs(mean)));
+    max_diff = max(max_diff, abs(fast.Variance(idx) - var ) / max(1., abs(var )));
+  }
+  return max_diff;
+}
+
+// -----------------------------------------------------------------------------
+/// Check local window statistics against brute-force window sums
+///
+/// The check uses small volumes with pseudo-random integer intensities, for
+/// which the window sums are exact, random masks, odd and even window widths,
+/// windows clipped at the image border, and a 2D image.
+int main(int, char *[])
+{
+  const int sizes[2][3] = {{23, 19, 17}, {31, 27, 1}};
+  for (int s = 0; s < 2; ++s) {
+    ImageAttributes attr(sizes[s][0], sizes[s][1], sizes[s][2], 1., 1., 1.);
+    RealImage   values(attr);
+    BinaryImage mask  (attr);
+    for (int idx = 0; idx < values.NumberOfVoxels(); ++idx) {
+      const unsigned int hash = 2654435761u * static_cast<unsigned int>(idx + 1);
+      values(idx) = static_cast<RealPixel>((hash >> 8) % 1000);
+      mask  (idx) = static_cast<BinaryPixel>((hash >> 4) % 3 != 0);
+    }
+    for (int width = 1; width <= 8; ++width) {
+      const double diff = max(CompareLocalStatistics(&values, &mask,   width),
+                              CompareLocalStatistics(&values, nullptr, width));
+      if (diff > 1e-9) {
+        cerr << "Error: Local window statistics differ from brute-force statistics"
+             << " for image size " << sizes[s][0] << "x" << sizes[s][1] << "x" << sizes[s][2]
+             << " and window width " << width << ": " << diff << endl;
+        return 1;
+      }
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,109 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright 2013-2017 Imperial College London
+ * Copyright 2013-2017 Andreas Schuh
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "mirtk/Common.h"
+#include "mirtk/NumericsConfig.h"
+#include "mirtk/DeformableConfig.h"
+
+#include "mirtk/DeformableSurfaceModel.h"
+#include "mirtk/ImplicitSurfaceDistance.h"
+
+#include "SyntheticInputs.h"
+
+using namespace mirtk;
+
+
+// -----------------------------------------------------------------------------
+/// Maximum distance of low-pass filtered points moved by the deformable
+/// surface model from those filtered by vtkWindowedSincPolyDataFilter
+double MaxLowPassDifference(vtkPolyData *surface, RegisteredImage &dmap,
+                            int niter, double passband)
+{
+  const int    n = static_cast<int>(surface->GetNumberOfPoints());
+  const double h = AverageEdgeLength(surface);
+
+  // Oscillating radial displacements to be smoothed
+  Array<double> dx(3 * n);
+  double p[3], r;
+  for (int ptId = 0; ptId < n; ++ptId) {
+    surface->GetPoint(ptId, p);
+    r = sqrt(p[0]*p[0] + p[1]*p[1] + p[2]*p[2]);
+    for (int d = 0; d < 3; ++d) {
+      dx[3 * ptId + d] = .2 * h * sin(7. * p[0] / r) * cos(5. * p[1] / r) * p[d] / r;
+    }
+  }
+  Array<double> expected(dx);
+  WindowedSincLowPass(surface, expected.data(), niter, passband);
+
+  ImplicitSurfaceDistance distance("Distance", 1.0);
+  DeformableSurfaceModel  model;
+  model.Input(Copy(surface));
+  model.ImplicitSurface(&dmap);
+  model.Add(&distance, false);
+  model.LowPassInterval(1);
+  model.LowPassIterations(niter);
+  model.LowPassBand(passband);
+  model.Initialize();
+  model.Step(dx.data());
+
+  vtkPointSet * const output = model.Output();
+  double q[3], max_dist = 0.;
+  for (int ptId = 0; ptId < n; ++ptId) {
+    surface->GetPoint(ptId, p);
+    output ->GetPoint(ptId, q);
+    for (int d = 0; d < 3; ++d) p[d] += expected[3 * ptId + d];
+    max_dist = max(max_dist, sqrt(vtkMath::Distance2BetweenPoints(p, q)));
+  }
+  return max_dist;
+}
+
+// -----------------------------------------------------------------------------
+/// Check that the native low-pass filter of the deformable surface model moves
+/// the nodes of closed and open surface meshes as vtkWindowedSincPolyDataFilter
+int main(int, char *[])
+{
+  InitializeNumericsLibrary();
+  InitializeDeformableLibrary();
+
+  ImplicitShape shape;
+  shape._Shape  = SS_Sphere;
+  shape._Radius = 30.;
+
+  RealImage input_image, input_dmap;
+  SyntheticImages(shape, 1., input_dmap, input_image);
+  RegisteredImage dmap;
+  InitializeRegisteredImage(dmap, input_dmap);
+
+  vtkSmartPointer<vtkPolyData> closed = SyntheticSurface(shape, 5000);
+  vtkSmartPointer<vtkPolyData> open   = CutSurface(closed, .5 * shape._Radius);
+  const double h = AverageEdgeLength(closed);
+
+  bool ok = true;
+  const double closed_dist = MaxLowPassDifference(closed, dmap, 20, .1);
+  if (closed_dist > 1e-3 * h) {
+    cerr << "Error: Low-pass filtered closed surface differs from vtkWindowedSincPolyDataFilter: " << closed_dist << endl;
+    ok = false;
+  }
+  const double open_dist = MaxLowPassDifference(open, dmap, 20, .1);
+  if (open_dist > 1e-3 * h) {
+    cerr << "Error: Low-pass filtered open surface differs from vtkWindowedSincPolyDataFilter: " << open_dist << endl;
+    ok = false;
+  }
+  return ok ? 0 : 1;
+}
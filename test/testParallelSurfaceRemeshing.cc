@@ -0,0 +1,95 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright 2013-2017 Imperial College London
+ * Copyright 2013-2017 Andreas Schuh
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "mirtk/Common.h"
+#include "mirtk/NumericsConfig.h"
+#include "mirtk/DeformableConfig.h"
+#include "mirtk/Parallel.h"
+
+#include "mirtk/ParallelSurfaceRemeshing.h"
+
+#include "SyntheticInputs.h"
+
+using namespace mirtk;
+
+
+// -----------------------------------------------------------------------------
+/// Whether two surface meshes have identical points and cells
+bool SameMesh(vtkPolyData *a, vtkPolyData *b)
+{
+  if (a->GetNumberOfPoints() != b->GetNumberOfPoints()) return false;
+  if (a->GetNumberOfCells()  != b->GetNumberOfCells())  return false;
+  double p[3], q[3];
+  for (vtkIdType ptId = 0; ptId < a->GetNumberOfPoints(); ++ptId) {
+    a->GetPoint(ptId, p);
+    b->GetPoint(ptId, q);
+    if (p[0] != q[0] || p[1] != q[1] || p[2] != q[2]) return false;
+  }
+  vtkIdType npts1, *pts1, npts2, *pts2;
+  for (vtkIdType cellId = 0; cellId < a->GetNumberOfCells(); ++cellId) {
+    a->GetCellPoints(cellId, npts1, pts1);
+    b->GetCellPoints(cellId, npts2, pts2);
+    if (npts1 != npts2) return false;
+    for (vtkIdType i = 0; i < npts1; ++i) {
+      if (pts1[i] != pts2[i]) return false;
+    }
+  }
+  return true;
+}
+
+// -----------------------------------------------------------------------------
+/// Check that the output of the concurrent remeshing is reproducible and
+/// independent of the number of threads
+int main(int, char *[])
+{
+  InitializeNumericsLibrary();
+  InitializeDeformableLibrary();
+
+  ImplicitShape shape;
+  shape._Shape  = SS_Gyrified;
+  shape._Radius = 30.;
+
+  vtkSmartPointer<vtkPolyData> surface = SyntheticSurface(shape, 10000);
+  const double h = AverageEdgeLength(surface);
+
+  // Coarsen mesh to exercise edge collapses, splits, and flips, twice with
+  // the same number of threads and once with a single thread
+  const int nthreads[] = {4, 4, 1};
+  vtkSmartPointer<vtkPolyData> output[3];
+  for (int i = 0; i < 3; ++i) {
+    task_scheduler_init init(nthreads[i]);
+    ParallelSurfaceRemeshing remesher;
+    remesher.Input(Copy(surface));
+    remesher.MinEdgeLength(1.1 * h);
+    remesher.MaxEdgeLength(2.5 * h);
+    remesher.Run();
+    output[i] = remesher.Output();
+  }
+  bool ok = true;
+  if (!SameMesh(output[0], output[1])) {
+    cerr << "Error: Output of ParallelSurfaceRemeshing differs between runs" << endl;
+    ok = false;
+  }
+  if (!SameMesh(output[0], output[2])) {
+    cerr << "Error: Output of ParallelSurfaceRemeshing differs between " << nthreads[0]
+         << " threads and " << nthreads[2] << " thread" << endl;
+    ok = false;
+  }
+  return ok ? 0 : 1;
+}
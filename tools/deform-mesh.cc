@@ -25,6 +25,7 @@
 #include "mirtk/DeformableConfig.h"
 #include "mirtk/TransformationConfig.h"
 
+#include "mirtk/Path.h"
 #include "mirtk/PointSetIO.h"
 #include "mirtk/PointSetUtils.h"
 #include "mirtk/SurfaceBoundary.h"
@@ -38,11 +39,15 @@
 #include "mirtk/DeformableSurfaceModel.h"
 #include "mirtk/DeformableSurfaceLogger.h"
 #include "mirtk/DeformableSurfaceDebugger.h"
+#include "mirtk/DeformableSurfaceTracer.h"
 
 // Optimization method
 #include "mirtk/LocalOptimizer.h"
 #include "mirtk/EulerMethod.h"
 #include "mirtk/EulerMethodWithMomentum.h"
+#include "mirtk/AdaptiveRungeKuttaMethod.h"
+#include "mirtk/FastInertialRelaxationEngine.h"
+#include "mirtk/SemiImplicitEulerMethod.h"
 #include "mirtk/GradientDescent.h"
 #include "mirtk/InexactLineSearch.h"
 #include "mirtk/BrentLineSearch.h"
@@ -80,11 +85,23 @@
 #include "vtkCellData.h"
 #include "vtkDataArray.h"
 #include "vtkFloatArray.h"
+#include "vtkIntArray.h"
+#include "vtkFieldData.h"
 #include "vtkGenericCell.h"
 #include "vtkCellTreeLocator.h"
 #include "vtkSortDataArray.h"
 #include "vtkPolyDataNormals.h"
 
+#include <cstdio> // rename
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
 
 using namespace mirtk;
 
@@ -99,11 +116,29 @@ void PrintHelp(const char *name)
   DeformableSurfaceModel model; // with default parameters
   cout << endl;
   cout << "Usage: " << name << " <input> <output> [options]" << endl;
+  cout << "       " << name << " -batch <jobs> [-batch-jobs <n>] [options]" << endl;
   cout << endl;
   cout << "Description:" << endl;
   cout << "  Iteratively minimizes a deformable surface model energy functional. The gradient of" << endl;
   cout << "  the energy terms are the internal and external forces of the deformable surface model." << endl;
   cout << endl;
+  cout << "Batch options:" << endl;
+  cout << "  -batch <file>" << endl;
+  cout << "      Deform multiple surfaces within the same images in a single process. Each non-empty" << endl;
+  cout << "      line of the given text file, which does not start with a '#', specifies one job as" << endl;
+  cout << "      whitespace separated <input> and <output> file names followed by options which are" << endl;
+  cout << "      appended to the options given on the command line. Input images are read and" << endl;
+  cout << "      preprocessed only once and shared by all jobs. Options which can be given multiple" << endl;
+  cout << "      times to set per-level parameters must not be given both on the command line and" << endl;
+  cout << "      in the job list. Common options such as :option:`-v`, :option:`-debug`, and" << endl;
+  cout << "      :option:`-threads` apply to all jobs and must be given on the command line." << endl;
+  cout << "      The wall clock time and throughput of each job are reported. A failed job" << endl;
+  cout << "      does not abort the remaining jobs, but the exit code is non-zero." << endl;
+  cout << "  -batch-jobs <n>" << endl;
+  cout << "      Maximum number of :option:`-batch` jobs processed concurrently. When n > 1, the" << endl;
+  cout << "      log output of each job is buffered and written when the job is done, with each" << endl;
+  cout << "      line prefixed by the job number. (default: 1)" << endl;
+  cout << endl;
   cout << "Input options:" << endl;
   cout << "  -initial <file>" << endl;
   cout << "      Point set used to initialize the deformed output mesh. Usually the output of a" << endl;
@@ -135,6 +170,10 @@ void PrintHelp(const char *name)
   cout << "      - ``EulerMethod``:              Forward Euler integration (default)" << endl;
   cout << "      - ``EulerMethodWithDamping``:   Forward Euler integration with momentum." << endl;
   cout << "      - ``EulerMethodWithMomentum``:  Forward Euler integration with momentum." << endl;
+  cout << "      - ``SemiImplicitEulerMethod``:  Euler integration with Laplacian smoothed gradient." << endl;
+  cout << "      - ``AdaptiveRungeKuttaMethod``: Runge-Kutta integration with adaptive time step." << endl;
+  cout << "      - ``FastInertialRelaxationEngine``, ``FIRE``: Damped dynamics with velocity mixing" << endl;
+  cout << "        and adaptive time step which restarts from rest when moving uphill." << endl;
   cout << "      - ``GradientDescent``:          Gradient descent optimizer." << endl;
   cout << "      - ``ConjugateGradientDescent``: Conjugate gradient descent." << endl;
   cout << "  -line-search, -linesearch <name>" << endl;
@@ -148,6 +187,13 @@ void PrintHelp(const char *name)
   cout << "      Momentum of Euler method with momentum, i.e., :math:`1 - damping` (see :option:`-damping`)" << endl;
   cout << "  -mass <value>" << endl;
   cout << "      Node mass used by Euler methods with momentum. (default: 1)" << endl;
+  cout << "  -tolerance <value>" << endl;
+  cout << "      Tolerated local error of node positions of the ``AdaptiveRungeKuttaMethod``" << endl;
+  cout << "      :option:`-optimizer` relative to the maximum node displacement. (default: 0.1)" << endl;
+  cout << "  -implicit-smoothing <value>" << endl;
+  cout << "      Weight of Laplacian smoothing of node displacements solved for by the" << endl;
+  cout << "      ``SemiImplicitEulerMethod`` :option:`-optimizer` at each step. Larger values" << endl;
+  cout << "      permit a larger :option:`-step` when internal forces are strong. (default: 1)" << endl;
   cout << "  -levels <max> | <min> <max>" << endl;
   cout << "      Perform optimization on starting at level <max> until level <min> (> 0)." << endl;
   cout << "      When only the <max> level argument is given, the <min> level is set to 1." << endl;
@@ -176,6 +222,10 @@ void PrintHelp(const char *name)
   cout << "  -remesh-adaptively" << endl;
   cout << "      Remesh surface mesh using an adaptive edge length interval based on local curvature" << endl;
   cout << "      of the deformed surface mesh or input implicit surface (:option:`-distance-image`)." << endl;
+  cout << "  -parallel-remeshing [on|off]\n";
+  cout << "      Remesh surface mesh by concurrent independent edge collapses and splits. The result does" << endl;
+  cout << "      not depend on the number of threads. Triangles are not inverted and this option is" << endl;
+  cout << "      ignored when :option:`-remesh-adaptively` is given. (default: off)" << endl;
   cout << "  -[no]triangle-inversion" << endl;
   cout << "      Whether to allow inversion of pair of triangles during surface remeshing. (default: on)" << endl;
   cout << "  -min-edgelength <value>..." << endl;
@@ -207,6 +257,13 @@ void PrintHelp(const char *name)
   cout << "      This parameter reduces false collision detection between neighboring triangles. (default: " << model.MaxCollisionAngle() << ")" << endl;
   cout << "  -fast-collision-test\n";
   cout << "      Use fast approximate triangle-triangle collision test based on distance of their centers only. (default: off)" << endl;
+  cout << "  -concurrent-terms [on|off]\n";
+  cout << "      Update energy terms and evaluate their gradients concurrently. The gradients are" << endl;
+  cout << "      summed in a fixed order such that the result is reproducible. (default: off)" << endl;
+  cout << "  -active-set [on|off]\n";
+  cout << "      Evaluate the gradient of internal force terms only at active nodes, where passive" << endl;
+  cout << "      nodes are those labeled by the :option:`-min-active` stopping criterion. The result" << endl;
+  cout << "      is identical to evaluating the gradient at all nodes. (default: off)" << endl;
   cout << "  -reset-status" << endl;
   cout << "      Set status of all mesh nodes to active again after each level (see :option:`-levels`). (default: off)" << endl;
   cout << endl;
@@ -356,6 +413,18 @@ void PrintHelp(const char *name)
   cout << "      Write :option:`-debug` output every n-th iteration. (default: 10)" << endl;
   cout << "  -[no]level-prefix" << endl;
   cout << "      Write :option:`-debug` output without level prefix in file names. (default: on)" << endl;
+  cout << "  -trace <file>" << endl;
+  cout << "      Write Chrome trace event JSON file with timings of energy term evaluations and" << endl;
+  cout << "      deformable surface model operations of each iteration, e.g., to be opened with" << endl;
+  cout << "      chrome://tracing or the Perfetto UI. (default: none)" << endl;
+  cout << "  -checkpoint <file>" << endl;
+  cout << "      Write state of Euler integration every :option:`-checkpoint-interval` steps to the" << endl;
+  cout << "      given point set file such that an interrupted execution can be resumed. (default: none)" << endl;
+  cout << "  -checkpoint-interval <n>" << endl;
+  cout << "      Number of integration steps between :option:`-checkpoint` writes. (default: 10)" << endl;
+  cout << "  -resume <file>" << endl;
+  cout << "      Resume interrupted execution from :option:`-checkpoint` file. All other arguments" << endl;
+  cout << "      and options must be identical to those of the interrupted execution. (default: none)" << endl;
   cout << endl;
   cout << "Advanced options:" << endl;
   cout << "  -par <name> <value>" << endl;
@@ -582,6 +651,187 @@ ResampleAtInitialPoints(vtkSmartPointer<vtkPointSet> input, vtkSmartPointer<vtkP
   return resampled;
 }
 
+// -----------------------------------------------------------------------------
+/// Error which aborts the current deform-mesh job
+///
+/// Unlike FatalError, which exits the process, this error only fails the job
+/// in which it occurs, such that the remaining jobs of a batch run complete.
+class JobError : public std::runtime_error
+{
+public:
+
+  JobError(const string &msg) : std::runtime_error(msg) {}
+};
+
+/// Abort current deform-mesh job with the given error message
+#define JobFailed(msg) \
+  do { \
+    std::ostringstream _msg; \
+    _msg << msg; \
+    throw JobError(_msg.str()); \
+  } while (false)
+
+// -----------------------------------------------------------------------------
+/// Writes checkpoint of Euler integration every n-th step
+class CheckpointWriter : public Observer
+{
+  mirtkObjectMacro(CheckpointWriter);
+
+  /// Output file name
+  mirtkPublicAttributeMacro(string, FileName);
+
+  /// Number of integration steps between checkpoints
+  mirtkPublicAttributeMacro(int, Interval);
+
+  /// Current level
+  mirtkPublicAttributeMacro(int, Level);
+
+public:
+
+  /// Constructor
+  CheckpointWriter() : _Interval(10), _Level(0) {}
+
+  /// Write checkpoint at end of every n-th iteration
+  void HandleEvent(Observable *obj, Event event, const void * = nullptr)
+  {
+    if (event != IterationEndEvent || _Interval <= 0) return;
+    const EulerMethod *euler = dynamic_cast<const EulerMethod *>(obj);
+    if (euler == nullptr || euler->StepCount() % _Interval != 0) return;
+
+    vtkSmartPointer<vtkPointSet> checkpoint = euler->Checkpoint();
+    vtkSmartPointer<vtkIntArray> level = vtkSmartPointer<vtkIntArray>::New();
+    level->SetName("Level");
+    level->InsertNextValue(_Level);
+    checkpoint->GetFieldData()->RemoveArray(level->GetName());
+    checkpoint->GetFieldData()->AddArray(level);
+
+    // Write to temporary file first such that an interruption while writing
+    // the checkpoint does not corrupt the previous checkpoint
+    const string ext   = Extension(_FileName);
+    const string fname = _FileName.substr(0, _FileName.length() - ext.length()) + ".tmp" + ext;
+    if (!WritePointSet(fname.c_str(), checkpoint)) {
+      JobFailed("Failed to write checkpoint to " << fname);
+    }
+    if (std::rename(fname.c_str(), _FileName.c_str()) != 0) {
+      JobFailed("Failed to rename checkpoint " << fname << " to " << _FileName);
+    }
+  }
+};
+
+// =============================================================================
+// Batch processing
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+/// Intensity image with optional foreground mask and its registered copy
+struct IntensityImage
+{
+  RegisteredImage::InputImageType input; ///< Input image
+  BinaryImage                     mask;  ///< Foreground mask of input image
+  RegisteredImage                 image; ///< Image used by external forces
+};
+
+// -----------------------------------------------------------------------------
+/// Image shared by the jobs of a batch run
+template <class ImageType>
+struct SharedImageEntry
+{
+  std::once_flag       once;  ///< Whether image was read
+  SharedPtr<ImageType> image; ///< Shared image
+};
+
+// -----------------------------------------------------------------------------
+/// Images and image statistics shared by the jobs of a batch run
+///
+/// Each image is read and preprocessed only once by the first job which needs
+/// it. Shared images must not be modified by any of the jobs thereafter.
+/// The mutex only guards the maps of entries, such that different images
+/// are read concurrently while jobs needing the same image wait for it.
+struct BatchData
+{
+  template <class ImageType>
+  using Images = std::map<string, SharedPtr<SharedImageEntry<ImageType> > >;
+
+  std::mutex                              mutex;
+  Images<IntensityImage>                  intensity_images;
+  Images<BinaryImage>                     masks;
+  Images<RealImage>                       images;
+  ImageEdgeDistance::ImageStatisticsCache edge_statistics;
+};
+
+// -----------------------------------------------------------------------------
+/// Summary of a deform-mesh job
+struct JobSummary
+{
+  int    npoints; ///< Number of output points
+  int    nsteps;  ///< Total number of integration steps
+  double time;    ///< Wall clock time in seconds
+  string error;   ///< Error message of failed job
+
+  JobSummary() : npoints(0), nsteps(0), time(0.) {}
+};
+
+// -----------------------------------------------------------------------------
+/// Get image shared by batch jobs or read it when not read before
+///
+/// \param[in] batch  Data shared by batch jobs or \c nullptr.
+/// \param[in] images Map of shared images of requested type.
+/// \param[in] key    Unique key of preprocessed image, i.e., file names and parameters.
+/// \param[in] read   Function which reads and preprocesses the image.
+template <class ImageType, class ReadFunction>
+SharedPtr<ImageType> SharedImage(BatchData *batch,
+                                 BatchData::Images<ImageType> BatchData::*images,
+                                 const string &key, ReadFunction read)
+{
+  if (batch) {
+    SharedPtr<SharedImageEntry<ImageType> > entry;
+    {
+      std::lock_guard<std::mutex> lock(batch->mutex);
+      auto &cached = (batch->*images)[key];
+      if (!cached) cached = NewShared<SharedImageEntry<ImageType> >();
+      entry = cached;
+    }
+    // When read throws, the next job which needs the image tries again
+    std::call_once(entry->once, [&entry, &read]() {
+      SharedPtr<ImageType> image = NewShared<ImageType>();
+      read(*image);
+      entry->image = image;
+    });
+    return entry->image;
+  }
+  SharedPtr<ImageType> image = NewShared<ImageType>();
+  read(*image);
+  return image;
+}
+
+// -----------------------------------------------------------------------------
+/// Read binary mask resampled on common image lattice (if any)
+SharedPtr<BinaryImage> ReadSharedMask(BatchData *batch, const char *fname,
+                                      const ImageAttributes &attr, const string &lattice)
+{
+  const string key = string(fname) + "|" + lattice;
+  return SharedImage(batch, &BatchData::masks, key, [&](BinaryImage &mask) {
+    mask.Read(fname);
+    if (attr && !mask.Attributes().EqualInSpace(attr)) {
+      ResampleMask(mask, attr);
+    }
+  });
+}
+
+// -----------------------------------------------------------------------------
+/// Read image resampled on common image lattice (if any)
+SharedPtr<RealImage> ReadSharedImage(BatchData *batch, const char *fname,
+                                     const ImageAttributes &attr, const string &lattice)
+{
+  const string key = string(fname) + "|" + lattice;
+  return SharedImage(batch, &BatchData::images, key, [&](RealImage &image) {
+    image.Read(fname);
+    if (attr && !image.Attributes().EqualInSpace(attr)) {
+      ResampleImage(image, attr);
+    }
+  });
+}
+
 // =============================================================================
 // Main
 // =============================================================================
@@ -597,29 +847,35 @@ ResampleAtInitialPoints(vtkSmartPointer<vtkPointSet> input, vtkSmartPointer<vtkP
   nlevels = max(nlevels, static_cast<int>((name).size()))
 
 // -----------------------------------------------------------------------------
-int main(int argc, char *argv[])
+/// Deform input surface mesh
+///
+/// \param[in]  argc    Number of command arguments.
+/// \param[in]  argv    Command arguments.
+/// \param[in]  batch   Data shared by batch jobs or \c nullptr.
+/// \param[out] summary Summary of deformation (optional).
+/// \param[out] out     Output stream of progress and log messages.
+///
+/// \returns Exit code of command.
+int DeformMesh(int argc, char *argv[], BatchData *batch = nullptr,
+               JobSummary *summary = nullptr, ostream &out = cout)
 {
   FileOption output_fopt = FO_Default;
 
-  verbose = 1; // default verbosity level
   EXPECTS_POSARGS(2);
 
-  // Initialize libraries / object factories
-  InitializeIOLibrary();
-  InitializeNumericsLibrary();
-  InitializeDeformableLibrary();
-  InitializeTransformationLibrary();
-
   // Deformable surface model and default optimizer
   UniquePtr<Transformation> dof;
   DeformableSurfaceModel    model;
-  DeformableSurfaceLogger   logger;
+  DeformableSurfaceLogger   logger(&out);
   DeformableSurfaceDebugger debugger(&model);
+  DeformableSurfaceTracer   tracer;
+  CheckpointWriter          checkpointer;
   UniquePtr<LocalOptimizer> optimizer(new EulerMethod(&model));
   ParameterList             params;
 
   // Read input point set
   vtkSmartPointer<vtkPointSet> input = ReadPointSet(POSARG(1), output_fopt);
+  if (input == nullptr) JobFailed("Failed to read input point set " << POSARG(1));
   vtkPointData * const inputPD = input->GetPointData();
   vtkCellData  * const inputCD = input->GetCellData();
   ImageAttributes domain = PointSetDomain(input);
@@ -687,6 +943,9 @@ int main(int argc, char *argv[])
   bool        track_use_median  = false;   // use median instead of mean for normalization
   const char *initial_name      = nullptr;
   const char *debug_prefix      = "deform-mesh_";
+  const char *trace_name        = nullptr;
+  const char *checkpoint_name   = nullptr;
+  const char *resume_name       = nullptr;
   double      padding           = NaN;
   bool        level_prefix      = true;
   bool        reset_status      = false;
@@ -819,9 +1078,20 @@ int main(int argc, char *argv[])
     // Optimization method
     unknown_option = false;
     if (OPTION("-optimizer") || OPTION("-optimiser")) {
+      const char *arg = ARGUMENT;
       OptimizationMethod m;
-      PARSE_ARGUMENT(m);
-      optimizer.reset(LocalOptimizer::New(m, &model));
+      if (strcmp(arg, SemiImplicitEulerMethod::NameOfType()) == 0) {
+        optimizer.reset(new SemiImplicitEulerMethod(&model));
+      } else if (strcmp(arg, AdaptiveRungeKuttaMethod::NameOfType()) == 0) {
+        optimizer.reset(new AdaptiveRungeKuttaMethod(&model));
+      } else if (strcmp(arg, FastInertialRelaxationEngine::NameOfType()) == 0 ||
+                 strcmp(arg, "FIRE") == 0) {
+        optimizer.reset(new FastInertialRelaxationEngine(&model));
+      } else if (FromString(arg, m)) {
+        optimizer.reset(LocalOptimizer::New(m, &model));
+      } else {
+        JobFailed("Invalid -optimizer argument: " << arg);
+      }
     }
     else if (OPTION("-line-search") || OPTION("-linesearch")) {
       Insert(params, "Line search strategy", ARGUMENT);
@@ -848,7 +1118,7 @@ int main(int argc, char *argv[])
       } else {
         TransformationType type = Transformation::TypeOfClass(arg.c_str());
         if (type == TRANSFORMATION_UNKNOWN) {
-          FatalError("Invalid -dof transformation type argument: " << arg);
+          JobFailed("Invalid -dof transformation type argument: " << arg);
         }
         dof.reset(Transformation::New(type));
       }
@@ -864,7 +1134,7 @@ int main(int argc, char *argv[])
         min_level = 1;
       }
       if (min_level < 1 || max_level < 1) {
-        FatalError("Invalid -levels argument");
+        JobFailed("Invalid -levels argument");
       }
       navgs   = GradientAveraging(min_level, max_level);
       nlevels = max(nlevels, static_cast<int>(navgs.size()));
@@ -898,6 +1168,8 @@ int main(int argc, char *argv[])
     else if (OPTION("-damping"))   Insert(params, "Deformable surface damping", ARGUMENT);
     else if (OPTION("-momentum"))  Insert(params, "Deformable surface momentum", ARGUMENT);
     else if (OPTION("-mass"))      Insert(params, "Deformable surface mass", ARGUMENT);
+    else if (OPTION("-implicit-smoothing")) Insert(params, "Implicit smoothing", ARGUMENT);
+    else if (OPTION("-tolerance")) Insert(params, "Integration error tolerance", ARGUMENT);
     else if (OPTION("-epsilon"))   Insert(params, "Epsilon", ARGUMENT);
     else if (OPTION("-delta")) {
       PARSE_ARGUMENTS(double, delta);
@@ -909,12 +1181,12 @@ int main(int argc, char *argv[])
       do {
         string value, units = ValueUnits(ARGUMENT, &value);
         if (!FromString(value, farg)) {
-          FatalError("Invalid -min-active value: " << value);
+          JobFailed("Invalid -min-active value: " << value);
         }
         if (units == "%") {
           farg /= 100.;
         } else if (!units.empty()) {
-          FatalError("Invalid -min-active units: " << units);
+          JobFailed("Invalid -min-active units: " << units);
         }
         min_active_thres.push_back(farg);
       } while (HAS_ARGUMENT);
@@ -1172,7 +1444,7 @@ int main(int argc, char *argv[])
         stretching.RestLength(farg);
         stretching.UseCurrentAverageLength(false);
       } else {
-        FatalError("Invalid -stretching-rest-length argument: " << arg);
+        JobFailed("Invalid -stretching-rest-length argument: " << arg);
       }
     }
     else if (OPTION("-repulsion")) {
@@ -1220,6 +1492,14 @@ int main(int argc, char *argv[])
     else if (OPTION("-remesh-adaptively")) {
       model.RemeshAdaptively(true);
     }
+    else if (OPTION("-parallel-remeshing")) {
+      if (HAS_ARGUMENT) PARSE_ARGUMENT(barg);
+      else barg = true;
+      model.ParallelRemeshing(barg);
+    }
+    else if (OPTION("-noparallel-remeshing")) {
+      model.ParallelRemeshing(false);
+    }
     else if (OPTION("-min-edge-length") || OPTION("-min-edgelength") || OPTION("-minedgelength")) {
       PARSE_ARGUMENTS(double, min_edge_length);
     }
@@ -1292,6 +1572,22 @@ int main(int argc, char *argv[])
     else if (OPTION("-nofast-collision-test")) {
       model.FastCollisionTest(false);
     }
+    else if (OPTION("-concurrent-terms")) {
+      if (HAS_ARGUMENT) PARSE_ARGUMENT(barg);
+      else barg = true;
+      model.ConcurrentTerms(barg);
+    }
+    else if (OPTION("-noconcurrent-terms")) {
+      model.ConcurrentTerms(false);
+    }
+    else if (OPTION("-active-set")) {
+      if (HAS_ARGUMENT) PARSE_ARGUMENT(barg);
+      else barg = true;
+      model.ActiveSet(barg);
+    }
+    else if (OPTION("-noactive-set")) {
+      model.ActiveSet(false);
+    }
     else {
       unknown_option = true;
     }
@@ -1373,29 +1669,86 @@ int main(int argc, char *argv[])
       PARSE_ARGUMENT(iarg);
       debugger.Interval(iarg);
     }
+    else if (OPTION("-trace")) {
+      trace_name = ARGUMENT;
+    }
+    else if (OPTION("-checkpoint")) {
+      checkpoint_name = ARGUMENT;
+    }
+    else if (OPTION("-checkpoint-interval")) {
+      PARSE_ARGUMENT(iarg);
+      checkpointer.Interval(iarg);
+    }
+    else if (OPTION("-resume")) {
+      resume_name = ARGUMENT;
+    }
     else HANDLE_POINTSETIO_OPTION(output_fopt);
     else {
       unknown_option = true;
     }
     if (!unknown_option) continue;
 
+    // Common options modify process-wide settings, which are shared by the
+    // jobs of a batch run. These are therefore parsed only once by RunBatch.
+    if (batch) JobFailed("Unknown option: " << OPTNAME);
+
     // Common or unknown option
     HANDLE_COMMON_OR_UNKNOWN_OPTION();
   }
 
-  if (debug   < 0) debug   = 0;
-  if (verbose < 0) verbose = 0;
+  if (!batch) {
+    if (debug   < 0) debug   = 0;
+    if (verbose < 0) verbose = 0;
+  }
 
   if (!image_name) {
     if (dedges.Weight() != 0.) {
       image_name = t2w_image_name;
     } else if (t1w_image_name && t2w_image_name) {
-      FatalError("Not both T1-w and T2-w images used, specify only one or use -image option");
+      JobFailed("Not both T1-w and T2-w images used, specify only one or use -image option");
     } else {
       image_name = (t1w_image_name ? t1w_image_name : t2w_image_name);
     }
   }
 
+  // Read checkpoint of interrupted execution
+  //
+  // When the surface was remeshed before the checkpoint was written, the input
+  // mesh is replaced by the remeshed surface with initial point positions as
+  // done by DeformableSurfaceModel::Remesh. The deformed points and integration
+  // state are restored by the Euler method when resuming the integration.
+  vtkSmartPointer<vtkPointSet> checkpoint;
+  int resume_level = -1;
+  if (resume_name) {
+    checkpoint = ReadPointSet(resume_name);
+    vtkDataArray * const level = checkpoint->GetFieldData()->GetArray("Level");
+    if (level == nullptr || level->GetNumberOfTuples() == 0) {
+      JobFailed("Checkpoint " << resume_name << " has no Level field data array");
+    }
+    resume_level = static_cast<int>(level->GetComponent(0, 0));
+    if (resume_level < 0 || resume_level >= nlevels) {
+      JobFailed("Checkpoint " << resume_name << " was written at level " << resume_level + 1
+                 << ", but number of levels is " << nlevels);
+    }
+    vtkDataArray * const initial_points = checkpoint->GetPointData()->GetArray("InitialPoints");
+    if (initial_points) {
+      if (strcmp(input->GetClassName(), checkpoint->GetClassName()) != 0) {
+        JobFailed("Checkpoint " << resume_name << " has different type than input point set");
+      }
+      vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
+      points->SetDataType(input->GetPoints()->GetDataType());
+      points->SetNumberOfPoints(checkpoint->GetNumberOfPoints());
+      for (vtkIdType ptId = 0; ptId < checkpoint->GetNumberOfPoints(); ++ptId) {
+        points->SetPoint(ptId, initial_points->GetTuple(ptId));
+      }
+      input->DeepCopy(checkpoint);
+      input->SetPoints(points);
+      input->GetFieldData()->Initialize();
+    } else if (checkpoint->GetNumberOfPoints() != input->GetNumberOfPoints()) {
+      JobFailed("Checkpoint " << resume_name << " has differing number of points");
+    }
+  }
+
   double nspring = .5 * (spring.InwardNormalWeight() + spring.OutwardNormalWeight());
   if (spring.Weight() == .0) { // no -spring, but -nspring and/or -tspring
     spring.Weight(nspring + spring.TangentialWeight());
@@ -1409,10 +1762,10 @@ int main(int argc, char *argv[])
     spring.Weight(.0);
   }
   if ((balloon.Weight() || edges.Weight()) && !image_name) {
-    FatalError("Input -image required by external forces!");
+    JobFailed("Input -image required by external forces!");
   }
   if (distance.Weight() && !dmap_name) {
-    FatalError("Input -distance-map required by external -distance forces!");
+    JobFailed("Input -distance-map required by external -distance forces!");
   }
 
   string dmagnitude;
@@ -1444,121 +1797,117 @@ int main(int argc, char *argv[])
   // Common image attributes
   const bool force_update = true; // named variable for better readability
   ImageAttributes attr;
+  string lattice; // key of image defining the common image attributes
 
   // Read input image
-  RegisteredImage::InputImageType input_image;
-  BinaryImage image_mask;
-  RegisteredImage image;
+  SharedPtr<IntensityImage> image;
   if (image_name) {
-    input_image.Read(image_name);
-    attr = input_image.Attributes();
-    input_image.PutBackgroundValueAsDouble(padding, true);
-    if (mask_name) {
-      image_mask.Read(mask_name);
-      if (!image_mask.Attributes().EqualInSpace(attr)) {
-        ResampleMask(image_mask, attr);
+    lattice = string(image_name) + "|" + (mask_name ? mask_name : "") + "|" + ToString(padding);
+    image = SharedImage(batch, &BatchData::intensity_images, lattice, [&](IntensityImage &entry) {
+      entry.input.Read(image_name);
+      const ImageAttributes image_attr = entry.input.Attributes();
+      entry.input.PutBackgroundValueAsDouble(padding, true);
+      if (mask_name) {
+        entry.mask.Read(mask_name);
+        if (!entry.mask.Attributes().EqualInSpace(image_attr)) {
+          ResampleMask(entry.mask, image_attr);
+        }
+        entry.input.PutMask(&entry.mask);
       }
-      input_image.PutMask(&image_mask);
-    }
-    image.InputImage(&input_image);
-    image.Initialize(attr);
-    image.Update(true, false, false, force_update);
-    image.SelfUpdate(false);
-    model.Image(&image);
+      entry.image.InputImage(&entry.input);
+      entry.image.Initialize(image_attr);
+      entry.image.Update(true, false, false, force_update);
+      entry.image.SelfUpdate(false);
+    });
+    attr = image->input.Attributes();
+    model.Image(&image->image);
   }
 
   // Read implicit surface distance map
-  RegisteredImage::InputImageType input_dmap;
-  RegisteredImage dmap;
+  //
+  // The distance map is modified at each level when distance offsets are
+  // given and can therefore not be shared by the jobs of a batch run.
+  SharedPtr<IntensityImage> dmap;
   if (dmap_name) {
-    input_dmap.Read(dmap_name);
-    if (attr) {
-      if (!input_dmap.Attributes().EqualInSpace(attr)) {
-        ResampleImage(input_dmap, attr);
+    const string key = string(dmap_name) + "|" + lattice;
+    dmap = SharedImage(dmap_offsets.empty() ? batch : nullptr, &BatchData::intensity_images, key,
+                       [&](IntensityImage &entry) {
+      entry.input.Read(dmap_name);
+      ImageAttributes dmap_attr = attr;
+      if (dmap_attr) {
+        if (!entry.input.Attributes().EqualInSpace(dmap_attr)) {
+          ResampleImage(entry.input, dmap_attr);
+        }
+      } else {
+        dmap_attr = entry.input.Attributes();
       }
-    } else {
-      attr = input_dmap.Attributes();
-    }
-    dmap.InputImage(&input_dmap);
-    dmap.Initialize(attr);
-    dmap.Update(true, false, false, force_update);
-    dmap.SelfUpdate(false);
-    model.ImplicitSurface(&dmap);
+      entry.image.InputImage(&entry.input);
+      entry.image.Initialize(dmap_attr);
+      entry.image.Update(true, false, false, force_update);
+      entry.image.SelfUpdate(false);
+    });
+    if (!attr) {
+      attr    = dmap->image.Attributes();
+      lattice = key;
+    }
+    model.ImplicitSurface(&dmap->image);
   }
 
   // Read implicit surface distance force magnitude map
-  RegisteredImage::InputImageType input_dmag;
-  RegisteredImage dmag;
+  SharedPtr<IntensityImage> dmag;
   if (dmag_name) {
-    input_dmag.Read(dmag_name);
-    if (attr && !input_dmag.Attributes().EqualInSpace(attr)) {
-      ResampleImage(input_dmag, attr);
-    }
-    dmag.InputImage(&input_dmag);
-    dmag.Initialize(input_dmag.Attributes());
-    dmag.Update(true, false, false, force_update);
-    dmag.SelfUpdate(false);
-    distance.MagnitudeImage(&dmag);
+    const string key = string(dmag_name) + "|" + lattice;
+    dmag = SharedImage(batch, &BatchData::intensity_images, key, [&](IntensityImage &entry) {
+      entry.input.Read(dmag_name);
+      if (attr && !entry.input.Attributes().EqualInSpace(attr)) {
+        ResampleImage(entry.input, attr);
+      }
+      entry.image.InputImage(&entry.input);
+      entry.image.Initialize(entry.input.Attributes());
+      entry.image.Update(true, false, false, force_update);
+      entry.image.SelfUpdate(false);
+    });
+    distance.MagnitudeImage(&dmag->image);
     distance.InvertMagnitude(false);
     distance.NormalizeMagnitude(false);
   }
 
   // Read foreground mask of balloon force
-  BinaryImage balloon_mask;
+  SharedPtr<BinaryImage> balloon_mask;
   if (balloon_mask_name) {
-    balloon_mask.Read(balloon_mask_name);
-    if (attr && !balloon_mask.Attributes().EqualInSpace(attr)) {
-      ResampleMask(balloon_mask, attr);
-    }
-    balloon.ForegroundMask(&balloon_mask);
+    balloon_mask = ReadSharedMask(batch, balloon_mask_name, attr, lattice);
+    balloon.ForegroundMask(balloon_mask.get());
   }
 
   // Read tissue masks of image edge distance force
-  BinaryImage wm_mask, gm_mask;
-  RealImage t1w_image, cortex_dmap, vents_dmap, cerebellum_dmap;
+  SharedPtr<BinaryImage> wm_mask, gm_mask;
+  SharedPtr<RealImage> t1w_image, cortex_dmap, vents_dmap, cerebellum_dmap;
   if (dedges.Weight() != 0.) {
     if (t1w_image_name) {
-      t1w_image.Read(t1w_image_name);
-      if (attr && !t1w_image.Attributes().EqualInSpace(attr)) {
-        ResampleImage(t1w_image, attr);
-      }
-      dedges.T1WeightedImage(&t1w_image);
+      t1w_image = ReadSharedImage(batch, t1w_image_name, attr, lattice);
+      dedges.T1WeightedImage(t1w_image.get());
     }
     if (wm_mask_name) {
-      wm_mask.Read(wm_mask_name);
-      if (attr && !wm_mask.Attributes().EqualInSpace(attr)) {
-        ResampleMask(wm_mask, attr);
-      }
-      dedges.WhiteMatterMask(&wm_mask);
+      wm_mask = ReadSharedMask(batch, wm_mask_name, attr, lattice);
+      dedges.WhiteMatterMask(wm_mask.get());
     }
     if (gm_mask_name) {
-      gm_mask.Read(gm_mask_name);
-      if (attr && !gm_mask.Attributes().EqualInSpace(attr)) {
-        ResampleMask(gm_mask, attr);
-      }
-      dedges.GreyMatterMask(&gm_mask);
+      gm_mask = ReadSharedMask(batch, gm_mask_name, attr, lattice);
+      dedges.GreyMatterMask(gm_mask.get());
     }
     if (cortex_dmap_name) {
-      cortex_dmap.Read(cortex_dmap_name);
-      if (attr && !cortex_dmap.Attributes().EqualInSpace(attr)) {
-        ResampleImage(cortex_dmap, attr);
-      }
-      dedges.CorticalHullDistance(&cortex_dmap);
+      cortex_dmap = ReadSharedImage(batch, cortex_dmap_name, attr, lattice);
+      dedges.CorticalHullDistance(cortex_dmap.get());
     }
     if (vents_dmap_name) {
-      vents_dmap.Read(vents_dmap_name);
-      if (attr && !vents_dmap.Attributes().EqualInSpace(attr)) {
-        ResampleImage(vents_dmap, attr);
-      }
-      dedges.VentriclesDistance(&vents_dmap);
+      vents_dmap = ReadSharedImage(batch, vents_dmap_name, attr, lattice);
+      dedges.VentriclesDistance(vents_dmap.get());
     }
     if (cerebellum_dmap_name) {
-      cerebellum_dmap.Read(cerebellum_dmap_name);
-      if (attr && !cerebellum_dmap.Attributes().EqualInSpace(attr)) {
-        ResampleImage(cerebellum_dmap, attr);
-      }
-      dedges.CerebellumDistance(&cerebellum_dmap);
+      cerebellum_dmap = ReadSharedImage(batch, cerebellum_dmap_name, attr, lattice);
+      dedges.CerebellumDistance(cerebellum_dmap.get());
     }
+    if (batch) dedges.SharedImageStatistics(&batch->edge_statistics);
   }
 
   // Add energy terms
@@ -1603,7 +1952,7 @@ int main(int argc, char *argv[])
       ok = false;
     }
   }
-  if (!ok) cout << endl;
+  if (!ok) out << endl;
 
   // Rename spring terms (after setting of parameters!)
   if (spring.Weight()) {
@@ -1638,11 +1987,11 @@ int main(int argc, char *argv[])
   // of the output by those of the previous output mesh (-initial argument).
   if (initial_name) {
     if (model.Transformation()) {
-      FatalError("Option -initial not allowed when optimizing a parametric deformation!");
+      JobFailed("Option -initial not allowed when optimizing a parametric deformation!");
     }
     vtkSmartPointer<vtkPointSet> initial = ReadPointSet(initial_name);
     if (initial->GetNumberOfPoints() != output->GetNumberOfPoints()) {
-      FatalError("Point set with initial deformed mesh points has differing number of points");
+      JobFailed("Point set with initial deformed mesh points has differing number of points");
     }
     output->GetPoints()->DeepCopy(initial->GetPoints());
   }
@@ -1677,7 +2026,7 @@ int main(int argc, char *argv[])
         current_status->SetComponent(ptId, 0, 0.);
       }
     } else {
-      FatalError("Option -fix-boundary currenly only supported for surface meshes!");
+      JobFailed("Option -fix-boundary currenly only supported for surface meshes!");
     }
   }
 
@@ -1688,6 +2037,11 @@ int main(int argc, char *argv[])
   optimizer->Function(&model);
   optimizer->Initialize();
 
+  if ((checkpoint_name || resume_name) && (euler == nullptr || model.Transformation() != nullptr)) {
+    JobFailed("Options -checkpoint and -resume can only be used with an Euler method as -optimizer\n"
+        "       to directly deform a surface mesh without a parametric transformation (no input -dof).");
+  }
+
   if (gd) {
     InexactLineSearch *linesearch;
     BrentLineSearch   *brentls;
@@ -1724,7 +2078,7 @@ int main(int argc, char *argv[])
   // (i.e., sulcal depth measure in case of surface -inflation)
   if (track_name) {
     if (euler == NULL || model.Transformation() != NULL || !IsSurfaceMesh(output)) {
-      FatalError("Option -track can currently only be used with an Euler method as -optimizer to\n"
+      JobFailed("Option -track can currently only be used with an Euler method as -optimizer to\n"
           "       directly deform a surface mesh without a parametric transformation (no input -dof).");
     }
     vtkSmartPointer<vtkDataArray> track_array;
@@ -1745,7 +2099,7 @@ int main(int argc, char *argv[])
   const double distortion_weight = distortion.Weight();
 
   if (verbose > 0) {
-    cout << endl;
+    out << endl;
     logger.Verbosity(verbose - 1);
     optimizer->AddObserver(logger);
   }
@@ -1753,14 +2107,26 @@ int main(int argc, char *argv[])
     debugger.Prefix(debug_prefix);
     optimizer->AddObserver(debugger);
   }
+  if (trace_name) {
+    model.Tracer(&tracer);
+    optimizer->AddObserver(tracer);
+  }
+  if (checkpoint_name) {
+    checkpointer.FileName(checkpoint_name);
+    optimizer->AddObserver(checkpointer);
+  }
 
+  int nsteps_total = 0;
   for (int level = 0; level < nlevels; ++level) {
 
+    // Skip levels completed before checkpoint was written
+    if (level < resume_level) continue;
+
     // Apply current distance-offset
     if (dmap_name && !dmap_offsets.empty()) {
-      input_dmap.Read(dmap_name);
-      input_dmap -= ParameterValue(level, nlevels, dmap_offsets, 0.);
-      dmap.Update(true, false, false, force_update);
+      dmap->input.Read(dmap_name);
+      dmap->input -= ParameterValue(level, nlevels, dmap_offsets, 0.);
+      dmap->image.Update(true, false, false, force_update);
     }
 
     // Set number of integration steps and length of each step
@@ -1806,7 +2172,7 @@ int main(int argc, char *argv[])
     }
 
     // Stopping criteria
-    if (level > 0 && reset_status) {
+    if (level > 0 && reset_status && level != resume_level) {
       vtkPointSet  * const output = model.Output();
       vtkDataArray * const status = output->GetPointData()->GetArray("Status");
       if (status) {
@@ -1825,28 +2191,28 @@ int main(int argc, char *argv[])
 
     // Debug/log output
     if (verbose > 0) {
-      cout << "Level " << (level + 1) << " out of " << nlevels << "\n";
+      out << "Level " << (level + 1) << " out of " << nlevels << "\n";
     }
     if (verbose > 1) {
-      cout << "\n";
-      PrintParameter(cout, "Maximum no. of steps", optimizer->NumberOfSteps());
-      PrintParameter(cout, "Maximum length of steps", dt);
-      PrintParameter(cout, "No. of gradient averaging steps", navg);
+      out << "\n";
+      PrintParameter(out, "Maximum no. of steps", optimizer->NumberOfSteps());
+      PrintParameter(out, "Maximum length of steps", dt);
+      PrintParameter(out, "No. of gradient averaging steps", navg);
       if (model.RemeshInterval() > 0) {
-        PrintParameter(cout, "Minimum edge length", model.MinEdgeLength());
-        PrintParameter(cout, "Maximum edge length", model.MaxEdgeLength());
-        PrintParameter(cout, "Minimum edge angle",  model.MinFeatureAngle());
-        PrintParameter(cout, "Maximum edge angle",  model.MaxFeatureAngle());
+        PrintParameter(out, "Minimum edge length", model.MinEdgeLength());
+        PrintParameter(out, "Maximum edge length", model.MaxEdgeLength());
+        PrintParameter(out, "Minimum edge angle",  model.MinFeatureAngle());
+        PrintParameter(out, "Maximum edge angle",  model.MaxFeatureAngle());
       }
       if (inflate_brain) {
-        PrintParameter(cout, "Distortion weight", distortion.Weight());
+        PrintParameter(out, "Distortion weight", distortion.Weight());
       }
       if (repulsion.Weight()) {
-        PrintParameter(cout, "Repulsion frontface radius", repulsion.FrontfaceRadius());
-        PrintParameter(cout, "Repulsion backface radius",  repulsion.BackfaceRadius());
+        PrintParameter(out, "Repulsion frontface radius", repulsion.FrontfaceRadius());
+        PrintParameter(out, "Repulsion backface radius",  repulsion.BackfaceRadius());
       }
     }
-    cout << endl;
+    out << endl;
     if (level_prefix) {
       char prefix[64];
       snprintf(prefix, 64, "%slevel_%d_", debug_prefix, level + 1);
@@ -1855,8 +2221,11 @@ int main(int argc, char *argv[])
     }
 
     // Perform optimization at current level
+    checkpointer.Level(level);
+    if (level == resume_level) euler->Resume(checkpoint);
     optimizer->Run();
-    if (verbose > 0) cout << endl;
+    if (euler) nsteps_total += euler->StepCount();
+    if (verbose > 0) out << endl;
   }
 
   optimizer->ClearObservers();
@@ -1912,10 +2281,216 @@ int main(int argc, char *argv[])
   // Scale output surface to match input area
   if (match_area) Scale(output, sqrt(Area(input) / Area(output)));
 
+  // Write trace of deformable surface model run
+  if (trace_name) {
+    model.Tracer(nullptr);
+    if (!tracer.Write(trace_name)) {
+      JobFailed("Failed to write trace to " << trace_name);
+    }
+  }
+
   // Write deformed output surface
   if (!WritePointSet(POSARG(2), output, output_fopt)) {
-    FatalError("Failed to write output to file " << output);
+    JobFailed("Failed to write output to file " << output);
+  }
+
+  if (summary) {
+    summary->npoints = static_cast<int>(output->GetNumberOfPoints());
+    summary->nsteps  = nsteps_total;
+  }
+  return 0;
+}
+
+// -----------------------------------------------------------------------------
+/// Whether argument is the name of a common option which modifies process-wide settings
+bool IsCommonOption(const string &arg)
+{
+  static const char * const names[] = {
+    "-h", "-help", "-version", "-revision", "-v", "-verbose", "-debug",
+    "-debug-time", "-profile", "-threads"
+  };
+  for (auto name : names) {
+    if (arg == name) return true;
+  }
+  return false;
+}
+
+// -----------------------------------------------------------------------------
+/// Whether argument is a value of a preceding common option
+bool IsCommonOptionArgument(const string &arg)
+{
+  double value;
+  return !arg.empty() && (arg[0] != '-' || FromString(arg.c_str(), value));
+}
+
+// -----------------------------------------------------------------------------
+/// Parse common options given on the command line of a batch run
+void ParseCommonOptions(int argc, char *argv[])
+{
+  EXPECTS_POSARGS(0);
+
+  for (ALL_OPTIONS) {
+    HANDLE_COMMON_OR_UNKNOWN_OPTION();
+  }
+
+  if (debug   < 0) debug   = 0;
+  if (verbose < 0) verbose = 0;
+}
+
+// -----------------------------------------------------------------------------
+/// Process jobs listed in -batch file
+///
+/// Common options are parsed once before any job is started and must not be
+/// given in the job list. A job which fails is reported as such, and the
+/// remaining jobs are processed nonetheless.
+int RunBatch(int argc, char *argv[])
+{
+  const char *jobs_name = nullptr;
+  int         max_jobs  = 1;
+  Array<string> options, common_options(1, argv[0]);
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "-batch") == 0) {
+      if (i + 1 == argc) FatalError("Option -batch requires a file name argument");
+      jobs_name = argv[++i];
+    } else if (strcmp(argv[i], "-batch-jobs") == 0) {
+      if (i + 1 == argc || !FromString(argv[i + 1], max_jobs) || max_jobs < 1) {
+        FatalError("Option -batch-jobs requires a positive number as argument");
+      }
+      ++i;
+    } else if (IsCommonOption(argv[i])) {
+      common_options.push_back(argv[i]);
+      while (i + 1 < argc && IsCommonOptionArgument(argv[i + 1])) {
+        common_options.push_back(argv[++i]);
+      }
+    } else {
+      options.push_back(argv[i]);
+    }
+  }
+  if (common_options.size() > 1) {
+    Array<char *> common_argv;
+    for (auto &arg : common_options) common_argv.push_back(const_cast<char *>(arg.c_str()));
+    common_argv.push_back(nullptr);
+    ParseCommonOptions(static_cast<int>(common_options.size()), common_argv.data());
+  }
+
+  // Read job list
+  Array<Array<string> > jobs;
+  std::ifstream ifs(jobs_name);
+  if (!ifs) FatalError("Failed to open job list " << jobs_name);
+  string line;
+  for (int lineno = 1; std::getline(ifs, line); ++lineno) {
+    std::istringstream is(line);
+    Array<string> args;
+    string arg;
+    while (is >> arg) args.push_back(arg);
+    if (args.empty() || args[0][0] == '#') continue;
+    if (args.size() < 2) {
+      FatalError("Job on line " << lineno << " of " << jobs_name << " requires <input> and <output> file names");
+    }
+    for (size_t i = 2; i < args.size(); ++i) {
+      if (IsCommonOption(args[i])) {
+        FatalError("Job on line " << lineno << " of " << jobs_name << " sets common option " << args[i]
+                   << ", which must be given on the command line instead");
+      }
+    }
+    Array<string> job;
+    job.reserve(1 + args.size() + options.size());
+    job.push_back(argv[0]);
+    job.push_back(args[0]);
+    job.push_back(args[1]);
+    job.insert(job.end(), options.begin(), options.end());
+    job.insert(job.end(), args.begin() + 2, args.end());
+    jobs.push_back(job);
+  }
+  const int njobs = static_cast<int>(jobs.size());
+
+  // Process jobs
+  BatchData         batch;
+  Array<JobSummary> summaries(njobs);
+  Array<int>        status(njobs, 1);
+  std::atomic<int>  next(0);
+  std::mutex        report_mutex;
+
+  // Output of each job is buffered and written as one block when the job is
+  // done, with each line prefixed by the job number, such that the output of
+  // jobs processed concurrently is not interleaved
+  auto process = [&]() {
+    for (int i = next++; i < njobs; i = next++) {
+      Array<char *> job_argv;
+      for (auto &arg : jobs[i]) job_argv.push_back(const_cast<char *>(arg.c_str()));
+      job_argv.push_back(nullptr);
+      std::ostringstream job_out;
+      const auto start = std::chrono::steady_clock::now();
+      try {
+        status[i] = DeformMesh(static_cast<int>(jobs[i].size()), job_argv.data(),
+                               &batch, &summaries[i], max_jobs > 1 ? job_out : cout);
+      } catch (const std::exception &e) {
+        summaries[i].error = e.what();
+        status[i] = 1;
+      }
+      summaries[i].time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      const JobSummary &summary = summaries[i];
+      std::lock_guard<std::mutex> lock(report_mutex);
+      std::istringstream job_lines(job_out.str());
+      string job_line;
+      while (std::getline(job_lines, job_line)) {
+        cout << "[Job " << (i + 1) << "] " << job_line << "\n";
+      }
+      cout << "Job " << (i + 1) << " of " << njobs << ": " << jobs[i][2];
+      if (status[i] != 0) {
+        cout << " failed";
+        if (!summary.error.empty()) cout << ": " << summary.error;
+        cout << endl;
+      } else {
+        cout << ", " << summary.npoints << " points, " << summary.nsteps << " steps in "
+             << summary.time << " s";
+        if (summary.time > 0.) {
+          cout << " (" << static_cast<double>(summary.npoints) * summary.nsteps / summary.time
+               << " point updates/s)";
+        }
+        cout << endl;
+      }
+    }
+  };
+
+  const auto start = std::chrono::steady_clock::now();
+  if (max_jobs > 1) {
+    Array<std::thread> threads;
+    for (int n = 0; n < min(max_jobs, njobs); ++n) threads.push_back(std::thread(process));
+    for (auto &thread : threads) thread.join();
+  } else {
+    process();
   }
+  const double time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  cout << "Processed " << njobs << " jobs in " << time << " s";
+  if (time > 0.) cout << " (" << njobs / time << " jobs/s)";
+  cout << endl;
 
+  for (int i = 0; i < njobs; ++i) {
+    if (status[i] != 0) return 1;
+  }
   return 0;
 }
+
+// -----------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+  verbose = 1; // default verbosity level
+
+  // Initialize libraries / object factories
+  InitializeIOLibrary();
+  InitializeNumericsLibrary();
+  InitializeDeformableLibrary();
+  InitializeTransformationLibrary();
+
+  // Process batch of jobs or single input mesh
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "-batch") == 0) return RunBatch(argc, argv);
+  }
+  try {
+    return DeformMesh(argc, argv);
+  } catch (const JobError &e) {
+    cerr << e.what() << endl;
+    return 1;
+  }
+}